@@ -0,0 +1,170 @@
+/**
+ * @file Body.h
+ * @brief State of one airfoil of a (possibly multi-body) configuration and the velocities it induces.
+ *
+ * Every body carries its own body-frame geometry, prescribed kinematics, instantaneous panel
+ * geometry, bound circulation, shed wake panel and wake of discrete vortices. Tandem wings, biplanes or a foil
+ * with a flap are described by several bodies, each placed in the inertial frame by its own offset.
+ */
+
+#ifndef BODY_H
+#define BODY_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include "geometry.h"
+#include "velocity.h"
+#include "MotionParameters.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief One airfoil with its kinematics, panel geometry, circulation and wake.
+ */
+struct Body
+{
+    /* geometry in the body-fixed frame (computed once) */
+    int n;       ///< Number of nodes (n-1 panels).
+    double c;    ///< Chord length (meters).
+    VectorXd x0; ///< Body-frame node x-coordinates (size n).
+    VectorXd y0; ///< Body-frame node y-coordinates (size n).
+
+    /* prescribed kinematics and their value at the current time step */
+    MotionProfile motion;  ///< Plunge, pitch and surge channels, pitch axis and position of the body.
+    RigidBodyState state;  ///< Rigid-body state at the current time, evaluated once per step.
+
+    /* instantaneous panel geometry in the inertial frame */
+    PanelGeometry panels; ///< Nodes, control points, panel lengths, normals and tangents.
+
+    /* cached rigid-motion invariant self-influence block, incl. the Kutta row (size n x n) */
+    MatrixXd A_self;
+
+    /* bound circulation */
+    VectorXd gamma_bound; ///< Vortex strengths at the nodes (size n).
+    double gamma_old;     ///< Bound circulation of the previous time step (Kelvin's theorem).
+
+    /* wake panel shed in the current time step */
+    double lwp, theta_wp, gamma_wp;    ///< Length, inertial orientation and (constant) strength.
+    MatrixXd wake_panel_coordinates;   ///< [x0, y0; x1, y1] (size 2 x 2).
+    VectorXd wake_panel_cp;            ///< Control point of the wake panel.
+    VectorXd wake_panel_normal;        ///< Unit normal of the wake panel.
+    VectorXd vtotal_wp_cp;             ///< Total velocity at the wake panel control point.
+
+    /* discrete vortices shed in the previous time steps */
+    vector<double> gamma_wake_strength;
+    vector<double> gamma_wake_x_location;
+    vector<double> gamma_wake_y_location;
+
+    /* surface potential and loads */
+    VectorXd phi_old;        ///< Potential at the control points of the previous time step (size n-1).
+    VectorXd phi_airfoil_cps; ///< Potential at the control points (size n-1).
+    VectorXd cp;             ///< Pressure coefficients at the control points (size n-1).
+    double cn_tilda, ca_tilda; ///< Normal (y) and axial (x) force coefficients in the inertial frame.
+};
+
+/**
+ * @brief Sizes all the per-body arrays once the number of nodes and the body-frame geometry are known.
+ *
+ * Also caches the self-influence block A_self. The normal-velocity influence of a body on its own control
+ * points is invariant under rigid motion, so it is evaluated once from the body-frame nodes.
+ *
+ * @param body Body whose n, x0 and y0 are set.
+ * @param Qinf Freestream speed, used for the initial guess of the wake panel length (meters/second).
+ * @param dt Time step (seconds).
+ * @param cache_self_influence false: A_self is left empty (matrix-free solver, O(n^2) memory avoided).
+ * @see Amatrix
+ */
+void initialize_body(Body &body, double Qinf, double dt, bool cache_self_influence = true);
+
+/**
+ * @brief Moves a body to time t: rigid-body state, nodes, control points, panel lengths, normals and tangents.
+ *
+ * @param body Body to update.
+ * @param t Current time (seconds).
+ * @see rigid_body_state, update_panel_geometry
+ */
+void update_body_geometry(Body &body, double t);
+
+/**
+ * @brief Kinematic velocity (freestream minus body motion) at a point attached to a body.
+ *
+ * Uses the rigid-body state cached by update_body_geometry for the current time step.
+ *
+ * @param body Body to which the point belongs.
+ * @param Qinf Freestream speed (meters/second).
+ * @param x x-coordinate of the point in the inertial frame (meters).
+ * @param y y-coordinate of the point in the inertial frame (meters).
+ * @return VectorXd A 2D velocity vector [u, v].
+ * @see velocity_at_surface_of_the_body_inertial_frame
+ */
+VectorXd body_kinematic_velocity(const Body &body, double Qinf, double x, double y);
+
+/**
+ * @brief Velocity induced at a point by the bound vortex panels of all bodies (and their images).
+ */
+VectorXd velocity_bound_vortices_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y);
+
+/**
+ * @brief Velocity induced at a point by the wake vortices of all bodies (and their images).
+ *
+ * @param skip_body Body owning a vortex to exclude (self-induction), or -1.
+ * @param skip_index Index of that vortex in the wake of skip_body.
+ */
+VectorXd velocity_wake_vortices_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y, int skip_body = -1, int skip_index = -1);
+
+/**
+ * @brief Velocity induced at a point by the current wake panels of all bodies (and their images).
+ *
+ * @param skip_body Body whose wake panel is left out, or -1.
+ */
+VectorXd velocity_wake_panels_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y, int skip_body = -1);
+
+/**
+ * @brief Total disturbance velocity at a point: bound panels, wake panels and wake vortices of all bodies.
+ */
+VectorXd velocity_induced_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y);
+
+/**
+ * @brief Velocity potential at a point of the bound panels, wake panels and wake vortices of all bodies.
+ *
+ * Every vortex takes its angle from the direction upstream of the point (see potential_due_to_discrete_vortex),
+ * so the result equals the integral of velocity_induced_all along the horizontal line from far upstream to
+ * the point, provided that line does not cross a body or a wake.
+ */
+double potential_induced_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y);
+
+/**
+ * @brief Places the wake panel of the prescribed wake, which needs no Newton iterations.
+ *
+ * In the prescribed wake the shed vorticity moves with the freestream only, so the panel shed over the last
+ * step is known from the kinematics: it runs from the trailing edge at time t to the point the trailing edge
+ * occupied at t - dt, convected by the freestream over dt. The velocity at its control point is the freestream.
+ * The body rests at its position of t_start before t_start, so the first panel of a march lies along the freestream.
+ *
+ * @param body Body whose panel geometry is set for time t.
+ * @param freestream Freestream velocity vector [u, v] (meters/second).
+ * @param t Current time (seconds).
+ * @param dt Step over which the panel was shed (seconds).
+ * @param t_start Start of the motion (seconds); -infinity for a periodic state.
+ */
+void prescribe_wake_panel(Body &body, const VectorXd &freestream, double t, double dt, double t_start);
+
+/**
+ * @brief Convects the wake vortices of all bodies over one time step and sheds the converged wake panels.
+ *
+ * All positions are updated simultaneously from the velocities at the start of the step. In the free wake
+ * (wake = 0) a vortex moves with the freestream plus the velocity induced by the other wake vortices, the bound
+ * vortices and the wake panels of all bodies; in the prescribed wake (wake = 1) it moves with the freestream
+ * only. Afterwards the wake panel of every body is released as a discrete vortex of strength gamma_wp * lwp
+ * at the position its control point reaches at the end of the step.
+ *
+ * @param bodies All bodies.
+ * @param images Image system of the boundaries.
+ * @param freestream Freestream velocity vector [u, v] (meters/second).
+ * @param dt Time step (seconds).
+ * @param wake 0 = free wake, 1 = prescribed wake.
+ */
+void convect_wakes(vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double dt, int wake);
+
+#endif // BODY_H
@@ -0,0 +1,99 @@
+/**
+ * @file Cache.h
+ * @brief Content-addressed store of simulation results keyed by the normalized input.
+ *
+ * The input is normalized before hashing: explanation blocks ("__..."), presentation settings (gnuplot
+ * terminal), the blocks of other modes, the flow-field snapshots and probes (never cached), the output
+ * triggers (which do not change the results) and null entries (which mean "default") are removed, all numbers
+ * are written as doubles, and every referenced file (airfoil coordinates, tabulated motions) is replaced by
+ * the SHA-256 of its contents. Two keys are derived, both including PANKH_VERSION:
+ *
+ * - the full key of the normalized input, which identifies a result;
+ * - the prefix key without the duration (simulation.ncycles and t_max), shared by all runs that follow the
+ *   same trajectory, so that a longer run can resume from the final state of a shorter one.
+ *
+ * An entry lives in <root>/<prefix key>/<full key>/ and holds the load files, the final wake and panel
+ * geometry and the complete state after the last time step. Its entry.json (number of completed steps) is
+ * written last, so entries of interrupted runs are ignored.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "Body.h"
+#include "CoupledSystem.h"
+#include "Performance.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief Full and prefix key of an input.
+ */
+struct CacheKeys
+{
+    string full;   ///< SHA-256 of the normalized input.
+    string prefix; ///< SHA-256 of the normalized input without its duration.
+};
+
+/**
+ * @brief SHA-256 digest of a byte string as 64 hexadecimal characters.
+ */
+string sha256_hex(const string &data);
+
+/**
+ * @brief Normalized copy of an input of the unsteady simulation (see the file description).
+ */
+json normalized_input(const json &input);
+
+/**
+ * @brief Full and prefix keys of an input of the unsteady simulation.
+ */
+CacheKeys cache_keys(const json &input);
+
+/**
+ * @brief Directory of the entry of a full key.
+ */
+string cache_entry_directory(const string &root, const CacheKeys &keys);
+
+/**
+ * @brief Finds the completed entry with the same prefix key and the most steps, at most max_steps.
+ *
+ * @param root Root directory of the store.
+ * @param keys Keys of the run.
+ * @param max_steps Largest usable number of completed steps.
+ * @param directory Output directory of the entry found.
+ * @param steps Output number of completed steps of the entry found.
+ * @return bool True when an entry was found.
+ */
+bool find_cache_entry(const string &root, const CacheKeys &keys, int max_steps, string &directory, int &steps);
+
+/**
+ * @brief Marks an entry as complete after all its files have been written.
+ */
+void complete_cache_entry(const string &directory, const CacheKeys &keys, int steps);
+
+/**
+ * @brief Writes the state after the last time step (wakes, wake panels, circulations, potentials, solver guesses
+ *        and the performance accumulators of the current window).
+ *
+ * Doubles are written with 17 significant digits, so a resumed run continues bit for bit.
+ */
+void save_simulation_state(const string &filename, const vector<Body> &bodies, const CoupledSystem &system, const vector<PerformanceAccumulator> &accumulators);
+
+/**
+ * @brief Restores the state written by save_simulation_state into initialized bodies, system and accumulators.
+ *
+ * @throws std::runtime_error If the file cannot be read or does not match the bodies.
+ */
+void load_simulation_state(const string &filename, vector<Body> &bodies, CoupledSystem &system, vector<PerformanceAccumulator> &accumulators);
+
+/**
+ * @brief Copies a file; returns false when it cannot be read or written.
+ */
+bool copy_file(const string &from, const string &to);
+
+#endif // CACHE_H
@@ -0,0 +1,71 @@
+/**
+ * @file Convergence.h
+ * @brief Load metrics of a run and Richardson extrapolation for grid and time-step convergence studies.
+ *
+ * A quantity f computed with a step h (panel size or time step) of a method of order p behaves like
+ * f(h) = f* + a h^p. Three runs with steps h, h / r and h / r^2 give the observed order
+ *
+ *     p = ln((f_1 - f_2) / (f_2 - f_3)) / ln r
+ *
+ * and the extrapolated value f* = f_3 + (f_3 - f_2) / (r^p - 1). When the panel count and the time step are
+ * refined independently the errors are taken as additive, f(h, tau) = f* + a h^p + b tau^q, so that the two
+ * one-dimensional extrapolations along the finest row and column of the ladder combine to f*.
+ */
+
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#include <string>
+#include "json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief Metrics of the load history of one run over its evaluation window.
+ */
+struct LoadMetrics
+{
+    double cl_mean;      ///< Mean lift coefficient.
+    double cl_amplitude; ///< Half the peak-to-peak lift coefficient.
+    double ct_mean;      ///< Mean thrust coefficient (minus the mean axial force coefficient).
+};
+
+/**
+ * @brief Reads a load file (time, Cl, Cd per line) and evaluates its metrics over the last window.
+ *
+ * @param filename Load file written by the unsteady simulation.
+ * @param window Length of the evaluation window at the end of the file (time units of the file, e.g. one
+ *               cycle for periodic motions).
+ * @param metrics Output metrics (trapezoidal means over the window).
+ * @throws std::runtime_error If the file cannot be read or holds fewer than two rows in the window.
+ */
+void read_load_metrics(const string &filename, double window, LoadMetrics &metrics);
+
+/**
+ * @brief Observed order and extrapolated value from three runs with steps h, h / r and h / r^2.
+ *
+ * @param f_coarse Value of the coarsest run.
+ * @param f_medium Value of the medium run.
+ * @param f_fine Value of the finest run.
+ * @param ratio Refinement ratio r > 1.
+ * @param order Output observed order (NaN unless the differences shrink monotonically).
+ * @param extrapolated Output extrapolated value (f_fine unless the differences shrink monotonically).
+ * @return bool True when the differences shrink monotonically (p > 0) and the extrapolation was applied.
+ */
+bool richardson_extrapolation(double f_coarse, double f_medium, double f_fine, double ratio, double &order, double &extrapolated);
+
+/**
+ * @brief Converge mode: runs the ladder of panel counts and time steps of the "converge" block and recommends
+ *        the cheapest run within the target error.
+ *
+ * Every run is a separate solver process in output_files/converge/<run>/, jobs of them at a time; the table of
+ * all runs goes to output_files/convergence.dat.
+ *
+ * @param input Complete input of the solver.
+ * @param executable Path of the solver executable (argv[0]).
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ */
+int run_converge(json input, const string &executable);
+
+#endif // CONVERGENCE_H
@@ -0,0 +1,136 @@
+/**
+ * @file CoupledSystem.h
+ * @brief Block-structured influence system of all bodies, their Kutta conditions, wake panels and Kelvin conditions.
+ *
+ * The unknowns are the nodal vortex strengths of every body followed by one wake panel strength per body.
+ * The system is kept in bordered form
+ *
+ *     [ K    W ] [ gamma ]   [ r     ]
+ *     [ C^T  D ] [ g     ] = [ Gamma ]
+ *
+ * where K (no-penetration and Kutta rows against the bound unknowns) is assembled from blocks: the self blocks
+ * are cached in the body frame (they do not change under rigid motion) and only the inter-body blocks are
+ * recomputed every time step. K is factorised once per time step (once per run for a single body); the wake
+ * panel columns W, which change in every Newton iteration, are eliminated through the small Schur complement
+ * D - C^T K^-1 W of size (number of bodies).
+ *
+ * Near a wall or free surface the images of every body also induce normal velocity on every body. These image
+ * blocks depend on the body positions, so K is then re-assembled and factorised every time step.
+ *
+ * For large panel counts K need not be formed at all: with the "gmres" solver every product K x is evaluated
+ * by a treecode over the bound panels (O(n log n)), and the solves with K use restarted GMRES preconditioned by
+ * the factorised diagonal blocks of the self-influence matrices (groups of neighbouring nodes, computed once in
+ * the body frame). The previous solutions are the initial guesses. With the "hmatrix" solver the products
+ * instead use a hierarchical approximation of K built by adaptive cross approximation, which compresses the
+ * far-apart panel interactions to low rank; for a single body without images it is built once per run.
+ */
+
+#ifndef COUPLEDSYSTEM_H
+#define COUPLEDSYSTEM_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include "Body.h"
+#include "HMatrix.h"
+#include "Treecode.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Settings of the matrix-free solver.
+ */
+struct KrylovSettings
+{
+    bool enabled;       ///< true: GMRES with treecode or H-matrix products, false: dense factorisation of K.
+    bool hmatrix;       ///< true: products with the H-matrix of K instead of the treecode.
+    double eta;         ///< Admissibility parameter of the H-matrix.
+    double aca_tolerance; ///< Relative accuracy of the low-rank blocks of the H-matrix.
+    double tolerance;   ///< Relative residual of the GMRES solves.
+    int restart;        ///< Krylov dimension before a restart.
+    int max_iterations; ///< Maximum number of products per solve; a solve that needs more fails.
+    double theta;       ///< Opening angle of the treecode.
+    int order;          ///< Highest multipole term of the treecode.
+    int leaf_size;      ///< Panels per leaf of the treecode and points per leaf of the H-matrix.
+    int block_size;     ///< Nodes per diagonal block of the preconditioner.
+};
+
+/**
+ * @brief Factorised bound system, right-hand side and offsets of the bodies in the unknown vector.
+ */
+struct CoupledSystem
+{
+    vector<int> offset;        ///< Index of the first bound unknown of every body.
+    int size;                  ///< Number of bound unknowns (sum of the nodes of all bodies).
+    MatrixXd K;                ///< Bound influence matrix incl. Kutta rows (size x size).
+    PartialPivLU<MatrixXd> lu; ///< Factorisation of K.
+    bool factorised;           ///< True once K has been factorised (kept for a single rigid body).
+    const PartialPivLU<MatrixXd> *shared_lu; ///< Factorisation of K of another system of the same body, used instead of lu when set.
+    VectorXd rhs;              ///< No-penetration right-hand side, zeros in the Kutta rows.
+    VectorXd K_inv_rhs;        ///< K^-1 rhs, computed once per time step.
+    MatrixXd W;                ///< Wake panel columns of the last solve (size x number of bodies).
+    ImageSystem images;        ///< Images of the boundaries, included in every influence coefficient and velocity.
+    VectorXd gamma_unsteady;   ///< Last solution: bound unknowns followed by the wake panel strengths.
+
+    /* matrix-free path (krylov.enabled): K is never formed */
+    KrylovSettings krylov;                    ///< Solver settings.
+    PanelTree tree;                           ///< Treecode of the bound panels of all bodies, rebuilt every time step.
+    TreeProjection projection;                ///< Interaction lists of the control points (and their images) in the tree.
+    HMatrix H;                                ///< Hierarchical approximation of the no-penetration rows of K.
+    bool hmatrix_built;                       ///< True once H has been built (kept for a single rigid body).
+    vector<vector<int>> blocks;               ///< Unknowns of every diagonal block of the preconditioner.
+    vector<PartialPivLU<MatrixXd>> block_lu;  ///< Factorised diagonal blocks.
+    MatrixXd K_inv_W;                         ///< Last K^-1 W, initial guess of the next wake panel solve.
+    int krylov_iterations;                    ///< Products used in the current time step.
+    double krylov_residual;                   ///< Largest relative residual reached in the current time step.
+};
+
+/**
+ * @brief Sets up the offsets and sizes of the coupled system.
+ *
+ * With krylov.enabled the diagonal blocks of the preconditioner are built and factorised here from the
+ * body-frame geometry (they are invariant under rigid motion); K is not allocated and A_self is not needed.
+ * Blocks run cyclically over the nodes so that the block holding the Kutta row also holds both trailing-edge nodes.
+ */
+void initialize_coupled_system(const vector<Body> &bodies, CoupledSystem &system, const KrylovSettings &krylov);
+
+/**
+ * @brief Assembles and factorises K for the current body positions.
+ *
+ * Self blocks are copied from the cached Body::A_self; the inter-body blocks (normal velocity at the control
+ * points of one body induced by the panels of another) and the image blocks are recomputed. With a single
+ * body and no images K never changes and is factorised only on the first call. On the matrix-free path only
+ * the treecode of the current panel positions is built, or the H-matrix (with the same caching as the
+ * factorisation).
+ */
+void assemble_bound_system(const vector<Body> &bodies, CoupledSystem &system);
+
+/**
+ * @brief Builds the right-hand side (freestream, body motion and previously shed vortices) and K^-1 rhs.
+ *
+ * @param Qinf Freestream speed (meters/second).
+ * @throws std::runtime_error If GMRES does not reach its tolerance in max_iterations products.
+ */
+void assemble_right_hand_side(const vector<Body> &bodies, CoupledSystem &system, double Qinf);
+
+/**
+ * @brief Solves the coupled system for the current wake panel geometries.
+ *
+ * Fills the wake panel columns, eliminates the wake panel strengths through the Schur complement with the
+ * Kelvin rows, and stores gamma_bound and gamma_wp in every body.
+ *
+ * @throws std::runtime_error If GMRES does not reach its tolerance in max_iterations products.
+ */
+void solve_coupled_system(vector<Body> &bodies, CoupledSystem &system);
+
+/**
+ * @brief Returns the full (bordered) coefficient matrix, used for output only.
+ */
+MatrixXd coupled_matrix(const vector<Body> &bodies, const CoupledSystem &system);
+
+/**
+ * @brief Returns the full right-hand side incl. the Kelvin rows, used for output only.
+ */
+VectorXd coupled_right_hand_side(const vector<Body> &bodies, const CoupledSystem &system);
+
+#endif // COUPLEDSYSTEM_H
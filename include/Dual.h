@@ -0,0 +1,303 @@
+/**
+ * @file Dual.h
+ * @brief Forward-mode (tangent) automatic differentiation with dual numbers.
+ *
+ * A Dual<N> carries a value and its derivatives with respect to N independent parameters. Every arithmetic
+ * operation and elementary function applies the chain rule to the derivatives alongside the value, so a
+ * computation written for a generic scalar type S and run with S = Dual<N> returns the derivatives of all its
+ * results with respect to the N seeded parameters in one pass. The value part follows exactly the operations of
+ * the same computation in double precision.
+ *
+ * Comparisons look at the values only: branches (convergence tests, pivoting, the side of a branch cut) take
+ * the path of the double computation and are differentiated as such. floor is piecewise constant and has zero
+ * derivatives.
+ */
+
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <Eigen/Core>
+#include <cmath>
+
+/**
+ * @brief A value and its derivatives with respect to N parameters.
+ */
+template <int N>
+struct Dual
+{
+    double value;         ///< Value.
+    double derivative[N]; ///< Derivatives with respect to the parameters.
+
+    Dual() : value(0.0)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] = 0.0;
+        }
+    }
+
+    Dual(double v) : value(v)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] = 0.0;
+        }
+    }
+
+    /**
+     * @brief The independent parameter i with value v (unit derivative in direction i).
+     */
+    static Dual parameter(double v, int i)
+    {
+        Dual x(v);
+        x.derivative[i] = 1.0;
+        return x;
+    }
+
+    Dual &operator+=(const Dual &b)
+    {
+        value += b.value;
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] += b.derivative[i];
+        }
+        return *this;
+    }
+
+    Dual &operator-=(const Dual &b)
+    {
+        value -= b.value;
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] -= b.derivative[i];
+        }
+        return *this;
+    }
+
+    Dual &operator*=(const Dual &b)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] = derivative[i] * b.value + value * b.derivative[i];
+        }
+        value *= b.value;
+        return *this;
+    }
+
+    Dual &operator/=(const Dual &b)
+    {
+        double q = value / b.value;
+        for (int i = 0; i < N; i++)
+        {
+            derivative[i] = (derivative[i] - q * b.derivative[i]) / b.value;
+        }
+        value = q;
+        return *this;
+    }
+};
+
+/* value of a scalar of either type */
+inline double scalar_value(double x)
+{
+    return x;
+}
+
+template <int N>
+inline double scalar_value(const Dual<N> &x)
+{
+    return x.value;
+}
+
+/* value and derivatives of f(x) with f'(x) = slope */
+template <int N>
+inline Dual<N> chain(const Dual<N> &x, double value, double slope)
+{
+    Dual<N> y(value);
+    for (int i = 0; i < N; i++)
+    {
+        y.derivative[i] = slope * x.derivative[i];
+    }
+    return y;
+}
+
+template <int N>
+inline Dual<N> operator-(const Dual<N> &a)
+{
+    return chain(a, -a.value, -1.0);
+}
+
+template <int N>
+inline Dual<N> operator+(Dual<N> a, const Dual<N> &b)
+{
+    return a += b;
+}
+
+template <int N>
+inline Dual<N> operator-(Dual<N> a, const Dual<N> &b)
+{
+    return a -= b;
+}
+
+template <int N>
+inline Dual<N> operator*(Dual<N> a, const Dual<N> &b)
+{
+    return a *= b;
+}
+
+template <int N>
+inline Dual<N> operator/(Dual<N> a, const Dual<N> &b)
+{
+    return a /= b;
+}
+
+template <int N>
+inline Dual<N> operator+(Dual<N> a, double b)
+{
+    a.value += b;
+    return a;
+}
+
+template <int N>
+inline Dual<N> operator+(double a, Dual<N> b)
+{
+    b.value = a + b.value;
+    return b;
+}
+
+template <int N>
+inline Dual<N> operator-(Dual<N> a, double b)
+{
+    a.value -= b;
+    return a;
+}
+
+template <int N>
+inline Dual<N> operator-(double a, const Dual<N> &b)
+{
+    return chain(b, a - b.value, -1.0);
+}
+
+template <int N>
+inline Dual<N> operator*(const Dual<N> &a, double b)
+{
+    return chain(a, a.value * b, b);
+}
+
+template <int N>
+inline Dual<N> operator*(double a, const Dual<N> &b)
+{
+    return chain(b, a * b.value, a);
+}
+
+template <int N>
+inline Dual<N> operator/(const Dual<N> &a, double b)
+{
+    Dual<N> y(a.value / b);
+    for (int i = 0; i < N; i++)
+    {
+        y.derivative[i] = a.derivative[i] / b;
+    }
+    return y;
+}
+
+template <int N>
+inline Dual<N> operator/(double a, const Dual<N> &b)
+{
+    double q = a / b.value;
+    return chain(b, q, -q / b.value);
+}
+
+/* comparisons of the values */
+template <int N> inline bool operator<(const Dual<N> &a, const Dual<N> &b) { return a.value < b.value; }
+template <int N> inline bool operator<(const Dual<N> &a, double b) { return a.value < b; }
+template <int N> inline bool operator<(double a, const Dual<N> &b) { return a < b.value; }
+template <int N> inline bool operator>(const Dual<N> &a, const Dual<N> &b) { return a.value > b.value; }
+template <int N> inline bool operator>(const Dual<N> &a, double b) { return a.value > b; }
+template <int N> inline bool operator>(double a, const Dual<N> &b) { return a > b.value; }
+template <int N> inline bool operator<=(const Dual<N> &a, const Dual<N> &b) { return a.value <= b.value; }
+template <int N> inline bool operator<=(const Dual<N> &a, double b) { return a.value <= b; }
+template <int N> inline bool operator<=(double a, const Dual<N> &b) { return a <= b.value; }
+template <int N> inline bool operator>=(const Dual<N> &a, const Dual<N> &b) { return a.value >= b.value; }
+template <int N> inline bool operator>=(const Dual<N> &a, double b) { return a.value >= b; }
+template <int N> inline bool operator>=(double a, const Dual<N> &b) { return a >= b.value; }
+template <int N> inline bool operator==(const Dual<N> &a, const Dual<N> &b) { return a.value == b.value; }
+template <int N> inline bool operator==(const Dual<N> &a, double b) { return a.value == b; }
+template <int N> inline bool operator==(double a, const Dual<N> &b) { return a == b.value; }
+template <int N> inline bool operator!=(const Dual<N> &a, const Dual<N> &b) { return a.value != b.value; }
+template <int N> inline bool operator!=(const Dual<N> &a, double b) { return a.value != b; }
+template <int N> inline bool operator!=(double a, const Dual<N> &b) { return a != b.value; }
+
+template <int N>
+inline Dual<N> sqrt(const Dual<N> &x)
+{
+    double r = std::sqrt(x.value);
+    return chain(x, r, 0.5 / r);
+}
+
+template <int N>
+inline Dual<N> sin(const Dual<N> &x)
+{
+    return chain(x, std::sin(x.value), std::cos(x.value));
+}
+
+template <int N>
+inline Dual<N> cos(const Dual<N> &x)
+{
+    return chain(x, std::cos(x.value), -std::sin(x.value));
+}
+
+template <int N>
+inline Dual<N> log(const Dual<N> &x)
+{
+    return chain(x, std::log(x.value), 1.0 / x.value);
+}
+
+template <int N>
+inline Dual<N> fabs(const Dual<N> &x)
+{
+    return chain(x, std::fabs(x.value), (x.value < 0.0) ? -1.0 : 1.0);
+}
+
+template <int N>
+inline Dual<N> floor(const Dual<N> &x)
+{
+    return Dual<N>(std::floor(x.value));
+}
+
+/* d atan2(y, x) = (x dy - y dx) / (x^2 + y^2) */
+template <int N>
+inline Dual<N> atan2(const Dual<N> &y, const Dual<N> &x)
+{
+    Dual<N> angle(std::atan2(y.value, x.value));
+    double r2 = x.value * x.value + y.value * y.value;
+    for (int i = 0; i < N; i++)
+    {
+        angle.derivative[i] = (r2 > 0.0) ? (x.value * y.derivative[i] - y.value * x.derivative[i]) / r2 : 0.0;
+    }
+    return angle;
+}
+
+/* dual numbers as Eigen scalars (storage and coefficient access of Matrix<Dual<N>, ...>) */
+namespace Eigen
+{
+template <int N>
+struct NumTraits<Dual<N>> : NumTraits<double>
+{
+    typedef Dual<N> Real;
+    typedef Dual<N> NonInteger;
+    typedef Dual<N> Nested;
+    typedef Dual<N> Literal;
+    enum
+    {
+        IsComplex = 0,
+        IsInteger = 0,
+        IsSigned = 1,
+        RequireInitialization = 1,
+        ReadCost = N + 1,
+        AddCost = N + 1,
+        MulCost = 2 * N + 1
+    };
+};
+}
+
+#endif // DUAL_H
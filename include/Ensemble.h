@@ -0,0 +1,96 @@
+/**
+ * @file Ensemble.h
+ * @brief Ensemble of kinematic cases that share one body: sweeps over k, h1, phases or pitch axes.
+ *
+ * Cases with the same geometry and number of nodes in an unbounded flow have the same bound influence matrix K
+ * in the body frame. The ensemble factorises K once and marches the cases one after the other against that
+ * factorisation, each with the right-hand side, wake panel iterations, loads and wake convection of the unsteady
+ * simulation, so every case reproduces its separate run.
+ */
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <vector>
+#include "json.hpp"
+#include "Body.h"
+#include "CoupledSystem.h"
+#include "MotionParameters.h"
+
+using namespace Eigen;
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief One case of the ensemble.
+ */
+struct EnsembleCase
+{
+    vector<Body> bodies;     ///< The body of the case (a single body).
+    CoupledSystem system;    ///< Right-hand side, wake panel column and solution of the case; K is shared.
+    double dt;               ///< Time step of the case (seconds).
+    double dt_previous;      ///< Step that led to the current time (seconds).
+    VectorXd freestream;     ///< Freestream velocity of the current step (meters/second).
+    double Qinf_t;           ///< Freestream speed of the current step (meters/second).
+    int newton_iterations;   ///< Wake panel Newton iterations of the last step.
+};
+
+/**
+ * @brief Settings shared by all cases.
+ */
+struct EnsembleSettings
+{
+    int wake;               ///< 0 = free wake, 1 = prescribed wake.
+    bool prescribed_wake_panel; ///< Wake panel of the prescribed wake from the kinematics instead of by Newton.
+    double epsilon;         ///< Perturbation of the Newton finite differences.
+    double tolerance;       ///< Convergence tolerance of the Newton update.
+    int max_newton_iterations; ///< Newton iterations after which a step fails.
+    double Qinf, Vinf;      ///< Freestream components (meters/second).
+    MotionChannel inflow;   ///< Start of the freestream (fraction of Qinf over time).
+    int z;                  ///< Points of the stagnation streamline quadrature.
+    double offset;          ///< Offset of the surface velocity evaluation.
+    bool phi_le_quadrature; ///< Leading-edge potential by quadrature instead of in closed form.
+};
+
+/**
+ * @brief Prepares the cases and factorises the shared K.
+ *
+ * Every case must hold one body, initialised with initialize_body; the first body must carry A_self. The systems
+ * of the cases solve with the factorisation held by shared, which must outlive them.
+ *
+ * @param cases Cases of the ensemble.
+ * @param shared System holding the factorised K of the common body.
+ * @throws std::invalid_argument If a case has more than one body or a body differs from the first in its
+ *         body-frame nodes.
+ */
+void initialize_ensemble(vector<EnsembleCase> &cases, CoupledSystem &shared);
+
+/**
+ * @brief Advances one case by one time step up to the loads (before the wake is convected).
+ *
+ * Moves the body to time iter * dt, solves the right-hand side and the wake panel with the shared factorisation
+ * and evaluates the pressure loads (cn_tilda, ca_tilda, cp), as the unsteady simulation does.
+ *
+ * @param ensemble_case Case to advance.
+ * @param settings Shared settings.
+ * @param iter Time step index.
+ * @throws std::runtime_error If the wake panel does not converge in max_newton_iterations Newton iterations.
+ */
+void solve_ensemble_step(EnsembleCase &ensemble_case, const EnsembleSettings &settings, int iter);
+
+/**
+ * @brief Ensemble mode: runs the cases of the "ensemble" block, each overriding entries of the top-level motion.
+ *
+ * Writes the loads and cycle performance of every case to output_files/ensemble/cl_cd_case<i>.dat and
+ * performance_case<i>.dat, and the last cycle of all cases to output_files/ensemble/summary.dat.
+ *
+ * @param input Complete input of the solver.
+ * @param settings Settings shared by all cases, read from the input by the caller.
+ * @param wall_start Start of the run, for the reported wall time.
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ */
+int run_ensemble(json input, const EnsembleSettings &settings, chrono::high_resolution_clock::time_point wall_start);
+
+#endif // ENSEMBLE_H
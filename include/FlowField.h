@@ -0,0 +1,152 @@
+/**
+ * @file FlowField.h
+ * @brief Velocity, pressure and smoothed vorticity of the flow on Cartesian grids (flow-field snapshots).
+ *
+ * All vorticity of the simulation (the linear-strength bound panels, the wake panels and the wake vortices) is
+ * sorted into a cluster tree. The grid is cut into square tiles of points, and every tile traverses the tree once:
+ * clusters far from the tile are summed through their complex multipole expansions (as in Treecode.h), the
+ * remaining elements directly. Panels are evaluated exactly in the near field, wake vortices with a Lamb-Oseen core
+ *
+ *     u - i v = (i Gamma / 2 pi) (1 - exp(-r^2 / delta^2)) / (z - z_k)
+ *
+ * so that the velocity stays finite and its vorticity is the Gaussian blob -Gamma / (pi delta^2) exp(-r^2 / delta^2)
+ * (counterclockwise positive, the circulations being clockwise positive). A cluster is only accepted when it is
+ * more than six core radii away, so the vorticity needs no far field.
+ *
+ * The pressure follows from the unsteady Bernoulli equation at fixed points of the inertial frame,
+ *
+ *     cp = (Qinf^2 - |V|^2 - 2 dphi/dt) / Qref^2,
+ *
+ * with dphi/dt written in terms of the elements rather than by differencing the multivalued potential:
+ * d/dt [Gamma_k G(z - z_k)] = dGamma_k/dt G - Gamma_k dz_k/dt . grad G. The convective part -sum dz_k/dt . v_k
+ * uses a second set of multipole moments with the strengths Gamma_k (dz_k/dt), the element velocities being the
+ * rigid-body velocity on the bound panels and the backward difference of the positions in the wake. The strength
+ * changes occur on the bound panels and the wake panel of every body and sum to zero (Kelvin), so their expansion
+ * about the body has no logarithmic term: the potential jump is confined to the body and its wake panel. Both
+ * rates are backward differences over the last time step, as dphi/dt on the surface, and need the state of the
+ * previous step (record_field_history); without it dphi/dt is taken as zero.
+ *
+ * Walls and free surfaces are included by evaluating the same sums at the image points of the grid.
+ * Points inside a body are set to NaN.
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include "Body.h"
+#include "Images.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Uniform Cartesian grid of nx x ny points, x varying fastest.
+ */
+struct FieldGrid
+{
+    int nx, ny;          ///< Number of points in x and y (>= 2).
+    double x_min, x_max; ///< Extent in x (meters).
+    double y_min, y_max; ///< Extent in y (meters).
+};
+
+/**
+ * @brief Settings of the field evaluation.
+ */
+struct FieldSettings
+{
+    FieldGrid grid;      ///< Evaluation grid.
+    double core_radius;  ///< Core radius delta of the wake vortices and of the vorticity blobs (meters).
+    double theta;        ///< Opening angle of the cluster tree (smaller is more accurate).
+    int order;           ///< Highest multipole term.
+    int tile;            ///< Edge of the square tiles of grid points that share one tree traversal.
+};
+
+/**
+ * @brief Element strengths and positions of the previous time step, for dphi/dt.
+ */
+struct FieldHistory
+{
+    bool valid;                          ///< false until a step has been recorded.
+    vector<VectorXd> gamma_bound;        ///< Bound vortex strengths of every body.
+    vector<vector<double>> wake_x, wake_y; ///< Wake vortex positions of every body.
+    vector<Vector2d> wake_panel_cp;      ///< Wake panel control point of every body.
+};
+
+/**
+ * @brief Flow field on a grid at one instant; NaN inside the bodies.
+ */
+struct FlowFieldSnapshot
+{
+    double t;                ///< Time (seconds).
+    FieldGrid grid;          ///< Grid of the samples.
+    vector<float> u, v;      ///< Velocity in the inertial frame (meters/second).
+    vector<float> cp;        ///< Pressure coefficient.
+    vector<float> vorticity; ///< Smoothed vorticity, counterclockwise positive (1/second).
+};
+
+/**
+ * @brief Stores the strengths and positions of the current step for the dphi/dt of the next one.
+ *
+ * Call it at the same point of the time step as evaluate_flow_field: after the solve, before the wakes are convected.
+ */
+void record_field_history(const vector<Body> &bodies, FieldHistory &history);
+
+/**
+ * @brief Evaluates the velocity, pressure and smoothed vorticity on the grid.
+ *
+ * @param bodies Bodies after the solve of the current time step.
+ * @param images Image system of the boundaries.
+ * @param freestream Freestream velocity [u, v] at the current time (meters/second).
+ * @param Qref Reference speed of the pressure coefficient (meters/second).
+ * @param history Strengths and positions of the previous time step.
+ * @param dt Step since the previous time step (seconds).
+ * @param t Current time (seconds).
+ * @param settings Grid and tree settings.
+ * @param snapshot Output fields.
+ * @throws std::invalid_argument If the grid has fewer than two points in a direction, the core radius is not positive,
+ *         theta is not in (0, 1), the order is negative or the tile is smaller than one point.
+ */
+void evaluate_flow_field(const vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double Qref, const FieldHistory &history, double dt, double t, const FieldSettings &settings, FlowFieldSnapshot &snapshot);
+
+/**
+ * @brief Evaluates the velocity and pressure at arbitrary points (probes), all with one tree build.
+ *
+ * @param bodies Bodies after the solve of the current time step.
+ * @param images Image system of the boundaries.
+ * @param freestream Freestream velocity [u, v] at the current time (meters/second).
+ * @param Qref Reference speed of the pressure coefficient (meters/second).
+ * @param history Strengths and positions of the previous time step.
+ * @param dt Step since the previous time step (seconds).
+ * @param x x-coordinates of the points in the inertial frame (meters).
+ * @param y y-coordinates of the points in the inertial frame (meters).
+ * @param settings Core radius and tree settings (the grid and the tile are not used).
+ * @param u Output velocity components in the inertial frame (meters/second), NaN inside a body.
+ * @param v Output velocity components in the inertial frame (meters/second), NaN inside a body.
+ * @param cp Output pressure coefficients, NaN inside a body.
+ * @throws std::invalid_argument If x and y differ in size, the core radius is not positive, theta is not in (0, 1)
+ *         or the order is negative.
+ */
+void evaluate_flow_points(const vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double Qref, const FieldHistory &history, double dt, const vector<double> &x, const vector<double> &y, const FieldSettings &settings, vector<double> &u, vector<double> &v, vector<double> &cp);
+
+/**
+ * @brief Writes a snapshot as a binary grid.
+ *
+ * The file holds the 8 characters "PANKHFLD", the int32 format version (1), nx, ny and the number of fields (4),
+ * the float64 time, x_min, x_max, y_min and y_max, then the float32 fields u, v, cp and vorticity, each of
+ * nx * ny values with x varying fastest, all in the byte order of the machine.
+ *
+ * @throws std::runtime_error If the file cannot be written.
+ */
+void write_field_grid(const string &filename, const FlowFieldSnapshot &snapshot);
+
+/**
+ * @brief Reads a binary grid written by write_field_grid.
+ *
+ * @throws std::runtime_error If the file cannot be read or is not a field grid of this format.
+ */
+void read_field_grid(const string &filename, FlowFieldSnapshot &snapshot);
+
+#endif // FLOWFIELD_H
@@ -0,0 +1,79 @@
+/**
+ * @file HMatrix.h
+ * @brief Hierarchical matrix built by adaptive cross approximation, for dense influence matrices of panels.
+ *
+ * Rows and columns are attached to points (control points and nodes) and sorted into binary cluster trees by
+ * recursive bisection. A pair of clusters whose bounding boxes are well separated,
+ *
+ *     min(diam(rows), diam(columns)) <= eta * dist(rows, columns),
+ *
+ * interacts through a smooth kernel, so its block is numerically low rank and is stored as U V^T, found by
+ * adaptive cross approximation with partial pivoting from O(rank (m + n)) entries. Close pairs are subdivided
+ * down to the leaves, which are stored dense. Storage and products then cost about O(n log n) instead of O(n^2).
+ */
+
+#ifndef HMATRIX_H
+#define HMATRIX_H
+
+#include <Eigen/Dense>
+#include <functional>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Entry (row, column) of the matrix, in original numbering.
+ */
+typedef function<double(int row, int column)> MatrixEntry;
+
+/**
+ * @brief One block of the partition: dense, or low rank U V^T. Ranges refer to the cluster orderings.
+ */
+struct HMatrixBlock
+{
+    int row_begin, row_end;       ///< Rows [row_begin, row_end) in row_order.
+    int column_begin, column_end; ///< Columns [column_begin, column_end) in column_order.
+    bool low_rank;                ///< true: the block is U V^T, false: the block is dense.
+    MatrixXd dense;               ///< Dense block.
+    MatrixXd U, V;                ///< Low-rank factors.
+};
+
+/**
+ * @brief Hierarchical matrix: cluster orderings of rows and columns and the partition into blocks.
+ */
+struct HMatrix
+{
+    int rows, columns;         ///< Size of the matrix.
+    vector<int> row_order;     ///< Original row at each cluster position.
+    vector<int> column_order;  ///< Original column at each cluster position.
+    vector<HMatrixBlock> blocks; ///< Blocks covering the matrix exactly once.
+};
+
+/**
+ * @brief Builds the hierarchical approximation of a matrix given entry by entry.
+ *
+ * @param row_x x-coordinates of the points of the rows.
+ * @param row_y y-coordinates of the points of the rows.
+ * @param column_x x-coordinates of the points of the columns.
+ * @param column_y y-coordinates of the points of the columns.
+ * @param entry Entry of the matrix.
+ * @param leaf_size Maximum number of points in a leaf cluster.
+ * @param eta Admissibility parameter (larger compresses more blocks, 1-2 is typical).
+ * @param tolerance Relative accuracy of the cross approximation of every low-rank block.
+ * @param matrix Output matrix.
+ * @throws std::invalid_argument If the coordinate vectors differ in size or leaf_size < 1.
+ */
+void build_hmatrix(const vector<double> &row_x, const vector<double> &row_y, const vector<double> &column_x, const vector<double> &column_y, const MatrixEntry &entry, int leaf_size, double eta, double tolerance, HMatrix &matrix);
+
+/**
+ * @brief y = H x.
+ */
+void hmatrix_product(const HMatrix &matrix, const VectorXd &x, VectorXd &y);
+
+/**
+ * @brief Number of stored values (dense entries plus the entries of the low-rank factors).
+ */
+size_t hmatrix_storage(const HMatrix &matrix);
+
+#endif // HMATRIX_H
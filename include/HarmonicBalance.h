@@ -0,0 +1,104 @@
+/**
+ * @file HarmonicBalance.h
+ * @brief Periodic state of a prescribed-wake simulation by harmonic balance (time spectral collocation).
+ *
+ * With the prescribed wake (simulation.wake = 1) a vortex shed at time tau from the trailing edge
+ * x_te(tau) sits at x_te(tau) + V_inf (t - tau) at time t, so the wake geometry of the periodic state is known
+ * in advance and the problem is linear in the bound circulations. The bound circulation Gamma_b(t) of every
+ * body is represented by its values at N = 2H + 1 equally spaced instants of one period (H harmonics) and
+ * interpolated in between with the trigonometric cardinal functions. At every instant the wake of the last
+ * wake_cycles periods is discretised as in the time-marching solver with simulation.wake_panel = prescribed: a
+ * constant-strength panel from the trailing edge over the last wake step, then discrete vortices of strength
+ * Gamma(tau_end) - Gamma(tau_start) per wake step. Imposing no-penetration, Kutta and Kelvin conditions at the N
+ * instants gives N x (number of bodies) linear equations for the sampled circulations, which are assembled by
+ * probing the (affine) solve of one instant with unit circulations and solved directly: no starting transient has
+ * to be marched out.
+ *
+ * The pressure uses the unsteady Bernoulli equation with dphi/dt from the spectral derivative of the sampled
+ * potentials, so the loads carry no time-discretisation lag; their harmonics follow from the samples exactly.
+ * The motion of every body must be periodic with the period 2 pi / omega.
+ */
+
+#ifndef HARMONICBALANCE_H
+#define HARMONICBALANCE_H
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <vector>
+#include "Body.h"
+#include "CoupledSystem.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Settings of the harmonic balance solver.
+ */
+struct HarmonicBalanceSettings
+{
+    int harmonics;          ///< Number of harmonics H (2H + 1 instants per period).
+    double wake_cycles;     ///< Length of the discretised wake in periods.
+    int wake_steps;         ///< Wake steps per period (panel and vortex spacing of the wake).
+    int z;                  ///< Panels on the upstream stagnation streamline (quadrature of the leading-edge potential).
+    double offset;          ///< Distance of the velocity evaluation points from the surface (meters).
+    bool phi_le_quadrature; ///< true: stagnation streamline quadrature for the leading-edge potential.
+};
+
+/**
+ * @brief Periodic solution sampled at the 2H + 1 instants of one period.
+ */
+struct HarmonicBalanceSolution
+{
+    VectorXd t;          ///< Instants (seconds, t_i = i T / N).
+    MatrixXd gamma;      ///< Bound circulation of every body (N x number of bodies).
+    MatrixXd cl;         ///< Normal (lift) force coefficient of every body (N x number of bodies).
+    MatrixXd cd;         ///< Axial force coefficient of every body (N x number of bodies).
+};
+
+/**
+ * @brief Trigonometric cardinal function of N (odd) equally spaced samples of a period.
+ *
+ * @param N Number of samples.
+ * @param x Phase relative to the sample, omega (t - t_k) (radians).
+ * @return double 1 at x = 0, 0 at the other samples.
+ */
+double trigonometric_cardinal(int N, double x);
+
+/**
+ * @brief Fourier coefficients of N = 2H + 1 equally spaced samples, f(t) = a_0 + sum a_h cos(h omega t) + b_h sin(h omega t).
+ *
+ * @param samples Values at t_i = i T / N.
+ * @param a Output cosine coefficients a_0 ... a_H.
+ * @param b Output sine coefficients (b_0 = 0) ... b_H.
+ */
+void fourier_coefficients(const VectorXd &samples, VectorXd &a, VectorXd &b);
+
+/**
+ * @brief Solves for the periodic state of the prescribed-wake problem.
+ *
+ * @param bodies Initialised bodies; on return they hold the state of the last instant.
+ * @param system Coupled system initialised for the bodies (the images are included).
+ * @param freestream Freestream velocity [u, v] (meters/second); Qinf = freestream(0) is the reference speed.
+ * @param omega Angular frequency of the motion (radians/second).
+ * @param settings Number of harmonics, wake discretisation and load evaluation settings.
+ * @param solution Output samples of the circulations and force coefficients.
+ * @throws std::invalid_argument If harmonics < 1, wake_steps < 1, wake_cycles <= 0 or omega <= 0.
+ * @see solve_coupled_system, compute_surface_loads
+ */
+void solve_harmonic_balance(vector<Body> &bodies, CoupledSystem &system, const VectorXd &freestream, double omega, const HarmonicBalanceSettings &settings, HarmonicBalanceSolution &solution);
+
+/**
+ * @brief Harmonic mode: solves the periodic state and writes Cl and Cd over one period and their harmonics.
+ *
+ * The Fourier coefficients of all bodies go to output_files/harmonic_coefficients_k=<k>_n=<n>.dat and one period
+ * per body, reconstructed at wake_steps instants, to output_files/harmonic_k=<k>_n=<n>[_body<b>].dat.
+ *
+ * @param k Reduced frequency (file names).
+ * @param n Number of nodes of the top-level geometry (file names).
+ * @param wall_start Start of the run, for the reported wall time.
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ * @see solve_harmonic_balance for the other parameters
+ */
+int run_harmonic(vector<Body> &bodies, CoupledSystem &system, const VectorXd &freestream, double omega, const HarmonicBalanceSettings &settings, double k, int n, chrono::high_resolution_clock::time_point wall_start);
+
+#endif // HARMONICBALANCE_H
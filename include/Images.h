@@ -0,0 +1,106 @@
+/**
+ * @file Images.h
+ * @brief Method of images for a ground plane, a free surface or a channel.
+ *
+ * A plane boundary y = y_w is represented by mirroring every vortex (bound panels, wake panels and wake
+ * vortices) about it: a solid wall takes an image of opposite strength (no flow through the wall), a free
+ * surface in its high-frequency limit (phi = 0 on the surface) takes an image of equal strength. A channel
+ * between two walls needs the infinite series of reflections about both walls, truncated here to a fixed
+ * number of reflections.
+ *
+ * The images are never stored. By symmetry, the velocity induced at P by the image of a source equals the
+ * velocity induced by the source itself at the mapped point of P, with the velocity components mapped back.
+ * The kernels therefore evaluate the original source data at the mapped evaluation points, which costs one
+ * extra kernel evaluation per image and no extra memory.
+ */
+
+#ifndef IMAGES_H
+#define IMAGES_H
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include "InfluenceMatrix.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief One image of the source distribution, expressed as a map of the evaluation point.
+ *
+ * A mirror image about the line y = offset is evaluated at (x, 2 offset - y); a translated image (used for
+ * the periodic part of the channel series) is evaluated at (x, y - offset). The velocity [u, v] induced by
+ * the original sources at the mapped point is turned into the image velocity [cu u, cv v].
+ */
+struct ImageTransform
+{
+    bool mirror;   ///< true: reflection about y = offset, false: translation by offset in y.
+    double offset; ///< Mirror line or translation (meters).
+    double cu, cv; ///< Factors applied to the velocity components evaluated at the mapped point.
+};
+
+/**
+ * @brief All images of the configuration (empty for an unbounded flow).
+ */
+struct ImageSystem
+{
+    string type;                       ///< "none", "ground", "free_surface" or "channel".
+    vector<ImageTransform> transforms; ///< Images added to every induced velocity.
+};
+
+/**
+ * @brief Builds the image system of a boundary.
+ *
+ * @param type "none", "ground" (wall at y_lower), "free_surface" (surface at y_upper) or "channel" (walls at y_lower and y_upper).
+ * @param y_lower Lower wall (meters).
+ * @param y_upper Upper wall or free surface (meters).
+ * @param reflections Number of reflections about each channel wall (>= 1, ignored otherwise).
+ * @return ImageSystem The image maps.
+ * @throws std::invalid_argument If the type is unknown, the channel walls are not ordered or reflections < 1.
+ */
+ImageSystem make_image_system(const string &type, double y_lower, double y_upper, int reflections);
+
+/**
+ * @brief y-coordinate of the mapped evaluation point of an image (S is double or a dual number, Dual.h).
+ */
+template <class S>
+inline S image_point_y(const ImageTransform &image, const S &y)
+{
+    return image.mirror ? 2.0 * image.offset - y : y - image.offset;
+}
+
+/**
+ * @brief Influence matrix of the images of a linear-strength vortex panel at a point.
+ *
+ * The sum over all images of the (2x2) influence matrix, so that
+ * (influence_matrix(...) + influence_matrix_images(...)) * [gamma_1, gamma_2] is the velocity induced by the panel
+ * and its images. Returns a zero matrix when there are no images.
+ *
+ * @see influence_matrix
+ */
+MatrixXd influence_matrix_images(double point1_x, double point1_y, double point2_x, double point2_y, double desired_point_x, double desired_point_y, const ImageSystem &images);
+
+/**
+ * @brief The image sum of influence_matrix_images for any scalar type (double or a dual number, Dual.h).
+ *
+ * @param P Output (2x2) sum of the image influence matrices (zero when there are no images).
+ * @see linear_vortex_panel_influence
+ */
+template <class S>
+void linear_vortex_panel_influence_images(const S &point1_x, const S &point1_y, const S &point2_x, const S &point2_y, const S &desired_point_x, const S &desired_point_y, const ImageSystem &images, S P[2][2])
+{
+    P[0][0] = P[0][1] = P[1][0] = P[1][1] = S(0.0);
+    for (size_t k = 0; k < images.transforms.size(); k++)
+    {
+        const ImageTransform &image = images.transforms[k];
+        S Pk[2][2];
+        linear_vortex_panel_influence(point1_x, point1_y, point2_x, point2_y, desired_point_x, image_point_y(image, desired_point_y), Pk);
+        for (int j = 0; j < 2; j++)
+        {
+            P[0][j] += image.cu * Pk[0][j];
+            P[1][j] += image.cv * Pk[1][j];
+        }
+    }
+}
+
+#endif // IMAGES_H
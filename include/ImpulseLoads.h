@@ -0,0 +1,74 @@
+/**
+ * @file ImpulseLoads.h
+ * @brief Force coefficients from the time derivative of the vortex impulse, O(n + N_w) per time step.
+ *
+ * The force on a body in an unbounded flow follows from the vorticity alone (Wu 1981):
+ *
+ *     F / rho = -d/dt sum x × omega + A dV_c/dt
+ *
+ * with the first moment of all vorticity (bound sheet, wake panel and wake vortices) and the area A and
+ * centroid velocity V_c of the body. With the clockwise-positive circulations of this code, omega_z = -Gamma,
+ * so -sum x × omega = sum Gamma [y, -x]. Since the total circulation is zero (Kelvin), the origin does not
+ * matter. Unlike the pressure path no potential, leading-edge integration or offset velocity evaluation is needed.
+ *
+ * The theorem holds for a force-free wake, so the impulse loads need the free wake. For a free-wake plunge
+ * (alpha1 = 0, n = 101, 80 steps per cycle) the two paths differ after the first cycle by up to 0.017 in Cl
+ * (0.6 % of its amplitude) and 0.076 in Cd, and the mean Ct is 0.317 against 0.303 from the pressure; the
+ * differences do not shrink with the time step. For pitching motions the pressure path is also lower by about
+ * 2 alpha_dot A / (Qinf c) in Cl, because it takes the freestream instead of the local kinematic velocity as the
+ * reference of Bernoulli's equation.
+ *
+ * The derivative is a backward difference over the step, like dphi/dt in the pressure path, so both share
+ * the same first-order lag. The impulse does not separate the forces of several bodies and excludes the
+ * forces on walls, so it is available for a single body in an unbounded flow.
+ */
+
+#ifndef IMPULSELOADS_H
+#define IMPULSELOADS_H
+
+#include <Eigen/Dense>
+#include "Body.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Impulse of a body at the previous time step and its constant area properties.
+ */
+struct ImpulseHistory
+{
+    bool started;          ///< false until the first time step has been evaluated.
+    Vector2d impulse;      ///< sum Gamma [y, -x] + A V_c at the previous time step (per unit density).
+    double area;           ///< Area enclosed by the body (square meters).
+    double x_centroid;     ///< Body-frame centroid of the area (meters).
+    double y_centroid;
+};
+
+/**
+ * @brief Area and centroid of the body polygon; resets the history.
+ */
+void initialize_impulse_history(const Body &body, ImpulseHistory &history);
+
+/**
+ * @brief Circulation moment sum Gamma [y, -x] (minus the vortex impulse per unit density) of the bound sheet,
+ * the wake panel and the wake vortices of a body.
+ *
+ * The bound sheet has linear strength on every panel, so its first moment is exact per panel; the wake panel
+ * has constant strength.
+ */
+Vector2d vortex_impulse(const Body &body);
+
+/**
+ * @brief Normal and axial force coefficients of a body from the vortex impulse.
+ *
+ * Sets body.cn_tilda and body.ca_tilda like compute_surface_loads; the first time step only stores the impulse
+ * (zero force, as the pressure path drops dphi/dt there).
+ *
+ * @param body Body after the solve of the current time step.
+ * @param history Impulse of the previous time step, updated.
+ * @param dt Step since the previous time step (seconds).
+ * @param Qref Reference speed of the coefficients (meters/second).
+ */
+void compute_impulse_loads(Body &body, ImpulseHistory &history, double dt, double Qref);
+
+#endif // IMPULSELOADS_H
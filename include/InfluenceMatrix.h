@@ -13,7 +13,10 @@
  #define INFLUENCEMATRIX_H
  
  #include <Eigen/Dense>
+ #include <cmath>
+ #include "constants.h"
  using namespace Eigen;
+ using namespace std;
  
  /**
   * @brief Computes the influence matrix for a linearly varying vortex panel.
@@ -31,6 +34,45 @@
   * @return MatrixXd (2x2) representing the influence matrix corresponding to a particular panel.
   */
  MatrixXd influence_matrix(double point1_x, double point1_y, double point2_x, double point2_y, double desired_point_x, double desired_point_y);
+
+ /**
+  * @brief Influence matrix of a linearly varying vortex panel for any scalar type.
+  *
+  * The computation behind influence_matrix, written for S = double or a dual number (Dual.h), so that the same
+  * operations also propagate derivatives with respect to the panel end points and the target point.
+  *
+  * @param P Output (2x2) influence matrix, P[i][j] = component i of the velocity induced by a unit strength at node j.
+  * @see influence_matrix
+  */
+ template <class S>
+ void linear_vortex_panel_influence(const S &point1_x, const S &point1_y, const S &point2_x, const S &point2_y, const S &desired_point_x, const S &desired_point_y, S P[2][2])
+ {
+     S dx = (point2_x - point1_x);
+     S dy = (point2_y - point1_y);
+     S li = sqrt(dx * dx + dy * dy);
+
+     /* target point in panel coordinates (along and normal to the panel, from its first node) */
+     S vec_x = desired_point_x - point1_x;
+     S vec_y = desired_point_y - point1_y;
+     S geta = (dx * vec_x + dy * vec_y) / li;
+     S eta = (-dy * vec_x + dx * vec_y) / li;
+     S phi = atan2((eta * li), ((eta * eta) + (geta * geta) - (geta * (li))));
+     S psi = 0.5 * log(((geta * geta) + (eta * eta)) / (((geta - li) * (geta - li)) + (eta * eta)));
+
+     S P2[2][2];
+     P2[0][0] = (li - geta) * phi + (eta * psi);
+     P2[0][1] = (geta * phi) - (eta * psi);
+     P2[1][0] = (eta * phi - (li - geta) * psi - li);
+     P2[1][1] = ((-eta * phi) - (geta * psi) + li);
+
+     /* back to the global frame with [dx, -dy; dy, dx] */
+     S scale = 2.0 * pi * li * li;
+     for (int j = 0; j < 2; j++)
+     {
+         P[0][j] = (dx * P2[0][j] + (-dy) * P2[1][j]) / scale;
+         P[1][j] = (dy * P2[0][j] + dx * P2[1][j]) / scale;
+     }
+ }
  
  #endif // INFLUENCEMATRIX_H
  
\ No newline at end of file
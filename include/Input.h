@@ -0,0 +1,65 @@
+/**
+ * @file Input.h
+ * @brief Reading of input.json shared by the modes: optional settings, the freestream speed and the bodies.
+ *
+ * An optional setting may be absent, or null as in the distributed input.json; both select its default.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <string>
+#include "json.hpp"
+#include "Body.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief Value of an optional setting of a block.
+ *
+ * @param block Block of the input (may itself be absent, i.e. null).
+ * @param key Name of the setting.
+ * @param fallback Default when the block or the setting is absent or null.
+ * @return T The setting, or fallback.
+ * @throws nlohmann::json::type_error If the setting has the wrong type.
+ */
+template <typename T>
+T optional_setting(const json &block, const string &key, const T &fallback)
+{
+    if (!block.is_object() || !block.contains(key) || block[key].is_null())
+    {
+        return fallback;
+    }
+    return block[key].get<T>();
+}
+
+/**
+ * @brief Freestream speed: flow.Qinf, or Re mu / (rho c) when it is null.
+ *
+ * @param flow The "flow" block.
+ * @param c Chord (meters).
+ */
+double freestream_speed(const json &flow, double c);
+
+/**
+ * @brief Number without trailing zeros, as it appears in the names of the output files.
+ */
+string double_to_string(double val, int precision = 3);
+
+/**
+ * @brief Builds one body from its geometry and motion blocks, placed at position [x, y] in the inertial frame.
+ *
+ * The sinusoidal pitch-plunge of the legacy keys (k, h0, h1, alpha0, alpha1, phi_h) is replaced by the optional
+ * plunge and pitch channels, and a surge channel may be added.
+ *
+ * @param geometry Geometry block.
+ * @param motion Motion block.
+ * @param position Position of the body-frame origin [x, y] (null: the inertial origin).
+ * @param Qinf Freestream speed (meters/second).
+ * @throws std::invalid_argument If a motion channel or the clustering is unknown.
+ * @throws std::runtime_error If an airfoil or motion table file cannot be read.
+ */
+Body make_body(json geometry, json motion, json position, double Qinf);
+
+#endif // INPUT_H
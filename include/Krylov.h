@@ -0,0 +1,39 @@
+/**
+ * @file Krylov.h
+ * @brief Restarted GMRES for matrix-free linear systems.
+ */
+
+#ifndef KRYLOV_H
+#define KRYLOV_H
+
+#include <Eigen/Dense>
+#include <functional>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Matrix-free linear operator: y = A x.
+ */
+typedef function<void(const VectorXd &x, VectorXd &y)> LinearOperator;
+
+/**
+ * @brief Solves A x = b with restarted, right-preconditioned GMRES.
+ *
+ * The Arnoldi basis is built for A M^-1, so the residual that is monitored is the true residual of A x = b.
+ * The iteration stops when ||b - A x|| <= tolerance ||b|| or after max_iterations matrix-vector products.
+ *
+ * @param A Operator of the system.
+ * @param preconditioner Approximate inverse M^-1 of A.
+ * @param b Right-hand side.
+ * @param x On entry the initial guess (e.g. the solution of the previous time step), on return the solution.
+ * @param restart Dimension of the Krylov space before a restart.
+ * @param max_iterations Maximum number of matrix-vector products.
+ * @param tolerance Relative residual at which the iteration stops.
+ * @param iterations On return the number of matrix-vector products used.
+ * @param relative_residual On return ||b - A x|| / ||b||.
+ * @return bool True if the tolerance was met, false if max_iterations ran out first (x is then the last iterate).
+ */
+bool gmres(const LinearOperator &A, const LinearOperator &preconditioner, const VectorXd &b, VectorXd &x, int restart, int max_iterations, double tolerance, int &iterations, double &relative_residual);
+
+#endif // KRYLOV_H
@@ -0,0 +1,42 @@
+/**
+ * @file Loads.h
+ * @brief Surface potential, unsteady pressure and force coefficients of a body.
+ */
+
+#ifndef LOADS_H
+#define LOADS_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include "Body.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Computes the potential, the pressure coefficients and the force coefficients of one body.
+ *
+ * @details The potential at the leading edge node, relative to the potential far upstream, is evaluated in
+ * closed form from the potentials of all bound panels, wake panels and wake vortices (O(n + N_w)). As a
+ * validation option it can instead be obtained by integrating the disturbance velocity along an approximate
+ * upstream stagnation streamline (z panels, sine-clustered towards the leading edge, 10 chords long), which
+ * costs z evaluations of the induced velocity. The potential at the nodes follows by integrating the tangential velocity along the surface, and the
+ * unsteady Bernoulli equation gives cp at the control points (dphi/dt = 0 in the first time step). The
+ * velocities are evaluated slightly off the surface, offset along the panel normals. On return the body holds
+ * phi_airfoil_cps, cp, cn_tilda, ca_tilda and phi_old (set to the current potential).
+ *
+ * @param bodies All bodies (the velocities include the influence of every body and wake).
+ * @param images Image system of the boundaries.
+ * @param b Index of the body whose loads are computed.
+ * @param iter Current time step index.
+ * @param dt Time step (seconds).
+ * @param Qinf Freestream speed at the current time (meters/second).
+ * @param Qref Reference speed of the pressure coefficient, the final freestream speed (meters/second).
+ * @param z Number of panels on the upstream stagnation streamline (quadrature only).
+ * @param offset Distance of the evaluation points from the surface (meters).
+ * @param phi_le_quadrature true: stagnation streamline quadrature for the leading-edge potential, false: closed form.
+ * @see potential_induced_all, velocity_induced_all, body_kinematic_velocity
+ */
+void compute_surface_loads(vector<Body> &bodies, const ImageSystem &images, int b, int iter, double dt, double Qinf, double Qref, int z, double offset, bool phi_le_quadrature);
+
+#endif // LOADS_H
@@ -1,67 +1,130 @@
+/**
+ * @file MotionParameters.h
+ * @brief Prescribed rigid-body kinematics: motion channels, motion profiles and the per-step rigid-body state.
+ *
+ * The motion of a body is described by three channels of time: the plunge h(t) (positive downwards), the
+ * pitch angle alpha(t) (positive nose-up) and the surge displacement x_s(t) along the freestream. Each channel
+ * is an analytic sinusoid, a Fourier series, a tabulated time series interpolated with a cubic spline or a
+ * smooth ramp between two values (the same channels also describe the impulsive or ramped start of the
+ * freestream). The profile is evaluated once per time step
+ * into a RigidBodyState holding the position, angle and velocities of the body, which is then used for every
+ * node and control point of that step.
+ */
+
 #ifndef MOTIONPARAMETERS_H
 #define MOTIONPARAMETERS_H
 
 #include <Eigen/Dense>
+#include <string>
+#include "Spline.h"
 
 using namespace Eigen;
+using namespace std;
 
 /**
- * @brief Computes the instantaneous heaving displacement vector.
+ * @brief One prescribed degree of freedom as a function of time.
  *
- * Calculates the heaving displacement of an airfoil at a given time, based on a sinusoidal motion
- * model. The displacement is returned as a 3D vector, with the y-component representing the
- * heaving motion (negative sign indicates downward motion is positive).
- *
- * @param h0 Heaving offset (meters).
- * @param h1 Heaving amplitude (meters).
- * @param phi_h Heaving phase angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
- * @return VectorXd A 3D vector [0, -h, 0] where h is the heaving displacement.
+ * - "sinusoid": offset + amplitude * sin(omega t + phase)
+ * - "fourier":  offset + sum_k a_k cos(k omega t) + b_k sin(k omega t), k = 1, 2, ...
+ * - "table":    cubic spline through (t_i, value_i); with periodic = true the time is wrapped into the table range
+ * - "ramp":     value_start + (value_end - value_start) s(tau), s(tau) = (1 - cos(pi tau)) / 2, tau = (t - t_start) / duration
+ *               clamped to [0, 1]; a zero duration gives a step at t_start
  */
-VectorXd h_instantaneous(double h0, double h1, double phi_h, double t, double omega);
+struct MotionChannel
+{
+    string type;               ///< "sinusoid", "fourier", "table" or "ramp".
+    double offset;             ///< Mean value (sinusoid, fourier).
+    double amplitude;          ///< Amplitude (sinusoid).
+    double phase;              ///< Phase (radians, sinusoid).
+    double omega;              ///< Angular frequency (radians/second, sinusoid and fourier).
+    VectorXd a, b;             ///< Cosine and sine coefficients of the harmonics 1, 2, ... (fourier).
+    CubicSpline table;         ///< Spline through the tabulated values (table).
+    bool periodic;             ///< Wrap the time into the table range (table).
+    double value_start;        ///< Value before the ramp (ramp).
+    double value_end;          ///< Value after the ramp (ramp).
+    double t_start;            ///< Start of the ramp (seconds).
+    double duration;           ///< Duration of the ramp (seconds).
+};
 
 /**
- * @brief Computes the instantaneous heaving velocity vector.
- *
- * Calculates the heaving velocity of an airfoil at a given time, based on the derivative of the
- * sinusoidal heaving motion. The velocity is returned as a 3D vector, with the y-component
- * representing the heaving velocity (negative sign indicates downward velocity is positive).
- *
- * @param h1 Heaving amplitude (meters).
- * @param phi_h Heaving phase angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
- * @return VectorXd A 3D vector [0, -h_dot, 0] where h_dot is the heaving velocity.
+ * @brief A constant or sinusoidal channel, offset + amplitude * sin(omega t + phase).
  */
-VectorXd h_dot_instantaneous(double h1, double phi_h, double t, double omega);
+MotionChannel sinusoid_channel(double offset, double amplitude, double phase, double omega);
 
 /**
- * @brief Computes the instantaneous pitch angle.
- *
- * Calculates the pitch angle of an airfoil at a given time, based on a sinusoidal motion model.
+ * @brief A Fourier series channel, offset + sum_k a_k cos(k omega t) + b_k sin(k omega t).
+ * @throws std::invalid_argument If a and b differ in size.
+ */
+MotionChannel fourier_channel(double offset, const VectorXd &a, const VectorXd &b, double omega);
+
+/**
+ * @brief A tabulated channel interpolated with a natural cubic spline.
+ * @throws std::invalid_argument If the table has fewer than two entries or the times are not increasing.
+ */
+MotionChannel table_channel(const VectorXd &times, const VectorXd &values, bool periodic);
+
+/**
+ * @brief A smooth (1 - cos) ramp from value_start to value_end; a zero duration gives a step.
+ */
+MotionChannel ramp_channel(double value_start, double value_end, double t_start, double duration);
+
+/**
+ * @brief Reads a two-column (time, value) motion table; blank lines and lines starting with '#' are skipped.
+ * @throws std::runtime_error If the file cannot be opened or holds fewer than two rows.
+ */
+void read_motion_table(const string &filename, VectorXd &times, VectorXd &values);
+
+/**
+ * @brief Evaluates a channel and its time derivative.
  *
- * @param alpha0 Pitch angle offset (radians).
- * @param alpha1 Pitch angle amplitude (radians).
- * @param phi_alpha Pitch phase angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
- * @return double The instantaneous pitch angle (radians).
+ * @param channel Channel to evaluate.
+ * @param t Time (seconds).
+ * @param value Output value.
+ * @param rate Output time derivative.
+ * @throws std::invalid_argument If the channel type is unknown.
  */
-double alpha_instantaneous(double alpha0, double alpha1, double phi_alpha, double t, double omega);
+void evaluate_channel(const MotionChannel &channel, double t, double &value, double &rate);
 
 /**
- * @brief Computes the instantaneous pitch angular velocity.
+ * @brief Complete prescribed motion of one body.
+ */
+struct MotionProfile
+{
+    MotionChannel plunge;      ///< h(t), positive downwards (meters).
+    MotionChannel pitch;       ///< alpha(t), positive nose-up (radians).
+    MotionChannel surge;       ///< x_s(t), displacement along +x (meters).
+    double x_pitch, y_pitch;   ///< Pitch axis in the body-fixed frame (meters).
+    double x_offset, y_offset; ///< Position of the body-frame origin in the inertial frame (meters).
+};
+
+/**
+ * @brief Position, orientation and velocities of a body at one instant.
  *
- * Calculates the pitch angular velocity of an airfoil at a given time, based on the derivative of
- * the sinusoidal pitch motion.
+ * A point (x_b, y_b) of the body-fixed frame lies in the inertial frame at
+ * [pivot_x, pivot_y] + R(alpha) [x_b - x_pitch, y_b - y_pitch], with R = [cos, sin; -sin, cos],
+ * and moves with [pivot_u, pivot_v] + (-alpha_dot) e_z x r, r being its offset from the pivot.
+ * S is double or a dual number (Dual.h) carrying the derivatives of the state with respect to motion parameters.
+ */
+template <class S>
+struct BasicRigidBodyState
+{
+    S alpha, alpha_dot;       ///< Pitch angle (radians) and pitch rate (radians/second).
+    S cos_alpha, sin_alpha;   ///< Cached cos(alpha) and sin(alpha).
+    S x_pitch, y_pitch;       ///< Pitch axis in the body-fixed frame (meters).
+    S pivot_x, pivot_y;       ///< Pitch axis in the inertial frame (meters).
+    S pivot_u, pivot_v;       ///< Velocity of the pitch axis (meters/second).
+};
+
+typedef BasicRigidBodyState<double> RigidBodyState;
+
+/**
+ * @brief Evaluates a motion profile at time t.
  *
- * @param alpha1 Pitch angle amplitude (radians).
- * @param phi_alpha Pitch phase angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
- * @return double The instantaneous pitch angular velocity (radians/second).
+ * @param motion Motion profile of the body.
+ * @param t Time (seconds).
+ * @return RigidBodyState The state used for all the nodes and control points of this time step.
+ * @see evaluate_channel
  */
-double alpha_dot_instantaneous(double alpha1, double phi_alpha, double t, double omega);
+RigidBodyState rigid_body_state(const MotionProfile &motion, double t);
 
-#endif // MOTIONPARAMETERS_H
\ No newline at end of file
+#endif // MOTIONPARAMETERS_H
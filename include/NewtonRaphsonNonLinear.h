@@ -6,6 +6,8 @@
 #include "VectorOperations.h"
 #include "InfluenceMatrix.h"
 #include "velocity.h"
+#include "Body.h"
+#include "CoupledSystem.h"
 
 using namespace Eigen;
 using namespace std;
@@ -13,39 +15,42 @@ using namespace std;
 /**
  * @brief Computes the residuals for the Newton-Raphson solver.
  * 
- * @details This function calculates the wake panel's influence, constructs the A_unsteady 
- * matrix, and solves for the unsteady circulation. It also determines the total velocity at 
- * the wake panel control point, including contributions from bound vortices, wake vortices, 
- * and the freestream. The function returns the residuals used for iterative correction.
+ * @details This function places the wake panel of every body at its trailing edge with the guessed length and
+ * orientation, solves the coupled system for the unsteady circulation and determines the total velocity at
+ * each wake panel control point, including contributions from the bound vortices and wake vortices of all
+ * bodies, the wake panels of the other bodies and the freestream. The function returns the residuals used
+ * for iterative correction.
  *
-*
- * @param n Number of nodes on the airfoil.
+ * @param bodies All bodies; their wake panel geometry, gamma_bound, gamma_wp and vtotal_wp_cp are updated.
+ * @param system Coupled system whose bound part and right-hand side are assembled for the current time step.
  * @param dt Time step (seconds).
- * @param t Current time (seconds).
- * @param lwp Length of the wake panel (meters).
- * @param theta_wp Orientation angle of the wake panel (radians).
  * @param freestream Freestream velocity vector [u, v] in the inertial frame (meters/second).
- * @param vtotal_wp_cp Output vector for the total velocity at the wake panel’s control point [u, v] (meters/second).
- * @param x_pp Vector of airfoil panel node x-coordinates (size n, meters).
- * @param y_pp Vector of airfoil panel node y-coordinates (size n, meters).
- * @param x_cp Vector of airfoil control point x-coordinates (size n-1, meters).
- * @param y_cp Vector of airfoil control point y-coordinates (size n-1, meters).
- * @param l Vector of airfoil panel lengths (size n-1, meters).
- * @param B_unsteady Right-hand side vector for the unsteady system (size n+1).
- * @param gamma_unsteady Output vector of vortex strengths for airfoil and wake panels (size n+1).
- * @param gamma_old Circulation from the previous time step (meters²/second).
- * @param gamma_bound Output vector of airfoil vortex strengths (size n).
- * @param gamma_wake_strength Vector of wake vortex strengths (meters²/second).
- * @param gamma_wake_x_location Vector of wake vortex x-coordinates (meters).
- * @param gamma_wake_y_location Vector of wake vortex y-coordinates (meters).
- * @param wake_panel_cp Output vector for the wake panel’s control point [x, y] (meters).
- * @param wake_panel_normal Output vector for the wake panel’s unit normal [nx, ny].
- * @param A_unsteady Output matrix for the unsteady influence coefficients (size (n+1) x (n+1)).
- * @param unit_normal Matrix of airfoil panel unit normals (size (n-1) x 2).
- * @param wake_panel_coordinates Matrix of wake panel node coordinates (size 2 x 2, [x0, y0; x1, y1], meters).
- * @return VectorXd A 2D vector of residuals [length_residual, angle_residual] for the Newton-Raphson solver.
- * @see influence_matrix, velocity_bound_vortices, velocity_induced_due_to_discrete_vortex, dot, magnitude
+ * @param lwp Lengths of the wake panels, one per body (meters).
+ * @param theta_wp Orientation angles of the wake panels, one per body (radians).
+ * @return VectorXd Residuals [length_residual, angle_residual] of every body (size 2 x number of bodies).
+ * @see solve_coupled_system, velocity_bound_vortices_all, velocity_wake_vortices_all, velocity_wake_panels_all
  */
-VectorXd newton_raphson(int n, double dt, double t, double lwp, double theta_wp, VectorXd freestream, VectorXd &vtotal_wp_cp, VectorXd &x_pp, VectorXd &y_pp, VectorXd &x_cp, VectorXd &y_cp, VectorXd &l, VectorXd &B_unsteady, VectorXd &gamma_unsteady, double gamma_old, VectorXd &gamma_bound, vector<double> &gamma_wake_strength, vector<double> &gamma_wake_x_location, vector<double> &gamma_wake_y_location, VectorXd &wake_panel_cp, VectorXd &wake_panel_normal, MatrixXd &A_unsteady, MatrixXd &unit_normal, MatrixXd &wake_panel_coordinates);
+VectorXd newton_raphson(vector<Body> &bodies, CoupledSystem &system, double dt, const VectorXd &freestream, const VectorXd &lwp, const VectorXd &theta_wp);
 
-#endif // NEWTONRAPHSONNONLINEAR_H
\ No newline at end of file
+/**
+ * @brief Iterates the lengths and orientations of all wake panels to convergence.
+ *
+ * @details Newton-Raphson with a forward-difference Jacobian, starting from the lwp and theta_wp stored in
+ * the bodies (the converged values of the previous time step). On return the bodies hold the converged wake
+ * panels and the corresponding solution of the coupled system.
+ *
+ * @param bodies All bodies.
+ * @param system Coupled system assembled for the current time step.
+ * @param dt Time step that ended at the current time (seconds), over which the wake panel was shed.
+ * @param freestream Freestream velocity vector [u, v] (meters/second).
+ * @param epsilon Perturbation for the finite differences.
+ * @param tolerance Convergence tolerance on the magnitude of the Newton update.
+ * @param max_iterations Largest number of Newton iterations.
+ * @return int Number of Newton iterations.
+ * @throws std::runtime_error If the update is still above the tolerance after max_iterations iterations (a
+ *         diverging or cycling iteration, typically from too large a time step), or if a GMRES solve of the
+ *         coupled system does not converge.
+ */
+int converge_wake_panels(vector<Body> &bodies, CoupledSystem &system, double dt, const VectorXd &freestream, double epsilon, double tolerance, int max_iterations);
+
+#endif // NEWTONRAPHSONNONLINEAR_H
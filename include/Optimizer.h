@@ -0,0 +1,108 @@
+/**
+ * @file Optimizer.h
+ * @brief Derivative-free optimisation of the pitch-plunge kinematics, with the candidates of every generation
+ *        evaluated concurrently.
+ *
+ * The optimiser maximises the propulsive efficiency or the mean thrust coefficient of the last cycle of a single
+ * pitching and plunging foil over any subset of k, h1, alpha1, phi_h and x_pitch, each within bounds. It is a
+ * covariance matrix adaptation evolution strategy (CMA-ES) in coordinates normalised by the bounds:
+ *
+ * - every generation samples lambda candidates around the mean from the adapted normal distribution, mirrors them
+ *   into the bounds and evaluates them concurrently on a pool of threads, each candidate being one plain march
+ *   (pitch_plunge_performance) that shares the factorised influence matrix of the foil;
+ * - the mu best candidates move the mean, and the evolution paths adapt the covariance and the step size;
+ * - it stops after the given number of generations or when the step size falls below the tolerance.
+ *
+ * Candidates are ranked by their objective. With a thrust constraint (min_ct), candidates below it rank after all
+ * others, by their thrust; candidates whose march failed or has no efficiency (no mean input power) rank last. The
+ * candidates are drawn by the calling thread from a seeded generator, so a run is reproducible whatever the number
+ * of threads.
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <vector>
+#include "Sensitivity.h"
+
+using namespace std;
+
+/**
+ * @brief Quantity maximised by the optimiser (of the last cycle).
+ */
+enum OptimizationObjective
+{
+    objective_efficiency, ///< Propulsive efficiency.
+    objective_thrust      ///< Mean thrust coefficient.
+};
+
+/**
+ * @brief Settings of the optimiser; parameters are indexed by KinematicParameter, in the units of
+ *        PitchPlungeParameters (radians for the angles).
+ */
+struct OptimizationSettings
+{
+    OptimizationObjective objective;        ///< Maximised quantity.
+    bool active[kinematic_parameter_count]; ///< Parameters varied by the optimiser; the others keep their start values.
+    double lower[kinematic_parameter_count], upper[kinematic_parameter_count]; ///< Bounds of the active parameters.
+    int population;   ///< Candidates per generation (lambda).
+    int generations;  ///< Largest number of generations.
+    double sigma;     ///< Initial step size, as a fraction of the bounds.
+    double tolerance; ///< Stop when the largest step falls below this fraction of the bounds.
+    double min_ct;    ///< Smallest admissible mean thrust coefficient (NaN = none).
+    int jobs;         ///< Candidates evaluated concurrently.
+    unsigned seed;    ///< Seed of the random generator.
+};
+
+/**
+ * @brief An evaluated candidate.
+ */
+struct OptimizationCandidate
+{
+    int generation;                    ///< Generation, 0 for the start point.
+    PitchPlungeParameters parameters;  ///< Kinematics of the candidate.
+    bool completed;                    ///< false when the march failed (the performance is NaN).
+    CyclePerformance performance;      ///< Performance of the last cycle.
+};
+
+/**
+ * @brief Evaluations and best candidate of an optimisation.
+ */
+struct OptimizationResult
+{
+    vector<OptimizationCandidate> history; ///< All evaluated candidates, the start point first, in generation order.
+    int best;                              ///< Index of the best candidate in the history.
+    int generations;                       ///< Generations run.
+    double step;                           ///< Largest step at the end, as a fraction of the bounds.
+};
+
+/**
+ * @brief Maximises the objective over the active parameters.
+ *
+ * Prints one progress line per generation to the standard output.
+ *
+ * @param foil Shared geometry and factorisation (initialize_pitch_plunge_foil).
+ * @param start Start point; its active parameters are clipped into the bounds.
+ * @param settings Flow and march settings of every candidate.
+ * @param optimization Settings of the optimiser.
+ * @return OptimizationResult Evaluated candidates and the best one.
+ * @throws std::invalid_argument If no parameter is active, the bounds are empty or a setting is out of range.
+ */
+OptimizationResult optimize_pitch_plunge(const PitchPlungeFoil &foil, const PitchPlungeParameters &start, const PitchPlungeSettings &settings, const OptimizationSettings &optimization);
+
+/**
+ * @brief Optimize mode: searches the kinematics within the bounds of the "optimize" block.
+ *
+ * Writes every candidate to output_files/optimize.dat and the input of the best one, ready to be run as an
+ * unsteady simulation, to output_files/optimize_best.json.
+ *
+ * @param input Complete input of the solver.
+ * @param body Body of the marches, initialised with initialize_body; its kinematics are the starting point.
+ * @param settings Flow and march settings.
+ * @param k Reduced frequency of the input.
+ * @param wall_start Start of the run, for the reported wall time.
+ * @return int Exit status of the solver: 0, or 1 on an error or when no candidate completed its march.
+ */
+int run_optimize(json input, const Body &body, const PitchPlungeSettings &settings, double k, chrono::high_resolution_clock::time_point wall_start);
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,124 @@
+/**
+ * @file OutputControl.h
+ * @brief When the per-step output files are written, and an incremental binary stream of the wake.
+ *
+ * Every per-step output (wake, airfoil motion, pressure, potential, circulations, matrix, right-hand side and
+ * normals) has its own trigger: a stride in time steps and/or a phase step, e.g. every 45 degrees of the cycle.
+ *
+ * Rewriting the whole wake every step makes the output grow as O(steps^2). The wake stream instead appends one
+ * record per written step with the body states, the wake panels, the newly shed vortices and the motion of the
+ * older vortices since the previous record. Positions are quantised to integer multiples of a quantum and the
+ * motion is stored as integer differences of the quantised positions, so no error accumulates: a reconstructed
+ * position is within half a quantum of the simulated one. A prescribed wake moves all older vortices by the same
+ * step and takes a single difference per record. The stream starts with the 8 characters "PANKHWAK", the int32
+ * version (1) and number of bodies, the float64 quantum and the float64 body-frame nodes of every body; records
+ * follow as described in OutputControl.cpp, all in the byte order of the machine.
+ */
+
+#ifndef OUTPUTCONTROL_H
+#define OUTPUTCONTROL_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Body.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief Steps at which one per-step output is written.
+ */
+struct OutputTrigger
+{
+    int stride;        ///< Write every stride time steps (0: never by stride).
+    double phase_step; ///< Write at the first step at or after every multiple of this phase (degrees, 0: never by phase).
+};
+
+/**
+ * @brief Whether an output is due at a time step.
+ *
+ * @param trigger Stride and phase step of the output.
+ * @param iter Time step index.
+ * @param cycles Time of the step in cycles (t / T; 0 for non-periodic motions).
+ * @param cycles_previous Time of the previous step in cycles.
+ * @return bool true on a multiple of the stride, or when a multiple of the phase step lies in (previous, current]
+ *         (and at the first step).
+ */
+bool output_due(const OutputTrigger &trigger, int iter, double cycles, double cycles_previous);
+
+/**
+ * @brief Writer state of a wake stream: the quantised positions of the previous record.
+ */
+struct WakeStreamWriter
+{
+    ofstream file;
+    double quantum;                            ///< Position quantum (meters).
+    vector<vector<int64_t>> qx, qy;            ///< Quantised wake vortex positions of the previous record per body.
+};
+
+/**
+ * @brief Reader state of a wake stream.
+ */
+struct WakeStreamReader
+{
+    ifstream file;
+    double quantum;
+    vector<VectorXd> x0, y0;                   ///< Body-frame nodes of every body.
+    vector<vector<int64_t>> qx, qy;            ///< Quantised positions of the last record read.
+    vector<vector<double>> gamma;              ///< Strengths of the wake vortices.
+};
+
+/**
+ * @brief One reconstructed record of a wake stream.
+ */
+struct WakeStreamSnapshot
+{
+    int iter;                                  ///< Time step index.
+    double t;                                  ///< Time (seconds).
+    vector<VectorXd> x_nodes, y_nodes;         ///< Airfoil nodes of every body in the inertial frame.
+    vector<Matrix2d> wake_panel;               ///< Wake panel end points (rows) of every body.
+    vector<vector<double>> x, y, gamma;        ///< Wake vortices of every body.
+};
+
+/**
+ * @brief Creates a wake stream and writes its header.
+ *
+ * @throws std::runtime_error If the file cannot be opened.
+ * @throws std::invalid_argument If the quantum is not positive.
+ */
+void open_wake_stream(const string &filename, const vector<Body> &bodies, double quantum, WakeStreamWriter &writer);
+
+/**
+ * @brief Appends the record of the current time step (after the solve, before the wakes are convected).
+ *
+ * @throws std::runtime_error If the record cannot be written.
+ */
+void append_wake_stream(WakeStreamWriter &writer, const vector<Body> &bodies, int iter, double t);
+
+/**
+ * @brief Opens a wake stream and reads its header.
+ *
+ * @throws std::runtime_error If the file cannot be read or is not a wake stream of this format.
+ */
+void open_wake_stream_reader(const string &filename, WakeStreamReader &reader);
+
+/**
+ * @brief Reads the next record and reconstructs the full snapshot.
+ *
+ * @return bool false at the end of the stream.
+ * @throws std::runtime_error If the record is truncated or inconsistent.
+ */
+bool read_wake_stream(WakeStreamReader &reader, WakeStreamSnapshot &snapshot);
+
+/**
+ * @brief Unpack mode: rebuilds the wake and motion files of every record of a wake stream next to the stream.
+ *
+ * @param filename Wake stream written by the incremental wake output.
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ */
+int run_unpack(const string &filename);
+
+#endif // OUTPUTCONTROL_H
@@ -0,0 +1,80 @@
+/**
+ * @file Performance.h
+ * @brief Pitching moment, input power and cycle-averaged propulsive performance of a body, evaluated online.
+ *
+ * The panel forces -cp l n (per unit 1/2 rho Qref^2) of the pressure path give the pitching moment about the
+ * pitch axis and, with the pivot velocity and the pitch rate, the power the body puts into the fluid:
+ *
+ *     P = -F . V_pivot - M alpha_dot,    Cpower = P / (1/2 rho Qref^3 c)
+ *
+ * with the nose-up moment M (alpha and alpha_dot are positive nose-up). The thrust coefficient is Ct = -Ca.
+ * The accumulator integrates Ct and Cpower over consecutive windows (one period for periodic motions) with the
+ * trapezoidal rule and reports their means, their root mean squares and the propulsive efficiency
+ * eta = mean Ct / mean Cpower, so that no pressure distributions need to be stored for the post-processing.
+ */
+
+#ifndef PERFORMANCE_H
+#define PERFORMANCE_H
+
+#include "Body.h"
+
+/**
+ * @brief Means over one window (cycle) of the thrust and power coefficients.
+ */
+struct CyclePerformance
+{
+    int cycle;           ///< Index of the window, starting at 0.
+    double ct_mean;      ///< Mean thrust coefficient.
+    double ct_rms;       ///< Root mean square of the thrust coefficient.
+    double cpower_mean;  ///< Mean input power coefficient.
+    double cpower_rms;   ///< Root mean square of the input power coefficient.
+    double efficiency;   ///< Propulsive efficiency mean Ct / mean Cpower (NaN without mean input power).
+};
+
+/**
+ * @brief Running trapezoidal integrals of Ct and Cpower over the current window.
+ */
+struct PerformanceAccumulator
+{
+    double window;          ///< Length of a window (seconds), one period for periodic motions.
+    int cycle;              ///< Index of the current window.
+    bool started;           ///< false until the first sample.
+    double t_last;          ///< Time of the last sample (seconds).
+    double ct_last, cpower_last;
+    double ct_integral, ct2_integral, cpower_integral, cpower2_integral;
+};
+
+/**
+ * @brief Pitching moment and input power coefficients of a body from its pressure coefficients.
+ *
+ * @param body Body after compute_surface_loads (cp, panels and state of the current time step).
+ * @param Qref Reference speed of the pressure coefficient (meters/second).
+ * @param cm Output pitching moment coefficient about the pitch axis, positive nose-up.
+ * @param cpower Output input power coefficient, positive when the body works on the fluid.
+ * @see compute_surface_loads
+ */
+void compute_moment_and_power(const Body &body, double Qref, double &cm, double &cpower);
+
+/**
+ * @brief Resets the accumulator.
+ *
+ * @param accumulator Accumulator to reset.
+ * @param window Length of a window (seconds).
+ */
+void initialize_performance_accumulator(PerformanceAccumulator &accumulator, double window);
+
+/**
+ * @brief Adds a sample; a window is completed when the samples reach its end.
+ *
+ * @details Samples straddling the end of a window are split by linear interpolation, so adaptive time steps
+ * need not land on the window boundaries.
+ *
+ * @param accumulator Accumulator of the body.
+ * @param t Time of the sample (seconds), increasing.
+ * @param ct Thrust coefficient.
+ * @param cpower Input power coefficient.
+ * @param completed Output windows completed by this sample, in order.
+ */
+void add_performance_sample(PerformanceAccumulator &accumulator, double t, double ct, double cpower, vector<CyclePerformance> &completed);
+
+#endif // PERFORMANCE_H
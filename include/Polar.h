@@ -0,0 +1,66 @@
+/**
+ * @file Polar.h
+ * @brief Steady lift, drag and moment polar of an airfoil from a single factorisation.
+ *
+ * In the body frame the steady influence matrix (no-penetration rows and the Kutta row) does not depend on
+ * the angle of attack; only the right-hand side -V_inf . n does. The matrix is therefore factorised once and
+ * all angles are solved together as one multi-right-hand-side block. The surface velocities of all angles
+ * follow from one product with a precomputed velocity influence matrix, so the cost of a polar is that of
+ * one steady solve plus a few matrix-matrix products.
+ */
+
+#ifndef POLAR_H
+#define POLAR_H
+
+#include <Eigen/Dense>
+#include "json.hpp"
+#include "Body.h"
+
+using namespace Eigen;
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief Steady solutions and coefficients of a body for a list of angles of attack.
+ */
+struct SteadyPolar
+{
+    VectorXd alpha;     ///< Angles of attack (radians).
+    VectorXd cl;        ///< Lift coefficient from pressure integration.
+    VectorXd cl_kj;     ///< Lift coefficient from the Kutta-Joukowski theorem, 2 Gamma / (Qinf c).
+    VectorXd cd;        ///< Pressure drag coefficient (zero up to discretisation error).
+    VectorXd cm;        ///< Pitching moment coefficient about the reference point, positive nose-up.
+    VectorXd x_cp;      ///< Body-frame x-coordinates of the control points (size n-1).
+    MatrixXd cp;        ///< Pressure coefficients, one column per angle (size (n-1) x number of angles).
+    MatrixXd gamma;     ///< Nodal vortex strengths, one column per angle (size n x number of angles).
+};
+
+/**
+ * @brief Solves the steady flow past a body for all angles of attack with one factorisation of A_self.
+ *
+ * The freestream of angle alpha is Qinf [cos(alpha), sin(alpha)] in the body frame (positive alpha is
+ * nose-up). The velocities are evaluated slightly off the surface, offset along the panel normals, as in the
+ * unsteady loads; lift and drag are the body-frame force coefficients resolved in the wind axes.
+ *
+ * @param body Initialised body (n, c, x0, y0 and A_self are used; the motion is ignored).
+ * @param Qinf Freestream speed (meters/second).
+ * @param alpha Angles of attack (radians).
+ * @param x_ref Body-frame x-coordinate of the moment reference point on the chord line (meters).
+ * @param offset Distance of the velocity evaluation points from the surface (meters).
+ * @param polar Output polar.
+ * @see initialize_body, compute_surface_loads
+ */
+void solve_steady_polar(const Body &body, double Qinf, const VectorXd &alpha, double x_ref, double offset, SteadyPolar &polar);
+
+/**
+ * @brief Polar mode: the steady polar of the top-level geometry for the angles of the "polar" block.
+ *
+ * Writes Cl, Cd and Cm per angle to output_files/polar_n=<n>.dat and the pressure distributions to
+ * output_files/polar_cp_n=<n>.dat.
+ *
+ * @param input Complete input of the solver.
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ */
+int run_polar(json input);
+
+#endif // POLAR_H
@@ -0,0 +1,170 @@
+/**
+ * @file Sensitivity.h
+ * @brief Cycle-averaged thrust, input power and efficiency of a pitching and plunging foil and their derivatives
+ *        with respect to the kinematic parameters, by forward-mode automatic differentiation of the time march.
+ *
+ * The march is the unsteady simulation of a single foil in an unbounded flow with the legacy sinusoidal motion
+ *
+ *     h(t) = h0 + h1 sin(omega t + phi_h),  alpha(t) = alpha0 + alpha1 sin(omega t + phi_h + 90 deg),
+ *     omega = 2 k Qinf / c,  dt = T / nsteps,
+ *
+ * a fixed time step, the direct solver and the pressure loads. It is written once for a scalar type S and run
+ * either with S = double (the plain march, used for candidate evaluations) or with S = Dual<5> (Dual.h), seeded
+ * with the five parameters k, h1, alpha1, phi_h and x_pitch. One dual march then returns the cycle means and their
+ * gradients with respect to all five parameters: the derivatives follow the geometry, the right-hand sides, the
+ * wake panel Newton iterations, the wake convection and the load integration of every step.
+ *
+ * The bound influence matrix K of a single rigid body depends on its body-frame nodes only, so it is factorised
+ * once in double precision and shared: its solves apply to the value and to the five derivative columns as one
+ * block. The Newton iterations of the free wake use the finite-difference Jacobian of the values only; once they
+ * have converged, one more update corrects the derivatives (the tangents of the converged panel), so the
+ * derivatives are those of the converged solution and not of the iteration history.
+ *
+ * The march mirrors the assembly of the unsteady simulation for this configuration (Body, CoupledSystem, Loads and
+ * Performance), which stays in double precision; the two agree to round-off.
+ */
+
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <vector>
+#include "json.hpp"
+#include "Body.h"
+#include "Dual.h"
+#include "Performance.h"
+
+using namespace Eigen;
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief Indices of the differentiated kinematic parameters.
+ */
+enum KinematicParameter
+{
+    parameter_k,       ///< Reduced frequency.
+    parameter_h1,      ///< Plunge amplitude (meters).
+    parameter_alpha1,  ///< Pitch amplitude (radians).
+    parameter_phi_h,   ///< Plunge phase (radians).
+    parameter_x_pitch, ///< Pitch axis (meters).
+    kinematic_parameter_count
+};
+
+/**
+ * @brief A value and its derivatives with respect to the kinematic parameters.
+ */
+typedef Dual<kinematic_parameter_count> KinematicDual;
+
+/**
+ * @brief Sinusoidal pitch-plunge kinematics of the foil (angles in radians).
+ */
+struct PitchPlungeParameters
+{
+    double k;                ///< Reduced frequency k = omega c / (2 Qinf).
+    double h0, h1;           ///< Mean plunge and plunge amplitude (meters).
+    double alpha0, alpha1;   ///< Mean pitch angle and pitch amplitude (radians).
+    double phi_h;            ///< Plunge phase (radians); the pitch leads by 90 degrees.
+    double x_pitch, y_pitch; ///< Pitch axis in the body-fixed frame (meters).
+};
+
+/**
+ * @brief Flow and march settings shared by all evaluations.
+ */
+struct PitchPlungeSettings
+{
+    double c;               ///< Chord length (meters).
+    double Qinf, Vinf;      ///< Freestream components (meters/second).
+    double inflow_duration; ///< Duration of the (1 - cos) start of the freestream, 0 for an impulsive start (seconds).
+    int nsteps, ncycles;    ///< Time steps per cycle and number of cycles.
+    int wake;               ///< 0 = free wake, 1 = prescribed wake.
+    bool prescribed_wake_panel; ///< Wake panel of the prescribed wake from the kinematics instead of by Newton.
+    double epsilon;         ///< Perturbation of the Newton finite differences.
+    double tolerance;       ///< Convergence tolerance of the Newton update.
+    int max_newton_iterations; ///< Newton iterations after which the march fails.
+    int z;                  ///< Points of the stagnation streamline quadrature.
+    double offset;          ///< Offset of the surface velocity evaluation.
+    bool phi_le_quadrature; ///< Leading-edge potential by quadrature instead of in closed form.
+};
+
+/**
+ * @brief Body-frame geometry of the foil and the factorisation of its bound influence matrix, shared by all marches.
+ */
+struct PitchPlungeFoil
+{
+    int n;                       ///< Number of nodes.
+    VectorXd x0, y0;             ///< Body-frame nodes (size n).
+    PartialPivLU<MatrixXd> lu;   ///< Factorisation of the self-influence block with the Kutta row.
+};
+
+/**
+ * @brief Cycle means of one cycle and their derivatives with respect to the kinematic parameters.
+ */
+struct CycleSensitivity
+{
+    int cycle;                  ///< Index of the cycle, starting at 0.
+    KinematicDual ct_mean;      ///< Mean thrust coefficient.
+    KinematicDual cpower_mean;  ///< Mean input power coefficient.
+    KinematicDual efficiency;   ///< Propulsive efficiency (NaN without mean input power).
+};
+
+/**
+ * @brief Factorises the bound influence matrix of a body for the marches.
+ *
+ * @param body Body initialised with initialize_body (A_self cached).
+ * @param foil Output shared geometry and factorisation.
+ * @throws std::invalid_argument If the body has no cached self-influence block.
+ */
+void initialize_pitch_plunge_foil(const Body &body, PitchPlungeFoil &foil);
+
+/**
+ * @brief Plain (double) march: the performance of every completed cycle.
+ *
+ * Safe to call concurrently on the same foil.
+ *
+ * @param foil Shared geometry and factorisation.
+ * @param parameters Kinematics of the foil.
+ * @param settings Flow and march settings.
+ * @return vector<CyclePerformance> One entry per cycle.
+ * @throws std::runtime_error If a wake panel does not converge in max_newton_iterations Newton iterations.
+ */
+vector<CyclePerformance> pitch_plunge_performance(const PitchPlungeFoil &foil, const PitchPlungeParameters &parameters, const PitchPlungeSettings &settings);
+
+/**
+ * @brief Dual march: the cycle means of every completed cycle and their gradients with respect to k, h1, alpha1,
+ *        phi_h and x_pitch (in the units of PitchPlungeParameters), in one run.
+ *
+ * @param foil Shared geometry and factorisation.
+ * @param parameters Kinematics of the foil (the point of differentiation).
+ * @param settings Flow and march settings.
+ * @return vector<CycleSensitivity> One entry per cycle.
+ * @throws std::runtime_error If a wake panel does not converge in max_newton_iterations Newton iterations.
+ */
+vector<CycleSensitivity> pitch_plunge_sensitivities(const PitchPlungeFoil &foil, const PitchPlungeParameters &parameters, const PitchPlungeSettings &settings);
+
+/**
+ * @brief Sinusoidal kinematics of a body without motion channels (angles in radians).
+ *
+ * @param body Body built from the legacy pitch-plunge keys of the motion block.
+ * @param k Reduced frequency.
+ */
+PitchPlungeParameters pitch_plunge_parameters(const Body &body, double k);
+
+/**
+ * @brief Sensitivity mode: the derivatives of the cycle means with respect to k, h1, alpha1, phi_h and x_pitch
+ *        from one dual march, optionally checked against central differences of plain marches.
+ *
+ * Writes every cycle to output_files/sensitivity.dat and the last one to the standard output, per unit of the
+ * input (degrees for the angles).
+ *
+ * @param body Body of the march, initialised with initialize_body.
+ * @param settings Flow and march settings.
+ * @param k Reduced frequency.
+ * @param sensitivity The "sensitivity" block (check_step of the central differences, default none).
+ * @param wall_start Start of the run, for the reported wall time.
+ * @return int Exit status of the solver: 0, or 1 on an error (reported on the standard error).
+ */
+int run_sensitivity(const Body &body, const PitchPlungeSettings &settings, double k, json sensitivity, chrono::high_resolution_clock::time_point wall_start);
+
+#endif // SENSITIVITY_H
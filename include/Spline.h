@@ -0,0 +1,56 @@
+/**
+ * @file Spline.h
+ * @brief Natural cubic spline interpolation of tabulated data.
+ *
+ * Used to represent airfoil contours read from coordinate files (parametrised by arc length), so that
+ * they can be re-panelled to any number of nodes.
+ */
+
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+/**
+ * @brief Piecewise cubic interpolant through a set of knots.
+ *
+ * The spline is stored by its knots, the values at the knots and the second derivatives at the knots,
+ * which is all that is needed to evaluate the cubic on any interval.
+ */
+struct CubicSpline
+{
+    VectorXd knots;              ///< Strictly increasing abscissae.
+    VectorXd values;             ///< Ordinates at the knots.
+    VectorXd second_derivatives; ///< Second derivatives at the knots.
+};
+
+/**
+ * @brief Fits a natural cubic spline (zero second derivative at both ends).
+ *
+ * The tridiagonal system for the second derivatives is solved with the Thomas algorithm.
+ *
+ * @param knots Strictly increasing abscissae (size m >= 2).
+ * @param values Ordinates at the knots (size m).
+ * @param spline Output spline.
+ * @throws std::invalid_argument If the sizes differ, fewer than two knots are given or the knots are not increasing.
+ */
+void fit_cubic_spline(const VectorXd &knots, const VectorXd &values, CubicSpline &spline);
+
+/**
+ * @brief Evaluates the spline at s (the end cubics are extended outside the knot range).
+ */
+double spline_value(const CubicSpline &spline, double s);
+
+/**
+ * @brief Evaluates the first derivative of the spline at s.
+ */
+double spline_first_derivative(const CubicSpline &spline, double s);
+
+/**
+ * @brief Evaluates the second derivative of the spline at s.
+ */
+double spline_second_derivative(const CubicSpline &spline, double s);
+
+#endif // SPLINE_H
@@ -0,0 +1,112 @@
+/**
+ * @file Summation.h
+ * @brief Compensated and pairwise reductions used for the long induced-velocity sums.
+ *
+ * The velocity induced by the wake is a sum of tens of thousands of terms of mixed sign. Accumulating
+ * them with a plain running sum loses digits and makes the answer depend on the order of evaluation.
+ * The helpers in this file keep those reductions accurate and give them a fixed, size-only dependent
+ * reduction tree, so that blocked, vectorised or threaded evaluations return bit-identical results.
+ */
+
+#ifndef SUMMATION_H
+#define SUMMATION_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Number of terms accumulated sequentially before a partial sum is closed.
+ *
+ * Wake sums are split into consecutive blocks of this many terms. Each block is summed with a
+ * compensated sum and the block partials are combined pairwise. Because the block boundaries only
+ * depend on the number of terms, any engine that evaluates whole blocks (in any order, on any number
+ * of threads) reproduces the sequential result exactly.
+ */
+constexpr size_t wake_sum_block_size = 256;
+
+/**
+ * @brief Running compensated sum (Kahan–Babuška / Neumaier variant).
+ *
+ * Keeps a running correction term that captures the low-order bits lost in each addition, which
+ * bounds the error independently of the number of terms, even when terms cancel. S is double or a
+ * dual number (Dual.h), whose values are summed exactly as in double precision.
+ */
+template <class S>
+struct BasicCompensatedSum
+{
+    S sum;
+    S compensation;
+
+    BasicCompensatedSum() : sum(0.0), compensation(0.0) {}
+
+    /**
+     * @brief Adds one term to the running sum.
+     * @param term Value to be accumulated.
+     */
+    void add(const S &term)
+    {
+        S t = sum + term;
+        /* Neumaier's variant also recovers the bits of "sum" when the new term is the larger one */
+        if (fabs(sum) >= fabs(term))
+        {
+            compensation += (sum - t) + term;
+        }
+        else
+        {
+            compensation += (term - t) + sum;
+        }
+        sum = t;
+    }
+
+    /**
+     * @brief Returns the compensated value of the sum.
+     */
+    S result() const { return sum + compensation; }
+};
+
+typedef BasicCompensatedSum<double> CompensatedSum;
+
+/**
+ * @brief Sums an array with a balanced pairwise (cascade) reduction.
+ *
+ * The array is halved recursively down to short runs that are added with a compensated sum. The shape of
+ * the reduction tree depends only on the number of terms.
+ *
+ * @param terms Pointer to the first term.
+ * @param count Number of terms.
+ * @return S The sum of all terms.
+ */
+template <class S>
+S pairwise_sum(const S *terms, size_t count)
+{
+    /* short runs are summed directly; the cut-off is fixed so the tree only depends on count */
+    if (count <= 8)
+    {
+        BasicCompensatedSum<S> s;
+        for (size_t i = 0; i < count; i++)
+        {
+            s.add(terms[i]);
+        }
+        return s.result();
+    }
+    size_t half = count / 2;
+    return pairwise_sum(terms, half) + pairwise_sum(terms + half, count - half);
+}
+
+/**
+ * @brief Sums a vector with a balanced pairwise (cascade) reduction.
+ *
+ * @param terms Terms to be summed.
+ * @return S The sum of all terms.
+ * @see pairwise_sum(const S *, size_t)
+ */
+template <class S>
+S pairwise_sum(const vector<S> &terms)
+{
+    return terms.empty() ? S(0.0) : pairwise_sum(terms.data(), terms.size());
+}
+
+#endif // SUMMATION_H
@@ -0,0 +1,80 @@
+/**
+ * @file Sweep.h
+ * @brief Parameter sweeps as separate solver processes with dynamic load balancing, on a local process pool or
+ *        across MPI ranks.
+ *
+ * Every case of a sweep is an unsteady simulation run by the solver executable in its own directory (input.json,
+ * log.txt and output_files). The cost of a case grows with its time steps (quadratically with a free wake), so the
+ * cases are handed out one at a time, the most expensive first, to whichever worker becomes idle:
+ *
+ * - without MPI (or on a single rank) the workers are jobs threads of the launching process, each running one
+ *   child solver at a time;
+ * - built with -DPANKH_USE_MPI and started with mpirun -np N, rank 0 dispatches the cases to ranks 1 to N - 1 and
+ *   runs cases itself between messages (a thread of its own), and every rank returns the metrics of its cases to
+ *   rank 0, which writes the aggregated table. The case directories are created by the rank that runs them, so the
+ *   ranks need no shared file system.
+ *
+ * Every worker streams the progress of its child solver (every tenth of the run, the cycle performance and errors)
+ * to its standard output, prefixed with the worker and the case; mpirun forwards it to the launcher.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "Convergence.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+/**
+ * @brief One case of a sweep.
+ */
+struct SweepCase
+{
+    json input;        ///< Complete input of the child solver.
+    string directory;  ///< Directory of the run (created by the worker that runs it).
+    string load_file;  ///< Load file of the first body in output_files of the directory.
+    double window;     ///< Evaluation window of the load metrics (time units of the load file).
+    double cost;       ///< Estimated relative cost; the most expensive cases are dispatched first.
+};
+
+/**
+ * @brief Metrics of a finished case.
+ */
+struct SweepResult
+{
+    bool completed;      ///< false when the case failed (see its log.txt) or was not run.
+    int worker;          ///< Rank (with MPI) or job slot that ran the case.
+    double wall_time;    ///< Wall time of the child solver (seconds).
+    LoadMetrics metrics; ///< Load metrics over the last window.
+    double cpower_mean;  ///< Mean input power coefficient of the last completed cycle (NaN without performance output).
+    double efficiency;   ///< Propulsive efficiency of the last completed cycle (NaN without performance output).
+};
+
+/**
+ * @brief Runs all cases and gathers their results.
+ *
+ * With MPI this initialises and finalises MPI, so it must be called once, by every rank.
+ *
+ * @param executable Absolute path of the solver executable.
+ * @param cases Cases of the sweep, identical on every rank.
+ * @param jobs Number of concurrent cases of the local process pool (without MPI or on a single rank).
+ * @param results Output results in the order of the cases (filled on the gathering process only).
+ * @return bool True on the process that gathered the results (always without MPI, rank 0 with MPI).
+ */
+bool run_sweep_cases(const string &executable, const vector<SweepCase> &cases, int jobs, vector<SweepResult> &results);
+
+/**
+ * @brief Sweep mode: runs the cases of the "sweep" block, each replacing entries of any block of the input, and
+ *        writes their metrics to output_files/sweep/summary.dat.
+ *
+ * @param input Complete input of the solver.
+ * @param executable Path of the solver executable (argv[0]).
+ * @return int Exit status of the solver: 0 (also on an MPI worker rank), or 1 on an error or a failed case.
+ */
+int run_sweep(json input, const string &executable);
+
+#endif // SWEEP_H
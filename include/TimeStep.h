@@ -0,0 +1,58 @@
+/**
+ * @file TimeStep.h
+ * @brief Adaptive choice of the time step from the wake spacing, the Newton iterations and the load history.
+ *
+ * Three limits are combined and the smallest wins:
+ *
+ * - wake CFL: the shed vortices of one step are spaced |V_wp| dt apart; dt <= cfl c / max |V_wp| keeps this
+ *   spacing below a fraction cfl of the chord c when the wake panels are fast (stroke reversals, gusts);
+ * - Newton: when the wake panel iteration needed more than newton_iterations iterations the step shrinks,
+ *   and it is only allowed to grow when the iteration converged easily;
+ * - load error: the time stepping is first order, and its error in Cl behaves like a lag of about half a step
+ *   (compared with converged runs), i.e. half the change of Cl over the step. dt is scaled by
+ *   cl_tolerance / error so that this error stays near cl_tolerance: small steps where the loads change fast,
+ *   large steps where they are nearly steady.
+ *
+ * The length of the wake panel follows dt, so an abrupt change of dt shows up as a spike in dphi/dt. The ratio of
+ * consecutive steps is therefore bounded by growth in both directions (except after a hard Newton iteration),
+ * and dt is kept in [dt_min, dt_max] and shortened to land on t_max.
+ */
+
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <vector>
+#include "Body.h"
+
+using namespace std;
+
+/**
+ * @brief Settings and history of the adaptive time step controller.
+ */
+struct TimeStepController
+{
+    bool adaptive;         ///< false: the time step stays fixed.
+    double cfl;            ///< Largest shed vortex spacing as a fraction of the chord.
+    double dt_min, dt_max; ///< Bounds of the time step (seconds).
+    int newton_iterations; ///< Newton iterations above which the step shrinks.
+    double cl_tolerance;   ///< Target error of Cl (half its change over one step).
+    double growth;         ///< Largest ratio of two consecutive steps.
+    int steps;             ///< Completed steps.
+    vector<double> t;      ///< Times of the last three steps.
+    vector<VectorXd> cl;   ///< Load coefficient cn_tilda of every body at the last three steps.
+};
+
+/**
+ * @brief Returns the next time step after a completed step.
+ *
+ * @param controller Controller; the history is updated.
+ * @param bodies All bodies after the step (converged wake panels and loads).
+ * @param t Time of the completed step (seconds).
+ * @param dt Time step just used (seconds).
+ * @param t_max End of the simulation (seconds).
+ * @param newton_iterations Newton iterations of the completed step.
+ * @return double The next time step (seconds); dt itself when the controller is not adaptive.
+ */
+double next_time_step(TimeStepController &controller, const vector<Body> &bodies, double t, double dt, double t_max, int newton_iterations);
+
+#endif // TIMESTEP_H
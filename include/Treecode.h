@@ -0,0 +1,120 @@
+/**
+ * @file Treecode.h
+ * @brief Barnes-Hut type treecode for the velocity induced by many linear-strength vortex panels.
+ *
+ * The panels are sorted into a binary cluster tree by recursive bisection of their midpoints. Far from a
+ * cluster, its panels are represented by point vortices at three Gauss points per panel and summed through a
+ * complex multipole expansion about the cluster centre,
+ *
+ *     u - i v = (i / 2 pi) sum_p a_p / (z - z_c)^(p+1),   a_p = sum_k Gamma_k (z_k - z_c)^p,
+ *
+ * which matches velocity_induced_due_to_discrete_vortex. Clusters that are too close to the evaluation point
+ * are opened, and the panels of the leaves that remain close are evaluated exactly with influence_matrix.
+ * A velocity evaluation then costs O(log n) cluster visits plus a bounded near field, instead of O(n).
+ *
+ * When the same targets are evaluated for many strength vectors (the products of an iterative solver within
+ * one time step), the traversal is done once: a TreeProjection stores for every target its near-field panel
+ * coefficients and the accepted clusters, and each product only sums over these lists.
+ */
+
+#ifndef TREECODE_H
+#define TREECODE_H
+
+#include <Eigen/Dense>
+#include <complex>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * @brief One cluster of the panel tree: a contiguous range of panels in tree order.
+ */
+struct PanelTreeNode
+{
+    double x_center, y_center; ///< Centre of the multipole expansion (mean of the panel midpoints).
+    double radius;             ///< Radius of the smallest centred circle containing all panel end points.
+    int begin, end;            ///< Range of panels [begin, end) in tree order.
+    int child[2];              ///< Indices of the two children, -1 for a leaf.
+};
+
+/**
+ * @brief Cluster tree of vortex panels with the multipole moments of the current strengths.
+ */
+struct PanelTree
+{
+    int order;                       ///< Highest multipole term p.
+    double theta;                    ///< Opening angle: a cluster is used when radius < theta * distance.
+    vector<int> panel;               ///< Original index of the panel at each tree position.
+    vector<double> x1, y1, x2, y2;   ///< Panel end points in tree order.
+    vector<double> gamma_1, gamma_2; ///< Strengths at the end points in tree order.
+    vector<PanelTreeNode> nodes;     ///< Clusters; node 0 is the root.
+    vector<complex<double>> moments; ///< Multipole moments a_0..a_order of every cluster.
+};
+
+/**
+ * @brief Precomputed interaction lists of projected velocities w_x u + w_y v at fixed targets.
+ *
+ * The near field is stored as the projected influence_matrix coefficients of every close panel, the far field
+ * as the accepted clusters with 1 / (z - z_c). Both are kept in compressed rows, one row per target.
+ */
+struct TreeProjection
+{
+    int rows;                                ///< Size of the result vector.
+    vector<int> row;                         ///< Result entry of every target.
+    vector<double> w_x, w_y;                 ///< Projection of every target.
+    vector<int> near_start;                  ///< Start of the near list of every target (size targets + 1).
+    vector<int> near_panel;                  ///< Close panels (tree order).
+    vector<double> near_c1, near_c2;         ///< Projected influence of gamma_1 and gamma_2 of the close panels.
+    vector<int> far_start;                   ///< Start of the far list of every target (size targets + 1).
+    vector<int> far_node;                    ///< Accepted clusters.
+    vector<complex<double>> far_inverse;     ///< 1 / (z - z_c) of the accepted clusters.
+};
+
+/**
+ * @brief Builds the cluster tree of a set of panels (the geometry is fixed until the next build).
+ *
+ * @param x1 x-coordinates of the first end points of the panels.
+ * @param y1 y-coordinates of the first end points of the panels.
+ * @param x2 x-coordinates of the second end points of the panels.
+ * @param y2 y-coordinates of the second end points of the panels.
+ * @param leaf_size Maximum number of panels in a leaf.
+ * @param theta Opening angle (smaller is more accurate, 0.5 is typical).
+ * @param order Highest multipole term.
+ * @param tree Output tree (strengths zero).
+ * @throws std::invalid_argument If the end point vectors differ in size, leaf_size < 1 or order < 0.
+ */
+void build_panel_tree(const vector<double> &x1, const vector<double> &y1, const vector<double> &x2, const vector<double> &y2, int leaf_size, double theta, int order, PanelTree &tree);
+
+/**
+ * @brief Sets the panel strengths (in original panel order) and recomputes the multipole moments.
+ */
+void set_panel_tree_strengths(PanelTree &tree, const vector<double> &gamma_1, const vector<double> &gamma_2);
+
+/**
+ * @brief Velocity induced at (x, y) by all panels of the tree.
+ *
+ * @return Vector2d The velocity [u, v].
+ */
+Vector2d panel_tree_velocity(const PanelTree &tree, double x, double y);
+
+/**
+ * @brief Traverses the tree once for a set of targets and stores their interaction lists.
+ *
+ * @param tree Tree whose geometry is used (the strengths are not needed).
+ * @param x x-coordinates of the targets.
+ * @param y y-coordinates of the targets.
+ * @param w_x Weights of u at the targets.
+ * @param w_y Weights of v at the targets.
+ * @param row Result entry to which every target adds (several targets may share one entry).
+ * @param rows Size of the result vector.
+ * @param projection Output interaction lists.
+ */
+void build_tree_projection(const PanelTree &tree, const vector<double> &x, const vector<double> &y, const vector<double> &w_x, const vector<double> &w_y, const vector<int> &row, int rows, TreeProjection &projection);
+
+/**
+ * @brief result(row_k) = sum over targets k of w_x u + w_y v for the current strengths of the tree.
+ */
+void apply_tree_projection(const PanelTree &tree, const TreeProjection &projection, VectorXd &result);
+
+#endif // TREECODE_H
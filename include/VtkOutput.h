@@ -0,0 +1,108 @@
+/**
+ * @file VtkOutput.h
+ * @brief VTK PolyData (.vtp) files of the airfoils and the wakes with .pvd time-series indices, written in the background.
+ *
+ * Every written time step produces two XML PolyData files:
+ *
+ * - airfoil_<step>.vtp: one piece per body, the nodes joined by line cells (one per panel), with the bound vortex
+ *   strength gamma as point data and, when the pressure loads are computed, cp and the surface potential phi of the
+ *   panels as cell data (they live at the control points);
+ * - wake_<step>.vtp: one piece per body, the wake vortices as vertex cells with their strength and age (time since
+ *   they were shed, seconds) as point data.
+ *
+ * All arrays are stored as appended raw binary data (UInt64 byte count before every array, byte order of the
+ * machine as declared in the header), which ParaView maps without parsing text. airfoil.pvd and wake.pvd list the
+ * files with their times and are written when the run finishes.
+ *
+ * The files are serialised in memory by the solver and handed to a writer thread, so that the time loop does not
+ * wait for the disk. The queue is bounded in bytes: the solver only waits when the disk falls behind by more than
+ * the bound. Where threads are not available the files are written directly.
+ */
+
+#ifndef VTKOUTPUT_H
+#define VTKOUTPUT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Body.h"
+
+using namespace std;
+
+/**
+ * @brief Background writer of whole files, in the order they were queued.
+ */
+struct AsyncWriter
+{
+    thread worker;
+    mutex lock;
+    condition_variable changed;
+    deque<pair<string, string>> pending; ///< File names and contents not yet written.
+    size_t pending_bytes;                ///< Bytes in the queue.
+    size_t max_pending_bytes;            ///< The solver waits while the queue holds more than this.
+    bool threaded;                       ///< false: files are written by queue_file itself.
+    bool closing;                        ///< Set by finish_async_writer.
+    string error;                        ///< First write failure of the worker.
+
+    ~AsyncWriter(); ///< Writes the remaining files and joins the worker.
+};
+
+/**
+ * @brief Starts the writer thread (or direct writing where threads cannot be created).
+ *
+ * @param writer Writer to start.
+ * @param max_pending_bytes Bound of the queue in bytes.
+ */
+void start_async_writer(AsyncWriter &writer, size_t max_pending_bytes);
+
+/**
+ * @brief Queues a file; its contents are moved into the queue.
+ *
+ * @throws std::runtime_error If an earlier file could not be written.
+ */
+void queue_file(AsyncWriter &writer, const string &filename, string &contents);
+
+/**
+ * @brief Writes the remaining files and stops the writer.
+ *
+ * @throws std::runtime_error If a file could not be written.
+ */
+void finish_async_writer(AsyncWriter &writer);
+
+/**
+ * @brief Files and times of a .pvd time series.
+ */
+struct VtkSeries
+{
+    vector<double> times;
+    vector<string> files; ///< File names relative to the .pvd.
+};
+
+/**
+ * @brief Queues airfoil_<iter>.vtp and wake_<iter>.vtp of the current time step.
+ *
+ * @param writer Background writer.
+ * @param directory Output directory.
+ * @param bodies Bodies after the solve (and the loads) of the current time step.
+ * @param wake_birth Shedding times of the wake vortices of every body (seconds).
+ * @param iter Time step index.
+ * @param t Current time (seconds).
+ * @param pressure Whether cp and phi are written (false when only the impulse loads are computed).
+ * @param airfoil Time series of the airfoil files, extended by this step.
+ * @param wake Time series of the wake files, extended by this step.
+ * @throws std::runtime_error If an earlier file could not be written.
+ */
+void write_vtk_step(AsyncWriter &writer, const string &directory, const vector<Body> &bodies, const vector<vector<double>> &wake_birth, int iter, double t, bool pressure, VtkSeries &airfoil, VtkSeries &wake);
+
+/**
+ * @brief Queues the .pvd index of a time series.
+ *
+ * @throws std::runtime_error If an earlier file could not be written.
+ */
+void write_vtk_series(AsyncWriter &writer, const string &filename, const VtkSeries &series);
+
+#endif // VTKOUTPUT_H
@@ -5,4 +5,7 @@ constexpr double pi = 3.14159265358979323846;
 constexpr double DEG2RAD = pi / 180.0;
 constexpr double RAD2DEG = 180.0 / pi;
 
+/* enters the keys of the result cache: bump it whenever a change of the solver changes its results */
+constexpr const char *PANKH_VERSION = "1.5";
+
 #endif // CONSTANTS_H
\ No newline at end of file
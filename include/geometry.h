@@ -1,6 +1,10 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
+#include <cmath>
+#include <ostream>
+#include <stdexcept>
+#include <string>
 #include "kinematics.h"
 #include "VectorOperations.h"
 #include "constants.h"
@@ -21,10 +25,10 @@ using namespace std;
  * @param p Maximum camber (fraction of chord).
  * @param trailing_edge_type Trailing edge type: 1 for open, 0 for closed.
  * @param t_m Thickness-to-chord ratio (e.g., 0.12 for 12% thickness).
- * @return MatrixXd A 3x2 matrix containing [x_upper, y_upper; x_lower, y_lower; x_camber, y_camber].
+ * @return Matrix<double, 3, 2> A fixed-size 3x2 matrix containing [x_upper, y_upper; x_lower, y_lower; x_camber, y_camber].
  * @throws std::invalid_argument If x_c is outside [0, 1] or other invalid parameters.
  */
-MatrixXd geometry(double x_c, double c, double q, double p, int trailing_edge_type, double t_m);
+Matrix<double, 3, 2> geometry(double x_c, double c, double q, double p, int trailing_edge_type, double t_m);
 
 /**
  * @brief Discretizes the airfoil into nodes using cosine clustering.
@@ -47,89 +51,135 @@ MatrixXd geometry(double x_c, double c, double q, double p, int trailing_edge_ty
 void nodal_coordinates_initial(int n, double c, double q, double p, int trailing_edge_type, double t_m, VectorXd &x0, VectorXd &y0);
 
 /**
- * @brief Transforms airfoil nodal coordinates to the instantaneous inertial frame.
+ * @brief Reads airfoil coordinates from a Selig or Lednicer formatted .dat file.
  *
- * Converts body-fixed coordinates to inertial coordinates accounting for heaving and pitching
- * motions. Writes transformed coordinates to "output_files/panel_points_instantaneous.dat".
+ * The first line (airfoil name) is skipped. A Lednicer file is recognised by its second line, which holds
+ * the number of upper and lower surface points. The contour is returned in the ordering used by the solver:
+ * from the lower-surface trailing edge, around the leading edge, to the upper-surface trailing edge.
+ * Coordinates are shifted and scaled so that the leading edge (minimum x) is at the origin and the chord is 1.
  *
- * @param n Number of nodes.
- * @param h0 Heaving amplitude (meters).
- * @param h1 Heaving offset (meters).
- * @param phi_h Heaving phase angle (radians).
- * @param x_pitch Pitch axis x-coordinate (meters).
- * @param y_pitch Pitch axis y-coordinate (meters).
- * @param alpha Pitch angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency of pitching (radians/second).
- * @param x0 Input vector of body-fixed x-coordinates (size n).
- * @param y0 Input vector of body-fixed y-coordinates (size n).
- * @param x_pp Output vector for inertial x-coordinates (size n).
- * @param y_pp Output vector for inertial y-coordinates (size n).
- * @throws std::runtime_error If file output fails.
- * @throws std::invalid_argument If vectors are incorrectly sized.
- * @see body_fixed_frame_to_inertial_frame
+ * @param filename Path of the coordinate file.
+ * @param x Output vector of contour x-coordinates (unit chord).
+ * @param y Output vector of contour y-coordinates (unit chord).
+ * @throws std::runtime_error If the file cannot be read or holds fewer than five points.
  */
-void nodal_coordinates_instantaneous(int n, double h0, double h1, double phi_h, double x_pitch, double y_pitch, double alpha, double t, double omega, VectorXd &x0, VectorXd &y0, VectorXd &x_pp, VectorXd &y_pp);
+void read_airfoil_coordinates(const string &filename, VectorXd &x, VectorXd &y);
 
 /**
- * @brief Computes control points as midpoints of airfoil panels.
+ * @brief Re-panels an arbitrary airfoil contour to n nodes with a cubic spline.
  *
- * Calculates the midpoints of panels formed by consecutive nodes. Writes results to
- * "output_files/control_points_instantaneous.dat".
+ * Fits natural cubic splines x(s), y(s) through the contour (parametrised by its cumulative chord length),
+ * locates the leading edge as the point of minimum x on the spline, and redistributes n nodes on each surface
+ * from the leading edge to the trailing edge. The same even/odd node conventions as nodal_coordinates_initial
+ * are used (odd n places a node at the leading edge). Writes the nodes to "output_files/_time=0.dat".
  *
- * @param n Number of nodes.
- * @param x_pp Input vector of panel x-coordinates (size n).
- * @param y_pp Input vector of panel y-coordinates (size n).
- * @param x_cp Output vector for control point x-coordinates (size n-1).
- * @param y_cp Output vector for control point y-coordinates (size n-1).
- * @throws std::runtime_error If file output fails.
- * @throws std::invalid_argument If vectors are incorrectly sized.
+ * - "cosine"    : cosine spacing in x on each surface, as for the NACA sections.
+ * - "curvature" : cosine spacing in the arc length weighted by 1 + curvature_weight * |kappa| (unit chord), which
+ *                 adds nodes where the surface bends most (leading edge, strong camber) on top of the end clustering.
+ *
+ * @param n Number of nodes (even or odd).
+ * @param c Chord length (meters).
+ * @param x_contour Contour x-coordinates, lower TE -> LE -> upper TE (unit chord).
+ * @param y_contour Contour y-coordinates, lower TE -> LE -> upper TE (unit chord).
+ * @param clustering Either "cosine" or "curvature".
+ * @param curvature_weight Weight of the curvature term for "curvature" clustering.
+ * @param x0 Output vector for x-coordinates (size n).
+ * @param y0 Output vector for y-coordinates (size n).
+ * @throws std::invalid_argument If the clustering name is unknown.
+ * @see fit_cubic_spline
  */
-void controlpoints(int n, VectorXd &x_pp, VectorXd &y_pp, VectorXd &x_cp, VectorXd &y_cp);
+void nodal_coordinates_repaneled(int n, double c, const VectorXd &x_contour, const VectorXd &y_contour, const string &clustering, double curvature_weight, VectorXd &x0, VectorXd &y0);
 
 /**
- * @brief Computes panel lengths and their x, y components.
- *
- * Calculates the x and y differences and Euclidean length of each panel formed by consecutive nodes.
+ * @brief Instantaneous panel geometry of one body in the inertial frame, stored as structure of arrays.
  *
- * @param n Number of nodes.
- * @param l_x Output vector for x-component of panel vectors (size n-1).
- * @param l_y Output vector for y-component of panel vectors (size n-1).
- * @param l Output vector for panel lengths (size n-1).
- * @param x_pp Input vector of panel x-coordinates (size n).
- * @param y_pp Input vector of panel y-coordinates (size n).
- * @throws std::invalid_argument If vectors are incorrectly sized or n < 2.
+ * Every quantity is a contiguous (aligned) Eigen vector, so the kernels that sweep the panels read unit-stride
+ * data; unit_normal and unit_tangent are column-major, i.e. all x-components followed by all y-components.
+ * S is double or a dual number (Dual.h).
  */
-void panel(int n, VectorXd &l_x, VectorXd &l_y, VectorXd &l, VectorXd &x_pp, VectorXd &y_pp);
+template <class S>
+struct BasicPanelGeometry
+{
+    Matrix<S, Dynamic, 1> x_pp, y_pp;                ///< Nodes (size n).
+    Matrix<S, Dynamic, 1> x_cp, y_cp;                ///< Control points, the panel midpoints (size n-1).
+    Matrix<S, Dynamic, 1> l, l_x, l_y;               ///< Panel lengths and their components (size n-1).
+    Matrix<S, Dynamic, Dynamic> unit_normal, unit_tangent; ///< Unit normals (-l_y, l_x) / l and tangents (l_x, l_y) / l (size (n-1) x 2).
+};
+
+typedef BasicPanelGeometry<double> PanelGeometry;
 
 /**
- * @brief Computes unit normal vectors for airfoil panels.
- *
- * Calculates the unit normal vectors (rotated 90° counterclockwise) for each panel.
- *
- * @param n Number of nodes.
- * @param unit_normal Output matrix of unit normal vectors (size (n-1) x 2).
- * @param l_x Input vector of panel x-components (size n-1).
- * @param l_y Input vector of panel y-components (size n-1).
- * @throws std::invalid_argument If vectors or matrix are incorrectly sized or n < 2.
- * @throws std::runtime_error If panel length is zero (causing normalization failure).
- * @see normalize_2d
+ * @brief Sizes the arrays of a panel geometry with n nodes.
  */
-void normal_function_for_panels(int n, MatrixXd &unit_normal, VectorXd &l_x, VectorXd &l_y);
+template <class S>
+void resize_panel_geometry(int n, BasicPanelGeometry<S> &panels)
+{
+    panels.x_pp.resize(n);
+    panels.y_pp.resize(n);
+    panels.x_cp.resize(n - 1);
+    panels.y_cp.resize(n - 1);
+    panels.l.resize(n - 1);
+    panels.l_x.resize(n - 1);
+    panels.l_y.resize(n - 1);
+    panels.unit_normal.resize(n - 1, 2);
+    panels.unit_tangent.resize(n - 1, 2);
+}
 
 /**
- * @brief Computes unit tangent vectors for airfoil panels.
+ * @brief Moves the body-frame nodes to the inertial frame and rebuilds the whole panel geometry in one pass.
  *
- * Calculates the unit tangent vectors for each panel.
+ * The rotation and translation of the rigid-body state are applied once per node (cos and sin are cached in
+ * the state); control points, panel components, lengths, normals and tangents are formed from each pair of
+ * consecutive nodes while they are in registers. Nothing is allocated.
  *
- * @param n Number of nodes.
- * @param unit_tangent Output matrix of unit tangent vectors (size (n-1) x 2).
- * @param l_x Input vector of panel x-components (size n-1).
- * @param l_y Input vector of panel y-components (size n-1).
- * @throws std::invalid_argument If vectors or matrix are incorrectly sized or n < 2.
- * @throws std::runtime_error If panel length is zero (causing normalization failure).
- * @see normalize_2d
+ * @param state Rigid-body state (pitch angle, pitch axis and pivot position) of the current time step.
+ * @param x0 Body-frame node x-coordinates (size n).
+ * @param y0 Body-frame node y-coordinates (size n).
+ * @param panels Output geometry, sized by resize_panel_geometry.
+ * @throws std::runtime_error If a panel has zero length.
+ * @see body_fixed_frame_to_inertial_frame
+ */
+template <class S>
+void update_panel_geometry(const BasicRigidBodyState<S> &state, const VectorXd &x0, const VectorXd &y0, BasicPanelGeometry<S> &panels)
+{
+    int n = x0.size();
+    const S c = state.cos_alpha, s = state.sin_alpha;
+    S *x_pp = panels.x_pp.data(), *y_pp = panels.y_pp.data();
+    S *x_cp = panels.x_cp.data(), *y_cp = panels.y_cp.data();
+    S *l = panels.l.data(), *l_x = panels.l_x.data(), *l_y = panels.l_y.data();
+    S *n_x = panels.unit_normal.col(0).data(), *n_y = panels.unit_normal.col(1).data();
+    S *t_x = panels.unit_tangent.col(0).data(), *t_y = panels.unit_tangent.col(1).data();
+
+    /* position relative to the pitch axis, rotated by R = [cos, sin; -sin, cos] and translated with the pivot */
+    S bx = x0(0) - state.x_pitch, by = y0(0) - state.y_pitch;
+    x_pp[0] = (c * bx + s * by) + state.pivot_x;
+    y_pp[0] = (-s * bx + c * by) + state.pivot_y;
+    for (int i = 0; i < n - 1; i++)
+    {
+        bx = x0(i + 1) - state.x_pitch;
+        by = y0(i + 1) - state.y_pitch;
+        x_pp[i + 1] = (c * bx + s * by) + state.pivot_x;
+        y_pp[i + 1] = (-s * bx + c * by) + state.pivot_y;
+
+        x_cp[i] = x_pp[i] - (x_pp[i] - x_pp[i + 1]) / 2;
+        y_cp[i] = y_pp[i] - (y_pp[i] - y_pp[i + 1]) / 2;
+        l_x[i] = x_pp[i + 1] - x_pp[i];
+        l_y[i] = y_pp[i + 1] - y_pp[i];
+        l[i] = sqrt(l_x[i] * l_x[i] + l_y[i] * l_y[i]);
+        if (l[i] == 0.0)
+        {
+            throw runtime_error("Panel " + to_string(i) + " has zero length");
+        }
+        n_x[i] = -l_y[i] / l[i];
+        n_y[i] = l_x[i] / l[i];
+        t_x[i] = l_x[i] / l[i];
+        t_y[i] = l_y[i] / l[i];
+    }
+}
+
+/**
+ * @brief Writes the nodes and control points of a panel geometry to two open files, one point per line.
  */
-void tangent_function_for_panels(int n, MatrixXd &unit_tangent, VectorXd &l_x, VectorXd &l_y);
+void write_panel_geometry(const PanelGeometry &panels, ostream &nodes, ostream &control_points);
 
 #endif // GEOMETRY_H
\ No newline at end of file
@@ -1,10 +1,11 @@
-
 /**
  * @file kinematics.h
  * @brief Contains functions for transforming coordinates and computing velocity in inertial and body-fixed frames.
  *
  * These functions are essential for converting between the body-fixed frame (BFF) and the inertial (earth) frame,
- * as well as for calculating velocity at any point on the body due to its kinematics.
+ * as well as for calculating velocity at any point on the body due to its kinematics. Both work from the
+ * RigidBodyState evaluated once per time step, so no trigonometric function is called per point. They are written
+ * for the scalar type S of the state (double, or a dual number of Dual.h in the sensitivity analysis).
  * 
  * @author [Rohit Chowdhury]
  */
@@ -22,48 +23,55 @@
 /**
  * @brief Transforms coordinates from the body-fixed frame to the inertial frame.
  *
- * Converts a point’s coordinates from the body-fixed frame (BFF) to the inertial frame, accounting
- * for heaving and pitching motions about a specified rotation point. The transformation includes
- * rotation (via pitch angle) and translation (via heaving motion).
+ * Converts a point’s coordinates from the body-fixed frame (BFF) to the inertial frame: rotation by the
+ * pitch angle about the pitch axis, followed by the translation of the pitch axis (plunge, surge and the
+ * position of the body).
  *
- * @param h0 Heaving offset (meters).
- * @param h1 Heaving amplitude (meters).
- * @param phi_h Heaving phase angle (radians).
- * @param x_pitch x-coordinate of the pitch axis in the body-fixed frame (meters).
- * @param y_pitch y-coordinate of the pitch axis in the body-fixed frame (meters).
- * @param alpha Pitch angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
+ * @param state Rigid-body state of the current time step.
  * @param bff_x_coord x-coordinate of the point in the body-fixed frame (meters).
  * @param bff_y_coord y-coordinate of the point in the body-fixed frame (meters).
- * @return VectorXd A 2D vector [x, y] representing the point’s coordinates in the inertial frame.
- * @see h_instantaneous
+ * @return Matrix<S, 2, 1> The point’s coordinates [x, y] in the inertial frame.
+ * @see rigid_body_state
  */
-VectorXd body_fixed_frame_to_inertial_frame(double h0, double h1, double phi_h, double x_pitch, double y_pitch, double alpha, double t, double omega, double bff_x_coord, double bff_y_coord);
+template <class S>
+Matrix<S, 2, 1> body_fixed_frame_to_inertial_frame(const BasicRigidBodyState<S> &state, double bff_x_coord, double bff_y_coord)
+{
+    /* position relative to the point of rotation, rotated by R = [cos, sin; -sin, cos] and translated with the pitch axis */
+    S bx = bff_x_coord - state.x_pitch;
+    S by = bff_y_coord - state.y_pitch;
+
+    Matrix<S, 2, 1> earth_frame; // vector in fixed frame or earth frame
+    earth_frame(0) = (state.cos_alpha * bx + state.sin_alpha * by) + state.pivot_x;
+    earth_frame(1) = (-state.sin_alpha * bx + state.cos_alpha * by) + state.pivot_y;
+    return earth_frame;
+}
 
 /**
  * @brief Computes the total velocity at a point on the body’s surface in the inertial frame.
  *
- * Calculates the velocity at a specified point on the body’s surface, considering freestream flow,
- * plunging motion, and pitching motion about a rotation point. The freestream flow is assumed to be
+ * Calculates the velocity of the flow relative to a point on the body’s surface: freestream minus the
+ * translation velocity of the pitch axis minus the rotation about it. The freestream flow is assumed to be
  * parallel to the x-axis of the inertial frame.
  *
  * @param Qinf Freestream flow speed (meters/second).
- * @param x_pitch x-coordinate of the pitch axis in the body-fixed frame (meters).
- * @param y_pitch y-coordinate of the pitch axis in the body-fixed frame (meters).
- * @param h0 Heaving offset (meters).
- * @param h1 Heaving amplitude (meters).
- * @param phi_h Heaving phase angle (radians).
- * @param alpha0 Pitch angle offset (radians).
- * @param alpha1 Pitch angle amplitude (radians).
- * @param phi_alpha Pitch phase angle (radians).
- * @param t Current time (seconds).
- * @param omega Angular frequency (radians/second).
+ * @param state Rigid-body state of the current time step.
  * @param point_x_coord x-coordinate of the point in the inertial frame (meters).
  * @param point_y_coord y-coordinate of the point in the inertial frame (meters).
- * @return VectorXd A 2D vector [u, v] representing the total velocity in the inertial frame.
- * @see h_dot_instantaneous, alpha_dot_instantaneous, cross
+ * @return Matrix<S, 2, 1> A 2D vector [u, v] representing the total velocity in the inertial frame.
+ * @see rigid_body_state
  */
-VectorXd velocity_at_surface_of_the_body_inertial_frame(double Qinf, double x_pitch, double y_pitch, double h0, double h1, double phi_h, double alpha0, double alpha1, double phi_alpha, double t, double omega, double point_x_coord, double point_y_coord);
+template <class S>
+Matrix<S, 2, 1> velocity_at_surface_of_the_body_inertial_frame(const S &Qinf, const BasicRigidBodyState<S> &state, const S &point_x_coord, const S &point_y_coord)
+{
+    /*ASSUMING THAT THERE IS A ONCOMING FLOW PARALLEL TO THE X AXIS OF THE INERTIAL FRAME */
+    S rx = point_x_coord - state.pivot_x;
+    S ry = point_y_coord - state.pivot_y;
+
+    /***** RELATIVE FLOW VELOCITY: freestream - pivot velocity + alpha_dot e_z x r ******/
+    Matrix<S, 2, 1> um;
+    um(0) = Qinf - state.pivot_u - state.alpha_dot * ry;
+    um(1) = -state.pivot_v + state.alpha_dot * rx;
+    return um;
+}
 
-#endif // KINEMATICS_H
\ No newline at end of file
+#endif // KINEMATICS_H
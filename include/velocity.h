@@ -3,8 +3,11 @@
 
 #include <Eigen/Dense>
 #include <cmath>
+#include <vector>
 #include "InfluenceMatrix.h"
 #include "constants.h"
+#include "Images.h"
+#include "Summation.h"
 
 using namespace Eigen;
 using namespace std;
@@ -15,17 +18,20 @@ using namespace std;
  *
  * @details This function calculates the velocity at a given point P(x, y) location 
  * due to the influence of bound vortices along the airfoil surface.
- * It uses the influence matrix to determine the contribution of each vortex panel.
+ * It uses the influence matrix to determine the contribution of each vortex panel. The images of every
+ * panel are evaluated in the same pass, right after the panel itself.
  *
  * @param x_pp VectorXd containing x-coordinates of the panel endpoints.
  * @param y_pp VectorXd containing y-coordinates of the panel endpoints.
  * @param x Double value representing the x-coordinate of the evaluation point.
  * @param y Double value representing the y-coordinate of the evaluation point.
  * @param G_bound VectorXd containing the circulation strengths of the bound vortices.
+ * @param images Image system of the boundaries (no transforms for an unbounded flow).
  *
  * @return VectorXd A 2D velocity vector [Vx, Vy] induced at the given (x, y) location.
+ * @see influence_matrix_images
  */
-VectorXd velocity_bound_vortices(int n, VectorXd &x_pp, VectorXd &y_pp, double x, double y, VectorXd G_bound);
+VectorXd velocity_bound_vortices(int n, const VectorXd &x_pp, const VectorXd &y_pp, double x, double y, const VectorXd &G_bound, const ImageSystem &images);
 
 /**
  * @brief Computes the velocity induced at a point by a single discrete vortex.
@@ -45,5 +51,270 @@ VectorXd velocity_bound_vortices(int n, VectorXd &x_pp, VectorXd &y_pp, double x
  */
 VectorXd velocity_induced_due_to_discrete_vortex(double gamma, double vor_point_x, double vor_point_y, double des_point_x, double des_point_y);
 
+/**
+ * @brief Computes the velocity induced at a point by all the previously shed wake vortices.
+ *
+ * @details This is the reduction used for every wake sum of the solver. The vortices are visited in
+ * consecutive blocks of `wake_sum_block_size`; each block is accumulated with a compensated sum and the
+ * block partials are combined pairwise. The result is therefore accurate for long wakes and does not
+ * depend on the order in which blocks are evaluated.
+ *
+ * Images are handled inside the same loop: every vortex is loaded once and evaluated at the evaluation point
+ * and at its mapped image points, so the wake vectors are never duplicated.
+ *
+ * @param gamma_wake_strength Circulation strengths of the wake vortices.
+ * @param gamma_wake_x_location x-coordinates of the wake vortices.
+ * @param gamma_wake_y_location y-coordinates of the wake vortices.
+ * @param des_point_x x-coordinate of the evaluation point.
+ * @param des_point_y y-coordinate of the evaluation point.
+ * @param images Image system of the boundaries (no transforms for an unbounded flow).
+ * @param skip Index of a vortex to leave out of the sum (self-induction of a wake vortex), or -1. Its images are kept.
+ *
+ * @return VectorXd A 2D velocity vector [Vx, Vy] induced at the given (des_point_x, des_point_y) location.
+ * @see velocity_induced_due_to_discrete_vortex, CompensatedSum, pairwise_sum
+ */
+VectorXd velocity_wake_vortices(const vector<double> &gamma_wake_strength, const vector<double> &gamma_wake_x_location, const vector<double> &gamma_wake_y_location, double des_point_x, double des_point_y, const ImageSystem &images, int skip = -1);
+
+/**
+ * @brief Velocity potential of a single discrete vortex.
+ *
+ * @details phi = -gamma theta / (2 pi), consistent with velocity_induced_due_to_discrete_vortex. The angle is
+ * measured at the vortex, from the direction pointing upstream (-x) of the evaluation point, so that the
+ * potential vanishes far upstream and its branch cut is the horizontal line running upstream from the
+ * evaluation point. Potentials evaluated this way at a point equal the integral of the induced velocity along
+ * the horizontal line from -infinity to that point, as long as no vortex lies on that line.
+ *
+ * @param gamma Circulation strength of the vortex.
+ * @param vor_point_x x-coordinate of the vortex.
+ * @param vor_point_y y-coordinate of the vortex.
+ * @param des_point_x x-coordinate of the evaluation point.
+ * @param des_point_y y-coordinate of the evaluation point.
+ *
+ * @return double The velocity potential at the evaluation point.
+ */
+double potential_due_to_discrete_vortex(double gamma, double vor_point_x, double vor_point_y, double des_point_x, double des_point_y);
+
+/**
+ * @brief Velocity potential of a vortex panel whose strength varies linearly from gamma_1 to gamma_2.
+ *
+ * @details The integral of potential_due_to_discrete_vortex along the panel, in closed form: in panel
+ * coordinates (xi along the panel, eta normal to it) the angle is theta = atan2(eta, xi) up to a constant
+ * multiple of 2 pi fixed at the panel midpoint, and
+ *
+ *     int theta dxi    = xi theta + eta ln(xi^2 + eta^2) / 2
+ *     int xi theta dxi = (xi^2 + eta^2) theta / 2 + eta xi / 2
+ *
+ * The evaluation point may be a node of the panel.
+ *
+ * @return double The velocity potential at (des_point_x, des_point_y).
+ * @see potential_due_to_discrete_vortex, influence_matrix
+ */
+double potential_linear_vortex_panel(double point1_x, double point1_y, double point2_x, double point2_y, double gamma_1, double gamma_2, double des_point_x, double des_point_y);
+
+/**
+ * @brief Velocity potential of the bound vortex panels of an airfoil and their images.
+ *
+ * @details An image maps the evaluation point like the velocity kernels do; its potential is the potential of
+ * the original panels at the mapped point times the factor cu of the image.
+ *
+ * @see potential_linear_vortex_panel, velocity_bound_vortices
+ */
+double potential_bound_vortices(int n, const VectorXd &x_pp, const VectorXd &y_pp, double x, double y, const VectorXd &G_bound, const ImageSystem &images);
+
+/**
+ * @brief Velocity potential of all the previously shed wake vortices and their images.
+ *
+ * @details Uses the same blocked compensated reduction as velocity_wake_vortices.
+ *
+ * @see potential_due_to_discrete_vortex, velocity_wake_vortices
+ */
+double potential_wake_vortices(const vector<double> &gamma_wake_strength, const vector<double> &gamma_wake_x_location, const vector<double> &gamma_wake_y_location, double des_point_x, double des_point_y, const ImageSystem &images);
+
+/*
+ * The kernels above for any scalar type S: double or a dual number (Dual.h), which carries the derivatives of the
+ * positions and strengths through the same operations. The double functions call these with S = double.
+ */
+
+/**
+ * @brief velocity_bound_vortices for any scalar type.
+ * @see velocity_bound_vortices
+ */
+template <class S>
+Matrix<S, 2, 1> bound_vortex_velocity(int n, const Matrix<S, Dynamic, 1> &x_pp, const Matrix<S, Dynamic, 1> &y_pp, const S &x, const S &y, const Matrix<S, Dynamic, 1> &G_bound, const ImageSystem &images)
+{
+    Matrix<S, 2, 1> VEL(S(0.0), S(0.0));
+    S P[2][2], image_P[2][2];
+    for (int i = 0; i < n - 1; i++)
+    {
+        linear_vortex_panel_influence(x_pp(i), y_pp(i), x_pp(i + 1), y_pp(i + 1), x, y, P);
+        if (!images.transforms.empty())
+        {
+            linear_vortex_panel_influence_images(x_pp(i), y_pp(i), x_pp(i + 1), y_pp(i + 1), x, y, images, image_P);
+            for (int r = 0; r < 2; r++)
+            {
+                P[r][0] += image_P[r][0];
+                P[r][1] += image_P[r][1];
+            }
+        }
+        VEL(0) += P[0][0] * G_bound(i) + P[0][1] * G_bound(i + 1);
+        VEL(1) += P[1][0] * G_bound(i) + P[1][1] * G_bound(i + 1);
+    }
+    return VEL;
+}
+
+/**
+ * @brief velocity_wake_vortices for any scalar type, with the same blocks and compensated sums.
+ * @see velocity_wake_vortices
+ */
+template <class S>
+Matrix<S, 2, 1> wake_vortex_velocity(const vector<S> &gamma_wake_strength, const vector<S> &gamma_wake_x_location, const vector<S> &gamma_wake_y_location, const S &des_point_x, const S &des_point_y, const ImageSystem &images, int skip = -1)
+{
+    size_t size = gamma_wake_strength.size();
+    size_t nimages = images.transforms.size();
+    vector<S> image_y(nimages);
+    for (size_t k = 0; k < nimages; k++)
+    {
+        image_y[k] = image_point_y(images.transforms[k], des_point_y);
+    }
+    size_t nblocks = (size + wake_sum_block_size - 1) / wake_sum_block_size;
+    vector<S> block_u(nblocks), block_v(nblocks);
+
+    for (size_t b = 0; b < nblocks; b++)
+    {
+        BasicCompensatedSum<S> u, v;
+        size_t end = min(size, (b + 1) * wake_sum_block_size);
+        for (size_t j = b * wake_sum_block_size; j < end; j++)
+        {
+            S delta_x = des_point_x - gamma_wake_x_location[j];
+            if ((int)j != skip)
+            {
+                S delta_y = des_point_y - gamma_wake_y_location[j];
+                S factor = gamma_wake_strength[j] / (2.0 * pi * (delta_x * delta_x + delta_y * delta_y));
+                u.add(factor * delta_y);
+                v.add(-factor * delta_x);
+            }
+            for (size_t k = 0; k < nimages; k++) // images of vortex j, evaluated at the mapped points
+            {
+                S delta_y = image_y[k] - gamma_wake_y_location[j];
+                S factor = gamma_wake_strength[j] / (2.0 * pi * (delta_x * delta_x + delta_y * delta_y));
+                u.add(images.transforms[k].cu * factor * delta_y);
+                v.add(-images.transforms[k].cv * factor * delta_x);
+            }
+        }
+        block_u[b] = u.result();
+        block_v[b] = v.result();
+    }
+    return Matrix<S, 2, 1>(pairwise_sum(block_u), pairwise_sum(block_v));
+}
+
+/**
+ * @brief potential_due_to_discrete_vortex for any scalar type.
+ * @see potential_due_to_discrete_vortex
+ */
+template <class S>
+S point_vortex_potential(const S &gamma, const S &vor_point_x, const S &vor_point_y, const S &des_point_x, const S &des_point_y)
+{
+    return -gamma / (2.0 * pi) * atan2(vor_point_y - des_point_y, vor_point_x - des_point_x);
+}
+
+/**
+ * @brief potential_linear_vortex_panel for any scalar type.
+ * @see potential_linear_vortex_panel
+ */
+template <class S>
+S linear_vortex_panel_potential(const S &point1_x, const S &point1_y, const S &point2_x, const S &point2_y, const S &gamma_1, const S &gamma_2, const S &des_point_x, const S &des_point_y)
+{
+    S l_x = point2_x - point1_x;
+    S l_y = point2_y - point1_y;
+    S L = sqrt(l_x * l_x + l_y * l_y);
+    if (L == 0.0)
+    {
+        return S(0.0);
+    }
+    S e_x = l_x / L, e_y = l_y / L;
+
+    /* vector from the evaluation point to the vortex at arc length s: a + s e, written as (xi0 + s, eta) in panel coordinates */
+    S a_x = point1_x - des_point_x;
+    S a_y = point1_y - des_point_y;
+    S xi0 = a_x * e_x + a_y * e_y;
+    S eta = -a_x * e_y + a_y * e_x;
+
+    /* angle of a + s e = angle of e + atan2(eta, xi) + 2 pi k, with k fixed at the midpoint (the angle is continuous along the panel) */
+    S angle_e = atan2(e_y, e_x);
+    S xi_mid = xi0 + 0.5 * L;
+    S shift = atan2(a_y + 0.5 * l_y, a_x + 0.5 * l_x) - angle_e - atan2(eta, xi_mid);
+    shift = angle_e + 2.0 * pi * floor(shift / (2.0 * pi) + 0.5);
+
+    S F0[2], F1[2];
+    for (int k = 0; k < 2; k++)
+    {
+        S xi = xi0 + k * L;
+        S r2 = xi * xi + eta * eta;
+        S theta = atan2(eta, xi);
+        F0[k] = xi * theta + ((r2 > 0.0) ? S(0.5 * eta * log(r2)) : S(0.0));
+        F1[k] = 0.5 * r2 * theta + 0.5 * eta * xi;
+    }
+    S int_theta = F0[1] - F0[0];
+    S int_xi_theta = F1[1] - F1[0];
+
+    /* gamma(s) = gamma_1 + (gamma_2 - gamma_1) s / L with s = xi - xi0 */
+    S integral = shift * 0.5 * (gamma_1 + gamma_2) * L + gamma_1 * int_theta + (gamma_2 - gamma_1) / L * (int_xi_theta - xi0 * int_theta);
+    return -integral / (2.0 * pi);
+}
+
+/**
+ * @brief potential_bound_vortices for any scalar type.
+ * @see potential_bound_vortices
+ */
+template <class S>
+S bound_vortex_potential(int n, const Matrix<S, Dynamic, 1> &x_pp, const Matrix<S, Dynamic, 1> &y_pp, const S &x, const S &y, const Matrix<S, Dynamic, 1> &G_bound, const ImageSystem &images)
+{
+    S phi = 0.0;
+    for (int i = 0; i < n - 1; i++)
+    {
+        phi += linear_vortex_panel_potential(x_pp(i), y_pp(i), x_pp(i + 1), y_pp(i + 1), G_bound(i), G_bound(i + 1), x, y);
+        for (size_t k = 0; k < images.transforms.size(); k++)
+        {
+            const ImageTransform &image = images.transforms[k];
+            phi += image.cu * linear_vortex_panel_potential(x_pp(i), y_pp(i), x_pp(i + 1), y_pp(i + 1), G_bound(i), G_bound(i + 1), x, image_point_y(image, y));
+        }
+    }
+    return phi;
+}
+
+/**
+ * @brief potential_wake_vortices for any scalar type, with the same blocks and compensated sums.
+ * @see potential_wake_vortices
+ */
+template <class S>
+S wake_vortex_potential(const vector<S> &gamma_wake_strength, const vector<S> &gamma_wake_x_location, const vector<S> &gamma_wake_y_location, const S &des_point_x, const S &des_point_y, const ImageSystem &images)
+{
+    size_t size = gamma_wake_strength.size();
+    size_t nimages = images.transforms.size();
+    vector<S> image_y(nimages);
+    for (size_t k = 0; k < nimages; k++)
+    {
+        image_y[k] = image_point_y(images.transforms[k], des_point_y);
+    }
+    size_t nblocks = (size + wake_sum_block_size - 1) / wake_sum_block_size;
+    vector<S> block_phi(nblocks);
+
+    for (size_t b = 0; b < nblocks; b++)
+    {
+        BasicCompensatedSum<S> phi;
+        size_t end = min(size, (b + 1) * wake_sum_block_size);
+        for (size_t j = b * wake_sum_block_size; j < end; j++)
+        {
+            phi.add(point_vortex_potential(gamma_wake_strength[j], gamma_wake_x_location[j], gamma_wake_y_location[j], des_point_x, des_point_y));
+            for (size_t k = 0; k < nimages; k++)
+            {
+                phi.add(images.transforms[k].cu * point_vortex_potential(gamma_wake_strength[j], gamma_wake_x_location[j], gamma_wake_y_location[j], des_point_x, image_y[k]));
+            }
+        }
+        block_phi[b] = phi.result();
+    }
+    return pairwise_sum(block_phi);
+}
+
 #endif // VELOCITY_H
 
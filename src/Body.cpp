@@ -0,0 +1,180 @@
+#include "Body.h"
+#include "Amatrix.h"
+#include "kinematics.h"
+#include <algorithm>
+
+void initialize_body(Body &body, double Qinf, double dt, bool cache_self_influence)
+{
+    int n = body.n;
+    resize_panel_geometry(n, body.panels);
+    body.gamma_bound = VectorXd::Zero(n);
+    body.gamma_old = 0.0;
+
+    /* initial guesses for lwp and theta_wp */
+    body.lwp = Qinf * dt;
+    body.theta_wp = 0.0;
+    body.gamma_wp = 0.0;
+    body.wake_panel_coordinates = MatrixXd::Zero(2, 2);
+    body.wake_panel_cp = VectorXd::Zero(2);
+    body.wake_panel_normal = VectorXd::Zero(2);
+    body.vtotal_wp_cp = VectorXd::Zero(2);
+
+    body.phi_old = VectorXd::Zero(n - 1);
+    body.phi_airfoil_cps = VectorXd::Zero(n - 1);
+    body.cp = VectorXd::Zero(n - 1);
+    body.cn_tilda = 0.0;
+    body.ca_tilda = 0.0;
+
+    /* self-influence block from the body-frame geometry (rigid motion leaves the normal influence unchanged) */
+    if (!cache_self_influence)
+    {
+        return;
+    }
+    VectorXd x_cp0(n - 1), y_cp0(n - 1);
+    for (int j = 0; j < n - 1; j++)
+    {
+        x_cp0(j) = 0.5 * (body.x0(j) + body.x0(j + 1));
+        y_cp0(j) = 0.5 * (body.y0(j) + body.y0(j + 1));
+    }
+    body.A_self.resize(n, n);
+    Amatrix(n, body.A_self, x_cp0, y_cp0, body.x0, body.y0);
+}
+
+void update_body_geometry(Body &body, double t)
+{
+    body.state = rigid_body_state(body.motion, t);
+    update_panel_geometry(body.state, body.x0, body.y0, body.panels);
+}
+
+VectorXd body_kinematic_velocity(const Body &body, double Qinf, double x, double y)
+{
+    return velocity_at_surface_of_the_body_inertial_frame(Qinf, body.state, x, y);
+}
+
+VectorXd velocity_bound_vortices_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y)
+{
+    VectorXd V = VectorXd::Zero(2);
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        V += velocity_bound_vortices(bodies[b].n, bodies[b].panels.x_pp, bodies[b].panels.y_pp, x, y, bodies[b].gamma_bound, images);
+    }
+    return V;
+}
+
+VectorXd velocity_wake_vortices_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y, int skip_body, int skip_index)
+{
+    VectorXd V = VectorXd::Zero(2);
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        V += velocity_wake_vortices(bodies[b].gamma_wake_strength, bodies[b].gamma_wake_x_location, bodies[b].gamma_wake_y_location, x, y, images, ((int)b == skip_body) ? skip_index : -1);
+    }
+    return V;
+}
+
+VectorXd velocity_wake_panels_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y, int skip_body)
+{
+    VectorXd V = VectorXd::Zero(2);
+    Vector2d wake_panel_strength;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        if ((int)b == skip_body)
+        {
+            continue;
+        }
+        const MatrixXd &wpc = bodies[b].wake_panel_coordinates;
+        wake_panel_strength << bodies[b].gamma_wp, bodies[b].gamma_wp;
+        V += influence_matrix(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), x, y) * wake_panel_strength;
+        if (!images.transforms.empty())
+        {
+            V += influence_matrix_images(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), x, y, images) * wake_panel_strength;
+        }
+    }
+    return V;
+}
+
+VectorXd velocity_induced_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y)
+{
+    return velocity_wake_panels_all(bodies, images, x, y) + velocity_bound_vortices_all(bodies, images, x, y) + velocity_wake_vortices_all(bodies, images, x, y);
+}
+
+double potential_induced_all(const vector<Body> &bodies, const ImageSystem &images, double x, double y)
+{
+    double phi = 0.0;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        const Body &body = bodies[b];
+        const MatrixXd &wpc = body.wake_panel_coordinates;
+        phi += potential_bound_vortices(body.n, body.panels.x_pp, body.panels.y_pp, x, y, body.gamma_bound, images);
+        phi += potential_linear_vortex_panel(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), body.gamma_wp, body.gamma_wp, x, y);
+        for (size_t k = 0; k < images.transforms.size(); k++)
+        {
+            const ImageTransform &image = images.transforms[k];
+            phi += image.cu * potential_linear_vortex_panel(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), body.gamma_wp, body.gamma_wp, x, image_point_y(image, y));
+        }
+        phi += potential_wake_vortices(body.gamma_wake_strength, body.gamma_wake_x_location, body.gamma_wake_y_location, x, y, images);
+    }
+    return phi;
+}
+
+void prescribe_wake_panel(Body &body, const VectorXd &freestream, double t, double dt, double t_start)
+{
+    int n = body.n;
+    Vector2d end = body_fixed_frame_to_inertial_frame(rigid_body_state(body.motion, max(t - dt, t_start)), body.x0(n - 1), body.y0(n - 1));
+    double dx = end(0) + freestream(0) * dt - body.panels.x_pp(n - 1);
+    double dy = end(1) + freestream(1) * dt - body.panels.y_pp(n - 1);
+    body.lwp = sqrt(dx * dx + dy * dy);
+    body.theta_wp = atan2(dy, dx);
+    body.wake_panel_coordinates(0, 0) = body.panels.x_pp(n - 1);
+    body.wake_panel_coordinates(0, 1) = body.panels.y_pp(n - 1);
+    body.wake_panel_coordinates(1, 0) = body.panels.x_pp(n - 1) + dx;
+    body.wake_panel_coordinates(1, 1) = body.panels.y_pp(n - 1) + dy;
+    body.wake_panel_cp(0) = body.panels.x_pp(n - 1) + 0.5 * dx;
+    body.wake_panel_cp(1) = body.panels.y_pp(n - 1) + 0.5 * dy;
+    body.wake_panel_normal(0) = -sin(body.theta_wp);
+    body.wake_panel_normal(1) = cos(body.theta_wp);
+    body.vtotal_wp_cp = freestream;
+}
+
+void convect_wakes(vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double dt, int wake)
+{
+    int nbodies = bodies.size();
+    vector<vector<double>> x_new(nbodies), y_new(nbodies);
+    Vector2d shed_vel, velocity, vel_wake_point;
+    for (int b = 0; b < nbodies; b++)
+    {
+        const Body &body = bodies[b];
+        int size = body.gamma_wake_x_location.size();
+        x_new[b].resize(size);
+        y_new[b].resize(size);
+        for (int j = 0; j < size; j++)
+        {
+            double x = body.gamma_wake_x_location[j];
+            double y = body.gamma_wake_y_location[j];
+            /******** free wake ********/
+            if (wake == 0)
+            {
+                shed_vel = velocity_wake_vortices_all(bodies, images, x, y, b, j); /* effect of other wake vortices on jth wake point */
+                velocity = velocity_bound_vortices_all(bodies, images, x, y);
+                vel_wake_point = velocity_wake_panels_all(bodies, images, x, y);
+                x_new[b][j] = x + (freestream(0) + shed_vel(0) + velocity(0) + vel_wake_point(0)) * dt;
+                y_new[b][j] = y + (freestream(1) + shed_vel(1) + velocity(1) + vel_wake_point(1)) * dt;
+            }
+            /******** prescribed wake ********/
+            else if (wake == 1)
+            {
+                x_new[b][j] = x + (freestream(0)) * dt;
+                y_new[b][j] = y + (freestream(1)) * dt;
+            }
+        }
+    }
+    for (int b = 0; b < nbodies; b++)
+    {
+        Body &body = bodies[b];
+        body.gamma_wake_x_location = x_new[b];
+        body.gamma_wake_y_location = y_new[b];
+        /* the panel shed in the current time step lies as a discrete vortex where its control point is convected to */
+        body.gamma_wake_strength.push_back(body.gamma_wp * body.lwp);
+        body.gamma_wake_x_location.push_back(body.wake_panel_cp(0) + body.vtotal_wp_cp(0) * dt);
+        body.gamma_wake_y_location.push_back(body.wake_panel_cp(1) + body.vtotal_wp_cp(1) * dt);
+    }
+}
@@ -0,0 +1,348 @@
+#include "Cache.h"
+#include "constants.h"
+#include <cstdint>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+/* FIPS 180-4 SHA-256 */
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotate_right(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+string sha256_hex(const string &data)
+{
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    /* padding: a single 1 bit, zeros, and the message length in bits as a big-endian 64-bit integer */
+    string message = data;
+    uint64_t bits = (uint64_t)data.size() * 8;
+    message += (char)0x80;
+    while (message.size() % 64 != 56)
+    {
+        message += (char)0x00;
+    }
+    for (int i = 7; i >= 0; i--)
+    {
+        message += (char)((bits >> (8 * i)) & 0xff);
+    }
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64)
+    {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char *p = (const unsigned char *)&message[chunk + 4 * i];
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t S1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+            uint32_t choice = (e & f) ^ (~e & g);
+            uint32_t temp1 = hh + S1 + choice + sha256_k[i] + w[i];
+            uint32_t S0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t temp2 = S0 + majority;
+            hh = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+    }
+
+    ostringstream digest;
+    for (int i = 0; i < 8; i++)
+    {
+        digest << hex << setw(8) << setfill('0') << h[i];
+    }
+    return digest.str();
+}
+
+/* recursive part of normalized_input */
+static json normalize(const json &value)
+{
+    if (value.is_object())
+    {
+        json result = json::object();
+        for (auto it = value.begin(); it != value.end(); ++it)
+        {
+            const string &key = it.key();
+            if (key.compare(0, 2, "__") == 0 || it.value().is_null())
+            {
+                continue; // explanations, and null entries which select the defaults
+            }
+            if (it.value().is_string() && key.size() >= 4 && key.compare(key.size() - 4, 4, "file") == 0)
+            {
+                /* referenced data files enter the key by content */
+                ifstream file(it.value().get<string>(), ios::binary);
+                ostringstream contents;
+                contents << file.rdbuf();
+                result[key] = {{"path", it.value()}, {"sha256", file.is_open() ? sha256_hex(contents.str()) : "missing"}};
+                continue;
+            }
+            result[key] = normalize(it.value());
+        }
+        return result;
+    }
+    if (value.is_array())
+    {
+        json result = json::array();
+        for (const json &element : value)
+        {
+            result.push_back(normalize(element));
+        }
+        return result;
+    }
+    if (value.is_number())
+    {
+        return json(value.get<double>());
+    }
+    return value;
+}
+
+json normalized_input(const json &input)
+{
+    json normalized = normalize(input);
+    normalized.erase("cache");
+    normalized.erase("converge");
+    normalized.erase("polar");
+    normalized.erase("harmonic");
+    normalized.erase("ensemble");
+    normalized.erase("sweep");
+    normalized.erase("sensitivity");
+    normalized.erase("optimize");
+    normalized.erase("field");
+    normalized.erase("probes");
+    normalized.erase("output");
+    if (normalized.contains("simulation"))
+    {
+        normalized["simulation"].erase("gnuplot_terminal");
+    }
+    normalized["version"] = PANKH_VERSION;
+    return normalized;
+}
+
+CacheKeys cache_keys(const json &input)
+{
+    json normalized = normalized_input(input);
+    CacheKeys keys;
+    keys.full = sha256_hex(normalized.dump());
+    if (normalized.contains("simulation"))
+    {
+        normalized["simulation"].erase("ncycles");
+        normalized["simulation"].erase("t_max");
+    }
+    keys.prefix = sha256_hex(normalized.dump());
+    return keys;
+}
+
+string cache_entry_directory(const string &root, const CacheKeys &keys)
+{
+    return root + "/" + keys.prefix + "/" + keys.full;
+}
+
+bool find_cache_entry(const string &root, const CacheKeys &keys, int max_steps, string &directory, int &steps)
+{
+    string prefix_directory = root + "/" + keys.prefix;
+    DIR *listing = opendir(prefix_directory.c_str());
+    if (!listing)
+    {
+        return false;
+    }
+    bool found = false;
+    struct dirent *item;
+    while ((item = readdir(listing)) != NULL)
+    {
+        string name = item->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        ifstream entry_file(prefix_directory + "/" + name + "/entry.json");
+        if (!entry_file.is_open())
+        {
+            continue; // incomplete entry
+        }
+        json entry;
+        try
+        {
+            entry_file >> entry;
+        }
+        catch (const exception &)
+        {
+            continue;
+        }
+        int entry_steps = entry["steps"].get<int>();
+        if (entry_steps <= max_steps && (!found || entry_steps > steps))
+        {
+            found = true;
+            steps = entry_steps;
+            directory = prefix_directory + "/" + name;
+        }
+    }
+    closedir(listing);
+    return found;
+}
+
+void complete_cache_entry(const string &directory, const CacheKeys &keys, int steps)
+{
+    {
+        ofstream entry_file(directory + "/entry.json.tmp");
+        entry_file << json({{"steps", steps}, {"full_key", keys.full}, {"prefix_key", keys.prefix}, {"version", PANKH_VERSION}}).dump(2) << endl;
+    }
+    rename((directory + "/entry.json.tmp").c_str(), (directory + "/entry.json").c_str());
+}
+
+static json to_json(const MatrixXd &matrix)
+{
+    return {{"rows", matrix.rows()}, {"cols", matrix.cols()}, {"data", vector<double>(matrix.data(), matrix.data() + matrix.size())}};
+}
+
+static MatrixXd matrix_from_json(const json &value)
+{
+    vector<double> data = value["data"].get<vector<double>>();
+    return Map<MatrixXd>(data.data(), value["rows"].get<int>(), value["cols"].get<int>());
+}
+
+void save_simulation_state(const string &filename, const vector<Body> &bodies, const CoupledSystem &system, const vector<PerformanceAccumulator> &accumulators)
+{
+    json state;
+    state["bodies"] = json::array();
+    for (const Body &body : bodies)
+    {
+        json b;
+        b["n"] = body.n;
+        b["gamma_bound"] = to_json(body.gamma_bound);
+        b["gamma_old"] = body.gamma_old;
+        b["lwp"] = body.lwp;
+        b["theta_wp"] = body.theta_wp;
+        b["gamma_wp"] = body.gamma_wp;
+        b["wake_panel_coordinates"] = to_json(body.wake_panel_coordinates);
+        b["wake_panel_cp"] = to_json(body.wake_panel_cp);
+        b["wake_panel_normal"] = to_json(body.wake_panel_normal);
+        b["vtotal_wp_cp"] = to_json(body.vtotal_wp_cp);
+        b["gamma_wake_strength"] = body.gamma_wake_strength;
+        b["gamma_wake_x_location"] = body.gamma_wake_x_location;
+        b["gamma_wake_y_location"] = body.gamma_wake_y_location;
+        b["phi_old"] = to_json(body.phi_old);
+        b["phi_airfoil_cps"] = to_json(body.phi_airfoil_cps);
+        b["cp"] = to_json(body.cp);
+        b["cn_tilda"] = body.cn_tilda;
+        b["ca_tilda"] = body.ca_tilda;
+        state["bodies"].push_back(b);
+    }
+    state["gamma_unsteady"] = to_json(system.gamma_unsteady);
+    state["K_inv_rhs"] = to_json(system.K_inv_rhs);
+    state["K_inv_W"] = to_json(system.K_inv_W);
+    state["performance"] = json::array();
+    for (const PerformanceAccumulator &accumulator : accumulators)
+    {
+        state["performance"].push_back({{"window", accumulator.window}, {"cycle", accumulator.cycle}, {"started", accumulator.started}, {"t_last", accumulator.t_last}, {"ct_last", accumulator.ct_last}, {"cpower_last", accumulator.cpower_last}, {"ct_integral", accumulator.ct_integral}, {"ct2_integral", accumulator.ct2_integral}, {"cpower_integral", accumulator.cpower_integral}, {"cpower2_integral", accumulator.cpower2_integral}});
+    }
+    ofstream file(filename);
+    file << state.dump() << endl;
+}
+
+void load_simulation_state(const string &filename, vector<Body> &bodies, CoupledSystem &system, vector<PerformanceAccumulator> &accumulators)
+{
+    ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw runtime_error("load_simulation_state: cannot open " + filename);
+    }
+    json state;
+    file >> state;
+    if (state["bodies"].size() != bodies.size() || state["performance"].size() != accumulators.size())
+    {
+        throw runtime_error("load_simulation_state: " + filename + " holds a different number of bodies");
+    }
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        Body &body = bodies[i];
+        const json &b = state["bodies"][i];
+        if (b["n"].get<int>() != body.n)
+        {
+            throw runtime_error("load_simulation_state: " + filename + " holds a different number of nodes");
+        }
+        body.gamma_bound = matrix_from_json(b["gamma_bound"]);
+        body.gamma_old = b["gamma_old"];
+        body.lwp = b["lwp"];
+        body.theta_wp = b["theta_wp"];
+        body.gamma_wp = b["gamma_wp"];
+        body.wake_panel_coordinates = matrix_from_json(b["wake_panel_coordinates"]);
+        body.wake_panel_cp = matrix_from_json(b["wake_panel_cp"]);
+        body.wake_panel_normal = matrix_from_json(b["wake_panel_normal"]);
+        body.vtotal_wp_cp = matrix_from_json(b["vtotal_wp_cp"]);
+        body.gamma_wake_strength = b["gamma_wake_strength"].get<vector<double>>();
+        body.gamma_wake_x_location = b["gamma_wake_x_location"].get<vector<double>>();
+        body.gamma_wake_y_location = b["gamma_wake_y_location"].get<vector<double>>();
+        body.phi_old = matrix_from_json(b["phi_old"]);
+        body.phi_airfoil_cps = matrix_from_json(b["phi_airfoil_cps"]);
+        body.cp = matrix_from_json(b["cp"]);
+        body.cn_tilda = b["cn_tilda"];
+        body.ca_tilda = b["ca_tilda"];
+    }
+    system.gamma_unsteady = matrix_from_json(state["gamma_unsteady"]);
+    system.K_inv_rhs = matrix_from_json(state["K_inv_rhs"]);
+    system.K_inv_W = matrix_from_json(state["K_inv_W"]);
+    for (size_t i = 0; i < accumulators.size(); i++)
+    {
+        const json &a = state["performance"][i];
+        PerformanceAccumulator &accumulator = accumulators[i];
+        accumulator.window = a["window"];
+        accumulator.cycle = a["cycle"];
+        accumulator.started = a["started"];
+        accumulator.t_last = a["t_last"];
+        accumulator.ct_last = a["ct_last"];
+        accumulator.cpower_last = a["cpower_last"];
+        accumulator.ct_integral = a["ct_integral"];
+        accumulator.ct2_integral = a["ct2_integral"];
+        accumulator.cpower_integral = a["cpower_integral"];
+        accumulator.cpower2_integral = a["cpower2_integral"];
+    }
+}
+
+bool copy_file(const string &from, const string &to)
+{
+    ifstream source(from, ios::binary);
+    if (!source.is_open())
+    {
+        return false;
+    }
+    ofstream destination(to, ios::binary);
+    destination << source.rdbuf();
+    return destination.good();
+}
@@ -0,0 +1,270 @@
+#include "Convergence.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "Input.h"
+#include "constants.h"
+
+void read_load_metrics(const string &filename, double window, LoadMetrics &metrics)
+{
+    ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw runtime_error("read_load_metrics: cannot open " + filename);
+    }
+    vector<double> t, cl, cd;
+    string line;
+    while (getline(file, line))
+    {
+        istringstream row(line);
+        double a, b, c;
+        if (row >> a >> b >> c)
+        {
+            t.push_back(a);
+            cl.push_back(b);
+            cd.push_back(c);
+        }
+    }
+    if (t.empty())
+    {
+        throw runtime_error("read_load_metrics: no loads in " + filename);
+    }
+
+    double t_start = t.back() - window;
+    size_t first = 0;
+    while (first < t.size() && t[first] < t_start - 1e-9 * fabs(window))
+    {
+        first++;
+    }
+    if (t.size() - first < 2)
+    {
+        throw runtime_error("read_load_metrics: fewer than two time steps in the window of " + filename);
+    }
+    double cl_integral = 0.0, cd_integral = 0.0;
+    double cl_min = cl[first], cl_max = cl[first];
+    for (size_t i = first + 1; i < t.size(); i++)
+    {
+        double h = t[i] - t[i - 1];
+        cl_integral += 0.5 * h * (cl[i] + cl[i - 1]);
+        cd_integral += 0.5 * h * (cd[i] + cd[i - 1]);
+        cl_min = min(cl_min, cl[i]);
+        cl_max = max(cl_max, cl[i]);
+    }
+    double length = t.back() - t[first];
+    metrics.cl_mean = cl_integral / length;
+    metrics.cl_amplitude = 0.5 * (cl_max - cl_min);
+    metrics.ct_mean = -cd_integral / length;
+}
+
+bool richardson_extrapolation(double f_coarse, double f_medium, double f_fine, double ratio, double &order, double &extrapolated)
+{
+    double d1 = f_coarse - f_medium, d2 = f_medium - f_fine;
+    extrapolated = f_fine;
+    order = numeric_limits<double>::quiet_NaN();
+    if (d2 == 0.0 || d1 / d2 <= 1.0)
+    {
+        return false; // converged to round-off, oscillatory or not converging
+    }
+    order = log(d1 / d2) / log(ratio);
+    extrapolated = f_fine - d2 / (pow(ratio, order) - 1.0);
+    return true;
+}
+
+/* one run of the convergence ladder */
+struct ConvergenceRun
+{
+    int n, nsteps;
+    double dt;
+    string directory;
+    LoadMetrics metrics;
+    double wall_time;
+    bool completed; // false when the solver failed (e.g. a wake panel that did not converge)
+};
+
+int run_converge(json input, const string &executable)
+{
+    json settings = input["converge"];
+    int levels = optional_setting(settings, "levels", 3);
+    int ratio = optional_setting(settings, "ratio", 2);
+    double target = optional_setting(settings, "target", 0.01);
+    int jobs = optional_setting(settings, "jobs", 4);
+    if (levels < 3 || ratio < 2 || jobs < 1 || !(target > 0.0))
+    {
+        cerr << "Error: converge needs levels >= 3, ratio >= 2, jobs >= 1 and target > 0" << endl;
+        return 1;
+    }
+    char resolved[PATH_MAX];
+    if (realpath(executable.c_str(), resolved) == NULL)
+    {
+        cerr << "Error: cannot locate the solver executable " << executable << endl;
+        return 1;
+    }
+
+    // Coarsest run from the input; panels and time steps are refined by ratio per level, independently
+    int n0 = input["geometry"]["n"];
+    double c = input["geometry"]["c"];
+    double k = input["motion"]["k"];
+    double Qinf = freestream_speed(input["flow"], c);
+    bool periodic = input["simulation"]["dt"].is_null(); // refine nsteps per cycle, otherwise the explicit dt
+    int nsteps0 = input["simulation"]["nsteps"];
+    double dt0 = periodic ? pi * c / (k * Qinf) / nsteps0 : input["simulation"]["dt"].get<double>(); // T / nsteps when periodic
+    // metrics over the last cycle (t/T), or over the last tenth of a non-periodic run (convective time)
+    double window = periodic ? 1.0 : 0.1 * 2.0 * Qinf * input["simulation"]["t_max"].get<double>() / c;
+
+    vector<ConvergenceRun> runs(levels * levels);
+    const char *subdirectories[] = {"a_matrix_file", "airfoil_normal_file", "b_vector_file", "gamma_vector_file", "potential_file", "pressure_file", "vortex_shedding"};
+    for (int i = 0; i < levels; i++)
+    {
+        for (int j = 0; j < levels; j++)
+        {
+            ConvergenceRun &run = runs[i * levels + j];
+            run.n = (n0 - 1) * (int)pow(ratio, i) + 1;
+            run.nsteps = nsteps0 * (int)pow(ratio, j);
+            run.dt = dt0 / pow(ratio, j);
+            run.directory = "output_files/converge/n=" + to_string(run.n) + (periodic ? "_nsteps=" + to_string(run.nsteps) : "_dt=" + double_to_string(run.dt, 8));
+            string command = "mkdir -p";
+            for (const char *subdirectory : subdirectories)
+            {
+                command += " '" + run.directory + "/output_files/" + subdirectory + "'";
+            }
+            command += " && rm -f '" + run.directory + "/status.txt'"; // no status left from an earlier ladder
+            if (system(command.c_str()) != 0)
+            {
+                cerr << "Error: cannot create " << run.directory << endl;
+                return 1;
+            }
+            json child = input;
+            child.erase("converge");
+            child["geometry"]["n"] = run.n;
+            child["simulation"]["nsteps"] = run.nsteps;
+            if (!periodic)
+            {
+                child["simulation"]["dt"] = run.dt;
+            }
+            child["simulation"]["gnuplot_terminal"] = "dumb";
+            ofstream(run.directory + "/input.json") << child.dump(2) << endl;
+        }
+    }
+
+    // Each run is a separate solver process in its own directory, jobs of them at a time
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t first = 0; first < runs.size(); first += jobs)
+    {
+        string command;
+        for (size_t r = first; r < min(runs.size(), first + jobs); r++)
+        {
+            cout << "converge: running n = " << runs[r].n << (periodic ? ", nsteps = " + to_string(runs[r].nsteps) : ", dt = " + double_to_string(runs[r].dt, 8)) << endl;
+            command += "(cd '" + runs[r].directory + "' && { '" + resolved + "' input.json > log.txt 2>&1; echo $? > status.txt; }) & ";
+        }
+        command += "wait";
+        if (system(command.c_str()) != 0)
+        {
+            cerr << "Error: the convergence runs could not be started" << endl;
+            return 1;
+        }
+    }
+    auto stop = chrono::high_resolution_clock::now();
+
+    // A failed run is marked and left out; it does not stop the ladder
+    for (ConvergenceRun &run : runs)
+    {
+        int status = -1;
+        ifstream(run.directory + "/status.txt") >> status;
+        run.completed = (status == 0);
+        if (!run.completed)
+        {
+            cerr << "converge: the run n = " << run.n << (periodic ? ", nsteps = " + to_string(run.nsteps) : ", dt = " + double_to_string(run.dt, 8)) << " failed (see " << run.directory << "/log.txt)" << endl;
+        }
+        else
+        {
+            string loads = run.directory + "/output_files/cl_cd_pitch_plunge_k=" + double_to_string(k, 3) + "_n=" + to_string(run.n) + (input["bodies"].is_null() ? "" : "_body0") + ".dat";
+            try
+            {
+                read_load_metrics(loads, window, run.metrics);
+            }
+            catch (const exception &e)
+            {
+                cerr << "converge: " << e.what() << " (see " << run.directory << "/log.txt)" << endl;
+                run.completed = false;
+            }
+        }
+        run.wall_time = 0.0;
+        ifstream log(run.directory + "/log.txt");
+        string line;
+        while (getline(log, line))
+        {
+            if (line.compare(0, 12, "Wall time = ") == 0)
+            {
+                run.wall_time = stod(line.substr(12));
+            }
+        }
+    }
+
+    // Richardson extrapolation along the finest column (panels) and row (time steps), combined additively
+    int L = levels - 1;
+    bool extrapolation = true; // needs the runs of the finest n and of the finest time step
+    for (int l = L - 2; l <= L; l++)
+    {
+        extrapolation = extrapolation && runs[l * levels + L].completed && runs[L * levels + l].completed;
+    }
+    const char *names[] = {"mean Cl", "Cl amplitude", "mean Ct"};
+    double extrapolated[3] = {numeric_limits<double>::quiet_NaN(), numeric_limits<double>::quiet_NaN(), numeric_limits<double>::quiet_NaN()};
+    for (int m = 0; m < 3 && extrapolation; m++)
+    {
+        auto value = [&](int i, int j)
+        {
+            const LoadMetrics &metrics = runs[i * levels + j].metrics;
+            return (m == 0) ? metrics.cl_mean : (m == 1) ? metrics.cl_amplitude : metrics.ct_mean;
+        };
+        double order_n, order_t, f_n, f_t;
+        bool monotone_n = richardson_extrapolation(value(L - 2, L), value(L - 1, L), value(L, L), ratio, order_n, f_n);
+        bool monotone_t = richardson_extrapolation(value(L, L - 2), value(L, L - 1), value(L, L), ratio, order_t, f_t);
+        extrapolated[m] = f_n + f_t - value(L, L);
+        cout << names[m] << ": extrapolated " << extrapolated[m] << ", observed order in n " << order_n << ", in time step " << order_t << endl;
+        if (!monotone_n || !monotone_t)
+        {
+            cout << "  (not monotone in " << (!monotone_n ? "n" : "time step") << ": the finest run is used there instead of an extrapolation)" << endl;
+        }
+    }
+
+    // Error of every run against the extrapolation; the cheapest run within the target is recommended
+    ofstream table("output_files/convergence.dat");
+    table << "# n\tnsteps\tdt\twall time [s]\tmean Cl\tCl amplitude\tmean Ct\terror (largest of the three against the extrapolation)" << endl;
+    int best = -1;
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const ConvergenceRun &run = runs[r];
+        if (!run.completed)
+        {
+            table << run.n << "\t" << run.nsteps << "\t" << run.dt << "\t" << run.wall_time << "\tnan\tnan\tnan\tfailed" << endl;
+            continue;
+        }
+        double error = max(fabs(run.metrics.cl_mean - extrapolated[0]), max(fabs(run.metrics.cl_amplitude - extrapolated[1]), fabs(run.metrics.ct_mean - extrapolated[2])));
+        table << run.n << "\t" << run.nsteps << "\t" << run.dt << "\t" << run.wall_time << "\t" << run.metrics.cl_mean << "\t" << run.metrics.cl_amplitude << "\t" << run.metrics.ct_mean << "\t" << error << endl;
+        if (error <= target && (best < 0 || run.wall_time < runs[best].wall_time))
+        {
+            best = r;
+        }
+    }
+    cout << "converge: " << runs.size() << " runs in " << chrono::duration<double>(stop - start).count() << " s, table in output_files/convergence.dat" << endl;
+    if (!extrapolation)
+    {
+        cerr << "Error: a run of the finest n or of the finest time step failed, there is no extrapolation to recommend a run against" << endl;
+        return 1;
+    }
+    if (best < 0)
+    {
+        cout << "No run of the ladder is within the target error " << target << ": refine further (more levels or a finer coarsest run)" << endl;
+        return 0;
+    }
+    cout << "Cheapest run within the target error " << target << ": n = " << runs[best].n << ", " << (periodic ? "nsteps = " + to_string(runs[best].nsteps) : "dt = " + double_to_string(runs[best].dt, 8)) << " (" << runs[best].wall_time << " s)" << endl;
+    return 0;
+}
@@ -0,0 +1,470 @@
+#include "CoupledSystem.h"
+#include "InfluenceMatrix.h"
+#include "Krylov.h"
+#include <sstream>
+#include <stdexcept>
+
+/* adds the normal velocity at the control points of target induced by unit nodal strengths of the panels of
+   source (direct = false: images only) to the block of K starting at (row0, col0) */
+static void add_influence_block(const Body &target, const Body &source, const ImageSystem &images, bool direct, MatrixXd &K, int row0, int col0)
+{
+    MatrixXd pcm(2, 2);
+    for (int j = 0; j < target.n - 1; j++)
+    {
+        for (int i = 0; i < source.n - 1; i++)
+        {
+            if (direct)
+            {
+                pcm = influence_matrix(source.panels.x_pp(i), source.panels.y_pp(i), source.panels.x_pp(i + 1), source.panels.y_pp(i + 1), target.panels.x_cp(j), target.panels.y_cp(j));
+            }
+            else
+            {
+                pcm.setZero();
+            }
+            if (!images.transforms.empty())
+            {
+                pcm += influence_matrix_images(source.panels.x_pp(i), source.panels.y_pp(i), source.panels.x_pp(i + 1), source.panels.y_pp(i + 1), target.panels.x_cp(j), target.panels.y_cp(j), images);
+            }
+            K(row0 + j, col0 + i) += target.panels.unit_normal(j, 0) * pcm(0, 0) + target.panels.unit_normal(j, 1) * pcm(1, 0);
+            K(row0 + j, col0 + i + 1) += target.panels.unit_normal(j, 0) * pcm(0, 1) + target.panels.unit_normal(j, 1) * pcm(1, 1);
+        }
+    }
+}
+
+/* Kelvin's circulation theorem: trapezoidal weights of the nodal strengths giving the bound circulation */
+static VectorXd kelvin_weights(const Body &body)
+{
+    int n = body.n;
+    VectorXd weights(n);
+    weights(0) = body.panels.l(0) * 0.5;
+    for (int i = 1; i < n - 1; i++)
+    {
+        weights(i) = (body.panels.l(i - 1) + body.panels.l(i)) * 0.5;
+    }
+    weights(n - 1) = body.panels.l(n - 2) * 0.5;
+    return weights;
+}
+
+/* normal velocity at control point j (or the Kutta row, j = n - 1) of a body induced by a unit strength at its node i */
+static double self_influence(const PanelGeometry &panels, int n, int j, int i)
+{
+    if (j == n - 1)
+    {
+        return (i == 0 || i == n - 1) ? 1.0 : 0.0;
+    }
+    double influence = 0.0;
+    for (int p = max(i - 1, 0); p <= min(i, n - 2); p++) // the panels ending and starting at node i
+    {
+        MatrixXd pcm = influence_matrix(panels.x_pp(p), panels.y_pp(p), panels.x_pp(p + 1), panels.y_pp(p + 1), panels.x_cp(j), panels.y_cp(j));
+        int column = (p == i) ? 0 : 1;
+        influence += panels.unit_normal(j, 0) * pcm(0, column) + panels.unit_normal(j, 1) * pcm(1, column);
+    }
+    return influence;
+}
+
+/* diagonal blocks of the preconditioner: block_size consecutive nodes, starting half a block before the
+   trailing edge so that the first block holds both trailing-edge nodes and the Kutta row */
+static void build_preconditioner(const vector<Body> &bodies, CoupledSystem &system)
+{
+    system.blocks.clear();
+    system.block_lu.clear();
+    int block_size = max(system.krylov.block_size, 2);
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        const Body &body = bodies[b];
+        int n = body.n;
+        RigidBodyState identity = RigidBodyState();
+        identity.cos_alpha = 1.0;
+        PanelGeometry panels;
+        resize_panel_geometry(n, panels);
+        update_panel_geometry(identity, body.x0, body.y0, panels);
+
+        int shift = (n > block_size) ? n - block_size / 2 : 0;
+        for (int start = 0; start < n; start += block_size)
+        {
+            int size = min(block_size, n - start);
+            vector<int> nodes(size);
+            for (int k = 0; k < size; k++)
+            {
+                nodes[k] = (start + k + shift) % n;
+            }
+            MatrixXd block(size, size);
+            for (int r = 0; r < size; r++)
+            {
+                for (int c = 0; c < size; c++)
+                {
+                    block(r, c) = self_influence(panels, n, nodes[r], nodes[c]);
+                }
+            }
+            for (int k = 0; k < size; k++)
+            {
+                nodes[k] += system.offset[b];
+            }
+            system.blocks.push_back(nodes);
+            system.block_lu.push_back(PartialPivLU<MatrixXd>(block));
+        }
+    }
+}
+
+/* H-matrix of the no-penetration rows of K: rows are the control points of all bodies, columns the nodes */
+static void build_bound_hmatrix(const vector<Body> &bodies, CoupledSystem &system)
+{
+    vector<double> row_x, row_y, column_x, column_y;
+    vector<int> row_body, row_panel, column_body, column_node;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        const PanelGeometry &panels = bodies[b].panels;
+        for (int j = 0; j < bodies[b].n - 1; j++)
+        {
+            row_x.push_back(panels.x_cp(j));
+            row_y.push_back(panels.y_cp(j));
+            row_body.push_back(b);
+            row_panel.push_back(j);
+        }
+        for (int i = 0; i < bodies[b].n; i++)
+        {
+            column_x.push_back(panels.x_pp(i));
+            column_y.push_back(panels.y_pp(i));
+            column_body.push_back(b);
+            column_node.push_back(i);
+        }
+    }
+    MatrixEntry entry = [&](int row, int column) -> double
+    {
+        const PanelGeometry &target = bodies[row_body[row]].panels;
+        const Body &source = bodies[column_body[column]];
+        int j = row_panel[row], i = column_node[column];
+        double value = 0.0;
+        for (int p = max(i - 1, 0); p <= min(i, source.n - 2); p++) // the panels ending and starting at node i
+        {
+            MatrixXd pcm = influence_matrix(source.panels.x_pp(p), source.panels.y_pp(p), source.panels.x_pp(p + 1), source.panels.y_pp(p + 1), target.x_cp(j), target.y_cp(j));
+            if (!system.images.transforms.empty())
+            {
+                pcm += influence_matrix_images(source.panels.x_pp(p), source.panels.y_pp(p), source.panels.x_pp(p + 1), source.panels.y_pp(p + 1), target.x_cp(j), target.y_cp(j), system.images);
+            }
+            int k = (p == i) ? 0 : 1;
+            value += target.unit_normal(j, 0) * pcm(0, k) + target.unit_normal(j, 1) * pcm(1, k);
+        }
+        return value;
+    };
+    build_hmatrix(row_x, row_y, column_x, column_y, entry, system.krylov.leaf_size, system.krylov.eta, system.krylov.aca_tolerance, system.H);
+    system.hmatrix_built = true;
+}
+
+/* y = K x evaluated with the treecode or the H-matrix (bound panels of all bodies and their images) and the Kutta rows */
+static void bound_product(const vector<Body> &bodies, CoupledSystem &system, const VectorXd &x, VectorXd &y)
+{
+    if (system.krylov.hmatrix)
+    {
+        /* the H-matrix rows skip the Kutta row of every body */
+        VectorXd y_panels;
+        hmatrix_product(system.H, x, y_panels);
+        y.resize(system.size);
+        int row = 0;
+        for (size_t a = 0; a < bodies.size(); a++)
+        {
+            int row0 = system.offset[a], n = bodies[a].n;
+            y.segment(row0, n - 1) = y_panels.segment(row, n - 1);
+            y(row0 + n - 1) = x(row0) + x(row0 + n - 1); /* [kutta condition] */
+            row += n - 1;
+        }
+        return;
+    }
+
+    vector<double> gamma_1, gamma_2;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        for (int i = 0; i < bodies[b].n - 1; i++)
+        {
+            gamma_1.push_back(x(system.offset[b] + i));
+            gamma_2.push_back(x(system.offset[b] + i + 1));
+        }
+    }
+    set_panel_tree_strengths(system.tree, gamma_1, gamma_2);
+    apply_tree_projection(system.tree, system.projection, y);
+    for (size_t a = 0; a < bodies.size(); a++)
+    {
+        int row0 = system.offset[a];
+        y(row0 + bodies[a].n - 1) = x(row0) + x(row0 + bodies[a].n - 1); /* [kutta condition] */
+    }
+}
+
+/* X = K^-1 B on the matrix-free path; X holds the initial guesses on entry. Throws if a column misses the tolerance. */
+static void solve_bound(const vector<Body> &bodies, CoupledSystem &system, const MatrixXd &B, MatrixXd &X)
+{
+    LinearOperator product = [&](const VectorXd &x, VectorXd &y)
+    { bound_product(bodies, system, x, y); };
+    LinearOperator preconditioner = [&](const VectorXd &r, VectorXd &z)
+    {
+        z.resize(r.size());
+        for (size_t k = 0; k < system.blocks.size(); k++)
+        {
+            const vector<int> &nodes = system.blocks[k];
+            VectorXd r_block(nodes.size());
+            for (size_t i = 0; i < nodes.size(); i++)
+            {
+                r_block(i) = r(nodes[i]);
+            }
+            VectorXd z_block = system.block_lu[k].solve(r_block);
+            for (size_t i = 0; i < nodes.size(); i++)
+            {
+                z(nodes[i]) = z_block(i);
+            }
+        }
+    };
+    if (X.rows() != B.rows() || X.cols() != B.cols())
+    {
+        X = MatrixXd::Zero(B.rows(), B.cols());
+    }
+    for (int c = 0; c < B.cols(); c++)
+    {
+        VectorXd x = X.col(c);
+        int iterations;
+        double residual;
+        bool converged = gmres(product, preconditioner, B.col(c), x, system.krylov.restart, system.krylov.max_iterations, system.krylov.tolerance, iterations, residual);
+        system.krylov_iterations += iterations;
+        system.krylov_residual = max(system.krylov_residual, residual);
+        if (!converged)
+        {
+            ostringstream message;
+            message << "GMRES did not converge in " << system.krylov.max_iterations << " products (relative residual " << residual << ", tolerance " << system.krylov.tolerance << ")";
+            throw runtime_error(message.str());
+        }
+        X.col(c) = x;
+    }
+}
+
+void initialize_coupled_system(const vector<Body> &bodies, CoupledSystem &system, const KrylovSettings &krylov)
+{
+    system.offset.resize(bodies.size());
+    system.size = 0;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        system.offset[b] = system.size;
+        system.size += bodies[b].n;
+    }
+    system.krylov = krylov;
+    system.krylov_iterations = 0;
+    system.krylov_residual = 0.0;
+    system.hmatrix_built = false;
+    if (krylov.enabled)
+    {
+        build_preconditioner(bodies, system);
+    }
+    else
+    {
+        system.K = MatrixXd::Zero(system.size, system.size);
+    }
+    system.rhs = VectorXd::Zero(system.size);
+    system.K_inv_rhs = VectorXd::Zero(system.size);
+    system.gamma_unsteady = VectorXd::Zero(system.size + bodies.size());
+    system.factorised = false;
+    system.shared_lu = nullptr;
+}
+
+void assemble_bound_system(const vector<Body> &bodies, CoupledSystem &system)
+{
+    int nbodies = bodies.size();
+    if (system.krylov.enabled && system.krylov.hmatrix)
+    {
+        system.krylov_iterations = 0;
+        system.krylov_residual = 0.0;
+        if (!(nbodies == 1 && system.images.transforms.empty() && system.hmatrix_built))
+        {
+            build_bound_hmatrix(bodies, system);
+        }
+        return;
+    }
+    if (system.krylov.enabled)
+    {
+        vector<double> x1, y1, x2, y2;
+        for (int b = 0; b < nbodies; b++)
+        {
+            const PanelGeometry &panels = bodies[b].panels;
+            for (int i = 0; i < bodies[b].n - 1; i++)
+            {
+                x1.push_back(panels.x_pp(i));
+                y1.push_back(panels.y_pp(i));
+                x2.push_back(panels.x_pp(i + 1));
+                y2.push_back(panels.y_pp(i + 1));
+            }
+        }
+        build_panel_tree(x1, y1, x2, y2, system.krylov.leaf_size, system.krylov.theta, system.krylov.order, system.tree);
+
+        /* the control points and their images are the same targets for every product of this time step */
+        vector<double> x, y, w_x, w_y;
+        vector<int> row;
+        for (int a = 0; a < nbodies; a++)
+        {
+            const PanelGeometry &panels = bodies[a].panels;
+            for (int j = 0; j < bodies[a].n - 1; j++)
+            {
+                x.push_back(panels.x_cp(j));
+                y.push_back(panels.y_cp(j));
+                w_x.push_back(panels.unit_normal(j, 0));
+                w_y.push_back(panels.unit_normal(j, 1));
+                row.push_back(system.offset[a] + j);
+                for (size_t k = 0; k < system.images.transforms.size(); k++)
+                {
+                    const ImageTransform &image = system.images.transforms[k];
+                    x.push_back(panels.x_cp(j));
+                    y.push_back(image_point_y(image, panels.y_cp(j)));
+                    w_x.push_back(image.cu * panels.unit_normal(j, 0));
+                    w_y.push_back(image.cv * panels.unit_normal(j, 1));
+                    row.push_back(system.offset[a] + j);
+                }
+            }
+        }
+        build_tree_projection(system.tree, x, y, w_x, w_y, row, system.size, system.projection);
+        system.krylov_iterations = 0;
+        system.krylov_residual = 0.0;
+        return;
+    }
+    if (nbodies == 1 && system.images.transforms.empty() && system.factorised)
+    {
+        return; // a single rigid body in an unbounded flow: K is the cached self block for the whole run
+    }
+
+    system.K.setZero();
+    for (int a = 0; a < nbodies; a++)
+    {
+        const Body &target = bodies[a];
+        system.K.block(system.offset[a], system.offset[a], target.n, target.n) = target.A_self;
+
+        /* inter-body blocks: normal velocity at the control points of body a induced by the panels of body b;
+           the self block only needs the images (the direct part is the cached A_self) */
+        for (int b = 0; b < nbodies; b++)
+        {
+            if (b == a && system.images.transforms.empty())
+            {
+                continue;
+            }
+            add_influence_block(target, bodies[b], system.images, b != a, system.K, system.offset[a], system.offset[b]);
+        }
+    }
+    system.lu.compute(system.K);
+    system.factorised = true;
+}
+
+/* the factorisation of K: the system's own, or the one it shares with systems of the same body */
+static const PartialPivLU<MatrixXd> &factorisation(const CoupledSystem &system)
+{
+    return (system.shared_lu != nullptr) ? *system.shared_lu : system.lu;
+}
+
+void assemble_right_hand_side(const vector<Body> &bodies, CoupledSystem &system, double Qinf)
+{
+    VectorXd normal_vector_panel_cp(2), shed_vel(2), flow_vel(2);
+    for (size_t a = 0; a < bodies.size(); a++)
+    {
+        const Body &body = bodies[a];
+        for (int i = 0; i < body.n - 1; i++)
+        {
+            normal_vector_panel_cp(0) = body.panels.unit_normal(i, 0);
+            normal_vector_panel_cp(1) = body.panels.unit_normal(i, 1);
+            shed_vel = velocity_wake_vortices_all(bodies, system.images, body.panels.x_cp(i), body.panels.y_cp(i)); /* due to the previously shed vortices */
+            flow_vel = body_kinematic_velocity(body, Qinf, body.panels.x_cp(i), body.panels.y_cp(i));
+            system.rhs(system.offset[a] + i) = -dot(shed_vel + flow_vel, normal_vector_panel_cp);
+        }
+        system.rhs(system.offset[a] + body.n - 1) = 0.0; /* [kutta condition] */
+    }
+    if (system.krylov.enabled)
+    {
+        MatrixXd X = system.K_inv_rhs; // the previous time step as initial guess
+        solve_bound(bodies, system, system.rhs, X);
+        system.K_inv_rhs = X.col(0);
+    }
+    else
+    {
+        system.K_inv_rhs = factorisation(system).solve(system.rhs);
+    }
+}
+
+void solve_coupled_system(vector<Body> &bodies, CoupledSystem &system)
+{
+    int nbodies = bodies.size();
+    Vector2d unit_gamma_wake(1, 1);
+    VectorXd normal_vector_panel_cp(2);
+
+    /* influence of every wake panel on the control points of every body, and the Kutta row of its own body */
+    system.W = MatrixXd::Zero(system.size, nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        const MatrixXd &wpc = bodies[b].wake_panel_coordinates;
+        for (int a = 0; a < nbodies; a++)
+        {
+            const Body &target = bodies[a];
+            for (int i = 0; i < target.n - 1; i++)
+            {
+                MatrixXd panel_coeff_matrix_wake = influence_matrix(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), target.panels.x_cp(i), target.panels.y_cp(i));
+                if (!system.images.transforms.empty())
+                {
+                    panel_coeff_matrix_wake += influence_matrix_images(wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), target.panels.x_cp(i), target.panels.y_cp(i), system.images);
+                }
+                normal_vector_panel_cp(0) = target.panels.unit_normal(i, 0);
+                normal_vector_panel_cp(1) = target.panels.unit_normal(i, 1);
+                system.W(system.offset[a] + i, b) = dot((panel_coeff_matrix_wake * unit_gamma_wake), normal_vector_panel_cp);
+            }
+        }
+        system.W(system.offset[b] + bodies[b].n - 1, b) = 1.0; // kutta condition
+    }
+
+    /* eliminate the bound unknowns: Kelvin rows give (D - C^T K^-1 W) g = Gamma_old - C^T K^-1 rhs */
+    MatrixXd K_inv_W;
+    if (system.krylov.enabled)
+    {
+        solve_bound(bodies, system, system.W, system.K_inv_W); // the previous wake panel solve as initial guess
+        K_inv_W = system.K_inv_W;
+    }
+    else
+    {
+        K_inv_W = factorisation(system).solve(system.W);
+    }
+    MatrixXd schur(nbodies, nbodies);
+    VectorXd schur_rhs(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        VectorXd weights = kelvin_weights(bodies[b]);
+        for (int c = 0; c < nbodies; c++)
+        {
+            schur(b, c) = ((b == c) ? bodies[b].lwp : 0.0) - weights.dot(K_inv_W.block(system.offset[b], c, bodies[b].n, 1).col(0));
+        }
+        schur_rhs(b) = bodies[b].gamma_old - weights.dot(system.K_inv_rhs.segment(system.offset[b], bodies[b].n));
+    }
+    VectorXd gamma_wp = schur.partialPivLu().solve(schur_rhs);
+    VectorXd gamma_bound = system.K_inv_rhs - K_inv_W * gamma_wp;
+
+    system.gamma_unsteady.head(system.size) = gamma_bound;
+    system.gamma_unsteady.tail(nbodies) = gamma_wp;
+    for (int b = 0; b < nbodies; b++)
+    {
+        bodies[b].gamma_bound = gamma_bound.segment(system.offset[b], bodies[b].n);
+        bodies[b].gamma_wp = gamma_wp(b);
+    }
+}
+
+MatrixXd coupled_matrix(const vector<Body> &bodies, const CoupledSystem &system)
+{
+    int nbodies = bodies.size();
+    MatrixXd A_unsteady = MatrixXd::Zero(system.size + nbodies, system.size + nbodies);
+    A_unsteady.topLeftCorner(system.size, system.size) = system.K;
+    A_unsteady.topRightCorner(system.size, nbodies) = system.W;
+    for (int b = 0; b < nbodies; b++)
+    {
+        A_unsteady.block(system.size + b, system.offset[b], 1, bodies[b].n) = kelvin_weights(bodies[b]).transpose(); /* Kelvins Circulation [DGAMMA/DT=0.0] */
+        A_unsteady(system.size + b, system.size + b) = bodies[b].lwp;
+    }
+    return A_unsteady;
+}
+
+VectorXd coupled_right_hand_side(const vector<Body> &bodies, const CoupledSystem &system)
+{
+    int nbodies = bodies.size();
+    VectorXd B_unsteady(system.size + nbodies);
+    B_unsteady.head(system.size) = system.rhs;
+    for (int b = 0; b < nbodies; b++)
+    {
+        B_unsteady(system.size + b) = bodies[b].gamma_old;
+    }
+    return B_unsteady;
+}
@@ -0,0 +1,190 @@
+#include "Ensemble.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "Input.h"
+#include "Loads.h"
+#include "NewtonRaphsonNonLinear.h"
+#include "Performance.h"
+#include "constants.h"
+
+void initialize_ensemble(vector<EnsembleCase> &cases, CoupledSystem &shared)
+{
+    if (cases.empty())
+    {
+        throw invalid_argument("initialize_ensemble: no cases");
+    }
+    KrylovSettings direct;
+    direct.enabled = false;
+    direct.hmatrix = false;
+    initialize_coupled_system(cases[0].bodies, shared, direct);
+    assemble_bound_system(cases[0].bodies, shared);
+
+    const Body &first = cases[0].bodies[0];
+    for (EnsembleCase &ensemble_case : cases)
+    {
+        if (ensemble_case.bodies.size() != 1)
+        {
+            throw invalid_argument("initialize_ensemble: every case must hold a single body");
+        }
+        const Body &body = ensemble_case.bodies[0];
+        if (body.n != first.n || body.x0 != first.x0 || body.y0 != first.y0)
+        {
+            throw invalid_argument("initialize_ensemble: all cases must share the geometry of the first one");
+        }
+        /* the system of a case keeps its own right-hand side and wake panel columns, but not K */
+        CoupledSystem &system = ensemble_case.system;
+        system.offset.assign(1, 0);
+        system.size = body.n;
+        system.krylov = direct;
+        system.factorised = true;
+        system.shared_lu = &shared.lu;
+        system.rhs = VectorXd::Zero(body.n);
+        system.K_inv_rhs = VectorXd::Zero(body.n);
+        system.gamma_unsteady = VectorXd::Zero(body.n + 1);
+        ensemble_case.dt_previous = ensemble_case.dt;
+        ensemble_case.freestream = VectorXd::Zero(2);
+        ensemble_case.newton_iterations = 0;
+    }
+}
+
+void solve_ensemble_step(EnsembleCase &ensemble_case, const EnsembleSettings &settings, int iter)
+{
+    vector<Body> &bodies = ensemble_case.bodies;
+    Body &body = bodies[0];
+    double t = iter * ensemble_case.dt;
+    double inflow_fraction, inflow_rate;
+    evaluate_channel(settings.inflow, t + ensemble_case.dt, inflow_fraction, inflow_rate);
+    ensemble_case.Qinf_t = settings.Qinf * inflow_fraction;
+    ensemble_case.freestream(0) = ensemble_case.Qinf_t;
+    ensemble_case.freestream(1) = settings.Vinf * inflow_fraction;
+    update_body_geometry(body, t);
+
+    assemble_right_hand_side(bodies, ensemble_case.system, ensemble_case.Qinf_t);
+    if (settings.prescribed_wake_panel)
+    {
+        prescribe_wake_panel(body, ensemble_case.freestream, t, ensemble_case.dt_previous, 0.0);
+        solve_coupled_system(bodies, ensemble_case.system);
+        ensemble_case.newton_iterations = 0;
+    }
+    else
+    {
+        ensemble_case.newton_iterations = converge_wake_panels(bodies, ensemble_case.system, ensemble_case.dt_previous, ensemble_case.freestream, settings.epsilon, settings.tolerance, settings.max_newton_iterations);
+    }
+
+    double gamma_t_minus_dt = 0.0;
+    for (int i = 0; i < body.n - 1; i++)
+    {
+        gamma_t_minus_dt += (body.gamma_bound(i) + body.gamma_bound(i + 1)) * body.panels.l(i) * 0.5;
+    }
+    body.gamma_old = gamma_t_minus_dt;
+    compute_surface_loads(bodies, ensemble_case.system.images, 0, iter, ensemble_case.dt_previous, ensemble_case.Qinf_t, settings.Qinf, settings.z, settings.offset, settings.phi_le_quadrature);
+}
+
+int run_ensemble(json input, const EnsembleSettings &settings, chrono::high_resolution_clock::time_point wall_start)
+{
+    json ensemble = input["ensemble"];
+    if (ensemble.is_null() || ensemble["cases"].is_null() || ensemble["cases"].empty())
+    {
+        cerr << "Error: ensemble mode needs the list ensemble.cases" << endl;
+        return 1;
+    }
+    double c = input["geometry"]["c"];
+    int nsteps = input["simulation"]["nsteps"];
+    int ncycles = input["simulation"]["ncycles"];
+    int ncases = ensemble["cases"].size();
+
+    // every case has its own period, time step and number of steps
+    vector<EnsembleCase> cases(ncases);
+    vector<double> case_k(ncases), time_scale(ncases), window(ncases);
+    vector<int> steps(ncases);
+    CoupledSystem shared;
+    try
+    {
+        for (int i = 0; i < ncases; i++)
+        {
+            json entry = ensemble["cases"][i];
+            json motion = input["motion"];
+            if (entry.contains("motion"))
+            {
+                motion.update(entry["motion"]);
+            }
+            case_k[i] = motion["k"].get<double>();
+            double T = 2.0 * pi / ((2.0 * case_k[i] * settings.Qinf) / c);
+            double dt = optional_setting(input["simulation"], "dt", T / nsteps);
+            double time_max = optional_setting(input["simulation"], "t_max", ncycles * T);
+            if (!(dt > 0.0) || !isfinite(dt) || !isfinite(time_max))
+            {
+                throw invalid_argument("ensemble case " + to_string(i) + ": a non-periodic motion (k = 0) needs simulation.dt and simulation.t_max");
+            }
+            steps[i] = (int)floor(time_max / dt + 0.5);
+            cases[i].bodies.push_back(make_body(input["geometry"], motion, json(), settings.Qinf));
+            initialize_body(cases[i].bodies[0], settings.Qinf, dt, i == 0); // K of the first case is shared
+            cases[i].dt = dt;
+            time_scale[i] = (case_k[i] > 0.0) ? 1.0 / T : 2.0 * settings.Qinf / c;
+            window[i] = (case_k[i] > 0.0) ? T : time_max;
+        }
+        initialize_ensemble(cases, shared);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    if (::system("mkdir -p output_files/ensemble") != 0)
+    {
+        cerr << "Error: cannot create output_files/ensemble" << endl;
+        return 1;
+    }
+
+    // the cases march one after the other; loads and cycle performance per case
+    vector<CyclePerformance> last(ncases), completed;
+    for (int i = 0; i < ncases; i++)
+    {
+        EnsembleCase &ensemble_case = cases[i];
+        const Body &body = ensemble_case.bodies[0];
+        ofstream load_file("output_files/ensemble/cl_cd_case" + to_string(i) + ".dat");
+        ofstream performance_file("output_files/ensemble/performance_case" + to_string(i) + ".dat");
+        performance_file << "# cycle\tCt mean\tCt rms\tCpower mean\tCpower rms\tefficiency" << endl;
+        PerformanceAccumulator accumulator;
+        initialize_performance_accumulator(accumulator, window[i]);
+        last[i].cycle = -1;
+        cout << "ensemble: case " << i << ", " << steps[i] + 1 << " time steps" << endl;
+        for (int iter = 0; iter <= steps[i]; iter++)
+        {
+            try
+            {
+                solve_ensemble_step(ensemble_case, settings, iter);
+            }
+            catch (const exception &e)
+            {
+                cerr << "Error: " << e.what() << " in case " << i << " at time step " << iter << endl;
+                return 1;
+            }
+            double t = iter * ensemble_case.dt;
+            load_file << t * time_scale[i] << "\t" << body.cn_tilda << "\t" << body.ca_tilda << endl;
+            double cm, cpower;
+            compute_moment_and_power(body, settings.Qinf, cm, cpower);
+            add_performance_sample(accumulator, t, -body.ca_tilda, cpower, completed);
+            for (const CyclePerformance &cycle : completed)
+            {
+                performance_file << cycle.cycle << "\t" << cycle.ct_mean << "\t" << cycle.ct_rms << "\t" << cycle.cpower_mean << "\t" << cycle.cpower_rms << "\t" << cycle.efficiency << endl;
+                last[i] = cycle;
+            }
+            convect_wakes(ensemble_case.bodies, ensemble_case.system.images, ensemble_case.freestream, ensemble_case.dt, settings.wake);
+        }
+    }
+
+    ofstream summary("output_files/ensemble/summary.dat");
+    summary << "# case\tk\tlast cycle\tCt mean\tCpower mean\tefficiency" << endl;
+    for (int i = 0; i < ncases; i++)
+    {
+        summary << i << "\t" << case_k[i] << "\t" << last[i].cycle << "\t" << last[i].ct_mean << "\t" << last[i].cpower_mean << "\t" << last[i].efficiency << endl;
+    }
+    auto wall_stop = chrono::high_resolution_clock::now();
+    cout << "ensemble: " << ncases << " cases, loads in output_files/ensemble/cl_cd_case<i>.dat, summary in output_files/ensemble/summary.dat" << endl;
+    cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
+    return 0;
+}
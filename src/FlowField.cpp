@@ -0,0 +1,681 @@
+#include "FlowField.h"
+#include "InfluenceMatrix.h"
+#include "constants.h"
+#include <algorithm>
+#include <complex>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+/* three-point Gauss-Legendre rule on [0, 1], as in the treecode */
+static const double gauss_s[3] = {0.5 - 0.5 * 0.7745966692414834, 0.5, 0.5 + 0.5 * 0.7745966692414834};
+static const double gauss_w[3] = {5.0 / 18.0, 8.0 / 18.0, 5.0 / 18.0};
+
+/* blobs further than this many core radii contribute nothing to the vorticity (exp(-36)) */
+static const double blob_reach = 6.0;
+
+/* sources of the field: linear-strength panels (bound and wake panels) and point vortices (wake vortices);
+   every element is also represented by vortex points (three Gauss points of a panel, the vortex itself) with
+   strength Gamma and convective strength Gamma (dz/dt) for the far field, the blobs and dphi/dt */
+struct FieldSources
+{
+    vector<bool> panel;                  // true: panel from (x1, y1) to (x2, y2) with strengths g1, g2
+    vector<double> x1, y1, x2, y2, g1, g2;
+    vector<double> xm, ym;               // midpoint of a panel, position of a vortex
+    vector<int> point_begin;             // vortex points of element e: [point_begin[e], point_begin[e + 1])
+    vector<double> px, py, pg;           // vortex points and their strengths
+    vector<complex<double>> pc;          // convective strengths Gamma (u + i v) of the points
+};
+
+struct FieldTreeNode
+{
+    double x_center, y_center, radius;
+    int begin, end; // elements [begin, end) in tree order
+    int child[2];
+};
+
+struct FieldTree
+{
+    int order;
+    vector<int> element;             // element at each tree position
+    vector<FieldTreeNode> nodes;
+    vector<complex<double>> moments; // per node: order + 1 moments of Gamma, then order + 1 of the convective strengths
+};
+
+/* strength changes of one body (bound panels and wake panel) with their zero-sum expansion about the body */
+struct StrengthChange
+{
+    complex<double> center;
+    double radius;
+    vector<complex<double>> points;
+    vector<double> rates;
+    vector<complex<double>> moments; // m_p = sum rate (z_k - center)^p, p = 1 ... order
+};
+
+void record_field_history(const vector<Body> &bodies, FieldHistory &history)
+{
+    int nbodies = bodies.size();
+    history.valid = true;
+    history.gamma_bound.resize(nbodies);
+    history.wake_x.resize(nbodies);
+    history.wake_y.resize(nbodies);
+    history.wake_panel_cp.resize(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        history.gamma_bound[b] = bodies[b].gamma_bound;
+        history.wake_x[b] = bodies[b].gamma_wake_x_location;
+        history.wake_y[b] = bodies[b].gamma_wake_y_location;
+        history.wake_panel_cp[b] = Vector2d(bodies[b].wake_panel_cp(0), bodies[b].wake_panel_cp(1));
+    }
+}
+
+/* panel with its Gauss points at rest; moving panels set the convective strengths afterwards */
+static void add_panel(FieldSources &sources, double x1, double y1, double x2, double y2, double g1, double g2)
+{
+    sources.panel.push_back(true);
+    sources.x1.push_back(x1);
+    sources.y1.push_back(y1);
+    sources.x2.push_back(x2);
+    sources.y2.push_back(y2);
+    sources.g1.push_back(g1);
+    sources.g2.push_back(g2);
+    sources.xm.push_back(0.5 * (x1 + x2));
+    sources.ym.push_back(0.5 * (y1 + y2));
+    double l = hypot(x2 - x1, y2 - y1);
+    for (int g = 0; g < 3; g++)
+    {
+        double s = gauss_s[g];
+        double strength = gauss_w[g] * l * (g1 + (g2 - g1) * s);
+        sources.px.push_back(x1 + s * (x2 - x1));
+        sources.py.push_back(y1 + s * (y2 - y1));
+        sources.pg.push_back(strength);
+        sources.pc.push_back(complex<double>(0.0, 0.0));
+    }
+    sources.point_begin.push_back(sources.px.size());
+}
+
+static void add_vortex(FieldSources &sources, double x, double y, double gamma, double u, double v)
+{
+    sources.panel.push_back(false);
+    sources.x1.push_back(x);
+    sources.y1.push_back(y);
+    sources.x2.push_back(x);
+    sources.y2.push_back(y);
+    sources.g1.push_back(gamma);
+    sources.g2.push_back(gamma);
+    sources.xm.push_back(x);
+    sources.ym.push_back(y);
+    sources.px.push_back(x);
+    sources.py.push_back(y);
+    sources.pg.push_back(gamma);
+    sources.pc.push_back(gamma * complex<double>(u, v));
+    sources.point_begin.push_back(sources.px.size());
+}
+
+/* all elements of the bodies with their velocities, and the strength changes of every body */
+static void collect_sources(const vector<Body> &bodies, const FieldHistory &history, double dt, int order, FieldSources &sources, vector<StrengthChange> &changes)
+{
+    int nbodies = bodies.size();
+    bool rates = history.valid && (int)history.gamma_bound.size() == nbodies && dt > 0.0;
+    sources.point_begin.assign(1, 0);
+    changes.resize(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        const Body &body = bodies[b];
+        const RigidBodyState &state = body.state;
+        const PanelGeometry &panels = body.panels;
+        StrengthChange &change = changes[b];
+        change.points.clear();
+        change.rates.clear();
+        bool body_rates = rates && history.gamma_bound[b].size() == body.gamma_bound.size();
+
+        /* bound panels move with the body: pivot velocity plus (-alpha_dot) e_z x r at every Gauss point */
+        for (int i = 0; i < body.n - 1; i++)
+        {
+            add_panel(sources, panels.x_pp(i), panels.y_pp(i), panels.x_pp(i + 1), panels.y_pp(i + 1), body.gamma_bound(i), body.gamma_bound(i + 1));
+            for (int p = sources.point_begin[sources.point_begin.size() - 2]; rates && p < sources.point_begin.back(); p++)
+            {
+                double u = state.pivot_u + state.alpha_dot * (sources.py[p] - state.pivot_y);
+                double v = state.pivot_v - state.alpha_dot * (sources.px[p] - state.pivot_x);
+                sources.pc[p] = sources.pg[p] * complex<double>(u, v);
+            }
+            if (body_rates)
+            {
+                double dg1 = (body.gamma_bound(i) - history.gamma_bound[b](i)) / dt;
+                double dg2 = (body.gamma_bound(i + 1) - history.gamma_bound[b](i + 1)) / dt;
+                for (int g = 0; g < 3; g++)
+                {
+                    int p = sources.point_begin[sources.point_begin.size() - 2] + g;
+                    change.points.push_back(complex<double>(sources.px[p], sources.py[p]));
+                    change.rates.push_back(gauss_w[g] * panels.l(i) * (dg1 + (dg2 - dg1) * gauss_s[g]));
+                }
+            }
+        }
+
+        /* the wake panel is shed during the step: its strength grows from zero, its motion is not followed */
+        const MatrixXd &wpc = body.wake_panel_coordinates;
+        add_panel(sources, wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1), body.gamma_wp, body.gamma_wp);
+        if (body_rates)
+        {
+            double l = hypot(wpc(1, 0) - wpc(0, 0), wpc(1, 1) - wpc(0, 1));
+            for (int g = 0; g < 3; g++)
+            {
+                int p = sources.point_begin[sources.point_begin.size() - 2] + g;
+                change.points.push_back(complex<double>(sources.px[p], sources.py[p]));
+                change.rates.push_back(gauss_w[g] * l * body.gamma_wp / dt);
+            }
+        }
+
+        /* wake vortices keep their strength; the newest one continues the wake panel of the previous step */
+        size_t size = body.gamma_wake_strength.size();
+        size_t previous = rates ? history.wake_x[b].size() : 0;
+        for (size_t k = 0; k < size; k++)
+        {
+            double u = 0.0, v = 0.0;
+            if (rates && size == previous + 1)
+            {
+                double x_old = (k < previous) ? history.wake_x[b][k] : history.wake_panel_cp[b](0);
+                double y_old = (k < previous) ? history.wake_y[b][k] : history.wake_panel_cp[b](1);
+                u = (body.gamma_wake_x_location[k] - x_old) / dt;
+                v = (body.gamma_wake_y_location[k] - y_old) / dt;
+            }
+            add_vortex(sources, body.gamma_wake_x_location[k], body.gamma_wake_y_location[k], body.gamma_wake_strength[k], u, v);
+        }
+
+        /* expansion of the strength changes about the centre of the body */
+        change.center = complex<double>(0.0, 0.0);
+        for (int i = 0; i < body.n; i++)
+        {
+            change.center += complex<double>(panels.x_pp(i), panels.y_pp(i)) / (double)body.n;
+        }
+        change.radius = 0.0;
+        change.moments.assign(order + 1, complex<double>(0.0, 0.0));
+        for (size_t k = 0; k < change.points.size(); k++)
+        {
+            complex<double> d = change.points[k] - change.center;
+            change.radius = max(change.radius, abs(d));
+            complex<double> power = change.rates[k];
+            for (int p = 1; p <= order; p++)
+            {
+                power *= d;
+                change.moments[p] += power;
+            }
+        }
+    }
+}
+
+/* orders the elements [begin, end) by recursive bisection of their midpoints and appends the clusters */
+static int build_node(FieldTree &tree, const FieldSources &sources, int begin, int end, int leaf_size)
+{
+    int index = tree.nodes.size();
+    tree.nodes.push_back(FieldTreeNode());
+
+    const vector<double> &xm = sources.xm, &ym = sources.ym;
+    double x_min = xm[tree.element[begin]], x_max = x_min, y_min = ym[tree.element[begin]], y_max = y_min;
+    double x_center = 0.0, y_center = 0.0;
+    for (int k = begin; k < end; k++)
+    {
+        int e = tree.element[k];
+        x_min = min(x_min, xm[e]);
+        x_max = max(x_max, xm[e]);
+        y_min = min(y_min, ym[e]);
+        y_max = max(y_max, ym[e]);
+        x_center += xm[e];
+        y_center += ym[e];
+    }
+    x_center /= (end - begin);
+    y_center /= (end - begin);
+    double radius = 0.0;
+    for (int k = begin; k < end; k++)
+    {
+        int e = tree.element[k];
+        radius = max(radius, hypot(sources.x1[e] - x_center, sources.y1[e] - y_center));
+        radius = max(radius, hypot(sources.x2[e] - x_center, sources.y2[e] - y_center));
+    }
+
+    FieldTreeNode node;
+    node.x_center = x_center;
+    node.y_center = y_center;
+    node.radius = radius;
+    node.begin = begin;
+    node.end = end;
+    node.child[0] = -1;
+    node.child[1] = -1;
+    if (end - begin > leaf_size)
+    {
+        /* split at the median along the longer side of the bounding box */
+        bool split_x = (x_max - x_min) >= (y_max - y_min);
+        int middle = begin + (end - begin) / 2;
+        nth_element(tree.element.begin() + begin, tree.element.begin() + middle, tree.element.begin() + end, [&](int a, int b)
+                    { return split_x ? xm[a] < xm[b] : ym[a] < ym[b]; });
+        node.child[0] = build_node(tree, sources, begin, middle, leaf_size);
+        node.child[1] = build_node(tree, sources, middle, end, leaf_size);
+    }
+    tree.nodes[index] = node;
+    return index;
+}
+
+static void build_field_tree(const FieldSources &sources, int order, FieldTree &tree)
+{
+    int m = sources.panel.size();
+    tree.order = order;
+    tree.nodes.clear();
+    tree.element.resize(m);
+    for (int e = 0; e < m; e++)
+    {
+        tree.element[e] = e;
+    }
+    if (m > 0)
+    {
+        build_node(tree, sources, 0, m, 16);
+    }
+
+    /* moments of every cluster directly from the vortex points of its elements */
+    int terms = order + 1;
+    tree.moments.assign(tree.nodes.size() * 2 * terms, complex<double>(0.0, 0.0));
+    for (size_t c = 0; c < tree.nodes.size(); c++)
+    {
+        const FieldTreeNode &node = tree.nodes[c];
+        complex<double> center(node.x_center, node.y_center);
+        complex<double> *a = &tree.moments[c * 2 * terms];
+        complex<double> *b = a + terms;
+        for (int k = node.begin; k < node.end; k++)
+        {
+            int e = tree.element[k];
+            for (int p = sources.point_begin[e]; p < sources.point_begin[e + 1]; p++)
+            {
+                complex<double> dz = complex<double>(sources.px[p], sources.py[p]) - center;
+                complex<double> power_a(sources.pg[p], 0.0), power_b = sources.pc[p];
+                for (int q = 0; q < terms; q++)
+                {
+                    a[q] += power_a;
+                    b[q] += power_b;
+                    power_a *= dz;
+                    power_b *= dz;
+                }
+            }
+        }
+    }
+}
+
+/* accumulators of one target: sum Gamma_k / (z - z_k) and sum c_k / (z - z_k) of the far field, the near-field
+   velocity, convective term and vorticity */
+struct FieldTarget
+{
+    double x, y;
+    complex<double> far_a, far_b;
+    double u, v, convective, vorticity;
+};
+
+/* regularised point vortex: velocity, convective term and blob vorticity */
+static void add_point(FieldTarget &target, double x, double y, double gamma, complex<double> c, double delta2, bool velocity)
+{
+    double dx = target.x - x, dy = target.y - y;
+    double r2 = dx * dx + dy * dy;
+    double e = exp(-r2 / delta2);
+    double f = (r2 > 1e-12 * delta2) ? (1.0 - e) / (2.0 * pi * r2) : 1.0 / (2.0 * pi * delta2);
+    if (velocity)
+    {
+        target.u += gamma * f * dy;
+        target.v -= gamma * f * dx;
+    }
+    target.convective -= f * (c.real() * dy - c.imag() * dx);
+    target.vorticity -= gamma * e / (pi * delta2);
+}
+
+static void evaluate_near(const FieldSources &sources, int e, FieldTarget &target, double delta2)
+{
+    if (sources.panel[e])
+    {
+        Vector2d strength(sources.g1[e], sources.g2[e]);
+        Vector2d V = influence_matrix(sources.x1[e], sources.y1[e], sources.x2[e], sources.y2[e], target.x, target.y) * strength;
+        target.u += V(0);
+        target.v += V(1);
+    }
+    for (int p = sources.point_begin[e]; p < sources.point_begin[e + 1]; p++)
+    {
+        add_point(target, sources.px[p], sources.py[p], sources.pg[p], sources.pc[p], delta2, !sources.panel[e]);
+    }
+}
+
+/* one traversal of the tree for a tile of targets with bounding circle (center, rho) */
+static void evaluate_tile(const FieldTree &tree, const FieldSources &sources, int c, complex<double> center, double rho, vector<FieldTarget> &targets, double theta, double delta)
+{
+    const FieldTreeNode &node = tree.nodes[c];
+    double gap = abs(center - complex<double>(node.x_center, node.y_center)) - rho;
+    int terms = tree.order + 1;
+    if (gap > 0.0 && node.radius < theta * gap && gap - node.radius > blob_reach * delta)
+    {
+        const complex<double> *a = &tree.moments[c * 2 * terms];
+        const complex<double> *b = a + terms;
+        for (FieldTarget &target : targets)
+        {
+            complex<double> inverse = 1.0 / complex<double>(target.x - node.x_center, target.y - node.y_center);
+            complex<double> sum_a = a[terms - 1], sum_b = b[terms - 1];
+            for (int q = terms - 2; q >= 0; q--)
+            {
+                sum_a = sum_a * inverse + a[q];
+                sum_b = sum_b * inverse + b[q];
+            }
+            target.far_a += sum_a * inverse;
+            target.far_b += sum_b * inverse;
+        }
+    }
+    else if (node.child[0] < 0)
+    {
+        double delta2 = delta * delta;
+        for (FieldTarget &target : targets)
+        {
+            for (int k = node.begin; k < node.end; k++)
+            {
+                evaluate_near(sources, tree.element[k], target, delta2);
+            }
+        }
+    }
+    else
+    {
+        evaluate_tile(tree, sources, node.child[0], center, rho, targets, theta, delta);
+        evaluate_tile(tree, sources, node.child[1], center, rho, targets, theta, delta);
+    }
+}
+
+/* strength-change part of dphi/dt, -1 / (2 pi) sum dGamma_k/dt arg((z - z_k) / (z - z_c)) */
+static double strength_change_rate(const StrengthChange &change, double x, double y)
+{
+    complex<double> dz = complex<double>(x, y) - change.center;
+    if (abs(dz) > 2.0 * change.radius)
+    {
+        /* log((z - z_k) / (z - z_c)) = -sum_p (d_k / (z - z_c))^p / p */
+        complex<double> inverse = 1.0 / dz, power = 1.0, sum = 0.0;
+        for (size_t p = 1; p < change.moments.size(); p++)
+        {
+            power *= inverse;
+            sum += change.moments[p] * power / (double)p;
+        }
+        return sum.imag() / (2.0 * pi);
+    }
+    double sum = 0.0;
+    for (size_t k = 0; k < change.points.size(); k++)
+    {
+        sum += change.rates[k] * arg((complex<double>(x, y) - change.points[k]) / dz);
+    }
+    return -sum / (2.0 * pi);
+}
+
+/* crossing-number test against the closed polygon of the nodes */
+static bool inside_body(const Body &body, double x, double y)
+{
+    bool inside = false;
+    const PanelGeometry &panels = body.panels;
+    for (int i = 0, j = body.n - 1; i < body.n; j = i++)
+    {
+        double yi = panels.y_pp(i), yj = panels.y_pp(j);
+        if ((yi > y) != (yj > y) && x < panels.x_pp(j) + (panels.x_pp(i) - panels.x_pp(j)) * (y - yj) / (yi - yj))
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+/* bounding boxes of the bodies for a cheap rejection before the polygon test */
+static vector<double> body_boxes(const vector<Body> &bodies)
+{
+    vector<double> box(4 * bodies.size());
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        box[4 * b] = bodies[b].panels.x_pp.minCoeff();
+        box[4 * b + 1] = bodies[b].panels.x_pp.maxCoeff();
+        box[4 * b + 2] = bodies[b].panels.y_pp.minCoeff();
+        box[4 * b + 3] = bodies[b].panels.y_pp.maxCoeff();
+    }
+    return box;
+}
+
+static bool inside_any_body(const vector<Body> &bodies, const vector<double> &box, double x, double y)
+{
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        if (x >= box[4 * b] && x <= box[4 * b + 1] && y >= box[4 * b + 2] && y <= box[4 * b + 3] && inside_body(bodies[b], x, y))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* velocity, cp and vorticity at a block of nearby points sharing one traversal per image */
+static void evaluate_block(const FieldTree &tree, const FieldSources &sources, const vector<StrengthChange> &changes, const ImageSystem &images, const VectorXd &freestream, double Qref, const FieldSettings &settings, const vector<double> &x, const vector<double> &y, vector<double> &U, vector<double> &V, vector<double> &cp, vector<double> &vorticity)
+{
+    size_t m = x.size();
+    /* U and V collect the induced velocity and cp collects dphi/dt until the final pass */
+    U.assign(m, 0.0);
+    V.assign(m, 0.0);
+    cp.assign(m, 0.0);
+    vorticity.assign(m, 0.0);
+    vector<FieldTarget> targets(m);
+
+    /* the sources themselves (image -1), then the images at the mapped points */
+    size_t nimages = images.transforms.size();
+    for (int image = -1; image < (int)nimages; image++)
+    {
+        double x_low = x[0], x_high = x_low, y_low = 0.0, y_high = 0.0;
+        for (size_t q = 0; q < m; q++)
+        {
+            FieldTarget &target = targets[q];
+            target.x = x[q];
+            target.y = (image < 0) ? y[q] : image_point_y(images.transforms[image], y[q]);
+            target.far_a = target.far_b = complex<double>(0.0, 0.0);
+            target.u = target.v = target.convective = target.vorticity = 0.0;
+            x_low = min(x_low, target.x);
+            x_high = max(x_high, target.x);
+            y_low = (q == 0) ? target.y : min(y_low, target.y);
+            y_high = (q == 0) ? target.y : max(y_high, target.y);
+        }
+        complex<double> center(0.5 * (x_low + x_high), 0.5 * (y_low + y_high));
+        double rho = 0.5 * hypot(x_high - x_low, y_high - y_low);
+        if (!tree.nodes.empty())
+        {
+            evaluate_tile(tree, sources, 0, center, rho, targets, settings.theta, settings.core_radius);
+        }
+        double cu = (image < 0) ? 1.0 : images.transforms[image].cu;
+        double cv = (image < 0) ? 1.0 : images.transforms[image].cv;
+        for (size_t q = 0; q < m; q++)
+        {
+            const FieldTarget &target = targets[q];
+            /* u - i v = (i / 2 pi) sum Gamma_k / (z - z_k); the convective term is -Re[(i / 2 pi) sum c_k / (z - z_k)] */
+            complex<double> w = complex<double>(0.0, 1.0 / (2.0 * pi)) * target.far_a;
+            complex<double> convective = complex<double>(0.0, 1.0 / (2.0 * pi)) * target.far_b;
+            double rate = target.convective - convective.real();
+            for (const StrengthChange &change : changes)
+            {
+                rate += strength_change_rate(change, target.x, target.y);
+            }
+            U[q] += cu * (target.u + w.real());
+            V[q] += cv * (target.v - w.imag());
+            cp[q] += cu * rate;
+            if (image < 0)
+            {
+                vorticity[q] = target.vorticity; // the blobs of the images lie outside the fluid
+            }
+        }
+    }
+
+    double Q2 = freestream(0) * freestream(0) + freestream(1) * freestream(1);
+    for (size_t q = 0; q < m; q++)
+    {
+        U[q] += freestream(0);
+        V[q] += freestream(1);
+        cp[q] = (Q2 - U[q] * U[q] - V[q] * V[q] - 2.0 * cp[q]) / (Qref * Qref);
+    }
+}
+
+static void check_field_settings(const FieldSettings &settings, const string &caller)
+{
+    if (!(settings.core_radius > 0.0) || !(settings.theta > 0.0 && settings.theta < 1.0) || settings.order < 0)
+    {
+        throw invalid_argument(caller + ": needs core_radius > 0, 0 < theta < 1 and order >= 0");
+    }
+}
+
+void evaluate_flow_field(const vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double Qref, const FieldHistory &history, double dt, double t, const FieldSettings &settings, FlowFieldSnapshot &snapshot)
+{
+    const FieldGrid &grid = settings.grid;
+    check_field_settings(settings, "evaluate_flow_field");
+    if (grid.nx < 2 || grid.ny < 2 || settings.tile < 1)
+    {
+        throw invalid_argument("evaluate_flow_field: needs nx, ny >= 2 and tile >= 1");
+    }
+    FieldSources sources;
+    vector<StrengthChange> changes;
+    collect_sources(bodies, history, dt, max(settings.order, 24), sources, changes);
+    FieldTree tree;
+    build_field_tree(sources, settings.order, tree);
+
+    size_t count = (size_t)grid.nx * grid.ny;
+    snapshot.t = t;
+    snapshot.grid = grid;
+    snapshot.u.assign(count, numeric_limits<float>::quiet_NaN());
+    snapshot.v.assign(count, numeric_limits<float>::quiet_NaN());
+    snapshot.cp.assign(count, numeric_limits<float>::quiet_NaN());
+    snapshot.vorticity.assign(count, numeric_limits<float>::quiet_NaN());
+    double hx = (grid.x_max - grid.x_min) / (grid.nx - 1);
+    double hy = (grid.y_max - grid.y_min) / (grid.ny - 1);
+    vector<double> box = body_boxes(bodies);
+
+    vector<size_t> index;
+    vector<double> x_tile, y_tile, U, V, cp, vorticity;
+    for (int j0 = 0; j0 < grid.ny; j0 += settings.tile)
+    {
+        for (int i0 = 0; i0 < grid.nx; i0 += settings.tile)
+        {
+            index.clear();
+            x_tile.clear();
+            y_tile.clear();
+            for (int j = j0; j < min(j0 + settings.tile, grid.ny); j++)
+            {
+                for (int i = i0; i < min(i0 + settings.tile, grid.nx); i++)
+                {
+                    double x = grid.x_min + i * hx, y = grid.y_min + j * hy;
+                    if (!inside_any_body(bodies, box, x, y))
+                    {
+                        index.push_back((size_t)j * grid.nx + i);
+                        x_tile.push_back(x);
+                        y_tile.push_back(y);
+                    }
+                }
+            }
+            if (index.empty())
+            {
+                continue;
+            }
+            evaluate_block(tree, sources, changes, images, freestream, Qref, settings, x_tile, y_tile, U, V, cp, vorticity);
+            for (size_t q = 0; q < index.size(); q++)
+            {
+                size_t k = index[q];
+                snapshot.u[k] = U[q];
+                snapshot.v[k] = V[q];
+                snapshot.cp[k] = cp[q];
+                snapshot.vorticity[k] = vorticity[q];
+            }
+        }
+    }
+}
+
+void evaluate_flow_points(const vector<Body> &bodies, const ImageSystem &images, const VectorXd &freestream, double Qref, const FieldHistory &history, double dt, const vector<double> &x, const vector<double> &y, const FieldSettings &settings, vector<double> &u, vector<double> &v, vector<double> &cp)
+{
+    check_field_settings(settings, "evaluate_flow_points");
+    if (x.size() != y.size())
+    {
+        throw invalid_argument("evaluate_flow_points: x and y differ in size");
+    }
+    FieldSources sources;
+    vector<StrengthChange> changes;
+    collect_sources(bodies, history, dt, max(settings.order, 24), sources, changes);
+    FieldTree tree;
+    build_field_tree(sources, settings.order, tree);
+
+    size_t m = x.size();
+    u.assign(m, numeric_limits<double>::quiet_NaN());
+    v.assign(m, numeric_limits<double>::quiet_NaN());
+    cp.assign(m, numeric_limits<double>::quiet_NaN());
+    vector<double> box = body_boxes(bodies);
+    vector<double> x_point(1), y_point(1), U, V, cp_point, vorticity;
+    for (size_t q = 0; q < m; q++)
+    {
+        /* the points may lie anywhere, so every point traverses the tree on its own */
+        if (inside_any_body(bodies, box, x[q], y[q]))
+        {
+            continue;
+        }
+        x_point[0] = x[q];
+        y_point[0] = y[q];
+        evaluate_block(tree, sources, changes, images, freestream, Qref, settings, x_point, y_point, U, V, cp_point, vorticity);
+        u[q] = U[0];
+        v[q] = V[0];
+        cp[q] = cp_point[0];
+    }
+}
+
+static const char field_magic[8] = {'P', 'A', 'N', 'K', 'H', 'F', 'L', 'D'};
+
+void write_field_grid(const string &filename, const FlowFieldSnapshot &snapshot)
+{
+    ofstream file(filename, ios::binary);
+    if (!file.is_open())
+    {
+        throw runtime_error("write_field_grid: cannot open " + filename);
+    }
+    int header[4] = {1, snapshot.grid.nx, snapshot.grid.ny, 4};
+    double extent[5] = {snapshot.t, snapshot.grid.x_min, snapshot.grid.x_max, snapshot.grid.y_min, snapshot.grid.y_max};
+    file.write(field_magic, sizeof(field_magic));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(extent), sizeof(extent));
+    const vector<float> *fields[4] = {&snapshot.u, &snapshot.v, &snapshot.cp, &snapshot.vorticity};
+    for (const vector<float> *field : fields)
+    {
+        file.write(reinterpret_cast<const char *>(field->data()), field->size() * sizeof(float));
+    }
+    if (!file)
+    {
+        throw runtime_error("write_field_grid: cannot write " + filename);
+    }
+}
+
+void read_field_grid(const string &filename, FlowFieldSnapshot &snapshot)
+{
+    ifstream file(filename, ios::binary);
+    if (!file.is_open())
+    {
+        throw runtime_error("read_field_grid: cannot open " + filename);
+    }
+    char magic[8];
+    int header[4];
+    double extent[5];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    file.read(reinterpret_cast<char *>(extent), sizeof(extent));
+    if (!file || memcmp(magic, field_magic, sizeof(magic)) != 0 || header[0] != 1 || header[1] < 1 || header[2] < 1 || header[3] != 4)
+    {
+        throw runtime_error("read_field_grid: " + filename + " is not a field grid of format version 1");
+    }
+    snapshot.grid.nx = header[1];
+    snapshot.grid.ny = header[2];
+    snapshot.t = extent[0];
+    snapshot.grid.x_min = extent[1];
+    snapshot.grid.x_max = extent[2];
+    snapshot.grid.y_min = extent[3];
+    snapshot.grid.y_max = extent[4];
+    size_t count = (size_t)header[1] * header[2];
+    vector<float> *fields[4] = {&snapshot.u, &snapshot.v, &snapshot.cp, &snapshot.vorticity};
+    for (vector<float> *field : fields)
+    {
+        field->resize(count);
+        file.read(reinterpret_cast<char *>(field->data()), count * sizeof(float));
+    }
+    if (!file)
+    {
+        throw runtime_error("read_field_grid: " + filename + " is truncated");
+    }
+}
@@ -0,0 +1,266 @@
+#include "HMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/* a contiguous range of points of one cluster ordering with its bounding box */
+struct HCluster
+{
+    int begin, end;
+    double x_min, x_max, y_min, y_max;
+    int child[2];
+};
+
+/* orders the points [begin, end) of order by recursive bisection along the longer side and appends the clusters */
+static int build_cluster(const vector<double> &x, const vector<double> &y, vector<int> &order, int begin, int end, int leaf_size, vector<HCluster> &clusters)
+{
+    HCluster cluster;
+    cluster.begin = begin;
+    cluster.end = end;
+    cluster.x_min = cluster.x_max = x[order[begin]];
+    cluster.y_min = cluster.y_max = y[order[begin]];
+    for (int k = begin; k < end; k++)
+    {
+        cluster.x_min = min(cluster.x_min, x[order[k]]);
+        cluster.x_max = max(cluster.x_max, x[order[k]]);
+        cluster.y_min = min(cluster.y_min, y[order[k]]);
+        cluster.y_max = max(cluster.y_max, y[order[k]]);
+    }
+    cluster.child[0] = -1;
+    cluster.child[1] = -1;
+    int index = clusters.size();
+    clusters.push_back(cluster);
+    if (end - begin > leaf_size)
+    {
+        bool split_x = (cluster.x_max - cluster.x_min) >= (cluster.y_max - cluster.y_min);
+        int middle = begin + (end - begin) / 2;
+        nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](int a, int b)
+                    { return split_x ? x[a] < x[b] : y[a] < y[b]; });
+        int first = build_cluster(x, y, order, begin, middle, leaf_size, clusters);
+        int second = build_cluster(x, y, order, middle, end, leaf_size, clusters);
+        clusters[index].child[0] = first;
+        clusters[index].child[1] = second;
+    }
+    return index;
+}
+
+static double diameter(const HCluster &c)
+{
+    return hypot(c.x_max - c.x_min, c.y_max - c.y_min);
+}
+
+static double distance(const HCluster &a, const HCluster &b)
+{
+    double dx = max(0.0, max(a.x_min - b.x_max, b.x_min - a.x_max));
+    double dy = max(0.0, max(a.y_min - b.y_max, b.y_min - a.y_max));
+    return hypot(dx, dy);
+}
+
+/* adaptive cross approximation with partial pivoting of the block rows x columns; false if the rank would
+   exceed half the smaller dimension (the block is then not worth compressing) */
+static bool cross_approximation(const HMatrix &matrix, const HCluster &r, const HCluster &c, const MatrixEntry &entry, double tolerance, MatrixXd &U, MatrixXd &V)
+{
+    int m = r.end - r.begin, n = c.end - c.begin;
+    int max_rank = min(m, n) / 2;
+    vector<VectorXd> us, vs;
+    vector<bool> used(m, false);
+    double norm2 = 0.0; // squared Frobenius norm of the approximation
+    int i = 0;
+    VectorXd row(n), column(m);
+    for (int tries = 0; tries < m && (int)us.size() < max_rank; tries++)
+    {
+        used[i] = true;
+        for (int j = 0; j < n; j++)
+        {
+            row(j) = entry(matrix.row_order[r.begin + i], matrix.column_order[c.begin + j]);
+        }
+        for (size_t k = 0; k < us.size(); k++)
+        {
+            row -= us[k](i) * vs[k];
+        }
+        int j_pivot;
+        double pivot = row.cwiseAbs().maxCoeff(&j_pivot);
+        if (pivot == 0.0)
+        {
+            /* this row is already reproduced: try the next unused row */
+            int next = -1;
+            for (int k = 0; k < m && next < 0; k++)
+            {
+                if (!used[k])
+                {
+                    next = k;
+                }
+            }
+            if (next < 0)
+            {
+                break;
+            }
+            i = next;
+            continue;
+        }
+        VectorXd v = row / row(j_pivot);
+        for (int k = 0; k < m; k++)
+        {
+            column(k) = entry(matrix.row_order[r.begin + k], matrix.column_order[c.begin + j_pivot]);
+        }
+        for (size_t k = 0; k < us.size(); k++)
+        {
+            column -= vs[k](j_pivot) * us[k];
+        }
+        VectorXd u = column;
+
+        double uv = u.squaredNorm() * v.squaredNorm();
+        for (size_t k = 0; k < us.size(); k++)
+        {
+            norm2 += 2.0 * u.dot(us[k]) * v.dot(vs[k]);
+        }
+        norm2 += uv;
+        us.push_back(u);
+        vs.push_back(v);
+        if (uv <= tolerance * tolerance * norm2)
+        {
+            break;
+        }
+
+        /* next pivot row: largest entry of the new column among the unused rows */
+        int next = -1;
+        double largest = -1.0;
+        for (int k = 0; k < m; k++)
+        {
+            if (!used[k] && fabs(u(k)) > largest)
+            {
+                largest = fabs(u(k));
+                next = k;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        i = next;
+    }
+    if ((int)us.size() >= max_rank && max_rank > 0)
+    {
+        return false;
+    }
+    U.resize(m, us.size());
+    V.resize(n, vs.size());
+    for (size_t k = 0; k < us.size(); k++)
+    {
+        U.col(k) = us[k];
+        V.col(k) = vs[k];
+    }
+    return true;
+}
+
+static void build_blocks(HMatrix &matrix, const vector<HCluster> &row_clusters, int r, const vector<HCluster> &column_clusters, int c, const MatrixEntry &entry, double eta, double tolerance)
+{
+    const HCluster &rc = row_clusters[r];
+    const HCluster &cc = column_clusters[c];
+    HMatrixBlock block;
+    block.row_begin = rc.begin;
+    block.row_end = rc.end;
+    block.column_begin = cc.begin;
+    block.column_end = cc.end;
+
+    double separation = distance(rc, cc);
+    if (separation > 0.0 && min(diameter(rc), diameter(cc)) <= eta * separation)
+    {
+        block.low_rank = true;
+        if (cross_approximation(matrix, rc, cc, entry, tolerance, block.U, block.V))
+        {
+            matrix.blocks.push_back(block);
+            return;
+        }
+    }
+
+    bool row_leaf = rc.child[0] < 0, column_leaf = cc.child[0] < 0;
+    if (row_leaf && column_leaf)
+    {
+        block.low_rank = false;
+        block.dense.resize(rc.end - rc.begin, cc.end - cc.begin);
+        for (int i = rc.begin; i < rc.end; i++)
+        {
+            for (int j = cc.begin; j < cc.end; j++)
+            {
+                block.dense(i - rc.begin, j - cc.begin) = entry(matrix.row_order[i], matrix.column_order[j]);
+            }
+        }
+        matrix.blocks.push_back(block);
+        return;
+    }
+    for (int a = 0; a < (row_leaf ? 1 : 2); a++)
+    {
+        for (int b = 0; b < (column_leaf ? 1 : 2); b++)
+        {
+            build_blocks(matrix, row_clusters, row_leaf ? r : rc.child[a], column_clusters, column_leaf ? c : cc.child[b], entry, eta, tolerance);
+        }
+    }
+}
+
+void build_hmatrix(const vector<double> &row_x, const vector<double> &row_y, const vector<double> &column_x, const vector<double> &column_y, const MatrixEntry &entry, int leaf_size, double eta, double tolerance, HMatrix &matrix)
+{
+    if (row_x.size() != row_y.size() || column_x.size() != column_y.size() || leaf_size < 1)
+    {
+        throw invalid_argument("build_hmatrix: inconsistent point coordinates or leaf_size < 1");
+    }
+    matrix.rows = row_x.size();
+    matrix.columns = column_x.size();
+    matrix.blocks.clear();
+    matrix.row_order.resize(matrix.rows);
+    matrix.column_order.resize(matrix.columns);
+    for (int i = 0; i < matrix.rows; i++)
+    {
+        matrix.row_order[i] = i;
+    }
+    for (int j = 0; j < matrix.columns; j++)
+    {
+        matrix.column_order[j] = j;
+    }
+    if (matrix.rows == 0 || matrix.columns == 0)
+    {
+        return;
+    }
+    vector<HCluster> row_clusters, column_clusters;
+    build_cluster(row_x, row_y, matrix.row_order, 0, matrix.rows, leaf_size, row_clusters);
+    build_cluster(column_x, column_y, matrix.column_order, 0, matrix.columns, leaf_size, column_clusters);
+    build_blocks(matrix, row_clusters, 0, column_clusters, 0, entry, eta, tolerance);
+}
+
+void hmatrix_product(const HMatrix &matrix, const VectorXd &x, VectorXd &y)
+{
+    VectorXd x_ordered(matrix.columns), y_ordered = VectorXd::Zero(matrix.rows);
+    for (int j = 0; j < matrix.columns; j++)
+    {
+        x_ordered(j) = x(matrix.column_order[j]);
+    }
+    for (size_t k = 0; k < matrix.blocks.size(); k++)
+    {
+        const HMatrixBlock &block = matrix.blocks[k];
+        int m = block.row_end - block.row_begin, n = block.column_end - block.column_begin;
+        if (block.low_rank)
+        {
+            y_ordered.segment(block.row_begin, m) += block.U * (block.V.transpose() * x_ordered.segment(block.column_begin, n));
+        }
+        else
+        {
+            y_ordered.segment(block.row_begin, m) += block.dense * x_ordered.segment(block.column_begin, n);
+        }
+    }
+    y.resize(matrix.rows);
+    for (int i = 0; i < matrix.rows; i++)
+    {
+        y(matrix.row_order[i]) = y_ordered(i);
+    }
+}
+
+size_t hmatrix_storage(const HMatrix &matrix)
+{
+    size_t storage = 0;
+    for (size_t k = 0; k < matrix.blocks.size(); k++)
+    {
+        const HMatrixBlock &block = matrix.blocks[k];
+        storage += block.low_rank ? block.U.size() + block.V.size() : block.dense.size();
+    }
+    return storage;
+}
@@ -0,0 +1,275 @@
+#include "HarmonicBalance.h"
+#include "Input.h"
+#include "Loads.h"
+#include "kinematics.h"
+#include "constants.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+double trigonometric_cardinal(int N, double x)
+{
+    double s = sin(0.5 * x);
+    if (fabs(s) < 1e-14)
+    {
+        return 1.0; // x on a multiple of the period
+    }
+    return sin(0.5 * N * x) / (N * s);
+}
+
+void fourier_coefficients(const VectorXd &samples, VectorXd &a, VectorXd &b)
+{
+    int N = samples.size();
+    int H = (N - 1) / 2;
+    a = VectorXd::Zero(H + 1);
+    b = VectorXd::Zero(H + 1);
+    a(0) = samples.mean();
+    for (int h = 1; h <= H; h++)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            double phase = 2.0 * pi * h * i / N;
+            a(h) += 2.0 / N * samples(i) * cos(phase);
+            b(h) += 2.0 / N * samples(i) * sin(phase);
+        }
+    }
+}
+
+/* bound circulation of a body from its nodal strengths, as in Kelvin's condition of the time-marching solver */
+static double bound_circulation(const Body &body)
+{
+    double gamma = 0.0;
+    for (int i = 0; i < body.n - 1; i++)
+    {
+        gamma += (body.gamma_bound(i) + body.gamma_bound(i + 1)) * body.panels.l(i) * 0.5;
+    }
+    return gamma;
+}
+
+/* position at time t of the wake shed from the trailing edge of a body at time tau (prescribed wake) */
+static Vector2d wake_point(const Body &body, const VectorXd &freestream, double tau, double t)
+{
+    Vector2d point = body_fixed_frame_to_inertial_frame(rigid_body_state(body.motion, tau), body.x0(body.n - 1), body.y0(body.n - 1));
+    point(0) += freestream(0) * (t - tau);
+    point(1) += freestream(1) * (t - tau);
+    return point;
+}
+
+/* body geometry, wake panel and wake vortex positions at time t; the strengths are set by set_wake_strengths */
+static void place_bodies_and_wakes(vector<Body> &bodies, const VectorXd &freestream, double t, double dtau, int segments)
+{
+    for (Body &body : bodies)
+    {
+        update_body_geometry(body, t);
+        prescribe_wake_panel(body, freestream, t, dtau, -numeric_limits<double>::infinity()); // wake panel over the last wake step
+
+        /* one discrete vortex per older wake step, at the position of the wake shed in the middle of the step */
+        body.gamma_wake_strength.assign(segments - 1, 0.0);
+        body.gamma_wake_x_location.resize(segments - 1);
+        body.gamma_wake_y_location.resize(segments - 1);
+        for (int m = 1; m < segments; m++)
+        {
+            Vector2d point = wake_point(body, freestream, t - (m + 0.5) * dtau, t);
+            body.gamma_wake_x_location[m - 1] = point(0);
+            body.gamma_wake_y_location[m - 1] = point(1);
+        }
+    }
+}
+
+/* wake strengths and Kelvin condition of one body from its circulation at the wake step boundaries tau_j = t - j dtau */
+static void set_wake_strengths(Body &body, const VectorXd &gamma_history)
+{
+    body.gamma_old = gamma_history(1);
+    for (size_t m = 0; m < body.gamma_wake_strength.size(); m++)
+    {
+        body.gamma_wake_strength[m] = gamma_history(m + 2) - gamma_history(m + 1);
+    }
+}
+
+/* interpolation weights of the sampled circulations at the wake step boundaries tau_j = t - j dtau, j = 0 ... segments */
+static MatrixXd history_weights(const VectorXd &t_samples, double omega, double t, double dtau, int segments)
+{
+    int N = t_samples.size();
+    MatrixXd weights(segments + 1, N);
+    for (int j = 0; j <= segments; j++)
+    {
+        for (int k = 0; k < N; k++)
+        {
+            weights(j, k) = trigonometric_cardinal(N, omega * (t - j * dtau - t_samples(k)));
+        }
+    }
+    return weights;
+}
+
+void solve_harmonic_balance(vector<Body> &bodies, CoupledSystem &system, const VectorXd &freestream, double omega, const HarmonicBalanceSettings &settings, HarmonicBalanceSolution &solution)
+{
+    if (settings.harmonics < 1 || settings.wake_steps < 1 || !(settings.wake_cycles > 0.0) || !(omega > 0.0))
+    {
+        throw invalid_argument("solve_harmonic_balance: needs harmonics >= 1, wake_steps >= 1, wake_cycles > 0 and a periodic motion (omega > 0)");
+    }
+    int nbodies = bodies.size();
+    int N = 2 * settings.harmonics + 1;
+    int unknowns = N * nbodies; // circulation of body b at instant k is unknown k * nbodies + b
+    double T = 2.0 * pi / omega;
+    double dtau = T / settings.wake_steps;
+    int segments = max(2, (int)floor(settings.wake_cycles * settings.wake_steps + 0.5));
+    double Qinf = freestream(0);
+
+    solution.t.resize(N);
+    for (int i = 0; i < N; i++)
+    {
+        solution.t(i) = i * T / N;
+    }
+
+    /* the solve of one instant is affine in the sampled circulations: probe it with zero and unit circulations */
+    MatrixXd probes(unknowns, unknowns + 1);
+    for (int i = 0; i < N; i++)
+    {
+        place_bodies_and_wakes(bodies, freestream, solution.t(i), dtau, segments);
+        assemble_bound_system(bodies, system);
+        MatrixXd weights = history_weights(solution.t, omega, solution.t(i), dtau, segments);
+        for (int p = 0; p <= unknowns; p++)
+        {
+            for (int b = 0; b < nbodies; b++)
+            {
+                VectorXd gamma_samples = VectorXd::Zero(N);
+                if (p > 0 && (p - 1) % nbodies == b)
+                {
+                    gamma_samples((p - 1) / nbodies) = 1.0;
+                }
+                set_wake_strengths(bodies[b], weights * gamma_samples);
+            }
+            assemble_right_hand_side(bodies, system, Qinf);
+            solve_coupled_system(bodies, system);
+            for (int b = 0; b < nbodies; b++)
+            {
+                probes(i * nbodies + b, p) = bound_circulation(bodies[b]);
+            }
+        }
+    }
+    MatrixXd A = MatrixXd::Identity(unknowns, unknowns);
+    for (int u = 0; u < unknowns; u++)
+    {
+        A.col(u) -= probes.col(u + 1) - probes.col(0);
+    }
+    VectorXd gamma = A.partialPivLu().solve(probes.col(0));
+    solution.gamma.resize(N, nbodies);
+    for (int k = 0; k < N; k++)
+    {
+        for (int b = 0; b < nbodies; b++)
+        {
+            solution.gamma(k, b) = gamma(k * nbodies + b);
+        }
+    }
+
+    /* loads at the instants: potentials and quasi-steady pressures first, then the spectral dphi/dt term */
+    vector<MatrixXd> phi(nbodies), normal_weight(nbodies), axial_weight(nbodies);
+    solution.cl.resize(N, nbodies);
+    solution.cd.resize(N, nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        phi[b].resize(bodies[b].n - 1, N);
+        normal_weight[b].resize(bodies[b].n - 1, N);
+        axial_weight[b].resize(bodies[b].n - 1, N);
+    }
+    for (int i = 0; i < N; i++)
+    {
+        place_bodies_and_wakes(bodies, freestream, solution.t(i), dtau, segments);
+        assemble_bound_system(bodies, system);
+        MatrixXd weights = history_weights(solution.t, omega, solution.t(i), dtau, segments);
+        for (int b = 0; b < nbodies; b++)
+        {
+            set_wake_strengths(bodies[b], weights * solution.gamma.col(b));
+        }
+        assemble_right_hand_side(bodies, system, Qinf);
+        solve_coupled_system(bodies, system);
+        for (int b = 0; b < nbodies; b++)
+        {
+            Body &body = bodies[b];
+            compute_surface_loads(bodies, system.images, b, 0, dtau, Qinf, Qinf, settings.z, settings.offset, settings.phi_le_quadrature); // iter 0: without dphi/dt
+            phi[b].col(i) = body.phi_airfoil_cps;
+            for (int j = 0; j < body.n - 1; j++)
+            {
+                normal_weight[b](j, i) = body.panels.l(j) * body.panels.unit_normal(j, 1) / body.c;
+                axial_weight[b](j, i) = body.panels.l(j) * body.panels.unit_normal(j, 0) / body.c;
+            }
+            solution.cl(i, b) = body.cn_tilda;
+            solution.cd(i, b) = body.ca_tilda;
+        }
+    }
+
+    /* spectral differentiation matrix of N (odd) equally spaced samples of the period */
+    MatrixXd D = MatrixXd::Zero(N, N);
+    for (int i = 0; i < N; i++)
+    {
+        for (int k = 0; k < N; k++)
+        {
+            if (i != k)
+            {
+                D(i, k) = 0.5 * omega * (((i - k) % 2 == 0) ? 1.0 : -1.0) / sin((i - k) * pi / N);
+            }
+        }
+    }
+    /* cp -= 2 dphi/dt / Qinf^2, so cn = -sum cp l n_y / c gains +2 / Qinf^2 sum dphi/dt l n_y / c */
+    for (int b = 0; b < nbodies; b++)
+    {
+        MatrixXd dphi_dt = phi[b] * D.transpose();
+        for (int i = 0; i < N; i++)
+        {
+            solution.cl(i, b) += 2.0 / (Qinf * Qinf) * dphi_dt.col(i).dot(normal_weight[b].col(i));
+            solution.cd(i, b) += 2.0 / (Qinf * Qinf) * dphi_dt.col(i).dot(axial_weight[b].col(i));
+        }
+    }
+}
+
+int run_harmonic(vector<Body> &bodies, CoupledSystem &system, const VectorXd &freestream, double omega, const HarmonicBalanceSettings &settings, double k, int n, chrono::high_resolution_clock::time_point wall_start)
+{
+    HarmonicBalanceSolution solution;
+    try
+    {
+        solve_harmonic_balance(bodies, system, freestream, omega, settings, solution);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    int nbodies = bodies.size();
+    int N = solution.t.size();
+    string suffix = "_k=" + double_to_string(k, 3) + "_n=" + to_string(n);
+    ofstream coefficients("output_files/harmonic_coefficients" + suffix + ".dat");
+    coefficients << "# body\tharmonic\tcl_cos\tcl_sin\tcl_amplitude\tcl_phase_deg\tcd_cos\tcd_sin" << endl;
+    for (int b = 0; b < nbodies; b++)
+    {
+        VectorXd cl_a, cl_b, cd_a, cd_b;
+        fourier_coefficients(solution.cl.col(b), cl_a, cl_b);
+        fourier_coefficients(solution.cd.col(b), cd_a, cd_b);
+        for (int h = 0; h < cl_a.size(); h++)
+        {
+            coefficients << b << "\t" << h << "\t" << cl_a(h) << "\t" << cl_b(h) << "\t" << sqrt(cl_a(h) * cl_a(h) + cl_b(h) * cl_b(h)) << "\t" << atan2(cl_b(h), cl_a(h)) * RAD2DEG << "\t" << cd_a(h) << "\t" << cd_b(h) << endl;
+        }
+        cout << "body " << b << ": mean Cl = " << cl_a(0) << ", first harmonic of Cl = " << sqrt(cl_a(1) * cl_a(1) + cl_b(1) * cl_b(1)) << ", mean Ct = " << -cd_a(0) << endl;
+
+        /* one period reconstructed from the harmonics with the time axis t/T of the load files */
+        string name = "output_files/harmonic" + suffix + ((nbodies > 1) ? "_body" + to_string(b) : "") + ".dat";
+        ofstream history(name);
+        for (int i = 0; i <= settings.wake_steps; i++)
+        {
+            double phase = 2.0 * pi * i / settings.wake_steps;
+            double cl = 0.0, cd = 0.0;
+            for (int j = 0; j < N; j++)
+            {
+                double weight = trigonometric_cardinal(N, phase - 2.0 * pi * j / N);
+                cl += weight * solution.cl(j, b);
+                cd += weight * solution.cd(j, b);
+            }
+            history << (double)i / settings.wake_steps << "\t" << cl << "\t" << cd << endl;
+        }
+    }
+    auto wall_stop = chrono::high_resolution_clock::now();
+    cout << "harmonic balance: " << settings.harmonics << " harmonics (" << N << " instants), wake of " << settings.wake_cycles << " periods, Fourier coefficients in output_files/harmonic_coefficients" << suffix << ".dat" << endl;
+    cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
+    return 0;
+}
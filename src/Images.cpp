@@ -0,0 +1,76 @@
+#include "Images.h"
+#include <stdexcept>
+
+ImageSystem make_image_system(const string &type, double y_lower, double y_upper, int reflections)
+{
+    ImageSystem images;
+    images.type = type;
+    ImageTransform image;
+    if (type == "none")
+    {
+        return images;
+    }
+    if (type == "ground") // wall: image of opposite strength
+    {
+        image.mirror = true;
+        image.offset = y_lower;
+        image.cu = 1.0;
+        image.cv = -1.0;
+        images.transforms.push_back(image);
+    }
+    else if (type == "free_surface") // phi = 0 on the surface: image of equal strength
+    {
+        image.mirror = true;
+        image.offset = y_upper;
+        image.cu = -1.0;
+        image.cv = 1.0;
+        images.transforms.push_back(image);
+    }
+    else if (type == "channel")
+    {
+        if (!(y_upper > y_lower) || reflections < 1)
+        {
+            throw invalid_argument("channel images need y_upper > y_lower and at least one reflection");
+        }
+        /* reflections about the walls y_lower + k H and translations by 2 k H, truncated symmetrically; the two
+           outermost reflections have no partner image across the nearer wall and are given half weight, which
+           cuts the truncation error at the walls by one to two orders of magnitude */
+        double H = y_upper - y_lower;
+        for (int k = 1 - reflections; k <= reflections; k++)
+        {
+            double weight = (k == 1 - reflections || k == reflections) ? 0.5 : 1.0;
+            image.mirror = true;
+            image.offset = y_lower + k * H;
+            image.cu = weight;
+            image.cv = -weight;
+            images.transforms.push_back(image);
+        }
+        for (int k = 1 - reflections; k <= reflections - 1; k++)
+        {
+            if (k == 0)
+            {
+                continue;
+            }
+            image.mirror = false;
+            image.offset = 2.0 * k * H;
+            image.cu = 1.0;
+            image.cv = 1.0;
+            images.transforms.push_back(image);
+        }
+    }
+    else
+    {
+        throw invalid_argument("unknown image type '" + type + "' (use none, ground, free_surface or channel)");
+    }
+    return images;
+}
+
+MatrixXd influence_matrix_images(double point1_x, double point1_y, double point2_x, double point2_y, double desired_point_x, double desired_point_y, const ImageSystem &images)
+{
+    double coefficients[2][2];
+    linear_vortex_panel_influence_images(point1_x, point1_y, point2_x, point2_y, desired_point_x, desired_point_y, images, coefficients);
+    MatrixXd P(2, 2);
+    P << coefficients[0][0], coefficients[0][1],
+        coefficients[1][0], coefficients[1][1];
+    return P;
+}
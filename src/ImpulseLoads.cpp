@@ -0,0 +1,69 @@
+#include "ImpulseLoads.h"
+#include "kinematics.h"
+#include <cmath>
+
+void initialize_impulse_history(const Body &body, ImpulseHistory &history)
+{
+    /* shoelace formula over the closed polygon of the nodes */
+    double area = 0.0, x_moment = 0.0, y_moment = 0.0;
+    for (int i = 0; i < body.n; i++)
+    {
+        int j = (i + 1) % body.n;
+        double cross = body.x0(i) * body.y0(j) - body.x0(j) * body.y0(i);
+        area += 0.5 * cross;
+        x_moment += (body.x0(i) + body.x0(j)) * cross / 6.0;
+        y_moment += (body.y0(i) + body.y0(j)) * cross / 6.0;
+    }
+    history.started = false;
+    history.impulse = Vector2d::Zero();
+    history.area = fabs(area);
+    history.x_centroid = (area != 0.0) ? x_moment / area : 0.0;
+    history.y_centroid = (area != 0.0) ? y_moment / area : 0.0;
+}
+
+Vector2d vortex_impulse(const Body &body)
+{
+    Vector2d impulse = Vector2d::Zero();
+    const PanelGeometry &panels = body.panels;
+    for (int i = 0; i < body.n - 1; i++)
+    {
+        /* first moment of a linear-strength panel: l / 6 [(2 g_i + g_i+1) x_i + (g_i + 2 g_i+1) x_i+1] */
+        double w1 = panels.l(i) / 6.0 * (2.0 * body.gamma_bound(i) + body.gamma_bound(i + 1));
+        double w2 = panels.l(i) / 6.0 * (body.gamma_bound(i) + 2.0 * body.gamma_bound(i + 1));
+        impulse(0) += w1 * panels.y_pp(i) + w2 * panels.y_pp(i + 1);
+        impulse(1) -= w1 * panels.x_pp(i) + w2 * panels.x_pp(i + 1);
+    }
+    double gamma_panel = body.gamma_wp * body.lwp;
+    impulse(0) += gamma_panel * body.wake_panel_cp(1);
+    impulse(1) -= gamma_panel * body.wake_panel_cp(0);
+    for (size_t k = 0; k < body.gamma_wake_strength.size(); k++)
+    {
+        impulse(0) += body.gamma_wake_strength[k] * body.gamma_wake_y_location[k];
+        impulse(1) -= body.gamma_wake_strength[k] * body.gamma_wake_x_location[k];
+    }
+    return impulse;
+}
+
+void compute_impulse_loads(Body &body, ImpulseHistory &history, double dt, double Qref)
+{
+    /* velocity of the centroid: pivot velocity plus (-alpha_dot) e_z x r */
+    const RigidBodyState &state = body.state;
+    Vector2d centroid = body_fixed_frame_to_inertial_frame(state, history.x_centroid, history.y_centroid);
+    Vector2d centroid_velocity;
+    centroid_velocity(0) = state.pivot_u + state.alpha_dot * (centroid(1) - state.pivot_y);
+    centroid_velocity(1) = state.pivot_v - state.alpha_dot * (centroid(0) - state.pivot_x);
+
+    /* F / rho = d/dt (sum Gamma [y, -x] + A V_c) */
+    Vector2d impulse = vortex_impulse(body) + history.area * centroid_velocity;
+    Vector2d force = Vector2d::Zero();
+    if (history.started)
+    {
+        force = (impulse - history.impulse) / dt;
+    }
+    history.impulse = impulse;
+    history.started = true;
+
+    double q = 0.5 * Qref * Qref * body.c;
+    body.cn_tilda = force(1) / q;
+    body.ca_tilda = force(0) / q;
+}
@@ -0,0 +1,149 @@
+#include "Input.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "MotionParameters.h"
+#include "geometry.h"
+#include "constants.h"
+
+double freestream_speed(const json &flow, double c)
+{
+    if (flow.contains("Qinf") && !flow["Qinf"].is_null())
+    {
+        return flow["Qinf"].get<double>();
+    }
+    return flow["Re"].get<double>() * flow["mu"].get<double>() / (flow["rho"].get<double>() * c);
+}
+
+// Helper function to convert double to string without trailing zeros
+string double_to_string(double val, int precision) {
+    ostringstream out;
+    out << fixed << setprecision(precision) << val;
+    string s = out.str();
+    s.erase(s.find_last_not_of('0') + 1, string::npos); 
+    if (s.back() == '.') s.pop_back();
+    return s;
+}
+
+/* reads an optional motion channel block (values multiplied by scale); the fallback is used when the block is absent */
+static MotionChannel parse_channel(json block, double scale, double omega, const MotionChannel &fallback)
+{
+    if (block.is_null())
+    {
+        return fallback;
+    }
+    string type = block["type"];
+    double channel_omega = optional_setting(block, "omega", omega);
+    if (type == "sinusoid")
+    {
+        double offset = optional_setting(block, "offset", 0.0);
+        double phase = optional_setting(block, "phase", 0.0) * DEG2RAD;
+        return sinusoid_channel(offset * scale, block["amplitude"].get<double>() * scale, phase, channel_omega);
+    }
+    if (type == "fourier")
+    {
+        double offset = optional_setting(block, "offset", 0.0);
+        vector<double> a = block["cos"].get<vector<double>>();
+        vector<double> b = block["sin"].get<vector<double>>();
+        return fourier_channel(offset * scale, Map<VectorXd>(a.data(), a.size()) * scale, Map<VectorXd>(b.data(), b.size()) * scale, channel_omega);
+    }
+    if (type == "table")
+    {
+        VectorXd times, values;
+        if (!block["file"].is_null())
+        {
+            read_motion_table(block["file"].get<string>(), times, values);
+        }
+        else
+        {
+            vector<double> t = block["t"].get<vector<double>>();
+            vector<double> v = block["values"].get<vector<double>>();
+            times = Map<VectorXd>(t.data(), t.size());
+            values = Map<VectorXd>(v.data(), v.size());
+        }
+        bool periodic = optional_setting(block, "periodic", false);
+        return table_channel(times, values * scale, periodic);
+    }
+    if (type == "ramp")
+    {
+        double t_start = optional_setting(block, "t_start", 0.0);
+        return ramp_channel(block["start"].get<double>() * scale, block["end"].get<double>() * scale, t_start, block["duration"].get<double>());
+    }
+    throw invalid_argument("unknown motion type '" + type + "' (use sinusoid, fourier, table or ramp)");
+}
+
+Body make_body(json geometry, json motion, json position, double Qinf)
+{
+    Body body;
+
+    // Extract geometry
+    body.n = geometry["n"];
+    body.c = geometry["c"];
+    int n = body.n;
+    double c = body.c;
+    double ymc = geometry["ymc"];
+    double xmc = geometry["xmc"];
+    double tmax = geometry["tmax"];
+    int trailing_edge_type = geometry["trailing_edge_type"];
+    // Optional: airfoil coordinate file (Selig or Lednicer) and node clustering, default NACA with cosine clustering
+    string airfoil_file = optional_setting<string>(geometry, "airfoil_file", "");
+    string clustering = optional_setting<string>(geometry, "clustering", "cosine");
+    double curvature_weight = optional_setting(geometry, "curvature_weight", 0.02);
+
+    // Derived parameters
+    double p = ymc / 100.0;
+    double q = xmc / 10.0;
+    double t_m = tmax / 100.0;
+
+    /* body-frame geometry: built once here, the time loop only rotates and translates it */
+    body.x0.resize(n);
+    body.y0.resize(n);
+    if (!airfoil_file.empty())
+    {
+        VectorXd x_contour, y_contour;
+        read_airfoil_coordinates(airfoil_file, x_contour, y_contour);
+        nodal_coordinates_repaneled(n, c, x_contour, y_contour, clustering, curvature_weight, body.x0, body.y0);
+    }
+    else if (clustering == "cosine")
+    {
+        nodal_coordinates_initial(n, c, q, p, trailing_edge_type, t_m, body.x0, body.y0);
+    }
+    else
+    {
+        /* NACA section sampled finely at unit chord, then re-panelled with the requested clustering */
+        int n_fine = 1001;
+        VectorXd x_fine(n_fine), y_fine(n_fine);
+        nodal_coordinates_initial(n_fine, 1.0, q, p, trailing_edge_type, t_m, x_fine, y_fine);
+        nodal_coordinates_repaneled(n, c, x_fine, y_fine, clustering, curvature_weight, body.x0, body.y0);
+    }
+
+    // Extract motion: sinusoidal pitch-plunge from the legacy keys
+    double k = motion["k"];
+    double h1 = optional_setting(motion, "h1", 0.25 * c);
+    double h0 = motion["h0"];
+    double alpha0 = motion["alpha0"].get<double>() * DEG2RAD;
+    double phi_h = motion["phi_h"].get<double>() * DEG2RAD;
+
+    // alpha1: either use JSON input (if provided) or derive it
+    double alpha1 = motion["alpha1"].is_null()
+                        ? (15.0 * DEG2RAD - atan2(2.0 * k * h1, c)) // derived
+                        : motion["alpha1"].get<double>() * DEG2RAD;      // provided
+
+    double phi_alpha = 90.0 * DEG2RAD + phi_h; // the pitch leads the plunge by 90 degrees
+    double omega = (2.0 * k * Qinf) / c;
+
+    // Optional: "plunge" (meters) and "pitch" (degrees) channels replace the sinusoids, "surge" (meters) adds a streamwise motion
+    body.motion.plunge = parse_channel(motion["plunge"], 1.0, omega, sinusoid_channel(h0, h1, phi_h, omega));
+    body.motion.pitch = parse_channel(motion["pitch"], DEG2RAD, omega, sinusoid_channel(alpha0, alpha1, phi_alpha, omega));
+    body.motion.surge = parse_channel(motion["surge"], 1.0, omega, sinusoid_channel(0.0, 0.0, 0.0, omega));
+
+    // Pitch axis: default to mid-chord if not specified
+    body.motion.x_pitch = optional_setting(motion, "x_pitch", c / 3.0);
+    body.motion.y_pitch = optional_setting(motion, "y_pitch", 0.0);
+
+    // Position of the body-frame origin, default at the inertial origin
+    body.motion.x_offset = position.is_null() ? 0.0 : position[0].get<double>();
+    body.motion.y_offset = position.is_null() ? 0.0 : position[1].get<double>();
+    return body;
+}
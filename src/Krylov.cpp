@@ -0,0 +1,83 @@
+#include "Krylov.h"
+#include <cmath>
+
+bool gmres(const LinearOperator &A, const LinearOperator &preconditioner, const VectorXd &b, VectorXd &x, int restart, int max_iterations, double tolerance, int &iterations, double &relative_residual)
+{
+    int size = b.size();
+    double b_norm = b.norm();
+    iterations = 0;
+    if (b_norm == 0.0)
+    {
+        x.setZero(size);
+        relative_residual = 0.0;
+        return true;
+    }
+
+    VectorXd Ax(size), r(size), z(size), w(size);
+    MatrixXd Q(size, restart + 1);       // Arnoldi basis
+    MatrixXd H = MatrixXd::Zero(restart + 1, restart);
+    VectorXd cs(restart), sn(restart), g(restart + 1);
+
+    A(x, Ax);
+    r = b - Ax;
+    relative_residual = r.norm() / b_norm;
+    while (relative_residual > tolerance && iterations < max_iterations)
+    {
+        double beta = r.norm();
+        Q.col(0) = r / beta;
+        g.setZero();
+        g(0) = beta;
+        H.setZero();
+        int j = 0;
+        for (; j < restart && iterations < max_iterations; j++)
+        {
+            /* Arnoldi step for A M^-1 with modified Gram-Schmidt */
+            preconditioner(Q.col(j), z);
+            A(z, w);
+            iterations++;
+            for (int i = 0; i <= j; i++)
+            {
+                H(i, j) = Q.col(i).dot(w);
+                w -= H(i, j) * Q.col(i);
+            }
+            H(j + 1, j) = w.norm();
+            if (H(j + 1, j) > 0.0)
+            {
+                Q.col(j + 1) = w / H(j + 1, j);
+            }
+
+            /* Givens rotations keep the least-squares problem triangular */
+            for (int i = 0; i < j; i++)
+            {
+                double h = cs(i) * H(i, j) + sn(i) * H(i + 1, j);
+                H(i + 1, j) = -sn(i) * H(i, j) + cs(i) * H(i + 1, j);
+                H(i, j) = h;
+            }
+            double d = hypot(H(j, j), H(j + 1, j));
+            if (d == 0.0)
+            {
+                break; // breakdown: the new direction adds nothing, solve with the first j columns
+            }
+            cs(j) = H(j, j) / d;
+            sn(j) = H(j + 1, j) / d;
+            H(j, j) = d;
+            H(j + 1, j) = 0.0;
+            g(j + 1) = -sn(j) * g(j);
+            g(j) = cs(j) * g(j);
+            if (fabs(g(j + 1)) <= tolerance * b_norm)
+            {
+                j++;
+                break;
+            }
+        }
+
+        /* x += M^-1 Q y with H y = g */
+        VectorXd y = H.topLeftCorner(j, j).triangularView<Upper>().solve(g.head(j));
+        preconditioner(Q.leftCols(j) * y, z);
+        x += z;
+        A(x, Ax);
+        r = b - Ax;
+        relative_residual = r.norm() / b_norm;
+    }
+    return relative_residual <= tolerance;
+}
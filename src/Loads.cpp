@@ -0,0 +1,104 @@
+#include "Loads.h"
+#include "VectorOperations.h"
+#include "constants.h"
+#include <fstream>
+#include <cmath>
+
+void compute_surface_loads(vector<Body> &bodies, const ImageSystem &images, int b, int iter, double dt, double Qinf, double Qref, int z, double offset, bool phi_le_quadrature)
+{
+    Body &body = bodies[b];
+    int n = body.n;
+    int le = (n + 1) / 2 - 1;
+
+    /* calculate phi at LE [phi_le(t_k)], relative to the potential far upstream */
+    double phi_le = 0.0;
+    if (phi_le_quadrature)
+    {
+        VectorXd x_forward_stag_streamline(z + 1); // z+1 is the number of nodes in forward stagnation streamline.
+        VectorXd y_forward_stag_streamline(z + 1);
+
+        /* now divide this stagnation line into z number of points by sine clustering such that clustering is towards the leading edge */
+        double lz = (10.0 * body.c);
+        for (int i = 0; i < z + 1; i++)
+        {
+            x_forward_stag_streamline(i) = (1.0 - sin(i * 0.5 * pi / z)) * (-lz) + body.panels.x_pp(le);
+            y_forward_stag_streamline(i) = body.panels.y_pp(le);
+        }
+        if (b == 0)
+        {
+            ofstream fsl("output_files/check_streamline_usptream.dat");
+            for (int i = 0; i < z + 1; i++)
+            {
+                fsl << x_forward_stag_streamline(i) << "\t" << y_forward_stag_streamline(i) << endl;
+            }
+        }
+
+        VectorXd vifsl(2); // velocity induced at the control points of the forward stagnation streamline
+        for (int i = 0; i < z; i++)
+        {
+            vifsl = velocity_induced_all(bodies, images, (x_forward_stag_streamline(i) + x_forward_stag_streamline(i + 1)) / 2.0, (y_forward_stag_streamline(i) + y_forward_stag_streamline(i + 1)) / 2.0);
+            phi_le = phi_le + vifsl(0) * fabs(x_forward_stag_streamline((i + 1)) - x_forward_stag_streamline((i)));
+        }
+    }
+    else
+    {
+        phi_le = potential_induced_all(bodies, images, body.panels.x_pp(le), body.panels.y_pp(le));
+    }
+
+    /* induced velocity just off the surface at every control point, shared by the potential and the pressure */
+    MatrixXd viacp(n - 1, 2); // viacp stands for velocity induced at airfoil control point.
+    VectorXd tang_vel(n - 1);
+    VectorXd unit_tangent_vector(2);
+    for (int i = 0; i < n - 1; i++)
+    {
+        VectorXd v = velocity_induced_all(bodies, images, body.panels.x_cp(i) + body.panels.unit_normal(i, 0) * offset, body.panels.y_cp(i) + body.panels.unit_normal(i, 1) * offset);
+        viacp(i, 0) = v(0);
+        viacp(i, 1) = v(1);
+        unit_tangent_vector(0) = body.panels.unit_tangent(i, 0); // tangent vector at ith control point
+        unit_tangent_vector(1) = body.panels.unit_tangent(i, 1);
+        tang_vel(i) = dot(unit_tangent_vector, v);
+    }
+
+    /*** now calculate the values of phi at all the nodes, integrating the tangential velocity away from the leading edge ***/
+    VectorXd phi_airfoil_nodes(n);
+    phi_airfoil_nodes(le) = phi_le;
+    double addition = 0.0;
+    for (int j = le - 1; j >= 0; j--) // lower surface
+    {
+        addition = addition + (tang_vel(j) * body.panels.l(j));
+        phi_airfoil_nodes(j) = phi_le - addition;
+    }
+    addition = 0.0;
+    for (int j = le + 1; j < n; j++) // upper surface
+    {
+        addition = addition + (tang_vel(j - 1) * body.panels.l(j - 1));
+        phi_airfoil_nodes(j) = phi_le + addition;
+    }
+    for (int i = 0; i < n - 1; i++) // accessing the control points.
+    {
+        body.phi_airfoil_cps(i) = (phi_airfoil_nodes(i + 1) + phi_airfoil_nodes(i)) / 2.0;
+    }
+
+    /* calculation of the pressure coefficients at all the control points.. */
+    VectorXd vi(2), flow_vel(2);
+    double V, dphi_dt;
+    for (int i = 0; i < n - 1; i++)
+    {
+        dphi_dt = (iter == 0) ? 0.0 : (body.phi_airfoil_cps(i) - body.phi_old(i)) / dt;
+        flow_vel = body_kinematic_velocity(body, Qinf, body.panels.x_cp(i), body.panels.y_cp(i));
+        vi(0) = viacp(i, 0) + flow_vel(0);
+        vi(1) = viacp(i, 1) + flow_vel(1);
+        V = magnitude(vi);
+        body.cp(i) = (Qinf * Qinf) / (Qref * Qref) - (V * V) / (Qref * Qref) - (2.0 / (Qref * Qref)) * (dphi_dt);
+    }
+    body.phi_old = body.phi_airfoil_cps;
+
+    /* calculation of lift and drag */
+    body.cn_tilda = 0.0;
+    body.ca_tilda = 0.0;
+    for (int i = 0; i < n - 1; i++) // scanning the control points...........
+    {
+        body.cn_tilda = body.cn_tilda - (1.0 / body.c) * body.cp(i) * body.panels.l(i) * body.panels.unit_normal(i, 1);
+        body.ca_tilda = body.ca_tilda - (1.0 / body.c) * body.cp(i) * body.panels.l(i) * body.panels.unit_normal(i, 0);
+    }
+}
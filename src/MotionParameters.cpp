@@ -1,35 +1,160 @@
 #include "MotionParameters.h"
+#include "constants.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
+MotionChannel sinusoid_channel(double offset, double amplitude, double phase, double omega)
+{
+    MotionChannel channel = MotionChannel();
+    channel.type = "sinusoid";
+    channel.offset = offset;
+    channel.amplitude = amplitude;
+    channel.phase = phase;
+    channel.omega = omega;
+    return channel;
+}
+
+MotionChannel fourier_channel(double offset, const VectorXd &a, const VectorXd &b, double omega)
+{
+    if (a.size() != b.size())
+    {
+        throw invalid_argument("fourier motion: the cosine and sine coefficients must have the same length");
+    }
+    MotionChannel channel = MotionChannel();
+    channel.type = "fourier";
+    channel.offset = offset;
+    channel.a = a;
+    channel.b = b;
+    channel.omega = omega;
+    return channel;
+}
 
-VectorXd h_instantaneous(double h0,double h1,double phi_h,double t, double omega)
+MotionChannel table_channel(const VectorXd &times, const VectorXd &values, bool periodic)
 {
-    VectorXd plunge(3);
-    double h = h0 + h1 * sin(omega * t + phi_h);
-    plunge(0) = 0.0;
-    plunge(1) = -h; // negative sign implies downward thrust is taken positive.
-    plunge(2) = 0.0;
-    return (plunge);
+    MotionChannel channel = MotionChannel();
+    channel.type = "table";
+    fit_cubic_spline(times, values, channel.table);
+    channel.periodic = periodic;
+    return channel;
 }
-VectorXd h_dot_instantaneous(double h1,double phi_h,double t, double omega)
+
+MotionChannel ramp_channel(double value_start, double value_end, double t_start, double duration)
 {
-    VectorXd plunge_vel(3);
-    double h_dot = h1 * omega * cos(omega * t + phi_h);
-    plunge_vel(0) = 0.0;
-    plunge_vel(1) = -h_dot;
-    plunge_vel(2) = 0.0;
-    return (plunge_vel);
+    MotionChannel channel = MotionChannel();
+    channel.type = "ramp";
+    channel.value_start = value_start;
+    channel.value_end = value_end;
+    channel.t_start = t_start;
+    channel.duration = duration;
+    return channel;
 }
 
-double alpha_instantaneous(double alpha0,double alpha1,double phi_alpha,double t,double omega)
+void read_motion_table(const string &filename, VectorXd &times, VectorXd &values)
 {
-    double alpha;
-    alpha = alpha0 + alpha1 * sin(omega * t + phi_alpha);
-    return alpha;
+    ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw runtime_error("cannot open motion table " + filename);
+    }
+    vector<double> t, v;
+    string line;
+    while (getline(file, line))
+    {
+        istringstream row(line);
+        double a, b;
+        if (line.empty() || line[0] == '#' || !(row >> a >> b))
+        {
+            continue;
+        }
+        t.push_back(a);
+        v.push_back(b);
+    }
+    if (t.size() < 2)
+    {
+        throw runtime_error("motion table " + filename + " needs at least two rows");
+    }
+    times = Map<VectorXd>(t.data(), t.size());
+    values = Map<VectorXd>(v.data(), v.size());
 }
 
-double alpha_dot_instantaneous(double alpha1,double phi_alpha,double t,double omega)
+void evaluate_channel(const MotionChannel &channel, double t, double &value, double &rate)
 {
-    double alpha_dot;
-    alpha_dot = alpha1 * omega * cos(omega * t + phi_alpha);
-    return alpha_dot;
+    if (channel.type == "sinusoid")
+    {
+        value = channel.offset + channel.amplitude * sin(channel.omega * t + channel.phase);
+        rate = channel.amplitude * channel.omega * cos(channel.omega * t + channel.phase);
+    }
+    else if (channel.type == "fourier")
+    {
+        value = channel.offset;
+        rate = 0.0;
+        /* harmonics by the angle-addition recurrence: one sin/cos pair per evaluation */
+        double c1 = cos(channel.omega * t), s1 = sin(channel.omega * t);
+        double ck = c1, sk = s1;
+        for (int k = 1; k <= channel.a.size(); k++)
+        {
+            value += channel.a(k - 1) * ck + channel.b(k - 1) * sk;
+            rate += k * channel.omega * (channel.b(k - 1) * ck - channel.a(k - 1) * sk);
+            double c_next = ck * c1 - sk * s1;
+            sk = sk * c1 + ck * s1;
+            ck = c_next;
+        }
+    }
+    else if (channel.type == "table")
+    {
+        double t0 = channel.table.knots(0);
+        double t1 = channel.table.knots(channel.table.knots.size() - 1);
+        double s = t;
+        if (channel.periodic)
+        {
+            s = t0 + fmod(t - t0, t1 - t0);
+            if (s < t0)
+            {
+                s += t1 - t0;
+            }
+        }
+        else if (s < t0 || s > t1) // hold the end values outside the table
+        {
+            value = spline_value(channel.table, (s < t0) ? t0 : t1);
+            rate = 0.0;
+            return;
+        }
+        value = spline_value(channel.table, s);
+        rate = spline_first_derivative(channel.table, s);
+    }
+    else if (channel.type == "ramp")
+    {
+        double tau = (channel.duration > 0.0) ? (t - channel.t_start) / channel.duration : ((t >= channel.t_start) ? 1.0 : 0.0);
+        tau = (tau < 0.0) ? 0.0 : ((tau > 1.0) ? 1.0 : tau);
+        double s = 0.5 * (1.0 - cos(pi * tau));
+        double s_dot = (channel.duration > 0.0 && tau > 0.0 && tau < 1.0) ? 0.5 * pi * sin(pi * tau) / channel.duration : 0.0;
+        value = channel.value_start + (channel.value_end - channel.value_start) * s;
+        rate = (channel.value_end - channel.value_start) * s_dot;
+    }
+    else
+    {
+        throw invalid_argument("unknown motion type '" + channel.type + "' (use sinusoid, fourier, table or ramp)");
+    }
+}
+
+RigidBodyState rigid_body_state(const MotionProfile &motion, double t)
+{
+    RigidBodyState state;
+    double h, h_dot, x_s, x_s_dot;
+    evaluate_channel(motion.plunge, t, h, h_dot);
+    evaluate_channel(motion.pitch, t, state.alpha, state.alpha_dot);
+    evaluate_channel(motion.surge, t, x_s, x_s_dot);
+
+    state.cos_alpha = cos(state.alpha);
+    state.sin_alpha = sin(state.alpha);
+    state.x_pitch = motion.x_pitch;
+    state.y_pitch = motion.y_pitch;
+    state.pivot_x = motion.x_pitch + x_s + motion.x_offset;
+    state.pivot_y = motion.y_pitch - h + motion.y_offset; // negative sign implies downward plunge is taken positive.
+    state.pivot_u = x_s_dot;
+    state.pivot_v = -h_dot;
+    return state;
 }
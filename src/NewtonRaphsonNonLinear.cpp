@@ -1,78 +1,108 @@
 #include "NewtonRaphsonNonLinear.h"
+#include <iostream>
 #include <cmath>
+#include <stdexcept>
+#include <string>
 
 /*this function returns the residuals */
-VectorXd newton_raphson(int n, double dt, double t, double lwp, double theta_wp,VectorXd freestream, VectorXd &vtotal_wp_cp, VectorXd &x_pp, VectorXd &y_pp, VectorXd &x_cp, VectorXd &y_cp, VectorXd &l, VectorXd &B_unsteady, VectorXd &gamma_unsteady, double gamma_old, VectorXd &gamma_bound, vector<double> &gamma_wake_strength, vector<double> &gamma_wake_x_location, vector<double> &gamma_wake_y_location, VectorXd &wake_panel_cp, VectorXd &wake_panel_normal, MatrixXd &A_unsteady, MatrixXd &unit_normal, MatrixXd &wake_panel_coordinates)
+VectorXd newton_raphson(vector<Body> &bodies, CoupledSystem &system, double dt, const VectorXd &freestream, const VectorXd &lwp, const VectorXd &theta_wp)
 {
-    VectorXd wake_influence(n - 1);
-    Vector2d unit_gamma_wake(1, 1);
-    MatrixXd panel_coeff_matrix_wake(2, 2);
-    VectorXd normal_vector_panel_cp(2);
-    VectorXd shed_vel(2), velocity_bound(2); // velocities due to [prev.shed,motion,bound vortices,total velocity]
+    int nbodies = bodies.size();
+    VectorXd shed_vel(2), velocity_bound(2), velocity_panels(2); // velocities due to [prev.shed, bound vortices, other wake panels]
 
-    /*WAKE PANEL COORDINATES*/
-    wake_panel_coordinates(0, 0) = x_pp(n - 1);
-    wake_panel_coordinates(0, 1) = y_pp(n - 1);
-    wake_panel_coordinates(1, 0) = x_pp(n - 1) + lwp * cos(theta_wp);
-    wake_panel_coordinates(1, 1) = y_pp(n - 1) + lwp * sin(theta_wp);
-
-    /* Once the position is guessed then calculate the control point coordinate of that wake panel */
-    wake_panel_cp(0) = (wake_panel_coordinates(0, 0) + wake_panel_coordinates(1, 0)) / 2.0;
-    wake_panel_cp(1) = (wake_panel_coordinates(0, 1) + wake_panel_coordinates(1, 1)) / 2.0;
+    for (int b = 0; b < nbodies; b++)
+    {
+        Body &body = bodies[b];
+        int n = body.n;
+        body.lwp = lwp(b);
+        body.theta_wp = theta_wp(b);
 
-    /* calculate the unit normal vector of the wake panel */
-    wake_panel_normal(0) = -sin(theta_wp);
-    wake_panel_normal(1) = cos(theta_wp);
+        /*WAKE PANEL COORDINATES*/
+        body.wake_panel_coordinates(0, 0) = body.panels.x_pp(n - 1);
+        body.wake_panel_coordinates(0, 1) = body.panels.y_pp(n - 1);
+        body.wake_panel_coordinates(1, 0) = body.panels.x_pp(n - 1) + lwp(b) * cos(theta_wp(b));
+        body.wake_panel_coordinates(1, 1) = body.panels.y_pp(n - 1) + lwp(b) * sin(theta_wp(b));
 
-    /*now we need to solve for AX=B, so first construct the Aunsteady matrix*/
-    /* first calculate the influence of this wake panel on all the control points of the airfoil */
-    for (int i = 0; i < n - 1; i++)
-    {
-        panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), x_cp(i), y_cp(i));
-        normal_vector_panel_cp(0) = unit_normal(i, 0);
-        normal_vector_panel_cp(1) = unit_normal(i, 1);
+        /* Once the position is guessed then calculate the control point coordinate of that wake panel */
+        body.wake_panel_cp(0) = (body.wake_panel_coordinates(0, 0) + body.wake_panel_coordinates(1, 0)) / 2.0;
+        body.wake_panel_cp(1) = (body.wake_panel_coordinates(0, 1) + body.wake_panel_coordinates(1, 1)) / 2.0;
 
-        wake_influence(i) = dot((panel_coeff_matrix_wake * unit_gamma_wake), normal_vector_panel_cp);
-        /* now we can COMPLETE the construction of the A_unsteady matrix by filling the influence of the wake panel on the control points of the airfoil's panels.*/
+        /* calculate the unit normal vector of the wake panel */
+        body.wake_panel_normal(0) = -sin(theta_wp(b));
+        body.wake_panel_normal(1) = cos(theta_wp(b));
     }
-    for (int i = 0; i < n - 1; i++) // filling the last column.....
-    {
-        A_unsteady(i, n) = wake_influence(i);
-    }
-
-    A_unsteady(n, n) = lwp; // from kelvins circulation theorem
 
-    B_unsteady(n) = gamma_old; // from kelvins circulation theorem
-    gamma_unsteady = A_unsteady.fullPivHouseholderQr().solve(B_unsteady);
-    // cout << "B unsteady vector =" << endl;
-    // cout << B_unsteady << endl;
-    /* now finding the local flow velocities at the control points of the wake panel */
+    /* the influence of the wake panels and kelvins circulation theorem close the coupled system */
+    solve_coupled_system(bodies, system);
 
-    for (int i = 0; i < n; i++)
+    /*finding the total velocity induced at the control point of every wake panel*/
+    VectorXd residuals(2 * nbodies);
+    for (int b = 0; b < nbodies; b++)
     {
-        gamma_bound(i) = gamma_unsteady(i);
+        Body &body = bodies[b];
+        velocity_bound = velocity_bound_vortices_all(bodies, system.images, body.wake_panel_cp(0), body.wake_panel_cp(1));
+        shed_vel = velocity_wake_vortices_all(bodies, system.images, body.wake_panel_cp(0), body.wake_panel_cp(1)); /* due to the previously shed vortices */
+        velocity_panels = velocity_wake_panels_all(bodies, system.images, body.wake_panel_cp(0), body.wake_panel_cp(1), b);
+
+        body.vtotal_wp_cp = velocity_bound + shed_vel + velocity_panels + freestream;
+        residuals(2 * b) = lwp(b) - magnitude(body.vtotal_wp_cp) * dt;
+        residuals(2 * b + 1) = theta_wp(b) - atan2(body.vtotal_wp_cp(1), body.vtotal_wp_cp(0));
     }
+    return residuals;
+}
 
-    /*finding the total velocity induced at the control point of the wake panel*/
-    velocity_bound = velocity_bound_vortices(n,x_pp, y_pp, wake_panel_cp(0), wake_panel_cp(1), gamma_bound);
-    if (t == 0)
+int converge_wake_panels(vector<Body> &bodies, CoupledSystem &system, double dt, const VectorXd &freestream, double epsilon, double tolerance, int max_iterations)
+{
+    int nbodies = bodies.size();
+    VectorXd lwp(nbodies), theta_wp(nbodies);
+    for (int b = 0; b < nbodies; b++)
     {
-        shed_vel(0) = 0.0;
-        shed_vel(1) = 0.0;
+        lwp(b) = bodies[b].lwp;
+        theta_wp(b) = bodies[b].theta_wp;
     }
-    else
+
+    VectorXd residuals(2 * nbodies), residuals_plus(2 * nbodies);
+    MatrixXd jacobian(2 * nbodies, 2 * nbodies);
+    VectorXd length_and_angle(2 * nbodies);
+    int conv_iter = 0;
+    double convergence = 0.0;
+
+    do
     {
-        shed_vel(0) = 0.0;
-        shed_vel(1) = 0.0;
-        for (size_t j = 0; j < gamma_wake_strength.size(); j++) /* due to the previously shed vortices */
+        if (conv_iter >= max_iterations)
         {
-            shed_vel = shed_vel + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[j], gamma_wake_x_location[j], gamma_wake_y_location[j], wake_panel_cp(0), wake_panel_cp(1));
+            throw runtime_error("converge_wake_panels: the wake panels did not converge in " + to_string(max_iterations) + " Newton iterations (last update " + to_string(convergence) + ", tolerance " + to_string(tolerance) + ")");
         }
-    }
- 
-    vtotal_wp_cp = velocity_bound + shed_vel + freestream;
-    VectorXd residuals(2);
-    residuals(0) = lwp - magnitude(vtotal_wp_cp) * dt;
-    residuals(1) = theta_wp - atan2(vtotal_wp_cp(1), vtotal_wp_cp(0));
-    return residuals;
+        cout << "convergence iteration= " << conv_iter << endl;
+        residuals = newton_raphson(bodies, system, dt, freestream, lwp, theta_wp);
+        /* fill the jacobian matrix column by column, perturbing the length and then the angle of every wake panel */
+        for (int b = 0; b < nbodies; b++)
+        {
+            VectorXd perturbed = lwp;
+            perturbed(b) += epsilon;
+            residuals_plus = newton_raphson(bodies, system, dt, freestream, perturbed, theta_wp);
+            jacobian.col(2 * b) = (residuals_plus - residuals) / epsilon;
+
+            perturbed = theta_wp;
+            perturbed(b) += epsilon;
+            residuals_plus = newton_raphson(bodies, system, dt, freestream, lwp, perturbed);
+            jacobian.col(2 * b + 1) = (residuals_plus - residuals) / epsilon;
+        }
+        cout << "JACOBIAN" << "\t" << endl
+             << jacobian << endl;
+        length_and_angle = jacobian.partialPivLu().solve(-residuals);
+        convergence = length_and_angle.norm();
+        cout << "convergence=" << convergence << endl;
+
+        for (int b = 0; b < nbodies; b++)
+        {
+            lwp(b) += length_and_angle(2 * b);
+            theta_wp(b) += length_and_angle(2 * b + 1);
+        }
+        conv_iter++;
+    } while ((convergence) > tolerance);
+
+    /* leave the bodies in the state of the converged wake panels */
+    newton_raphson(bodies, system, dt, freestream, lwp, theta_wp);
+    return conv_iter;
 }
@@ -0,0 +1,376 @@
+#include "Optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include "Input.h"
+#include "constants.h"
+
+/* candidates of a generation not yet handed out; shared by the workers */
+struct CandidateQueue
+{
+    mutex lock;
+    size_t next;
+    vector<OptimizationCandidate> *candidates;
+};
+
+static double &kinematic_parameter(PitchPlungeParameters &parameters, int i)
+{
+    double *values[kinematic_parameter_count] = {&parameters.k, &parameters.h1, &parameters.alpha1, &parameters.phi_h, &parameters.x_pitch};
+    return *values[i];
+}
+
+/* mirrors a normalised coordinate into [0, 1] */
+static double mirror_into_bounds(double u)
+{
+    u = fmod(fabs(u), 2.0);
+    return (u > 1.0) ? 2.0 - u : u;
+}
+
+/* last-cycle performance of a candidate, NaN when its march fails */
+static void evaluate_candidate(const PitchPlungeFoil &foil, const PitchPlungeSettings &settings, OptimizationCandidate &candidate)
+{
+    candidate.completed = false;
+    candidate.performance.cycle = -1;
+    candidate.performance.ct_mean = candidate.performance.ct_rms = numeric_limits<double>::quiet_NaN();
+    candidate.performance.cpower_mean = candidate.performance.cpower_rms = numeric_limits<double>::quiet_NaN();
+    candidate.performance.efficiency = numeric_limits<double>::quiet_NaN();
+    try
+    {
+        vector<CyclePerformance> cycles = pitch_plunge_performance(foil, candidate.parameters, settings);
+        if (!cycles.empty())
+        {
+            candidate.performance = cycles.back();
+            candidate.completed = isfinite(candidate.performance.ct_mean) && isfinite(candidate.performance.cpower_mean);
+        }
+    }
+    catch (const exception &)
+    {
+        // a diverging march is a failed candidate, ranked last
+    }
+}
+
+static void candidate_worker(const PitchPlungeFoil &foil, const PitchPlungeSettings &settings, CandidateQueue &queue)
+{
+    while (true)
+    {
+        size_t index;
+        {
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.next >= queue.candidates->size())
+            {
+                return;
+            }
+            index = queue.next++;
+        }
+        evaluate_candidate(foil, settings, (*queue.candidates)[index]);
+    }
+}
+
+/* jobs workers; the calling thread is one of them */
+static void evaluate_candidates(const PitchPlungeFoil &foil, const PitchPlungeSettings &settings, int jobs, vector<OptimizationCandidate> &candidates)
+{
+    CandidateQueue queue;
+    queue.next = 0;
+    queue.candidates = &candidates;
+    vector<thread> workers;
+    for (int w = 1; w < jobs && w < (int)candidates.size(); w++)
+    {
+        try
+        {
+            workers.push_back(thread(candidate_worker, cref(foil), cref(settings), ref(queue)));
+        }
+        catch (const system_error &)
+        {
+            break; // fewer jobs where threads cannot be created
+        }
+    }
+    candidate_worker(foil, settings, queue);
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/* ranking: admissible candidates by their objective, then those below min_ct by their thrust, then failures */
+static int admissibility(const OptimizationCandidate &candidate, const OptimizationSettings &optimization)
+{
+    if (!candidate.completed || (optimization.objective == objective_efficiency && !isfinite(candidate.performance.efficiency)))
+    {
+        return 2;
+    }
+    return (candidate.performance.ct_mean < optimization.min_ct) ? 1 : 0;
+}
+
+static bool better_candidate(const OptimizationCandidate &a, const OptimizationCandidate &b, const OptimizationSettings &optimization)
+{
+    int class_a = admissibility(a, optimization), class_b = admissibility(b, optimization);
+    if (class_a != class_b)
+    {
+        return class_a < class_b;
+    }
+    if (class_a == 2)
+    {
+        return false;
+    }
+    if (class_a == 1 || optimization.objective == objective_thrust)
+    {
+        return a.performance.ct_mean > b.performance.ct_mean;
+    }
+    return a.performance.efficiency > b.performance.efficiency;
+}
+
+OptimizationResult optimize_pitch_plunge(const PitchPlungeFoil &foil, const PitchPlungeParameters &start, const PitchPlungeSettings &settings, const OptimizationSettings &optimization)
+{
+    vector<int> active;
+    for (int i = 0; i < kinematic_parameter_count; i++)
+    {
+        if (optimization.active[i])
+        {
+            if (!(optimization.lower[i] < optimization.upper[i]))
+            {
+                throw invalid_argument("optimize_pitch_plunge: the lower bound of every parameter must be below its upper bound");
+            }
+            active.push_back(i);
+        }
+    }
+    if (active.empty())
+    {
+        throw invalid_argument("optimize_pitch_plunge: no parameter to optimise");
+    }
+    if (optimization.active[parameter_k] && !(optimization.lower[parameter_k] > 0.0))
+    {
+        throw invalid_argument("optimize_pitch_plunge: the bounds of k must be positive");
+    }
+    if (optimization.population < 2 || optimization.generations < 1 || !(optimization.sigma > 0.0) || optimization.tolerance < 0.0 || optimization.jobs < 1 || settings.ncycles < 1)
+    {
+        throw invalid_argument("optimize_pitch_plunge: needs population >= 2, generations >= 1, sigma > 0, tolerance >= 0, jobs >= 1 and a complete cycle");
+    }
+
+    /* strategy parameters (Hansen's defaults) for d coordinates normalised by the bounds */
+    int d = active.size();
+    int lambda = optimization.population;
+    int mu = lambda / 2;
+    VectorXd weights(mu);
+    for (int i = 0; i < mu; i++)
+    {
+        weights(i) = log(mu + 0.5) - log(i + 1.0);
+    }
+    weights /= weights.sum();
+    double mueff = 1.0 / weights.squaredNorm();
+    double cc = (4.0 + mueff / d) / (d + 4.0 + 2.0 * mueff / d);
+    double cs = (mueff + 2.0) / (d + mueff + 5.0);
+    double c1 = 2.0 / ((d + 1.3) * (d + 1.3) + mueff);
+    double cmu = min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((d + 2.0) * (d + 2.0) + mueff));
+    double damps = 1.0 + 2.0 * max(0.0, sqrt((mueff - 1.0) / (d + 1.0)) - 1.0) + cs;
+    double chi = sqrt((double)d) * (1.0 - 1.0 / (4.0 * d) + 1.0 / (21.0 * d * d));
+
+    OptimizationResult result;
+    result.best = 0;
+    result.generations = 0;
+    OptimizationCandidate first;
+    first.generation = 0;
+    first.parameters = start;
+    VectorXd mean(d);
+    for (int j = 0; j < d; j++)
+    {
+        int i = active[j];
+        double &value = kinematic_parameter(first.parameters, i);
+        value = min(max(value, optimization.lower[i]), optimization.upper[i]);
+        mean(j) = (value - optimization.lower[i]) / (optimization.upper[i] - optimization.lower[i]);
+    }
+    evaluate_candidate(foil, settings, first);
+    result.history.push_back(first);
+
+    double sigma = optimization.sigma;
+    MatrixXd C = MatrixXd::Identity(d, d), B = MatrixXd::Identity(d, d);
+    VectorXd D = VectorXd::Ones(d), pc = VectorXd::Zero(d), ps = VectorXd::Zero(d);
+    result.step = sigma;
+    mt19937 generator(optimization.seed);
+    normal_distribution<double> normal(0.0, 1.0);
+
+    for (int generation = 1; generation <= optimization.generations && result.step >= optimization.tolerance; generation++)
+    {
+        /* sample and mirror into the bounds on this thread, evaluate on the pool */
+        MatrixXd u(d, lambda);
+        vector<OptimizationCandidate> candidates(lambda);
+        for (int c = 0; c < lambda; c++)
+        {
+            VectorXd z(d);
+            for (int j = 0; j < d; j++)
+            {
+                z(j) = normal(generator);
+            }
+            u.col(c) = mean + sigma * (B * D.asDiagonal() * z);
+            candidates[c].generation = generation;
+            candidates[c].parameters = start;
+            for (int j = 0; j < d; j++)
+            {
+                int i = active[j];
+                u(j, c) = mirror_into_bounds(u(j, c));
+                kinematic_parameter(candidates[c].parameters, i) = optimization.lower[i] + u(j, c) * (optimization.upper[i] - optimization.lower[i]);
+            }
+        }
+        evaluate_candidates(foil, settings, optimization.jobs, candidates);
+
+        vector<int> order(lambda);
+        for (int c = 0; c < lambda; c++)
+        {
+            order[c] = c;
+        }
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return better_candidate(candidates[a], candidates[b], optimization); });
+        for (int c = 0; c < lambda; c++)
+        {
+            result.history.push_back(candidates[c]);
+            if (better_candidate(candidates[c], result.history[result.best], optimization))
+            {
+                result.best = result.history.size() - 1;
+            }
+        }
+
+        /* recombination, evolution paths, covariance and step size */
+        VectorXd old_mean = mean;
+        mean.setZero();
+        for (int r = 0; r < mu; r++)
+        {
+            mean += weights(r) * u.col(order[r]);
+        }
+        VectorXd shift = (mean - old_mean) / sigma;
+        ps = (1.0 - cs) * ps + sqrt(cs * (2.0 - cs) * mueff) * (B * D.cwiseInverse().asDiagonal() * B.transpose() * shift);
+        // the covariance path pauses while the step-size path is long (the step is still growing)
+        bool hold_pc = ps.norm() / sqrt(1.0 - pow(1.0 - cs, 2.0 * generation)) / chi >= 1.4 + 2.0 / (d + 1.0);
+        pc = (1.0 - cc) * pc + (hold_pc ? 0.0 : sqrt(cc * (2.0 - cc) * mueff)) * shift;
+        MatrixXd rank_mu = MatrixXd::Zero(d, d);
+        for (int r = 0; r < mu; r++)
+        {
+            VectorXd y = (u.col(order[r]) - old_mean) / sigma;
+            rank_mu += weights(r) * y * y.transpose();
+        }
+        C = (1.0 - c1 - cmu) * C + c1 * (pc * pc.transpose() + (hold_pc ? cc * (2.0 - cc) : 0.0) * C) + cmu * rank_mu;
+        C = 0.5 * (C + C.transpose());
+        sigma *= exp((cs / damps) * (ps.norm() / chi - 1.0));
+
+        // C is symmetric positive definite: its singular vectors and values are its eigenvectors and eigenvalues
+        JacobiSVD<MatrixXd, NoQRPreconditioner> eigen(C, ComputeFullU);
+        B = eigen.matrixU();
+        D = eigen.singularValues().cwiseMax(1e-20).cwiseSqrt();
+        result.step = sigma * D.maxCoeff();
+        result.generations = generation;
+
+        const OptimizationCandidate &best = result.history[result.best];
+        cout << "optimize: generation " << generation << ", best " << ((optimization.objective == objective_efficiency) ? "efficiency " : "Ct mean ");
+        cout << ((optimization.objective == objective_efficiency) ? best.performance.efficiency : best.performance.ct_mean);
+        cout << " (Ct mean " << best.performance.ct_mean << ", Cpower mean " << best.performance.cpower_mean << "), step " << result.step << endl;
+    }
+    return result;
+}
+
+int run_optimize(json input, const Body &body, const PitchPlungeSettings &settings, double k, chrono::high_resolution_clock::time_point wall_start)
+{
+    const char *names[kinematic_parameter_count] = {"k", "h1", "alpha1", "phi_h", "x_pitch"};
+    // bounds and results in the units of the input: degrees for the angles
+    const double units[kinematic_parameter_count] = {1.0, 1.0, DEG2RAD, DEG2RAD, 1.0};
+    json optimize = input["optimize"];
+    if (optimize.is_null() || !optimize["bounds"].is_object() || optimize["bounds"].empty())
+    {
+        cerr << "Error: optimize mode needs the bounds of at least one of k, h1, alpha1, phi_h and x_pitch (optimize.bounds)" << endl;
+        return 1;
+    }
+    OptimizationSettings optimization;
+    string objective = optional_setting<string>(optimize, "objective", "efficiency");
+    if (objective != "efficiency" && objective != "thrust")
+    {
+        cerr << "Error: unknown optimize.objective '" << objective << "' (use efficiency or thrust)" << endl;
+        return 1;
+    }
+    optimization.objective = (objective == "thrust") ? objective_thrust : objective_efficiency;
+    for (auto &entry : optimize["bounds"].items())
+    {
+        if (find(names, names + kinematic_parameter_count, entry.key()) == names + kinematic_parameter_count)
+        {
+            cerr << "Error: optimize.bounds has unknown parameter '" << entry.key() << "' (use k, h1, alpha1, phi_h, x_pitch)" << endl;
+            return 1;
+        }
+    }
+    int nactive = 0;
+    for (int i = 0; i < kinematic_parameter_count; i++)
+    {
+        json bound = optimize["bounds"][names[i]];
+        optimization.active[i] = !bound.is_null();
+        optimization.lower[i] = optimization.upper[i] = 0.0;
+        if (optimization.active[i])
+        {
+            if (!bound.is_array() || bound.size() != 2)
+            {
+                cerr << "Error: optimize.bounds." << names[i] << " must be [lower, upper]" << endl;
+                return 1;
+            }
+            optimization.lower[i] = bound[0].get<double>() * units[i];
+            optimization.upper[i] = bound[1].get<double>() * units[i];
+            nactive++;
+        }
+    }
+    optimization.jobs = optional_setting(optimize, "jobs", 4);
+    optimization.population = optional_setting(optimize, "population", max(4 + (int)floor(3.0 * log((double)nactive)), optimization.jobs));
+    optimization.generations = optional_setting(optimize, "generations", 30);
+    optimization.sigma = optional_setting(optimize, "sigma", 0.3);
+    optimization.tolerance = optional_setting(optimize, "tolerance", 1e-3);
+    optimization.min_ct = optional_setting(optimize, "min_ct", numeric_limits<double>::quiet_NaN());
+    optimization.seed = optional_setting<unsigned>(optimize, "seed", 1);
+
+    PitchPlungeFoil foil;
+    OptimizationResult result;
+    try
+    {
+        initialize_pitch_plunge_foil(body, foil);
+        cout << "optimize: " << objective << " over " << nactive << " parameters, " << optimization.population << " candidates per generation on " << optimization.jobs << " jobs" << endl;
+        result = optimize_pitch_plunge(foil, pitch_plunge_parameters(body, k), settings, optimization);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    ofstream table("output_files/optimize.dat");
+    table << "# generation	k	h1	alpha1	phi_h	x_pitch	Ct mean	Cpower mean	efficiency" << endl;
+    for (const OptimizationCandidate &candidate : result.history)
+    {
+        const PitchPlungeParameters &p = candidate.parameters;
+        table << candidate.generation << "	" << p.k << "	" << p.h1 << "	" << p.alpha1 * RAD2DEG << "	" << p.phi_h * RAD2DEG << "	" << p.x_pitch;
+        table << "	" << candidate.performance.ct_mean << "	" << candidate.performance.cpower_mean << "	" << candidate.performance.efficiency << endl;
+    }
+
+    const OptimizationCandidate &best = result.history[result.best];
+    if (!best.completed)
+    {
+        cerr << "Error: no candidate completed its march, see output_files/optimize.dat" << endl;
+        return 1;
+    }
+    // the input of the best candidate, ready to be run as an unsteady simulation
+    json best_input = input;
+    best_input["motion"]["k"] = best.parameters.k;
+    best_input["motion"]["h1"] = best.parameters.h1;
+    best_input["motion"]["alpha1"] = best.parameters.alpha1 * RAD2DEG;
+    best_input["motion"]["phi_h"] = best.parameters.phi_h * RAD2DEG;
+    best_input["motion"]["x_pitch"] = best.parameters.x_pitch;
+    ofstream("output_files/optimize_best.json") << best_input.dump(2) << endl;
+
+    cout << "optimize: best of " << result.history.size() << " candidates in " << result.generations << " generations (step " << result.step << "):" << endl;
+    cout << "k = " << best.parameters.k << ", h1 = " << best.parameters.h1 << " m, alpha1 = " << best.parameters.alpha1 * RAD2DEG << " deg, phi_h = " << best.parameters.phi_h * RAD2DEG << " deg, x_pitch = " << best.parameters.x_pitch << " m" << endl;
+    cout << "Ct mean = " << best.performance.ct_mean << ", Cpower mean = " << best.performance.cpower_mean << ", efficiency = " << best.performance.efficiency << endl;
+    if (best.performance.ct_mean < optimization.min_ct)
+    {
+        cout << "optimize: no candidate reached optimize.min_ct = " << optimization.min_ct << endl;
+    }
+    auto wall_stop = chrono::high_resolution_clock::now();
+    cout << "optimize: candidates in output_files/optimize.dat, input of the best one in output_files/optimize_best.json" << endl;
+    cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
+    return 0;
+}
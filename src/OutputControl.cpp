@@ -0,0 +1,320 @@
+#include "OutputControl.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+/*
+ * Record of one written time step:
+ *   int32 iter, float64 t, then for every body
+ *   float64 x_pitch, y_pitch, cos_alpha, sin_alpha, pivot_x, pivot_y   (the nodes follow as in update_panel_geometry)
+ *   float64 wake panel x1, y1, x2, y2
+ *   int32 n_old, n_new, encoding
+ *   encoding 0: int32 dqx, dqy shared by the n_old older vortices (prescribed wake)
+ *   encoding 1: n_old x int32 dqx, dqy
+ *   encoding 2: n_old x int64 qx, qy (differences too large for int32)
+ *   n_new x (int64 qx, int64 qy, float64 gamma) of the vortices shed since the previous record
+ * The older vortices are the first n_old vortices of the previous record and keep their strengths.
+ */
+
+static const char wake_magic[8] = {'P', 'A', 'N', 'K', 'H', 'W', 'A', 'K'};
+
+bool output_due(const OutputTrigger &trigger, int iter, double cycles, double cycles_previous)
+{
+    if (trigger.stride > 0 && iter % trigger.stride == 0)
+    {
+        return true;
+    }
+    if (trigger.phase_step > 0.0)
+    {
+        double current = floor(cycles * 360.0 / trigger.phase_step + 1e-9);
+        double previous = floor(cycles_previous * 360.0 / trigger.phase_step + 1e-9);
+        return iter == 0 || current > previous;
+    }
+    return false;
+}
+
+template <typename T>
+static void write_value(ofstream &file, T value)
+{
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static T read_value(ifstream &file)
+{
+    T value;
+    file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return value;
+}
+
+void open_wake_stream(const string &filename, const vector<Body> &bodies, double quantum, WakeStreamWriter &writer)
+{
+    if (!(quantum > 0.0))
+    {
+        throw invalid_argument("open_wake_stream: the quantum must be positive");
+    }
+    writer.file.open(filename, ios::binary);
+    if (!writer.file.is_open())
+    {
+        throw runtime_error("open_wake_stream: cannot open " + filename);
+    }
+    writer.quantum = quantum;
+    writer.qx.assign(bodies.size(), vector<int64_t>());
+    writer.qy.assign(bodies.size(), vector<int64_t>());
+    writer.file.write(wake_magic, sizeof(wake_magic));
+    write_value<int32_t>(writer.file, 1);
+    write_value<int32_t>(writer.file, bodies.size());
+    write_value<double>(writer.file, quantum);
+    for (const Body &body : bodies)
+    {
+        write_value<int32_t>(writer.file, body.n);
+        writer.file.write(reinterpret_cast<const char *>(body.x0.data()), body.n * sizeof(double));
+        writer.file.write(reinterpret_cast<const char *>(body.y0.data()), body.n * sizeof(double));
+    }
+}
+
+void append_wake_stream(WakeStreamWriter &writer, const vector<Body> &bodies, int iter, double t)
+{
+    ofstream &file = writer.file;
+    write_value<int32_t>(file, iter);
+    write_value<double>(file, t);
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        const Body &body = bodies[b];
+        const RigidBodyState &state = body.state;
+        double frame[6] = {state.x_pitch, state.y_pitch, state.cos_alpha, state.sin_alpha, state.pivot_x, state.pivot_y};
+        file.write(reinterpret_cast<const char *>(frame), sizeof(frame));
+        const MatrixXd &wpc = body.wake_panel_coordinates;
+        double panel[4] = {wpc(0, 0), wpc(0, 1), wpc(1, 0), wpc(1, 1)};
+        file.write(reinterpret_cast<const char *>(panel), sizeof(panel));
+
+        size_t size = body.gamma_wake_strength.size();
+        vector<int64_t> qx(size), qy(size);
+        for (size_t k = 0; k < size; k++)
+        {
+            qx[k] = llround(body.gamma_wake_x_location[k] / writer.quantum);
+            qy[k] = llround(body.gamma_wake_y_location[k] / writer.quantum);
+        }
+        size_t n_old = (size >= writer.qx[b].size()) ? writer.qx[b].size() : 0;
+
+        /* the smallest encoding of the older vortices */
+        bool uniform = true, small = true;
+        for (size_t k = 0; k < n_old; k++)
+        {
+            int64_t dx = qx[k] - writer.qx[b][k], dy = qy[k] - writer.qy[b][k];
+            uniform = uniform && dx == qx[0] - writer.qx[b][0] && dy == qy[0] - writer.qy[b][0];
+            small = small && llabs(dx) <= numeric_limits<int32_t>::max() && llabs(dy) <= numeric_limits<int32_t>::max();
+        }
+        int32_t encoding = small ? (uniform ? 0 : 1) : 2;
+        write_value<int32_t>(file, n_old);
+        write_value<int32_t>(file, size - n_old);
+        write_value<int32_t>(file, encoding);
+        if (encoding == 0)
+        {
+            write_value<int32_t>(file, (n_old > 0) ? qx[0] - writer.qx[b][0] : 0);
+            write_value<int32_t>(file, (n_old > 0) ? qy[0] - writer.qy[b][0] : 0);
+        }
+        for (size_t k = 0; k < n_old && encoding > 0; k++)
+        {
+            if (encoding == 1)
+            {
+                write_value<int32_t>(file, qx[k] - writer.qx[b][k]);
+                write_value<int32_t>(file, qy[k] - writer.qy[b][k]);
+            }
+            else
+            {
+                write_value<int64_t>(file, qx[k]);
+                write_value<int64_t>(file, qy[k]);
+            }
+        }
+        for (size_t k = n_old; k < size; k++)
+        {
+            write_value<int64_t>(file, qx[k]);
+            write_value<int64_t>(file, qy[k]);
+            write_value<double>(file, body.gamma_wake_strength[k]);
+        }
+        writer.qx[b].swap(qx);
+        writer.qy[b].swap(qy);
+    }
+    file.flush();
+    if (!file)
+    {
+        throw runtime_error("append_wake_stream: cannot write the record of time step " + to_string(iter));
+    }
+}
+
+void open_wake_stream_reader(const string &filename, WakeStreamReader &reader)
+{
+    reader.file.open(filename, ios::binary);
+    if (!reader.file.is_open())
+    {
+        throw runtime_error("open_wake_stream_reader: cannot open " + filename);
+    }
+    char magic[8];
+    reader.file.read(magic, sizeof(magic));
+    int32_t version = read_value<int32_t>(reader.file);
+    int32_t nbodies = read_value<int32_t>(reader.file);
+    reader.quantum = read_value<double>(reader.file);
+    if (!reader.file || memcmp(magic, wake_magic, sizeof(magic)) != 0 || version != 1 || nbodies < 1)
+    {
+        throw runtime_error("open_wake_stream_reader: " + filename + " is not a wake stream of format version 1");
+    }
+    reader.x0.resize(nbodies);
+    reader.y0.resize(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        int32_t n = read_value<int32_t>(reader.file);
+        if (!reader.file || n < 2)
+        {
+            throw runtime_error("open_wake_stream_reader: truncated header in " + filename);
+        }
+        reader.x0[b].resize(n);
+        reader.y0[b].resize(n);
+        reader.file.read(reinterpret_cast<char *>(reader.x0[b].data()), n * sizeof(double));
+        reader.file.read(reinterpret_cast<char *>(reader.y0[b].data()), n * sizeof(double));
+    }
+    if (!reader.file)
+    {
+        throw runtime_error("open_wake_stream_reader: truncated header in " + filename);
+    }
+    reader.qx.assign(nbodies, vector<int64_t>());
+    reader.qy.assign(nbodies, vector<int64_t>());
+    reader.gamma.assign(nbodies, vector<double>());
+}
+
+bool read_wake_stream(WakeStreamReader &reader, WakeStreamSnapshot &snapshot)
+{
+    ifstream &file = reader.file;
+    int32_t iter = read_value<int32_t>(file);
+    if (file.eof())
+    {
+        return false;
+    }
+    snapshot.iter = iter;
+    snapshot.t = read_value<double>(file);
+    int nbodies = reader.x0.size();
+    snapshot.x_nodes.resize(nbodies);
+    snapshot.y_nodes.resize(nbodies);
+    snapshot.wake_panel.resize(nbodies);
+    snapshot.x.resize(nbodies);
+    snapshot.y.resize(nbodies);
+    snapshot.gamma.resize(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        double frame[6], panel[4];
+        file.read(reinterpret_cast<char *>(frame), sizeof(frame));
+        file.read(reinterpret_cast<char *>(panel), sizeof(panel));
+        int32_t n_old = read_value<int32_t>(file);
+        int32_t n_new = read_value<int32_t>(file);
+        int32_t encoding = read_value<int32_t>(file);
+        if (!file || n_old < 0 || n_new < 0 || n_old > (int32_t)reader.qx[b].size() || encoding < 0 || encoding > 2)
+        {
+            throw runtime_error("read_wake_stream: truncated or inconsistent record");
+        }
+
+        /* nodes as in update_panel_geometry */
+        int n = reader.x0[b].size();
+        snapshot.x_nodes[b].resize(n);
+        snapshot.y_nodes[b].resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            double bx = reader.x0[b](i) - frame[0], by = reader.y0[b](i) - frame[1];
+            snapshot.x_nodes[b](i) = (frame[2] * bx + frame[3] * by) + frame[4];
+            snapshot.y_nodes[b](i) = (-frame[3] * bx + frame[2] * by) + frame[5];
+        }
+        snapshot.wake_panel[b] << panel[0], panel[1], panel[2], panel[3];
+
+        vector<int64_t> &qx = reader.qx[b], &qy = reader.qy[b];
+        qx.resize(n_old);
+        qy.resize(n_old);
+        reader.gamma[b].resize(n_old);
+        if (encoding == 0)
+        {
+            int32_t dx = read_value<int32_t>(file), dy = read_value<int32_t>(file);
+            for (int k = 0; k < n_old; k++)
+            {
+                qx[k] += dx;
+                qy[k] += dy;
+            }
+        }
+        for (int k = 0; k < n_old && encoding > 0; k++)
+        {
+            if (encoding == 1)
+            {
+                qx[k] += read_value<int32_t>(file);
+                qy[k] += read_value<int32_t>(file);
+            }
+            else
+            {
+                qx[k] = read_value<int64_t>(file);
+                qy[k] = read_value<int64_t>(file);
+            }
+        }
+        for (int k = 0; k < n_new; k++)
+        {
+            qx.push_back(read_value<int64_t>(file));
+            qy.push_back(read_value<int64_t>(file));
+            reader.gamma[b].push_back(read_value<double>(file));
+        }
+        if (!file)
+        {
+            throw runtime_error("read_wake_stream: truncated record of time step " + to_string(iter));
+        }
+        size_t size = qx.size();
+        snapshot.x[b].resize(size);
+        snapshot.y[b].resize(size);
+        for (size_t k = 0; k < size; k++)
+        {
+            snapshot.x[b][k] = qx[k] * reader.quantum;
+            snapshot.y[b][k] = qy[k] * reader.quantum;
+        }
+        snapshot.gamma[b] = reader.gamma[b];
+    }
+    return true;
+}
+
+int run_unpack(const string &filename)
+{
+    string directory = (filename.find('/') == string::npos) ? "." : filename.substr(0, filename.rfind('/'));
+    WakeStreamReader reader;
+    WakeStreamSnapshot snapshot;
+    int records = 0;
+    try
+    {
+        open_wake_stream_reader(filename, reader);
+        while (read_wake_stream(reader, snapshot))
+        {
+            ofstream wakefile(directory + "/wake_" + to_string(snapshot.iter) + ".dat");
+            ofstream motionfile(directory + "/motion_" + to_string(snapshot.iter) + ".dat");
+            for (size_t b = 0; b < snapshot.x.size(); b++)
+            {
+                if (b > 0)
+                {
+                    motionfile << endl;
+                }
+                for (int i = 0; i < snapshot.x_nodes[b].size(); i++)
+                {
+                    motionfile << snapshot.x_nodes[b](i) << "\t" << snapshot.y_nodes[b](i) << endl;
+                }
+                for (int i = 0; i < 2; i++)
+                {
+                    wakefile << snapshot.wake_panel[b](i, 0) << "\t" << snapshot.wake_panel[b](i, 1) << endl;
+                }
+                for (size_t j = 0; j < snapshot.x[b].size(); j++)
+                {
+                    wakefile << snapshot.x[b][j] << "\t" << snapshot.y[b][j] << endl;
+                }
+            }
+            records++;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    cout << "unpack: " << records << " time steps written to " << directory << "/wake_<step>.dat and motion_<step>.dat" << endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "Performance.h"
+#include <cmath>
+#include <limits>
+
+void compute_moment_and_power(const Body &body, double Qref, double &cm, double &cpower)
+{
+    const RigidBodyState &state = body.state;
+    const PanelGeometry &panels = body.panels;
+    double cn = 0.0, ca = 0.0;
+    cm = 0.0;
+    for (int i = 0; i < body.n - 1; i++)
+    {
+        cn -= body.cp(i) * panels.l(i) * panels.unit_normal(i, 1) / body.c;
+        ca -= body.cp(i) * panels.l(i) * panels.unit_normal(i, 0) / body.c;
+        /* nose-up moment of the panel force -cp l n about the pitch axis */
+        cm += body.cp(i) * panels.l(i) * ((panels.x_cp(i) - state.pivot_x) * panels.unit_normal(i, 1) - (panels.y_cp(i) - state.pivot_y) * panels.unit_normal(i, 0)) / (body.c * body.c);
+    }
+    /* P = -F . V_pivot - M alpha_dot, per unit 1/2 rho Qref^3 c */
+    cpower = -(ca * state.pivot_u + cn * state.pivot_v) / Qref - cm * state.alpha_dot * body.c / Qref;
+}
+
+void initialize_performance_accumulator(PerformanceAccumulator &accumulator, double window)
+{
+    accumulator.window = window;
+    accumulator.cycle = 0;
+    accumulator.started = false;
+    accumulator.t_last = 0.0;
+    accumulator.ct_last = 0.0;
+    accumulator.cpower_last = 0.0;
+    accumulator.ct_integral = 0.0;
+    accumulator.ct2_integral = 0.0;
+    accumulator.cpower_integral = 0.0;
+    accumulator.cpower2_integral = 0.0;
+}
+
+/* trapezoidal integrals of f and f^2 over a segment with linear f */
+static void integrate_segment(double h, double f0, double f1, double &integral, double &squared_integral)
+{
+    integral += 0.5 * h * (f0 + f1);
+    squared_integral += h * (f0 * f0 + f0 * f1 + f1 * f1) / 3.0;
+}
+
+void add_performance_sample(PerformanceAccumulator &accumulator, double t, double ct, double cpower, vector<CyclePerformance> &completed)
+{
+    completed.clear();
+    if (!accumulator.started)
+    {
+        accumulator.started = true;
+        accumulator.t_last = t;
+        accumulator.ct_last = ct;
+        accumulator.cpower_last = cpower;
+        return;
+    }
+    double tolerance = 1e-9 * accumulator.window;
+    while (accumulator.t_last < t)
+    {
+        /* the segment ends at the sample or at the end of the current window, whichever comes first */
+        double t_end = (accumulator.cycle + 1) * accumulator.window;
+        double t_next = (t < t_end - tolerance) ? t : t_end;
+        double s = (t_next - accumulator.t_last) / (t - accumulator.t_last);
+        double ct_next = accumulator.ct_last + s * (ct - accumulator.ct_last);
+        double cpower_next = accumulator.cpower_last + s * (cpower - accumulator.cpower_last);
+        double h = t_next - accumulator.t_last;
+        integrate_segment(h, accumulator.ct_last, ct_next, accumulator.ct_integral, accumulator.ct2_integral);
+        integrate_segment(h, accumulator.cpower_last, cpower_next, accumulator.cpower_integral, accumulator.cpower2_integral);
+        accumulator.t_last = t_next;
+        accumulator.ct_last = ct_next;
+        accumulator.cpower_last = cpower_next;
+        if (t_next == t_end)
+        {
+            CyclePerformance performance;
+            performance.cycle = accumulator.cycle;
+            performance.ct_mean = accumulator.ct_integral / accumulator.window;
+            performance.ct_rms = sqrt(accumulator.ct2_integral / accumulator.window);
+            performance.cpower_mean = accumulator.cpower_integral / accumulator.window;
+            performance.cpower_rms = sqrt(accumulator.cpower2_integral / accumulator.window);
+            performance.efficiency = (performance.cpower_mean > 0.0) ? performance.ct_mean / performance.cpower_mean : numeric_limits<double>::quiet_NaN();
+            completed.push_back(performance);
+            accumulator.cycle++;
+            accumulator.ct_integral = 0.0;
+            accumulator.ct2_integral = 0.0;
+            accumulator.cpower_integral = 0.0;
+            accumulator.cpower2_integral = 0.0;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include "Polar.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include "InfluenceMatrix.h"
+#include "Input.h"
+#include "constants.h"
+
+void solve_steady_polar(const Body &body, double Qinf, const VectorXd &alpha, double x_ref, double offset, SteadyPolar &polar)
+{
+    int n = body.n;
+    int m = alpha.size();
+
+    /* body-frame panel geometry: the identity rigid-body state */
+    RigidBodyState identity = RigidBodyState();
+    identity.cos_alpha = 1.0;
+    PanelGeometry panels;
+    resize_panel_geometry(n, panels);
+    update_panel_geometry(identity, body.x0, body.y0, panels);
+
+    /* right-hand sides of all angles: -Qinf (cos(alpha) n_x + sin(alpha) n_y), zero in the Kutta row */
+    MatrixXd B = MatrixXd::Zero(n, m);
+    for (int a = 0; a < m; a++)
+    {
+        double u = Qinf * cos(alpha(a)), v = Qinf * sin(alpha(a));
+        for (int i = 0; i < n - 1; i++)
+        {
+            B(i, a) = -(u * panels.unit_normal(i, 0) + v * panels.unit_normal(i, 1));
+        }
+    }
+    PartialPivLU<MatrixXd> lu(body.A_self);
+    polar.gamma = lu.solve(B);
+
+    /* velocity influence of the nodal strengths at the offset control points, shared by all angles */
+    MatrixXd U = MatrixXd::Zero(n - 1, n), V = MatrixXd::Zero(n - 1, n);
+    for (int j = 0; j < n - 1; j++)
+    {
+        double x = panels.x_cp(j) + panels.unit_normal(j, 0) * offset;
+        double y = panels.y_cp(j) + panels.unit_normal(j, 1) * offset;
+        for (int i = 0; i < n - 1; i++)
+        {
+            MatrixXd P = influence_matrix(panels.x_pp(i), panels.y_pp(i), panels.x_pp(i + 1), panels.y_pp(i + 1), x, y);
+            U(j, i) += P(0, 0);
+            U(j, i + 1) += P(0, 1);
+            V(j, i) += P(1, 0);
+            V(j, i + 1) += P(1, 1);
+        }
+    }
+    MatrixXd u_surface = U * polar.gamma;
+    MatrixXd v_surface = V * polar.gamma;
+
+    polar.alpha = alpha;
+    polar.x_cp = panels.x_cp;
+    polar.cp.resize(n - 1, m);
+    polar.cl.resize(m);
+    polar.cl_kj.resize(m);
+    polar.cd.resize(m);
+    polar.cm.resize(m);
+    double c = body.c;
+    for (int a = 0; a < m; a++)
+    {
+        double ca = cos(alpha(a)), sa = sin(alpha(a));
+        double cn_tilda = 0.0, ca_tilda = 0.0, cm = 0.0, circulation = 0.0;
+        for (int i = 0; i < n - 1; i++)
+        {
+            double u = u_surface(i, a) + Qinf * ca;
+            double v = v_surface(i, a) + Qinf * sa;
+            double cp = 1.0 - (u * u + v * v) / (Qinf * Qinf);
+            polar.cp(i, a) = cp;
+            cn_tilda -= cp * panels.l(i) * panels.unit_normal(i, 1) / c;
+            ca_tilda -= cp * panels.l(i) * panels.unit_normal(i, 0) / c;
+            /* nose-up moment of the panel force -cp l n about (x_ref, 0) */
+            cm += cp * panels.l(i) * ((panels.x_cp(i) - x_ref) * panels.unit_normal(i, 1) - panels.y_cp(i) * panels.unit_normal(i, 0)) / (c * c);
+            circulation += 0.5 * (polar.gamma(i, a) + polar.gamma(i + 1, a)) * panels.l(i);
+        }
+        polar.cl(a) = cn_tilda * ca - ca_tilda * sa;
+        polar.cd(a) = cn_tilda * sa + ca_tilda * ca;
+        polar.cm(a) = cm;
+        polar.cl_kj(a) = 2.0 * circulation / (Qinf * c);
+    }
+}
+
+int run_polar(json input)
+{
+    int n = input["geometry"]["n"];
+    double c = input["geometry"]["c"];
+    double Qinf = freestream_speed(input["flow"], c);
+    json polar_input = input["polar"];
+    if (polar_input.is_null())
+    {
+        cerr << "Error: polar mode needs a \"polar\" block" << endl;
+        return 1;
+    }
+
+    // Angles in degrees: an explicit list "alphas" or the range alpha_start : alpha_step : alpha_end
+    vector<double> alphas_deg;
+    if (!polar_input["alphas"].is_null())
+    {
+        alphas_deg = polar_input["alphas"].get<vector<double>>();
+    }
+    else
+    {
+        double alpha_start = polar_input["alpha_start"], alpha_end = polar_input["alpha_end"], alpha_step = polar_input["alpha_step"];
+        if (!(alpha_step > 0.0))
+        {
+            cerr << "Error: polar.alpha_step must be positive" << endl;
+            return 1;
+        }
+        for (int i = 0; alpha_start + i * alpha_step <= alpha_end + 1e-9 * alpha_step; i++)
+        {
+            alphas_deg.push_back(alpha_start + i * alpha_step);
+        }
+    }
+    VectorXd alpha = Map<VectorXd>(alphas_deg.data(), alphas_deg.size()) * DEG2RAD;
+    double x_ref = optional_setting(polar_input, "x_ref", 0.25 * c);
+
+    Body body;
+    SteadyPolar polar;
+    auto start = chrono::high_resolution_clock::now();
+    try
+    {
+        body = make_body(input["geometry"], input["motion"], json(), Qinf);
+        initialize_body(body, Qinf, 0.0);
+        solve_steady_polar(body, Qinf, alpha, x_ref, 1.e-4, polar);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    auto stop = chrono::high_resolution_clock::now();
+
+    ofstream polar_file("output_files/polar_n=" + to_string(n) + ".dat");
+    polar_file << "# alpha [deg]\tCl (pressure)\tCl (Kutta-Joukowski)\tCd (pressure)\tCm (about x_ref)" << endl;
+    for (int a = 0; a < alpha.size(); a++)
+    {
+        polar_file << alphas_deg[a] << "\t" << polar.cl(a) << "\t" << polar.cl_kj(a) << "\t" << polar.cd(a) << "\t" << polar.cm(a) << endl;
+    }
+    ofstream cp_file("output_files/polar_cp_n=" + to_string(n) + ".dat");
+    cp_file << "# x_cp [m] followed by cp at every angle of the polar" << endl;
+    for (int i = 0; i < n - 1; i++)
+    {
+        cp_file << polar.x_cp(i);
+        for (int a = 0; a < alpha.size(); a++)
+        {
+            cp_file << "\t" << polar.cp(i, a);
+        }
+        cp_file << endl;
+    }
+    cout << "Steady polar of " << alpha.size() << " angles solved in " << chrono::duration<double>(stop - start).count() << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,700 @@
+#include "Sensitivity.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "Input.h"
+#include "kinematics.h"
+#include "velocity.h"
+#include "constants.h"
+
+/* kinematic parameters in the scalar type of the march */
+template <class S>
+struct MarchParameters
+{
+    S k, h0, h1, alpha0, alpha1, phi_h, x_pitch, y_pitch;
+};
+
+/* state of the foil and its wake during the march */
+template <class S>
+struct FoilMarch
+{
+    BasicRigidBodyState<S> state;
+    BasicPanelGeometry<S> panels;
+    Matrix<S, Dynamic, 1> rhs, K_inv_rhs, W, gamma_bound;
+    S gamma_old, lwp, theta_wp, gamma_wp;
+    S wake_panel_x[2], wake_panel_y[2]; ///< End points of the wake panel (trailing edge first).
+    Matrix<S, 2, 1> wake_panel_cp, vtotal_wp_cp;
+    vector<S> gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location;
+    Matrix<S, Dynamic, 1> phi_old, phi_airfoil_cps, cp;
+    S cn_tilda, ca_tilda;
+};
+
+/* the parameters of the march: plain values, or seeded as the independent variables of the derivatives */
+static void seed_parameter(double value, int, double &parameter)
+{
+    parameter = value;
+}
+
+template <int N>
+static void seed_parameter(double value, int index, Dual<N> &parameter)
+{
+    parameter = (index >= 0) ? Dual<N>::parameter(value, index) : Dual<N>(value);
+}
+
+template <class S>
+static MarchParameters<S> seed_parameters(const PitchPlungeParameters &parameters)
+{
+    MarchParameters<S> p;
+    seed_parameter(parameters.k, parameter_k, p.k);
+    seed_parameter(parameters.h0, -1, p.h0);
+    seed_parameter(parameters.h1, parameter_h1, p.h1);
+    seed_parameter(parameters.alpha0, -1, p.alpha0);
+    seed_parameter(parameters.alpha1, parameter_alpha1, p.alpha1);
+    seed_parameter(parameters.phi_h, parameter_phi_h, p.phi_h);
+    seed_parameter(parameters.x_pitch, parameter_x_pitch, p.x_pitch);
+    seed_parameter(parameters.y_pitch, -1, p.y_pitch);
+    return p;
+}
+
+/* K x = b with the shared factorisation; K is constant, so the value and the derivatives are one block of columns */
+static VectorXd solve_foil(const PartialPivLU<MatrixXd> &lu, const VectorXd &b)
+{
+    return lu.solve(b);
+}
+
+template <int N>
+static Matrix<Dual<N>, Dynamic, 1> solve_foil(const PartialPivLU<MatrixXd> &lu, const Matrix<Dual<N>, Dynamic, 1> &b)
+{
+    MatrixXd B(b.size(), N + 1);
+    for (int i = 0; i < b.size(); i++)
+    {
+        B(i, 0) = b(i).value;
+        for (int c = 0; c < N; c++)
+        {
+            B(i, c + 1) = b(i).derivative[c];
+        }
+    }
+    MatrixXd X = lu.solve(B);
+    Matrix<Dual<N>, Dynamic, 1> x(b.size());
+    for (int i = 0; i < b.size(); i++)
+    {
+        x(i).value = X(i, 0);
+        for (int c = 0; c < N; c++)
+        {
+            x(i).derivative[c] = X(i, c + 1);
+        }
+    }
+    return x;
+}
+
+/* Newton update x += -J^-1 r of the wake panel (length, angle); J holds the derivatives of the values, the update of
+   a dual applies the same J^-1 to the derivatives of the residuals. Returns the norm of the update of the values. */
+static double newton_update(const Matrix2d &jacobian, const double residual[2], double x[2], bool)
+{
+    Vector2d step = jacobian.partialPivLu().solve(-Vector2d(residual[0], residual[1]));
+    x[0] += step(0);
+    x[1] += step(1);
+    return step.norm();
+}
+
+template <int N>
+static double newton_update(const Matrix2d &jacobian, const Dual<N> residual[2], Dual<N> x[2], bool tangents_only)
+{
+    PartialPivLU<Matrix2d> lu(jacobian);
+    Matrix<double, 2, N + 1> R;
+    for (int r = 0; r < 2; r++)
+    {
+        R(r, 0) = -residual[r].value;
+        for (int c = 0; c < N; c++)
+        {
+            R(r, c + 1) = -residual[r].derivative[c];
+        }
+    }
+    Matrix<double, 2, N + 1> step = lu.solve(R);
+    for (int r = 0; r < 2; r++)
+    {
+        if (!tangents_only)
+        {
+            x[r].value += step(r, 0);
+        }
+        for (int c = 0; c < N; c++)
+        {
+            x[r].derivative[c] += step(r, c + 1);
+        }
+    }
+    return step.col(0).norm();
+}
+
+/* sinusoidal pitch-plunge state at time t (legacy motion: no surge, body at the inertial origin) */
+template <class S>
+static BasicRigidBodyState<S> pitch_plunge_state(const MarchParameters<S> &p, const S &omega, const S &t)
+{
+    BasicRigidBodyState<S> state;
+    S h = p.h0 + p.h1 * sin(omega * t + p.phi_h);
+    S h_dot = p.h1 * omega * cos(omega * t + p.phi_h);
+    S phi_alpha = 90.0 * DEG2RAD + p.phi_h;
+    state.alpha = p.alpha0 + p.alpha1 * sin(omega * t + phi_alpha);
+    state.alpha_dot = p.alpha1 * omega * cos(omega * t + phi_alpha);
+    state.cos_alpha = cos(state.alpha);
+    state.sin_alpha = sin(state.alpha);
+    state.x_pitch = p.x_pitch;
+    state.y_pitch = p.y_pitch;
+    state.pivot_x = p.x_pitch;
+    state.pivot_y = p.y_pitch - h; // negative sign implies downward plunge is taken positive.
+    state.pivot_u = 0.0;
+    state.pivot_v = -h_dot;
+    return state;
+}
+
+/* fraction of Qinf reached at time t by the (1 - cos) start of the freestream */
+template <class S>
+static S inflow_fraction(double duration, const S &t)
+{
+    if (!(duration > 0.0))
+    {
+        return S((t >= 0.0) ? 1.0 : 0.0);
+    }
+    S tau = t / duration;
+    tau = (tau < 0.0) ? S(0.0) : ((tau > 1.0) ? S(1.0) : tau);
+    return 0.5 * (1.0 - cos(pi * tau));
+}
+
+/* velocity induced by the wake panel (constant strength gamma_wp) at a point */
+template <class S>
+static Matrix<S, 2, 1> wake_panel_velocity(const FoilMarch<S> &march, const S &x, const S &y)
+{
+    S P[2][2];
+    linear_vortex_panel_influence(march.wake_panel_x[0], march.wake_panel_y[0], march.wake_panel_x[1], march.wake_panel_y[1], x, y, P);
+    return Matrix<S, 2, 1>(P[0][0] * march.gamma_wp + P[0][1] * march.gamma_wp, P[1][0] * march.gamma_wp + P[1][1] * march.gamma_wp);
+}
+
+/* wake panel columns of the coupled system and the elimination of the bound unknowns (solve_coupled_system) */
+template <class S>
+static void solve_coupled_foil(const PitchPlungeFoil &foil, FoilMarch<S> &march)
+{
+    int n = foil.n;
+    const BasicPanelGeometry<S> &panels = march.panels;
+    S P[2][2];
+    for (int i = 0; i < n - 1; i++)
+    {
+        linear_vortex_panel_influence(march.wake_panel_x[0], march.wake_panel_y[0], march.wake_panel_x[1], march.wake_panel_y[1], panels.x_cp(i), panels.y_cp(i), P);
+        march.W(i) = (P[0][0] + P[0][1]) * panels.unit_normal(i, 0) + (P[1][0] + P[1][1]) * panels.unit_normal(i, 1);
+    }
+    march.W(n - 1) = 1.0; // kutta condition
+    Matrix<S, Dynamic, 1> K_inv_W = solve_foil(foil.lu, march.W);
+
+    /* Kelvin's circulation theorem with the trapezoidal weights of the nodal strengths */
+    S schur = march.lwp, schur_rhs = march.gamma_old;
+    for (int i = 0; i < n; i++)
+    {
+        S weight = (i == 0) ? S(panels.l(0) * 0.5) : ((i == n - 1) ? S(panels.l(n - 2) * 0.5) : S((panels.l(i - 1) + panels.l(i)) * 0.5));
+        schur -= weight * K_inv_W(i);
+        schur_rhs -= weight * march.K_inv_rhs(i);
+    }
+    march.gamma_wp = schur_rhs / schur;
+    for (int i = 0; i < n; i++)
+    {
+        march.gamma_bound(i) = march.K_inv_rhs(i) - K_inv_W(i) * march.gamma_wp;
+    }
+}
+
+/* places the wake panel, solves the coupled system and returns the residuals of the panel (newton_raphson) */
+template <class S>
+static void wake_panel_residuals(const PitchPlungeFoil &foil, FoilMarch<S> &march, const Matrix<S, 2, 1> &freestream, const S &dt, const S x[2], S residuals[2])
+{
+    int n = foil.n;
+    march.lwp = x[0];
+    march.theta_wp = x[1];
+    march.wake_panel_x[0] = march.panels.x_pp(n - 1);
+    march.wake_panel_y[0] = march.panels.y_pp(n - 1);
+    march.wake_panel_x[1] = march.panels.x_pp(n - 1) + x[0] * cos(x[1]);
+    march.wake_panel_y[1] = march.panels.y_pp(n - 1) + x[0] * sin(x[1]);
+    march.wake_panel_cp(0) = (march.wake_panel_x[0] + march.wake_panel_x[1]) / 2.0;
+    march.wake_panel_cp(1) = (march.wake_panel_y[0] + march.wake_panel_y[1]) / 2.0;
+    solve_coupled_foil(foil, march);
+
+    ImageSystem unbounded;
+    Matrix<S, 2, 1> velocity_bound = bound_vortex_velocity(n, march.panels.x_pp, march.panels.y_pp, march.wake_panel_cp(0), march.wake_panel_cp(1), march.gamma_bound, unbounded);
+    Matrix<S, 2, 1> shed_vel = wake_vortex_velocity(march.gamma_wake_strength, march.gamma_wake_x_location, march.gamma_wake_y_location, march.wake_panel_cp(0), march.wake_panel_cp(1), unbounded);
+    march.vtotal_wp_cp = velocity_bound + shed_vel + freestream;
+    residuals[0] = x[0] - sqrt(march.vtotal_wp_cp(0) * march.vtotal_wp_cp(0) + march.vtotal_wp_cp(1) * march.vtotal_wp_cp(1)) * dt;
+    residuals[1] = x[1] - atan2(march.vtotal_wp_cp(1), march.vtotal_wp_cp(0));
+}
+
+/* converge_wake_panels: Newton on the values with a finite-difference Jacobian, then one update of the tangents */
+template <class S>
+static void converge_wake_panel(const PitchPlungeFoil &foil, FoilMarch<S> &march, const Matrix<S, 2, 1> &freestream, const S &dt, const PitchPlungeSettings &settings)
+{
+    S x[2] = {march.lwp, march.theta_wp}, perturbed[2], residuals[2], residuals_plus[2];
+    Matrix2d jacobian;
+    double convergence;
+    int iterations = 0;
+    do
+    {
+        // a diverging wake panel (kinematics far outside the validity of the model) ends the march instead of hanging it
+        if (++iterations > settings.max_newton_iterations)
+        {
+            throw runtime_error("converge_wake_panel: the wake panel did not converge in " + to_string(settings.max_newton_iterations) + " Newton iterations");
+        }
+        wake_panel_residuals(foil, march, freestream, dt, x, residuals);
+        for (int c = 0; c < 2; c++)
+        {
+            perturbed[0] = x[0];
+            perturbed[1] = x[1];
+            perturbed[c] += settings.epsilon;
+            wake_panel_residuals(foil, march, freestream, dt, perturbed, residuals_plus);
+            jacobian(0, c) = (scalar_value(residuals_plus[0]) - scalar_value(residuals[0])) / settings.epsilon;
+            jacobian(1, c) = (scalar_value(residuals_plus[1]) - scalar_value(residuals[1])) / settings.epsilon;
+        }
+        convergence = newton_update(jacobian, residuals, x, false);
+    } while (convergence > settings.tolerance);
+
+    if (!is_same<S, double>::value)
+    {
+        wake_panel_residuals(foil, march, freestream, dt, x, residuals);
+        newton_update(jacobian, residuals, x, true);
+    }
+
+    /* leave the march in the state of the converged wake panel */
+    wake_panel_residuals(foil, march, freestream, dt, x, residuals);
+}
+
+/* prescribe_wake_panel: from the trailing edge at t to the point it occupied at t - dt (not before the start at 0),
+   convected by the freestream */
+template <class S>
+static void prescribe_foil_wake_panel(const PitchPlungeFoil &foil, FoilMarch<S> &march, const MarchParameters<S> &p, const S &omega, const Matrix<S, 2, 1> &freestream, const S &t, const S &dt)
+{
+    int n = foil.n;
+    S t_shed = (scalar_value(t - dt) < 0.0) ? S(0.0) : S(t - dt);
+    Matrix<S, 2, 1> end = body_fixed_frame_to_inertial_frame(pitch_plunge_state(p, omega, t_shed), foil.x0(n - 1), foil.y0(n - 1));
+    S dx = end(0) + freestream(0) * dt - march.panels.x_pp(n - 1);
+    S dy = end(1) + freestream(1) * dt - march.panels.y_pp(n - 1);
+    march.lwp = sqrt(dx * dx + dy * dy);
+    march.theta_wp = atan2(dy, dx);
+    march.wake_panel_x[0] = march.panels.x_pp(n - 1);
+    march.wake_panel_y[0] = march.panels.y_pp(n - 1);
+    march.wake_panel_x[1] = march.panels.x_pp(n - 1) + dx;
+    march.wake_panel_y[1] = march.panels.y_pp(n - 1) + dy;
+    march.wake_panel_cp(0) = march.panels.x_pp(n - 1) + 0.5 * dx;
+    march.wake_panel_cp(1) = march.panels.y_pp(n - 1) + 0.5 * dy;
+    march.vtotal_wp_cp = freestream;
+    solve_coupled_foil(foil, march);
+}
+
+/* velocity_induced_all and potential_induced_all of the foil */
+template <class S>
+static Matrix<S, 2, 1> induced_velocity(const PitchPlungeFoil &foil, const FoilMarch<S> &march, const S &x, const S &y)
+{
+    ImageSystem unbounded;
+    return wake_panel_velocity(march, x, y) + bound_vortex_velocity(foil.n, march.panels.x_pp, march.panels.y_pp, x, y, march.gamma_bound, unbounded) + wake_vortex_velocity(march.gamma_wake_strength, march.gamma_wake_x_location, march.gamma_wake_y_location, x, y, unbounded);
+}
+
+template <class S>
+static S induced_potential(const PitchPlungeFoil &foil, const FoilMarch<S> &march, const S &x, const S &y)
+{
+    ImageSystem unbounded;
+    S phi = 0.0;
+    phi += bound_vortex_potential(foil.n, march.panels.x_pp, march.panels.y_pp, x, y, march.gamma_bound, unbounded);
+    phi += linear_vortex_panel_potential(march.wake_panel_x[0], march.wake_panel_y[0], march.wake_panel_x[1], march.wake_panel_y[1], march.gamma_wp, march.gamma_wp, x, y);
+    phi += wake_vortex_potential(march.gamma_wake_strength, march.gamma_wake_x_location, march.gamma_wake_y_location, x, y, unbounded);
+    return phi;
+}
+
+/* compute_surface_loads of the foil: surface potential, pressure and force coefficients */
+template <class S>
+static void foil_surface_loads(const PitchPlungeFoil &foil, FoilMarch<S> &march, const PitchPlungeSettings &settings, int iter, const S &dt, const S &Qinf_t, double c)
+{
+    int n = foil.n;
+    int le = (n + 1) / 2 - 1;
+    const BasicPanelGeometry<S> &panels = march.panels;
+    double Qref = settings.Qinf;
+
+    S phi_le = 0.0;
+    if (settings.phi_le_quadrature)
+    {
+        int z = settings.z;
+        vector<S> x_streamline(z + 1);
+        double lz = (10.0 * c);
+        for (int i = 0; i < z + 1; i++)
+        {
+            x_streamline[i] = (1.0 - sin(i * 0.5 * pi / z)) * (-lz) + panels.x_pp(le);
+        }
+        for (int i = 0; i < z; i++)
+        {
+            Matrix<S, 2, 1> v = induced_velocity(foil, march, S((x_streamline[i] + x_streamline[i + 1]) / 2.0), S((panels.y_pp(le) + panels.y_pp(le)) / 2.0));
+            phi_le = phi_le + v(0) * fabs(x_streamline[i + 1] - x_streamline[i]);
+        }
+    }
+    else
+    {
+        phi_le = induced_potential(foil, march, panels.x_pp(le), panels.y_pp(le));
+    }
+
+    /* induced velocity just off the surface at every control point, shared by the potential and the pressure */
+    vector<Matrix<S, 2, 1>> viacp(n - 1);
+    Matrix<S, Dynamic, 1> tang_vel(n - 1);
+    for (int i = 0; i < n - 1; i++)
+    {
+        viacp[i] = induced_velocity(foil, march, S(panels.x_cp(i) + panels.unit_normal(i, 0) * settings.offset), S(panels.y_cp(i) + panels.unit_normal(i, 1) * settings.offset));
+        tang_vel(i) = panels.unit_tangent(i, 0) * viacp[i](0) + panels.unit_tangent(i, 1) * viacp[i](1);
+    }
+
+    /* potential at the nodes, integrating the tangential velocity away from the leading edge */
+    Matrix<S, Dynamic, 1> phi_airfoil_nodes(n);
+    phi_airfoil_nodes(le) = phi_le;
+    S addition = 0.0;
+    for (int j = le - 1; j >= 0; j--) // lower surface
+    {
+        addition = addition + (tang_vel(j) * panels.l(j));
+        phi_airfoil_nodes(j) = phi_le - addition;
+    }
+    addition = 0.0;
+    for (int j = le + 1; j < n; j++) // upper surface
+    {
+        addition = addition + (tang_vel(j - 1) * panels.l(j - 1));
+        phi_airfoil_nodes(j) = phi_le + addition;
+    }
+    for (int i = 0; i < n - 1; i++)
+    {
+        march.phi_airfoil_cps(i) = (phi_airfoil_nodes(i + 1) + phi_airfoil_nodes(i)) / 2.0;
+    }
+
+    /* unsteady Bernoulli pressure at the control points */
+    for (int i = 0; i < n - 1; i++)
+    {
+        S dphi_dt = (iter == 0) ? S(0.0) : S((march.phi_airfoil_cps(i) - march.phi_old(i)) / dt);
+        Matrix<S, 2, 1> flow_vel = velocity_at_surface_of_the_body_inertial_frame(Qinf_t, march.state, panels.x_cp(i), panels.y_cp(i));
+        S vi_x = viacp[i](0) + flow_vel(0);
+        S vi_y = viacp[i](1) + flow_vel(1);
+        S V = sqrt(vi_x * vi_x + vi_y * vi_y);
+        march.cp(i) = (Qinf_t * Qinf_t) / (Qref * Qref) - (V * V) / (Qref * Qref) - (2.0 / (Qref * Qref)) * (dphi_dt);
+    }
+    march.phi_old = march.phi_airfoil_cps;
+
+    march.cn_tilda = 0.0;
+    march.ca_tilda = 0.0;
+    for (int i = 0; i < n - 1; i++)
+    {
+        march.cn_tilda = march.cn_tilda - (1.0 / c) * march.cp(i) * panels.l(i) * panels.unit_normal(i, 1);
+        march.ca_tilda = march.ca_tilda - (1.0 / c) * march.cp(i) * panels.l(i) * panels.unit_normal(i, 0);
+    }
+}
+
+/* compute_moment_and_power: input power coefficient of the current step */
+template <class S>
+static S foil_input_power(const PitchPlungeFoil &foil, const FoilMarch<S> &march, double Qref, double c)
+{
+    const BasicRigidBodyState<S> &state = march.state;
+    const BasicPanelGeometry<S> &panels = march.panels;
+    S cn = 0.0, ca = 0.0, cm = 0.0;
+    for (int i = 0; i < foil.n - 1; i++)
+    {
+        cn -= march.cp(i) * panels.l(i) * panels.unit_normal(i, 1) / c;
+        ca -= march.cp(i) * panels.l(i) * panels.unit_normal(i, 0) / c;
+        cm += march.cp(i) * panels.l(i) * ((panels.x_cp(i) - state.pivot_x) * panels.unit_normal(i, 1) - (panels.y_cp(i) - state.pivot_y) * panels.unit_normal(i, 0)) / (c * c);
+    }
+    return -(ca * state.pivot_u + cn * state.pivot_v) / Qref - cm * state.alpha_dot * c / Qref;
+}
+
+/* convect_wakes of the foil: moves the wake vortices over one step and sheds the wake panel */
+template <class S>
+static void convect_foil_wake(const PitchPlungeFoil &foil, FoilMarch<S> &march, const Matrix<S, 2, 1> &freestream, const S &dt, int wake)
+{
+    size_t size = march.gamma_wake_x_location.size();
+    vector<S> x_new(size), y_new(size);
+    ImageSystem unbounded;
+    for (size_t j = 0; j < size; j++)
+    {
+        const S &x = march.gamma_wake_x_location[j];
+        const S &y = march.gamma_wake_y_location[j];
+        if (wake == 0)
+        {
+            Matrix<S, 2, 1> shed_vel = wake_vortex_velocity(march.gamma_wake_strength, march.gamma_wake_x_location, march.gamma_wake_y_location, x, y, unbounded, (int)j);
+            Matrix<S, 2, 1> velocity = bound_vortex_velocity(foil.n, march.panels.x_pp, march.panels.y_pp, x, y, march.gamma_bound, unbounded);
+            Matrix<S, 2, 1> vel_wake_point = wake_panel_velocity(march, x, y);
+            x_new[j] = x + (freestream(0) + shed_vel(0) + velocity(0) + vel_wake_point(0)) * dt;
+            y_new[j] = y + (freestream(1) + shed_vel(1) + velocity(1) + vel_wake_point(1)) * dt;
+        }
+        else
+        {
+            x_new[j] = x + (freestream(0)) * dt;
+            y_new[j] = y + (freestream(1)) * dt;
+        }
+    }
+    march.gamma_wake_x_location = x_new;
+    march.gamma_wake_y_location = y_new;
+    march.gamma_wake_strength.push_back(march.gamma_wp * march.lwp);
+    march.gamma_wake_x_location.push_back(march.wake_panel_cp(0) + march.vtotal_wp_cp(0) * dt);
+    march.gamma_wake_y_location.push_back(march.wake_panel_cp(1) + march.vtotal_wp_cp(1) * dt);
+}
+
+/* cycle means of Ct and Cpower, and the rms of both */
+template <class S>
+struct MarchCycle
+{
+    int cycle;
+    S ct_mean, ct_rms, cpower_mean, cpower_rms, efficiency;
+};
+
+/* the unsteady simulation of the foil over ncycles, in the scalar type S */
+template <class S>
+static vector<MarchCycle<S>> march_pitch_plunge(const PitchPlungeFoil &foil, const PitchPlungeParameters &parameters, const PitchPlungeSettings &settings)
+{
+    int n = foil.n;
+    double c = settings.c;
+    MarchParameters<S> p = seed_parameters<S>(parameters);
+    S omega = (2.0 * p.k * settings.Qinf) / c;
+    S T = 2.0 * pi / omega;
+    S dt = T / settings.nsteps;
+
+    FoilMarch<S> march;
+    resize_panel_geometry(n, march.panels);
+    march.rhs = Matrix<S, Dynamic, 1>::Zero(n);
+    march.W = Matrix<S, Dynamic, 1>::Zero(n);
+    march.gamma_bound = Matrix<S, Dynamic, 1>::Zero(n);
+    march.gamma_old = 0.0;
+    march.lwp = settings.Qinf * dt;
+    march.theta_wp = 0.0;
+    march.gamma_wp = 0.0;
+    march.phi_old = Matrix<S, Dynamic, 1>::Zero(n - 1);
+    march.phi_airfoil_cps = Matrix<S, Dynamic, 1>::Zero(n - 1);
+    march.cp = Matrix<S, Dynamic, 1>::Zero(n - 1);
+
+    vector<MarchCycle<S>> cycles;
+    S ct_last = 0.0, cpower_last = 0.0;
+    S ct_integral = 0.0, ct2_integral = 0.0, cpower_integral = 0.0, cpower2_integral = 0.0;
+    ImageSystem unbounded;
+    int steps = settings.ncycles * settings.nsteps;
+    for (int iter = 0; iter <= steps; iter++)
+    {
+        S t = iter * dt;
+        S fraction = inflow_fraction(settings.inflow_duration, S(t + dt));
+        S Qinf_t = settings.Qinf * fraction;
+        Matrix<S, 2, 1> freestream(Qinf_t, settings.Vinf * fraction);
+        march.state = pitch_plunge_state(p, omega, t);
+        update_panel_geometry(march.state, foil.x0, foil.y0, march.panels);
+
+        /* right-hand side: wake vortices and kinematic velocity at the control points, Kutta row */
+        for (int i = 0; i < n - 1; i++)
+        {
+            Matrix<S, 2, 1> shed_vel = wake_vortex_velocity(march.gamma_wake_strength, march.gamma_wake_x_location, march.gamma_wake_y_location, march.panels.x_cp(i), march.panels.y_cp(i), unbounded);
+            Matrix<S, 2, 1> flow_vel = velocity_at_surface_of_the_body_inertial_frame(Qinf_t, march.state, march.panels.x_cp(i), march.panels.y_cp(i));
+            march.rhs(i) = -((shed_vel(0) + flow_vel(0)) * march.panels.unit_normal(i, 0) + (shed_vel(1) + flow_vel(1)) * march.panels.unit_normal(i, 1));
+        }
+        march.rhs(n - 1) = 0.0; /* [kutta condition] */
+        march.K_inv_rhs = solve_foil(foil.lu, march.rhs);
+
+        if (settings.prescribed_wake_panel)
+        {
+            prescribe_foil_wake_panel(foil, march, p, omega, freestream, t, dt);
+        }
+        else
+        {
+            converge_wake_panel(foil, march, freestream, dt, settings);
+        }
+        S gamma_t_minus_dt = 0.0;
+        for (int i = 0; i < n - 1; i++)
+        {
+            gamma_t_minus_dt += (march.gamma_bound(i) + march.gamma_bound(i + 1)) * march.panels.l(i) * 0.5;
+        }
+        march.gamma_old = gamma_t_minus_dt;
+
+        /* loads, and the trapezoidal cycle integrals of Ct = -ca_tilda and Cpower (add_performance_sample) */
+        foil_surface_loads(foil, march, settings, iter, dt, Qinf_t, c);
+        S ct = -march.ca_tilda;
+        S cpower = foil_input_power(foil, march, settings.Qinf, c);
+        if (iter > 0)
+        {
+            ct_integral += 0.5 * dt * (ct_last + ct);
+            ct2_integral += dt * (ct_last * ct_last + ct_last * ct + ct * ct) / 3.0;
+            cpower_integral += 0.5 * dt * (cpower_last + cpower);
+            cpower2_integral += dt * (cpower_last * cpower_last + cpower_last * cpower + cpower * cpower) / 3.0;
+        }
+        ct_last = ct;
+        cpower_last = cpower;
+        if (iter > 0 && iter % settings.nsteps == 0)
+        {
+            MarchCycle<S> cycle;
+            cycle.cycle = iter / settings.nsteps - 1;
+            cycle.ct_mean = ct_integral / T;
+            cycle.ct_rms = sqrt(ct2_integral / T);
+            cycle.cpower_mean = cpower_integral / T;
+            cycle.cpower_rms = sqrt(cpower2_integral / T);
+            cycle.efficiency = (cycle.cpower_mean > 0.0) ? S(cycle.ct_mean / cycle.cpower_mean) : S(numeric_limits<double>::quiet_NaN());
+            cycles.push_back(cycle);
+            ct_integral = ct2_integral = cpower_integral = cpower2_integral = 0.0;
+        }
+
+        convect_foil_wake(foil, march, freestream, dt, settings.wake);
+    }
+    return cycles;
+}
+
+void initialize_pitch_plunge_foil(const Body &body, PitchPlungeFoil &foil)
+{
+    if (body.A_self.rows() != body.n)
+    {
+        throw invalid_argument("initialize_pitch_plunge_foil: the body has no cached self-influence block");
+    }
+    foil.n = body.n;
+    foil.x0 = body.x0;
+    foil.y0 = body.y0;
+    foil.lu.compute(body.A_self);
+}
+
+vector<CyclePerformance> pitch_plunge_performance(const PitchPlungeFoil &foil, const PitchPlungeParameters &parameters, const PitchPlungeSettings &settings)
+{
+    vector<MarchCycle<double>> cycles = march_pitch_plunge<double>(foil, parameters, settings);
+    vector<CyclePerformance> performance(cycles.size());
+    for (size_t i = 0; i < cycles.size(); i++)
+    {
+        performance[i].cycle = cycles[i].cycle;
+        performance[i].ct_mean = cycles[i].ct_mean;
+        performance[i].ct_rms = cycles[i].ct_rms;
+        performance[i].cpower_mean = cycles[i].cpower_mean;
+        performance[i].cpower_rms = cycles[i].cpower_rms;
+        performance[i].efficiency = cycles[i].efficiency;
+    }
+    return performance;
+}
+
+vector<CycleSensitivity> pitch_plunge_sensitivities(const PitchPlungeFoil &foil, const PitchPlungeParameters &parameters, const PitchPlungeSettings &settings)
+{
+    vector<MarchCycle<KinematicDual>> cycles = march_pitch_plunge<KinematicDual>(foil, parameters, settings);
+    vector<CycleSensitivity> sensitivities(cycles.size());
+    for (size_t i = 0; i < cycles.size(); i++)
+    {
+        sensitivities[i].cycle = cycles[i].cycle;
+        sensitivities[i].ct_mean = cycles[i].ct_mean;
+        sensitivities[i].cpower_mean = cycles[i].cpower_mean;
+        sensitivities[i].efficiency = cycles[i].efficiency;
+    }
+    return sensitivities;
+}
+
+PitchPlungeParameters pitch_plunge_parameters(const Body &body, double k)
+{
+    PitchPlungeParameters parameters;
+    parameters.k = k;
+    parameters.h0 = body.motion.plunge.offset;
+    parameters.h1 = body.motion.plunge.amplitude;
+    parameters.phi_h = body.motion.plunge.phase;
+    parameters.alpha0 = body.motion.pitch.offset;
+    parameters.alpha1 = body.motion.pitch.amplitude;
+    parameters.x_pitch = body.motion.x_pitch;
+    parameters.y_pitch = body.motion.y_pitch;
+    return parameters;
+}
+
+int run_sensitivity(const Body &body, const PitchPlungeSettings &settings, double k, json sensitivity, chrono::high_resolution_clock::time_point wall_start)
+{
+    const char *names[kinematic_parameter_count] = {"k", "h1", "alpha1", "phi_h", "x_pitch"};
+    // derivatives are reported per unit of the input: degrees for the angles
+    const double units[kinematic_parameter_count] = {1.0, 1.0, DEG2RAD, DEG2RAD, 1.0};
+    double check_step = optional_setting(sensitivity, "check_step", 0.0);
+    if (check_step < 0.0)
+    {
+        cerr << "Error: sensitivity.check_step must not be negative" << endl;
+        return 1;
+    }
+    PitchPlungeParameters parameters = pitch_plunge_parameters(body, k);
+
+    PitchPlungeFoil foil;
+    vector<CycleSensitivity> cycles;
+    try
+    {
+        initialize_pitch_plunge_foil(body, foil);
+        cycles = pitch_plunge_sensitivities(foil, parameters, settings);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    if (cycles.empty())
+    {
+        cerr << "Error: sensitivity mode needs at least one complete cycle (simulation.ncycles)" << endl;
+        return 1;
+    }
+
+    ofstream table("output_files/sensitivity.dat");
+    table << "# cycle";
+    for (const char *quantity : {"Ct mean", "Cpower mean", "efficiency"})
+    {
+        table << "	" << quantity;
+        for (int i = 0; i < kinematic_parameter_count; i++)
+        {
+            table << "	d(" << quantity << ")/d" << names[i];
+        }
+    }
+    table << endl;
+    for (const CycleSensitivity &cycle : cycles)
+    {
+        table << cycle.cycle;
+        for (const KinematicDual *quantity : {&cycle.ct_mean, &cycle.cpower_mean, &cycle.efficiency})
+        {
+            table << "	" << quantity->value;
+            for (int i = 0; i < kinematic_parameter_count; i++)
+            {
+                table << "	" << (isnan(quantity->value) ? quantity->value : quantity->derivative[i] * units[i]);
+            }
+        }
+        table << endl;
+    }
+
+    const CycleSensitivity &last = cycles.back();
+    cout << "sensitivity: cycle " << last.cycle << ", derivatives per unit of the input (k, h1 [m], alpha1 [deg], phi_h [deg], x_pitch [m])" << endl;
+    cout << "quantity	value";
+    for (int i = 0; i < kinematic_parameter_count; i++)
+    {
+        cout << "	d/d" << names[i];
+    }
+    cout << endl;
+    const char *labels[3] = {"Ct mean", "Cpower mean", "efficiency"};
+    const KinematicDual *quantities[3] = {&last.ct_mean, &last.cpower_mean, &last.efficiency};
+    for (int q = 0; q < 3; q++)
+    {
+        cout << labels[q] << "	" << quantities[q]->value;
+        for (int i = 0; i < kinematic_parameter_count; i++)
+        {
+            cout << "	" << quantities[q]->derivative[i] * units[i];
+        }
+        cout << endl;
+    }
+
+    // Optional: central differences of two plain marches per parameter, step check_step * max(|p|, reference)
+    if (check_step > 0.0)
+    {
+        const double references[kinematic_parameter_count] = {1.0, settings.c, 1.0, 1.0, settings.c};
+        cout << "central differences (relative step " << check_step << "):" << endl;
+        for (int q = 0; q < 3; q++)
+        {
+            cout << labels[q] << "	";
+            for (int i = 0; i < kinematic_parameter_count; i++)
+            {
+                double values[2];
+                double *parameter[kinematic_parameter_count] = {&parameters.k, &parameters.h1, &parameters.alpha1, &parameters.phi_h, &parameters.x_pitch};
+                double base = *parameter[i];
+                double h = check_step * max(fabs(base), references[i]);
+                for (int side = 0; side < 2; side++)
+                {
+                    PitchPlungeParameters perturbed = parameters;
+                    double *perturbed_parameter[kinematic_parameter_count] = {&perturbed.k, &perturbed.h1, &perturbed.alpha1, &perturbed.phi_h, &perturbed.x_pitch};
+                    *perturbed_parameter[i] = base + (side == 0 ? h : -h);
+                    const CyclePerformance &cycle = pitch_plunge_performance(foil, perturbed, settings).back();
+                    values[side] = (q == 0) ? cycle.ct_mean : ((q == 1) ? cycle.cpower_mean : cycle.efficiency);
+                }
+                cout << "	" << (values[0] - values[1]) / (2.0 * h) * units[i];
+            }
+            cout << endl;
+        }
+    }
+    auto wall_stop = chrono::high_resolution_clock::now();
+    cout << "sensitivity: " << cycles.size() << " cycles in output_files/sensitivity.dat" << endl;
+    cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "Spline.h"
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+void fit_cubic_spline(const VectorXd &knots, const VectorXd &values, CubicSpline &spline)
+{
+    int m = knots.size();
+    if (m < 2 || values.size() != m)
+    {
+        throw invalid_argument("fit_cubic_spline: need at least two knots and one value per knot");
+    }
+    for (int i = 0; i < m - 1; i++)
+    {
+        if (!(knots(i + 1) > knots(i)))
+        {
+            throw invalid_argument("fit_cubic_spline: knots must be strictly increasing");
+        }
+    }
+
+    spline.knots = knots;
+    spline.values = values;
+    spline.second_derivatives = VectorXd::Zero(m);
+    if (m == 2)
+    {
+        return;
+    }
+
+    /* tridiagonal system for the interior second derivatives (natural end conditions) */
+    vector<double> diag(m), upper(m), rhs(m);
+    for (int i = 1; i < m - 1; i++)
+    {
+        double h0 = knots(i) - knots(i - 1);
+        double h1 = knots(i + 1) - knots(i);
+        double lower = h0 / 6.0;
+        diag[i] = (h0 + h1) / 3.0;
+        upper[i] = h1 / 6.0;
+        rhs[i] = (values(i + 1) - values(i)) / h1 - (values(i) - values(i - 1)) / h0;
+        if (i > 1) // forward elimination
+        {
+            double w = lower / diag[i - 1];
+            diag[i] -= w * upper[i - 1];
+            rhs[i] -= w * rhs[i - 1];
+        }
+    }
+    for (int i = m - 2; i >= 1; i--) // back substitution
+    {
+        double next = (i < m - 2) ? spline.second_derivatives(i + 1) : 0.0;
+        spline.second_derivatives(i) = (rhs[i] - upper[i] * next) / diag[i];
+    }
+}
+
+/* index of the interval [knots(k), knots(k+1)] containing s (clamped to the end intervals) */
+static int spline_interval(const CubicSpline &spline, double s)
+{
+    int lo = 0, hi = spline.knots.size() - 1;
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if (spline.knots(mid) > s)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid;
+        }
+    }
+    return lo;
+}
+
+double spline_value(const CubicSpline &spline, double s)
+{
+    int k = spline_interval(spline, s);
+    double h = spline.knots(k + 1) - spline.knots(k);
+    double a = (spline.knots(k + 1) - s) / h;
+    double b = (s - spline.knots(k)) / h;
+    return a * spline.values(k) + b * spline.values(k + 1) + ((a * a * a - a) * spline.second_derivatives(k) + (b * b * b - b) * spline.second_derivatives(k + 1)) * h * h / 6.0;
+}
+
+double spline_first_derivative(const CubicSpline &spline, double s)
+{
+    int k = spline_interval(spline, s);
+    double h = spline.knots(k + 1) - spline.knots(k);
+    double a = (spline.knots(k + 1) - s) / h;
+    double b = (s - spline.knots(k)) / h;
+    return (spline.values(k + 1) - spline.values(k)) / h - (3.0 * a * a - 1.0) * h * spline.second_derivatives(k) / 6.0 + (3.0 * b * b - 1.0) * h * spline.second_derivatives(k + 1) / 6.0;
+}
+
+double spline_second_derivative(const CubicSpline &spline, double s)
+{
+    int k = spline_interval(spline, s);
+    double h = spline.knots(k + 1) - spline.knots(k);
+    double a = (spline.knots(k + 1) - s) / h;
+    double b = (s - spline.knots(k)) / h;
+    return a * spline.second_derivatives(k) + b * spline.second_derivatives(k + 1);
+}
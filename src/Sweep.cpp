@@ -0,0 +1,408 @@
+#include "Sweep.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include "Input.h"
+#include "constants.h"
+#ifdef PANKH_USE_MPI
+#include <mpi.h>
+#endif
+
+/* cases not yet handed out, the most expensive first; shared by the workers of a process */
+struct SweepQueue
+{
+    mutex lock;
+    vector<int> order;
+    size_t next;
+    vector<SweepResult> *results;
+};
+
+static mutex output_lock; // one progress line at a time on the standard output
+
+static int take_case(SweepQueue &queue)
+{
+    lock_guard<mutex> guard(queue.lock);
+    return (queue.next < queue.order.size()) ? queue.order[queue.next++] : -1;
+}
+
+static void report(const string &worker, int index, const string &message)
+{
+    lock_guard<mutex> guard(output_lock);
+    cout << "[" << worker << "] case " << index << ": " << message << endl;
+}
+
+/* mean input power and efficiency of the last completed cycle of a performance file */
+static void read_last_cycle(const string &filename, double &cpower_mean, double &efficiency)
+{
+    cpower_mean = numeric_limits<double>::quiet_NaN();
+    efficiency = numeric_limits<double>::quiet_NaN();
+    ifstream file(filename);
+    string line;
+    while (getline(file, line))
+    {
+        istringstream row(line);
+        double cycle, ct_mean, ct_rms, cpower, cpower_rms, eta;
+        if (line.compare(0, 1, "#") != 0 && row >> cycle >> ct_mean >> ct_rms >> cpower >> cpower_rms >> eta)
+        {
+            cpower_mean = cpower;
+            efficiency = eta;
+        }
+    }
+}
+
+/* runs the child solver of a case in its directory, keeps its output in log.txt and streams its progress */
+static SweepResult run_case(const string &executable, const SweepCase &sweep_case, int index, int worker, const string &name)
+{
+    SweepResult result;
+    result.completed = false;
+    result.worker = worker;
+    result.wall_time = 0.0;
+    result.metrics.cl_mean = result.metrics.cl_amplitude = result.metrics.ct_mean = numeric_limits<double>::quiet_NaN();
+    result.cpower_mean = result.efficiency = numeric_limits<double>::quiet_NaN();
+
+    const char *subdirectories[] = {"a_matrix_file", "airfoil_normal_file", "b_vector_file", "gamma_vector_file", "potential_file", "pressure_file", "vortex_shedding"};
+    string command = "mkdir -p";
+    for (const char *subdirectory : subdirectories)
+    {
+        command += " '" + sweep_case.directory + "/output_files/" + subdirectory + "'";
+    }
+    if (system(command.c_str()) != 0)
+    {
+        report(name, index, "Error: cannot create " + sweep_case.directory);
+        return result;
+    }
+    ofstream(sweep_case.directory + "/input.json") << sweep_case.input.dump(2) << endl;
+    ofstream log(sweep_case.directory + "/log.txt");
+
+    report(name, index, "started in " + sweep_case.directory);
+    auto start = chrono::high_resolution_clock::now();
+    FILE *child = popen(("cd '" + sweep_case.directory + "' && '" + executable + "' input.json 2>&1").c_str(), "r");
+    if (child == NULL)
+    {
+        report(name, index, "Error: the solver could not be started");
+        return result;
+    }
+    char buffer[4096];
+    int tenths = 0;
+    while (fgets(buffer, sizeof(buffer), child) != NULL)
+    {
+        string line(buffer);
+        log << line;
+        if (!line.empty() && line.back() == '\n')
+        {
+            line.pop_back();
+        }
+        if (line.compare(0, 28, "percentage time completed =\t") == 0)
+        {
+            double percentage = atof(line.c_str() + 28);
+            if (percentage >= 10.0 * (tenths + 1))
+            {
+                tenths = (int)(percentage / 10.0);
+                report(name, index, to_string(10 * tenths) + " %");
+            }
+        }
+        else if (line.compare(0, 6, "cycle ") == 0 || line.find("Error") != string::npos)
+        {
+            report(name, index, line);
+        }
+    }
+    log.close();
+    int status = pclose(child);
+    result.wall_time = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    if (status != 0)
+    {
+        report(name, index, "Error: the solver failed, see " + sweep_case.directory + "/log.txt");
+        return result;
+    }
+    try
+    {
+        read_load_metrics(sweep_case.directory + "/output_files/" + sweep_case.load_file, sweep_case.window, result.metrics);
+    }
+    catch (const exception &e)
+    {
+        report(name, index, string("Error: ") + e.what());
+        return result;
+    }
+    read_last_cycle(sweep_case.directory + "/output_files/performance_" + sweep_case.load_file, result.cpower_mean, result.efficiency);
+    result.completed = true;
+    ostringstream message;
+    message << "finished in " << result.wall_time << " s, mean Ct = " << result.metrics.ct_mean;
+    report(name, index, message.str());
+    return result;
+}
+
+static void pool_worker(const string &executable, const vector<SweepCase> &cases, SweepQueue &queue, int worker, const string &name)
+{
+    int index;
+    while ((index = take_case(queue)) >= 0)
+    {
+        SweepResult result = run_case(executable, cases[index], index, worker, name);
+        lock_guard<mutex> guard(queue.lock);
+        (*queue.results)[index] = result;
+    }
+}
+
+/* jobs workers of this process; the calling thread is one of them */
+static void run_pool(const string &executable, const vector<SweepCase> &cases, int jobs, SweepQueue &queue)
+{
+    vector<thread> workers;
+    for (int w = 1; w < jobs; w++)
+    {
+        try
+        {
+            workers.push_back(thread(pool_worker, cref(executable), cref(cases), ref(queue), w, "job " + to_string(w)));
+        }
+        catch (const system_error &)
+        {
+            break; // fewer jobs where threads cannot be created
+        }
+    }
+    pool_worker(executable, cases, queue, 0, "job 0");
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+#ifdef PANKH_USE_MPI
+/* message of a worker: case index (-1 for the first request), completed, wall time, the metrics */
+static const int result_size = 8;
+
+static void pack_result(int index, const SweepResult &result, double *message)
+{
+    message[0] = index;
+    message[1] = result.completed ? 1.0 : 0.0;
+    message[2] = result.wall_time;
+    message[3] = result.metrics.cl_mean;
+    message[4] = result.metrics.cl_amplitude;
+    message[5] = result.metrics.ct_mean;
+    message[6] = result.cpower_mean;
+    message[7] = result.efficiency;
+}
+
+/* rank 0: answers every request with the next case (or -1) and runs cases itself on a thread in between */
+static void dispatch_cases(const string &executable, const vector<SweepCase> &cases, SweepQueue &queue, int size, bool threads)
+{
+    thread local;
+    bool local_started = false;
+    if (threads)
+    {
+        try
+        {
+            local = thread(pool_worker, cref(executable), cref(cases), ref(queue), 0, string("rank 0"));
+            local_started = true;
+        }
+        catch (const system_error &)
+        {
+        }
+    }
+    int active = size - 1;
+    while (active > 0)
+    {
+        // polled with pauses, a blocking receive would spin on the core of the local case
+        int arrived = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &arrived, &status);
+        if (!arrived)
+        {
+            this_thread::sleep_for(chrono::milliseconds(20));
+            continue;
+        }
+        double message[result_size];
+        MPI_Recv(message, result_size, MPI_DOUBLE, status.MPI_SOURCE, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        int index = (int)message[0];
+        if (index >= 0)
+        {
+            SweepResult result;
+            result.completed = message[1] != 0.0;
+            result.worker = status.MPI_SOURCE;
+            result.wall_time = message[2];
+            result.metrics.cl_mean = message[3];
+            result.metrics.cl_amplitude = message[4];
+            result.metrics.ct_mean = message[5];
+            result.cpower_mean = message[6];
+            result.efficiency = message[7];
+            lock_guard<mutex> guard(queue.lock);
+            (*queue.results)[index] = result;
+        }
+        int next = take_case(queue);
+        MPI_Send(&next, 1, MPI_INT, status.MPI_SOURCE, 1, MPI_COMM_WORLD);
+        if (next < 0)
+        {
+            active--;
+        }
+    }
+    if (local_started)
+    {
+        local.join();
+    }
+}
+
+/* ranks 1 to N - 1: request a case, run it, return its metrics with the next request */
+static void serve_cases(const string &executable, const vector<SweepCase> &cases, int rank)
+{
+    double message[result_size];
+    SweepResult none;
+    none.completed = false;
+    none.wall_time = 0.0;
+    none.metrics.cl_mean = none.metrics.cl_amplitude = none.metrics.ct_mean = 0.0;
+    none.cpower_mean = none.efficiency = 0.0;
+    pack_result(-1, none, message);
+    while (true)
+    {
+        MPI_Send(message, result_size, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+        int index;
+        MPI_Recv(&index, 1, MPI_INT, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (index < 0)
+        {
+            return;
+        }
+        pack_result(index, run_case(executable, cases[index], index, rank, "rank " + to_string(rank)), message);
+    }
+}
+#endif
+
+bool run_sweep_cases(const string &executable, const vector<SweepCase> &cases, int jobs, vector<SweepResult> &results)
+{
+    SweepResult pending;
+    pending.completed = false;
+    pending.worker = -1;
+    pending.wall_time = 0.0;
+    pending.metrics.cl_mean = pending.metrics.cl_amplitude = pending.metrics.ct_mean = numeric_limits<double>::quiet_NaN();
+    pending.cpower_mean = pending.efficiency = numeric_limits<double>::quiet_NaN();
+    results.assign(cases.size(), pending);
+
+    SweepQueue queue;
+    queue.next = 0;
+    queue.results = &results;
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        queue.order.push_back(i);
+    }
+    stable_sort(queue.order.begin(), queue.order.end(), [&cases](int a, int b) { return cases[a].cost > cases[b].cost; });
+
+#ifdef PANKH_USE_MPI
+    int provided, rank, size;
+    MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size > 1)
+    {
+        if (rank == 0)
+        {
+            dispatch_cases(executable, cases, queue, size, provided >= MPI_THREAD_FUNNELED);
+        }
+        else
+        {
+            serve_cases(executable, cases, rank);
+        }
+        MPI_Finalize();
+        return rank == 0;
+    }
+    run_pool(executable, cases, jobs, queue);
+    MPI_Finalize();
+    return true;
+#else
+    run_pool(executable, cases, jobs, queue);
+    return true;
+#endif
+}
+
+int run_sweep(json input, const string &executable)
+{
+    json settings = input["sweep"];
+    if (settings.is_null() || settings["cases"].is_null() || settings["cases"].empty())
+    {
+        cerr << "Error: sweep mode needs the list sweep.cases" << endl;
+        return 1;
+    }
+    int jobs = optional_setting(settings, "jobs", 4);
+    if (jobs < 1)
+    {
+        cerr << "Error: sweep.jobs must be at least 1" << endl;
+        return 1;
+    }
+    char resolved[PATH_MAX];
+    if (realpath(executable.c_str(), resolved) == NULL)
+    {
+        cerr << "Error: cannot locate the solver executable " << executable << endl;
+        return 1;
+    }
+
+    // Every case replaces entries of the blocks of the input; its cost is estimated from its time steps
+    vector<SweepCase> cases(settings["cases"].size());
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        json child = input;
+        child.erase("sweep");
+        for (auto &entry : settings["cases"][i].items())
+        {
+            if (child[entry.key()].is_object() && entry.value().is_object())
+            {
+                child[entry.key()].update(entry.value());
+            }
+            else
+            {
+                child[entry.key()] = entry.value();
+            }
+        }
+        child["simulation"]["gnuplot_terminal"] = "dumb";
+        int n = child["geometry"]["n"];
+        double c = child["geometry"]["c"];
+        double k = child["motion"]["k"];
+        double Qinf = freestream_speed(child["flow"], c);
+        double T = pi * c / (k * Qinf);
+        bool periodic = child["simulation"]["dt"].is_null();
+        double dt = periodic ? T / child["simulation"]["nsteps"].get<double>() : child["simulation"]["dt"].get<double>();
+        double time_max = optional_setting(child["simulation"], "t_max", child["simulation"]["ncycles"].get<double>() * T);
+        double steps = time_max / dt;
+
+        SweepCase &sweep_case = cases[i];
+        sweep_case.directory = "output_files/sweep/case" + to_string(i);
+        sweep_case.load_file = "cl_cd_pitch_plunge_k=" + double_to_string(k, 3) + "_n=" + to_string(n) + (child["bodies"].is_null() ? "" : "_body0") + ".dat";
+        // metrics over the last cycle (t/T), or over the last tenth of a non-periodic run (convective time)
+        sweep_case.window = periodic ? 1.0 : 0.1 * 2.0 * Qinf * time_max / c;
+        // a free wake adds every shed vortex to the work of every later step
+        sweep_case.cost = isfinite(steps) ? steps * (n + (child["simulation"]["wake"].get<int>() == 0 ? steps : 0.0)) : 0.0;
+        sweep_case.input = child;
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    vector<SweepResult> results;
+    if (!run_sweep_cases(resolved, cases, jobs, results))
+    {
+        return 0; // an MPI worker rank: the results were gathered by rank 0
+    }
+    auto stop = chrono::high_resolution_clock::now();
+
+    ofstream table("output_files/sweep/summary.dat");
+    table << "# case\tworker\twall time [s]\tmean Cl\tCl amplitude\tmean Ct\tCpower mean\tefficiency\tcase" << endl;
+    int failed = 0;
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        const SweepResult &result = results[i];
+        if (!result.completed)
+        {
+            failed++;
+            table << "# ";
+        }
+        table << i << "\t" << result.worker << "\t" << result.wall_time << "\t" << result.metrics.cl_mean << "\t" << result.metrics.cl_amplitude << "\t" << result.metrics.ct_mean << "\t" << result.cpower_mean << "\t" << result.efficiency << "\t" << settings["cases"][i].dump() << endl;
+    }
+    cout << "sweep: " << cases.size() << " cases in " << chrono::duration<double>(stop - start).count() << " s, table in output_files/sweep/summary.dat" << endl;
+    if (failed > 0)
+    {
+        cerr << "Error: " << failed << " of the cases failed (commented out in the table, see their log.txt)" << endl;
+        return 1;
+    }
+    return 0;
+}
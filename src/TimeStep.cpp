@@ -0,0 +1,81 @@
+#include "TimeStep.h"
+#include "VectorOperations.h"
+#include <algorithm>
+#include <cmath>
+
+double next_time_step(TimeStepController &controller, const vector<Body> &bodies, double t, double dt, double t_max, int newton_iterations)
+{
+    if (!controller.adaptive)
+    {
+        return dt;
+    }
+    int nbodies = bodies.size();
+    VectorXd cl(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        cl(b) = bodies[b].cn_tilda;
+    }
+    controller.steps++;
+    if (controller.steps > 1) // the first step has no dphi/dt term and does not belong to the smooth load history
+    {
+        controller.t.push_back(t);
+        controller.cl.push_back(cl);
+    }
+    if (controller.t.size() > 3)
+    {
+        controller.t.erase(controller.t.begin());
+        controller.cl.erase(controller.cl.begin());
+    }
+
+    /* until the load history is available (start transient) the step is held */
+    double dt_next = (controller.t.size() == 3) ? dt * controller.growth : dt;
+
+    /* wake CFL: spacing of the shed vortices below cfl chords */
+    for (int b = 0; b < nbodies; b++)
+    {
+        double speed = magnitude(bodies[b].vtotal_wp_cp);
+        if (speed > 0.0)
+        {
+            dt_next = min(dt_next, controller.cfl * bodies[b].c / speed);
+        }
+    }
+
+    /* Newton: shrink after a hard iteration */
+    if (newton_iterations > controller.newton_iterations)
+    {
+        dt_next = min(dt_next, 0.7 * dt);
+    }
+
+    /* load error: the loads lag by about half a step, i.e. half the change of Cl over the step, O(dt); the rate
+       of change is taken over the last two steps, which averages out the small kink a change of dt leaves in Cl */
+    if (controller.t.size() == 3)
+    {
+        double rate = (controller.cl[2] - controller.cl[0]).cwiseAbs().maxCoeff() / (controller.t[2] - controller.t[0]);
+        double error = 0.5 * rate * dt;
+        if (error > 0.0)
+        {
+            double target = dt * controller.cl_tolerance / error;
+            /* a small deadband above the current step avoids a limit cycle of grow and shrink */
+            if (target < dt || target > dt * controller.growth)
+            {
+                dt_next = min(dt_next, target);
+            }
+            else
+            {
+                dt_next = min(dt_next, dt);
+            }
+        }
+    }
+
+    /* the wake panel length follows dt, so abrupt changes show up in dphi/dt: shrink at most by growth^2 */
+    dt_next = max(dt_next, dt / (controller.growth * controller.growth));
+    dt_next = min(max(dt_next, controller.dt_min), controller.dt_max);
+
+    /* land on t_max instead of stepping over it or leaving a sliver */
+    double remaining = t_max - (t + dt);
+    if (remaining > 0.0 && remaining < 1.5 * dt_next)
+    {
+        dt_next = (remaining > dt_next) ? 0.5 * remaining : remaining;
+    }
+    return dt_next;
+}
@@ -0,0 +1,271 @@
+#include "Treecode.h"
+#include "InfluenceMatrix.h"
+#include "constants.h"
+#include <algorithm>
+#include <stdexcept>
+
+/* three-point Gauss-Legendre rule on [0, 1]: exact far-field moments of a linear panel up to order five */
+static const double gauss_s[3] = {0.5 - 0.5 * 0.7745966692414834, 0.5, 0.5 + 0.5 * 0.7745966692414834};
+static const double gauss_w[3] = {5.0 / 18.0, 8.0 / 18.0, 5.0 / 18.0};
+
+/* orders the panels [begin, end) of tree.panel by recursive bisection of their midpoints and appends the clusters */
+static int build_node(PanelTree &tree, const vector<double> &xm, const vector<double> &ym, const vector<double> &x1, const vector<double> &y1, const vector<double> &x2, const vector<double> &y2, int begin, int end, int leaf_size)
+{
+    int index = tree.nodes.size();
+    tree.nodes.push_back(PanelTreeNode());
+
+    double x_min = xm[tree.panel[begin]], x_max = x_min, y_min = ym[tree.panel[begin]], y_max = y_min;
+    double x_center = 0.0, y_center = 0.0;
+    for (int k = begin; k < end; k++)
+    {
+        int p = tree.panel[k];
+        x_min = min(x_min, xm[p]);
+        x_max = max(x_max, xm[p]);
+        y_min = min(y_min, ym[p]);
+        y_max = max(y_max, ym[p]);
+        x_center += xm[p];
+        y_center += ym[p];
+    }
+    x_center /= (end - begin);
+    y_center /= (end - begin);
+    double radius = 0.0;
+    for (int k = begin; k < end; k++)
+    {
+        int p = tree.panel[k];
+        radius = max(radius, hypot(x1[p] - x_center, y1[p] - y_center));
+        radius = max(radius, hypot(x2[p] - x_center, y2[p] - y_center));
+    }
+
+    PanelTreeNode node;
+    node.x_center = x_center;
+    node.y_center = y_center;
+    node.radius = radius;
+    node.begin = begin;
+    node.end = end;
+    node.child[0] = -1;
+    node.child[1] = -1;
+    if (end - begin > leaf_size)
+    {
+        /* split at the median along the longer side of the bounding box */
+        bool split_x = (x_max - x_min) >= (y_max - y_min);
+        int middle = begin + (end - begin) / 2;
+        nth_element(tree.panel.begin() + begin, tree.panel.begin() + middle, tree.panel.begin() + end, [&](int a, int b)
+                    { return split_x ? xm[a] < xm[b] : ym[a] < ym[b]; });
+        node.child[0] = build_node(tree, xm, ym, x1, y1, x2, y2, begin, middle, leaf_size);
+        node.child[1] = build_node(tree, xm, ym, x1, y1, x2, y2, middle, end, leaf_size);
+    }
+    tree.nodes[index] = node;
+    return index;
+}
+
+void build_panel_tree(const vector<double> &x1, const vector<double> &y1, const vector<double> &x2, const vector<double> &y2, int leaf_size, double theta, int order, PanelTree &tree)
+{
+    size_t m = x1.size();
+    if (y1.size() != m || x2.size() != m || y2.size() != m || leaf_size < 1 || order < 0)
+    {
+        throw invalid_argument("build_panel_tree: inconsistent panel end points, leaf_size < 1 or order < 0");
+    }
+    tree.order = order;
+    tree.theta = theta;
+    tree.nodes.clear();
+    tree.panel.resize(m);
+    vector<double> xm(m), ym(m);
+    for (size_t p = 0; p < m; p++)
+    {
+        tree.panel[p] = p;
+        xm[p] = 0.5 * (x1[p] + x2[p]);
+        ym[p] = 0.5 * (y1[p] + y2[p]);
+    }
+    if (m > 0)
+    {
+        build_node(tree, xm, ym, x1, y1, x2, y2, 0, m, leaf_size);
+    }
+
+    tree.x1.resize(m);
+    tree.y1.resize(m);
+    tree.x2.resize(m);
+    tree.y2.resize(m);
+    for (size_t k = 0; k < m; k++)
+    {
+        tree.x1[k] = x1[tree.panel[k]];
+        tree.y1[k] = y1[tree.panel[k]];
+        tree.x2[k] = x2[tree.panel[k]];
+        tree.y2[k] = y2[tree.panel[k]];
+    }
+    tree.gamma_1.assign(m, 0.0);
+    tree.gamma_2.assign(m, 0.0);
+    tree.moments.assign(tree.nodes.size() * (order + 1), complex<double>(0.0, 0.0));
+}
+
+void set_panel_tree_strengths(PanelTree &tree, const vector<double> &gamma_1, const vector<double> &gamma_2)
+{
+    int m = tree.panel.size();
+    for (int k = 0; k < m; k++)
+    {
+        tree.gamma_1[k] = gamma_1[tree.panel[k]];
+        tree.gamma_2[k] = gamma_2[tree.panel[k]];
+    }
+
+    /* moments of every cluster directly from the Gauss-point vortices of its panels (O(n log n order)) */
+    int terms = tree.order + 1;
+    for (size_t c = 0; c < tree.nodes.size(); c++)
+    {
+        const PanelTreeNode &node = tree.nodes[c];
+        complex<double> center(node.x_center, node.y_center);
+        complex<double> *a = &tree.moments[c * terms];
+        fill(a, a + terms, complex<double>(0.0, 0.0));
+        for (int k = node.begin; k < node.end; k++)
+        {
+            double l = hypot(tree.x2[k] - tree.x1[k], tree.y2[k] - tree.y1[k]);
+            for (int g = 0; g < 3; g++)
+            {
+                double s = gauss_s[g];
+                double strength = gauss_w[g] * l * (tree.gamma_1[k] + (tree.gamma_2[k] - tree.gamma_1[k]) * s);
+                complex<double> dz = complex<double>(tree.x1[k] + s * (tree.x2[k] - tree.x1[k]), tree.y1[k] + s * (tree.y2[k] - tree.y1[k])) - center;
+                complex<double> power(strength, 0.0);
+                for (int p = 0; p < terms; p++)
+                {
+                    a[p] += power;
+                    power *= dz;
+                }
+            }
+        }
+    }
+}
+
+Vector2d panel_tree_velocity(const PanelTree &tree, double x, double y)
+{
+    Vector2d V(0.0, 0.0);
+    if (tree.nodes.empty())
+    {
+        return V;
+    }
+    int terms = tree.order + 1;
+    complex<double> far(0.0, 0.0); // sum_p a_p / (z - z_c)^(p+1) over the accepted clusters
+    complex<double> z(x, y);
+    Vector2d strengths;
+
+    vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        int c = stack.back();
+        stack.pop_back();
+        const PanelTreeNode &node = tree.nodes[c];
+        complex<double> dz = z - complex<double>(node.x_center, node.y_center);
+        double distance = abs(dz);
+        if (node.radius < tree.theta * distance)
+        {
+            const complex<double> *a = &tree.moments[c * terms];
+            complex<double> inverse = 1.0 / dz;
+            complex<double> power = inverse;
+            for (int p = 0; p < terms; p++)
+            {
+                far += a[p] * power;
+                power *= inverse;
+            }
+        }
+        else if (node.child[0] < 0)
+        {
+            for (int k = node.begin; k < node.end; k++)
+            {
+                strengths << tree.gamma_1[k], tree.gamma_2[k];
+                V += influence_matrix(tree.x1[k], tree.y1[k], tree.x2[k], tree.y2[k], x, y) * strengths;
+            }
+        }
+        else
+        {
+            stack.push_back(node.child[0]);
+            stack.push_back(node.child[1]);
+        }
+    }
+
+    /* u - i v = (i / 2 pi) far */
+    complex<double> w = complex<double>(0.0, 1.0 / (2.0 * pi)) * far;
+    V(0) += w.real();
+    V(1) -= w.imag();
+    return V;
+}
+
+void build_tree_projection(const PanelTree &tree, const vector<double> &x, const vector<double> &y, const vector<double> &w_x, const vector<double> &w_y, const vector<int> &row, int rows, TreeProjection &projection)
+{
+    size_t targets = x.size();
+    projection.rows = rows;
+    projection.row = row;
+    projection.w_x = w_x;
+    projection.w_y = w_y;
+    projection.near_start.assign(1, 0);
+    projection.near_panel.clear();
+    projection.near_c1.clear();
+    projection.near_c2.clear();
+    projection.far_start.assign(1, 0);
+    projection.far_node.clear();
+    projection.far_inverse.clear();
+
+    vector<int> stack;
+    for (size_t t = 0; t < targets; t++)
+    {
+        complex<double> z(x[t], y[t]);
+        stack.assign(tree.nodes.empty() ? 0 : 1, 0);
+        while (!stack.empty())
+        {
+            int c = stack.back();
+            stack.pop_back();
+            const PanelTreeNode &node = tree.nodes[c];
+            complex<double> dz = z - complex<double>(node.x_center, node.y_center);
+            if (node.radius < tree.theta * abs(dz))
+            {
+                projection.far_node.push_back(c);
+                projection.far_inverse.push_back(1.0 / dz);
+            }
+            else if (node.child[0] < 0)
+            {
+                for (int k = node.begin; k < node.end; k++)
+                {
+                    MatrixXd P = influence_matrix(tree.x1[k], tree.y1[k], tree.x2[k], tree.y2[k], x[t], y[t]);
+                    projection.near_panel.push_back(k);
+                    projection.near_c1.push_back(w_x[t] * P(0, 0) + w_y[t] * P(1, 0));
+                    projection.near_c2.push_back(w_x[t] * P(0, 1) + w_y[t] * P(1, 1));
+                }
+            }
+            else
+            {
+                stack.push_back(node.child[0]);
+                stack.push_back(node.child[1]);
+            }
+        }
+        projection.near_start.push_back(projection.near_panel.size());
+        projection.far_start.push_back(projection.far_node.size());
+    }
+}
+
+void apply_tree_projection(const PanelTree &tree, const TreeProjection &projection, VectorXd &result)
+{
+    result = VectorXd::Zero(projection.rows);
+    int terms = tree.order + 1;
+    size_t targets = projection.row.size();
+    for (size_t t = 0; t < targets; t++)
+    {
+        double value = 0.0;
+        for (int e = projection.near_start[t]; e < projection.near_start[t + 1]; e++)
+        {
+            int k = projection.near_panel[e];
+            value += projection.near_c1[e] * tree.gamma_1[k] + projection.near_c2[e] * tree.gamma_2[k];
+        }
+        complex<double> far(0.0, 0.0);
+        for (int e = projection.far_start[t]; e < projection.far_start[t + 1]; e++)
+        {
+            const complex<double> *a = &tree.moments[projection.far_node[e] * terms];
+            complex<double> inverse = projection.far_inverse[e];
+            /* Horner: sum_p a_p inverse^(p+1) */
+            complex<double> sum = a[terms - 1];
+            for (int p = terms - 2; p >= 0; p--)
+            {
+                sum = sum * inverse + a[p];
+            }
+            far += sum * inverse;
+        }
+        /* u - i v = (i / 2 pi) far, i.e. u = -Im(far) / 2 pi, v = -Re(far) / 2 pi */
+        value -= (projection.w_x[t] * far.imag() + projection.w_y[t] * far.real()) / (2.0 * pi);
+        result(projection.row[t]) += value;
+    }
+}
@@ -0,0 +1,254 @@
+#include "VtkOutput.h"
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+static bool write_whole_file(const string &filename, const string &contents)
+{
+    ofstream file(filename, ios::binary);
+    file.write(contents.data(), contents.size());
+    file.close();
+    return !file.fail();
+}
+
+static void write_pending(AsyncWriter *writer)
+{
+    unique_lock<mutex> guard(writer->lock);
+    while (true)
+    {
+        writer->changed.wait(guard, [writer]() { return writer->closing || !writer->pending.empty(); });
+        if (writer->pending.empty())
+        {
+            return;
+        }
+        pair<string, string> file = move(writer->pending.front());
+        writer->pending.pop_front();
+        guard.unlock();
+        bool written = write_whole_file(file.first, file.second);
+        guard.lock();
+        writer->pending_bytes -= file.second.size();
+        if (!written && writer->error.empty())
+        {
+            writer->error = "cannot write " + file.first;
+        }
+        writer->changed.notify_all();
+    }
+}
+
+void start_async_writer(AsyncWriter &writer, size_t max_pending_bytes)
+{
+    writer.pending_bytes = 0;
+    writer.max_pending_bytes = max_pending_bytes;
+    writer.closing = false;
+    writer.error.clear();
+    try
+    {
+        writer.worker = thread(write_pending, &writer);
+        writer.threaded = true;
+    }
+    catch (const system_error &)
+    {
+        writer.threaded = false;
+    }
+}
+
+void queue_file(AsyncWriter &writer, const string &filename, string &contents)
+{
+    if (!writer.threaded)
+    {
+        if (!writer.error.empty() || !write_whole_file(filename, contents))
+        {
+            writer.error = writer.error.empty() ? "cannot write " + filename : writer.error;
+            throw runtime_error(writer.error);
+        }
+        return;
+    }
+    unique_lock<mutex> guard(writer.lock);
+    size_t size = contents.size();
+    writer.changed.wait(guard, [&writer, size]() { return writer.pending.empty() || writer.pending_bytes + size <= writer.max_pending_bytes || !writer.error.empty(); });
+    if (!writer.error.empty())
+    {
+        throw runtime_error(writer.error);
+    }
+    writer.pending_bytes += size;
+    writer.pending.push_back(make_pair(filename, move(contents)));
+    writer.changed.notify_all();
+}
+
+void finish_async_writer(AsyncWriter &writer)
+{
+    if (writer.worker.joinable())
+    {
+        {
+            lock_guard<mutex> guard(writer.lock);
+            writer.closing = true;
+        }
+        writer.changed.notify_all();
+        writer.worker.join();
+    }
+    writer.threaded = false;
+    if (!writer.error.empty())
+    {
+        throw runtime_error(writer.error);
+    }
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    if (worker.joinable())
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            closing = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+}
+
+static const char *byte_order()
+{
+    uint16_t one = 1;
+    return (*reinterpret_cast<const char *>(&one) == 1) ? "LittleEndian" : "BigEndian";
+}
+
+/* appends an array (UInt64 byte count, then the raw values) to the appended data and returns its DataArray tag */
+static string data_array(string &appended, const char *type, const string &name, int components, const void *values, size_t bytes)
+{
+    ostringstream tag;
+    tag << "        <DataArray type=\"" << type << "\"";
+    if (!name.empty())
+    {
+        tag << " Name=\"" << name << "\"";
+    }
+    if (components > 1)
+    {
+        tag << " NumberOfComponents=\"" << components << "\"";
+    }
+    tag << " format=\"appended\" offset=\"" << appended.size() << "\"/>\n";
+    uint64_t count = bytes;
+    appended.append(reinterpret_cast<const char *>(&count), sizeof(count));
+    if (bytes > 0)
+    {
+        appended.append(reinterpret_cast<const char *>(values), bytes);
+    }
+    return tag.str();
+}
+
+static string polydata_file(const string &pieces, const string &appended)
+{
+    string file = string("<?xml version=\"1.0\"?>\n<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"") + byte_order() + "\" header_type=\"UInt64\">\n  <PolyData>\n";
+    file += pieces;
+    file += "  </PolyData>\n  <AppendedData encoding=\"raw\">\n   _";
+    file += appended;
+    file += "\n  </AppendedData>\n</VTKFile>\n";
+    return file;
+}
+
+static string airfoil_polydata(const vector<Body> &bodies, bool pressure)
+{
+    string pieces, appended;
+    for (const Body &body : bodies)
+    {
+        int n = body.n;
+        vector<double> points(3 * n);
+        for (int i = 0; i < n; i++)
+        {
+            points[3 * i] = body.panels.x_pp(i);
+            points[3 * i + 1] = body.panels.y_pp(i);
+            points[3 * i + 2] = 0.0;
+        }
+        vector<int64_t> connectivity(2 * (n - 1)), offsets(n - 1);
+        for (int i = 0; i < n - 1; i++)
+        {
+            connectivity[2 * i] = i;
+            connectivity[2 * i + 1] = i + 1;
+            offsets[i] = 2 * (i + 1);
+        }
+        ostringstream piece;
+        piece << "    <Piece NumberOfPoints=\"" << n << "\" NumberOfVerts=\"0\" NumberOfLines=\"" << n - 1 << "\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n";
+        piece << "      <PointData Scalars=\"gamma\">\n";
+        piece << data_array(appended, "Float64", "gamma", 1, body.gamma_bound.data(), n * sizeof(double));
+        piece << "      </PointData>\n";
+        if (pressure)
+        {
+            piece << "      <CellData Scalars=\"cp\">\n";
+            piece << data_array(appended, "Float64", "cp", 1, body.cp.data(), (n - 1) * sizeof(double));
+            piece << data_array(appended, "Float64", "phi", 1, body.phi_airfoil_cps.data(), (n - 1) * sizeof(double));
+            piece << "      </CellData>\n";
+        }
+        piece << "      <Points>\n" << data_array(appended, "Float64", "", 3, points.data(), points.size() * sizeof(double)) << "      </Points>\n";
+        piece << "      <Lines>\n";
+        piece << data_array(appended, "Int64", "connectivity", 1, connectivity.data(), connectivity.size() * sizeof(int64_t));
+        piece << data_array(appended, "Int64", "offsets", 1, offsets.data(), offsets.size() * sizeof(int64_t));
+        piece << "      </Lines>\n    </Piece>\n";
+        pieces += piece.str();
+    }
+    return polydata_file(pieces, appended);
+}
+
+static string wake_polydata(const vector<Body> &bodies, const vector<vector<double>> &wake_birth, double t)
+{
+    string pieces, appended;
+    for (size_t b = 0; b < bodies.size(); b++)
+    {
+        const Body &body = bodies[b];
+        size_t count = body.gamma_wake_strength.size();
+        vector<double> points(3 * count), age(count);
+        vector<int64_t> connectivity(count), offsets(count);
+        for (size_t j = 0; j < count; j++)
+        {
+            points[3 * j] = body.gamma_wake_x_location[j];
+            points[3 * j + 1] = body.gamma_wake_y_location[j];
+            points[3 * j + 2] = 0.0;
+            age[j] = (j < wake_birth[b].size()) ? t - wake_birth[b][j] : numeric_limits<double>::quiet_NaN();
+            connectivity[j] = j;
+            offsets[j] = j + 1;
+        }
+        ostringstream piece;
+        piece << "    <Piece NumberOfPoints=\"" << count << "\" NumberOfVerts=\"" << count << "\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n";
+        piece << "      <PointData Scalars=\"strength\">\n";
+        piece << data_array(appended, "Float64", "strength", 1, body.gamma_wake_strength.data(), count * sizeof(double));
+        piece << data_array(appended, "Float64", "age", 1, age.data(), count * sizeof(double));
+        piece << "      </PointData>\n";
+        piece << "      <Points>\n" << data_array(appended, "Float64", "", 3, points.data(), points.size() * sizeof(double)) << "      </Points>\n";
+        piece << "      <Verts>\n";
+        piece << data_array(appended, "Int64", "connectivity", 1, connectivity.data(), count * sizeof(int64_t));
+        piece << data_array(appended, "Int64", "offsets", 1, offsets.data(), count * sizeof(int64_t));
+        piece << "      </Verts>\n    </Piece>\n";
+        pieces += piece.str();
+    }
+    return polydata_file(pieces, appended);
+}
+
+void write_vtk_step(AsyncWriter &writer, const string &directory, const vector<Body> &bodies, const vector<vector<double>> &wake_birth, int iter, double t, bool pressure, VtkSeries &airfoil, VtkSeries &wake)
+{
+    string airfoil_name = "airfoil_" + to_string(iter) + ".vtp";
+    string wake_name = "wake_" + to_string(iter) + ".vtp";
+    string contents = airfoil_polydata(bodies, pressure);
+    queue_file(writer, directory + "/" + airfoil_name, contents);
+    contents = wake_polydata(bodies, wake_birth, t);
+    queue_file(writer, directory + "/" + wake_name, contents);
+    airfoil.times.push_back(t);
+    airfoil.files.push_back(airfoil_name);
+    wake.times.push_back(t);
+    wake.files.push_back(wake_name);
+}
+
+void write_vtk_series(AsyncWriter &writer, const string &filename, const VtkSeries &series)
+{
+    ostringstream pvd;
+    pvd << "<?xml version=\"1.0\"?>\n<VTKFile type=\"Collection\" version=\"0.1\" byte_order=\"" << byte_order() << "\">\n  <Collection>\n";
+    pvd << setprecision(15);
+    for (size_t i = 0; i < series.files.size(); i++)
+    {
+        pvd << "    <DataSet timestep=\"" << series.times[i] << "\" group=\"\" part=\"0\" file=\"" << series.files[i] << "\"/>\n";
+    }
+    pvd << "  </Collection>\n</VTKFile>\n";
+    string contents = pvd.str();
+    queue_file(writer, filename, contents);
+}
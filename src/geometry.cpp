@@ -1,11 +1,15 @@
 #include "geometry.h"
+#include "Spline.h"
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 /* this function returns the upper and lower coordinates (dimensionalised) of a NACA 4 digit series airfoil for any x/c. */
-MatrixXd geometry(double x_c, double c, double q, double p, int trailing_edge_type, double t_m)
+Matrix<double, 3, 2> geometry(double x_c, double c, double q, double p, int trailing_edge_type, double t_m)
 {
 
-    MatrixXd airfoil_points(3, 2);
+    Matrix<double, 3, 2> airfoil_points;
 
     double yc, der_yc, t;
 
@@ -51,7 +55,7 @@ MatrixXd geometry(double x_c, double c, double q, double p, int trailing_edge_ty
 void nodal_coordinates_initial(int n,double c, double q, double p, int trailing_edge_type, double t_m, VectorXd &x0, VectorXd &y0) // this function basically discretizes the chord in a nonlinear way [COSINE CLUSTERING]
 {
     double theta;
-    MatrixXd panel_points(3, 2);
+    Matrix<double, 3, 2> panel_points;
     double x_nd, delta_theta;
     delta_theta = (2 * pi) / (n - 1);
     ofstream myfile;
@@ -114,71 +118,235 @@ void nodal_coordinates_initial(int n,double c, double q, double p, int trailing_
     }
 }
 
-void nodal_coordinates_instantaneous(int n,double h0,double h1,double phi_h,double x_pitch, double y_pitch,double alpha, double t,double omega,VectorXd &x0, VectorXd &y0, VectorXd &x_pp, VectorXd &y_pp)
+void read_airfoil_coordinates(const string &filename, VectorXd &x, VectorXd &y)
 {
-    ofstream myfile2;
-    myfile2.open("output_files/panel_points_instantaneous.dat");
-    double theta;
-    MatrixXd panel_points(3, 2);
-    double x_nd, delta_theta;
-    delta_theta = (2.0 * pi) / (n - 1);
-    VectorXd inert_temp(2);
+    ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw runtime_error("Cannot open airfoil coordinate file " + filename);
+    }
 
-    for (int i = 0; i < n; i++)
-    {    
-        inert_temp = body_fixed_frame_to_inertial_frame(h0,h1,phi_h,x_pitch,y_pitch,alpha,t,omega,x0(i), y0(i));
-        x_pp(i) = inert_temp(0);
-        y_pp(i) = inert_temp(1);
-        myfile2 << x_pp(i) << "\t" << y_pp(i) << endl;
+    string line;
+    getline(file, line); // airfoil name
+    vector<double> xs, ys;
+    while (getline(file, line))
+    {
+        istringstream pair(line);
+        double a, b;
+        if (pair >> a >> b)
+        {
+            xs.push_back(a);
+            ys.push_back(b);
+        }
     }
-}
 
-/*calculate the control points */
-void controlpoints(int n, VectorXd &x_pp, VectorXd &y_pp, VectorXd &x_cp, VectorXd &y_cp)
-{
-    ofstream myfile3;
-    myfile3.open("output_files/control_points_instantaneous.dat");
-    for (int j = 0; j < (n - 1); j++)
+    vector<double> cx, cy; // contour ordered lower TE -> LE -> upper TE
+    if (!xs.empty() && xs[0] > 1.5 && ys[0] > 1.5)
+    {
+        /* Lednicer: point counts, then upper surface LE -> TE, then lower surface LE -> TE */
+        size_t nu = (size_t)xs[0], nl = (size_t)ys[0];
+        if (xs.size() < 1 + nu + nl)
+        {
+            throw runtime_error("Airfoil file " + filename + " has fewer points than its Lednicer header announces");
+        }
+        for (size_t i = nl; i >= 1; i--)
+        {
+            cx.push_back(xs[nu + i]);
+            cy.push_back(ys[nu + i]);
+        }
+        for (size_t i = 1; i <= nu; i++)
+        {
+            cx.push_back(xs[i]);
+            cy.push_back(ys[i]);
+        }
+    }
+    else
     {
-        x_cp(j) = x_pp(j) - (x_pp(j) - x_pp(j + 1)) / 2;
-        y_cp(j) = y_pp(j) - (y_pp(j) - y_pp(j + 1)) / 2;
-        myfile3 << x_cp(j) << "\t" << y_cp(j) << endl;
+        /* Selig: upper surface TE -> LE -> lower surface TE */
+        for (size_t i = xs.size(); i >= 1; i--)
+        {
+            cx.push_back(xs[i - 1]);
+            cy.push_back(ys[i - 1]);
+        }
+    }
+
+    /* drop repeated points (the leading edge is often listed on both surfaces) */
+    vector<double> ux, uy;
+    for (size_t i = 0; i < cx.size(); i++)
+    {
+        if (ux.empty() || fabs(cx[i] - ux.back()) + fabs(cy[i] - uy.back()) > 1e-12)
+        {
+            ux.push_back(cx[i]);
+            uy.push_back(cy[i]);
+        }
+    }
+    if (ux.size() < 5)
+    {
+        throw runtime_error("Airfoil file " + filename + " does not contain enough coordinates");
+    }
+
+    /* normalise: leading edge at the origin, unit chord */
+    size_t i_le = 0;
+    for (size_t i = 1; i < ux.size(); i++)
+    {
+        if (ux[i] < ux[i_le])
+        {
+            i_le = i;
+        }
+    }
+    double x_le = ux[i_le], y_le = uy[i_le];
+    double chord = 0.5 * (ux.front() + ux.back()) - x_le;
+    x.resize(ux.size());
+    y.resize(ux.size());
+    for (size_t i = 0; i < ux.size(); i++)
+    {
+        x(i) = (ux[i] - x_le) / chord;
+        y(i) = (uy[i] - y_le) / chord;
     }
 }
 
-void panel(int n, VectorXd &l_x, VectorXd &l_y, VectorXd &l, VectorXd &x_pp, VectorXd &y_pp)
+/* arc-length positions of the nodes of one surface, measured from s_le towards s_te, for the given fractions of the surface */
+static vector<double> surface_node_positions(const CubicSpline &sx, const CubicSpline &sy, double s_le, double s_te, const vector<double> &fractions, const string &clustering, double curvature_weight)
 {
-    for (int i = 0; i < n - 1; i++)
+    vector<double> positions(fractions.size());
+    if (clustering == "cosine")
     {
-        l_x(i) = x_pp(i + 1) - x_pp(i);
-        l_y(i) = y_pp(i + 1) - y_pp(i);
-        l(i) = sqrt(l_x(i) * l_x(i) + l_y(i) * l_y(i));
+        /* cosine spacing in x, as for the NACA sections: solve x(s) = x_target by bisection along the surface */
+        double x_le = spline_value(sx, s_le), x_te = spline_value(sx, s_te);
+        for (size_t j = 0; j < fractions.size(); j++)
+        {
+            double x_target = x_le + (x_te - x_le) * 0.5 * (1.0 - cos(pi * fractions[j]));
+            double a = s_le, b = s_te;
+            for (int it = 0; it < 60; it++)
+            {
+                double mid = 0.5 * (a + b);
+                if ((spline_value(sx, mid) - x_target) * (x_te - x_le) < 0.0)
+                {
+                    a = mid;
+                }
+                else
+                {
+                    b = mid;
+                }
+            }
+            positions[j] = 0.5 * (a + b);
+        }
     }
+    else if (clustering == "curvature")
+    {
+        /* cumulative weighted arc length W(s) = int (1 + w |kappa|) ds on a fine sampling of the surface */
+        const int samples = 4000;
+        vector<double> s(samples + 1), W(samples + 1);
+        double density_old = 0.0;
+        for (int k = 0; k <= samples; k++)
+        {
+            s[k] = s_le + (s_te - s_le) * k / samples;
+            double dx = spline_first_derivative(sx, s[k]), dy = spline_first_derivative(sy, s[k]);
+            double ddx = spline_second_derivative(sx, s[k]), ddy = spline_second_derivative(sy, s[k]);
+            double kappa = (dx * ddy - dy * ddx) / pow(dx * dx + dy * dy, 1.5);
+            double density = 1.0 + curvature_weight * fabs(kappa);
+            W[k] = (k == 0) ? 0.0 : W[k - 1] + 0.5 * (density + density_old) * fabs(s[k] - s[k - 1]);
+            density_old = density;
+        }
+        /* cosine spacing in the weighted arc length keeps the end clustering and adds nodes where the surface bends */
+        int k = 0;
+        for (size_t j = 0; j < fractions.size(); j++) // fractions are increasing
+        {
+            double target = 0.5 * (1.0 - cos(pi * fractions[j])) * W[samples];
+            while (k < samples - 1 && W[k + 1] < target)
+            {
+                k++;
+            }
+            double w = (target - W[k]) / (W[k + 1] - W[k]);
+            positions[j] = s[k] + w * (s[k + 1] - s[k]);
+        }
+    }
+    else
+    {
+        throw invalid_argument("Unknown clustering '" + clustering + "' (expected 'cosine' or 'curvature')");
+    }
+    return positions;
 }
 
-void normal_function_for_panels(int n, MatrixXd &unit_normal, VectorXd &l_x, VectorXd &l_y) /*here we are finding the unit normal of n-1 panels*/
+void nodal_coordinates_repaneled(int n, double c, const VectorXd &x_contour, const VectorXd &y_contour, const string &clustering, double curvature_weight, VectorXd &x0, VectorXd &y0)
 {
-    VectorXd panel_length(2);
-    VectorXd unit_normal_vector(2);
-    for (int i = 0; i < n - 1; i++)
+    int m = x_contour.size();
+
+    /* parametrise the contour by its cumulative chord length and fit x(s), y(s) */
+    VectorXd s(m);
+    s(0) = 0.0;
+    for (int i = 1; i < m; i++)
+    {
+        s(i) = s(i - 1) + sqrt(pow(x_contour(i) - x_contour(i - 1), 2) + pow(y_contour(i) - y_contour(i - 1), 2));
+    }
+    CubicSpline sx, sy;
+    fit_cubic_spline(s, x_contour, sx);
+    fit_cubic_spline(s, y_contour, sy);
+
+    /* leading edge: minimum of x(s), refined by Newton iterations on dx/ds = 0 */
+    int i_le = 0;
+    for (int i = 1; i < m; i++)
+    {
+        if (x_contour(i) < x_contour(i_le))
+        {
+            i_le = i;
+        }
+    }
+    double s_le = s(i_le);
+    double s_lo = s(max(i_le - 1, 0)), s_hi = s(min(i_le + 1, m - 1));
+    for (int it = 0; it < 20; it++)
+    {
+        double d2 = spline_second_derivative(sx, s_le);
+        if (d2 <= 0.0)
+        {
+            break;
+        }
+        double step = spline_first_derivative(sx, s_le) / d2;
+        s_le = min(max(s_le - step, s_lo), s_hi);
+        if (fabs(step) < 1e-14 * s(m - 1))
+        {
+            break;
+        }
+    }
+
+    /* fraction of each surface (from the LE) at which nodes are placed, following the even/odd conventions of nodal_coordinates_initial */
+    int m_side = n / 2;
+    vector<double> fractions;
+    for (int j = (n % 2 == 0) ? 1 : 0; j <= m_side; j++)
+    {
+        fractions.push_back((n % 2 == 0) ? (j - 0.5) / (m_side - 0.5) : j / static_cast<double>(m_side));
+    }
+    vector<double> s_lower = surface_node_positions(sx, sy, s_le, 0.0, fractions, clustering, curvature_weight);
+    vector<double> s_upper = surface_node_positions(sx, sy, s_le, s(m - 1), fractions, clustering, curvature_weight);
+
+    int first = (n % 2 == 0) ? 1 : 0;
+    for (size_t k = 0; k < fractions.size(); k++)
     {
-        panel_length(0) = -l_y(i);
-        panel_length(1) = l_x(i);
-        unit_normal_vector = normalize_2d(panel_length);
-        unit_normal(i, 0) = unit_normal_vector(0);
-        unit_normal(i, 1) = unit_normal_vector(1);
+        int j = first + k;
+        x0(m_side - j) = c * spline_value(sx, s_lower[k]); // lower surface, towards the TE with decreasing index
+        y0(m_side - j) = c * spline_value(sy, s_lower[k]);
+        if (j > 0)
+        {
+            x0(n - 1 - m_side + j) = c * spline_value(sx, s_upper[k]); // upper surface
+            y0(n - 1 - m_side + j) = c * spline_value(sy, s_upper[k]);
+        }
+    }
+
+    ofstream myfile("output_files/_time=0.dat");
+    for (int i = 0; i < n; i++)
+    {
+        myfile << x0(i) << "\t" << y0(i) << endl;
     }
 }
-void tangent_function_for_panels(int n, MatrixXd &unit_tangent, VectorXd &l_x, VectorXd &l_y) /*here we are finding the unit normal of n-1 panels*/
+
+void write_panel_geometry(const PanelGeometry &panels, ostream &nodes, ostream &control_points)
 {
-    VectorXd panel_length(2);
-    VectorXd unit_tangent_vector(2);
-    for (int i = 0; i < n - 1; i++)
+    for (int i = 0; i < panels.x_pp.size(); i++)
     {
-        panel_length(0) = l_x(i);
-        panel_length(1) = l_y(i);
-        unit_tangent_vector = normalize_2d(panel_length);
-        unit_tangent(i, 0) = unit_tangent_vector(0);
-        unit_tangent(i, 1) = unit_tangent_vector(1);
+        nodes << panels.x_pp(i) << "\t" << panels.y_pp(i) << endl;
     }
-}
\ No newline at end of file
+    for (int j = 0; j < panels.x_cp.size(); j++)
+    {
+        control_points << panels.x_cp(j) << "\t" << panels.y_cp(j) << endl;
+    }
+}
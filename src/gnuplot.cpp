@@ -1,6 +1,6 @@
 #include "gnuplot.h"
 
-void plot_wake(FILE *gnuplotPipe, const vector<double> &gamma_wake_x_location, const vector<double> &gamma_wake_y_location, double wake_x1, double wake_y1, double wake_x2, double wake_y2, const VectorXd &x_pp, const VectorXd &y_pp,const string &terminal_type)
+void plot_wake(FILE *gnuplotPipe, const vector<Body> &bodies, const string &terminal_type)
 {
     fprintf(gnuplotPipe, "set terminal %s\n", terminal_type.c_str());
     fprintf(gnuplotPipe, "set size ratio -1\n"); // Equal axis scaling
@@ -9,40 +9,68 @@ void plot_wake(FILE *gnuplotPipe, const vector<double> &gamma_wake_x_location, c
     fprintf(gnuplotPipe, "plot '-' title 'Wake Vortices' with points pt 7 ps 1.0 lc rgb 'red', '-' title 'Airfoil Surface' with lines lw 3 lc rgb 'blue'\n");
 
     // Plot wake vortices (Red points)
-    fprintf(gnuplotPipe, "%lf %lf\n", wake_x1, wake_y1);
-    fprintf(gnuplotPipe, "%lf %lf\n", wake_x2, wake_y2);
-    for (size_t k = 0; k < gamma_wake_x_location.size(); k++)
+    for (size_t b = 0; b < bodies.size(); b++)
     {
-        fprintf(gnuplotPipe, "%lf %lf\n", gamma_wake_x_location[k], gamma_wake_y_location[k]);
+        const Body &body = bodies[b];
+        fprintf(gnuplotPipe, "%lf %lf\n", body.wake_panel_coordinates(0, 0), body.wake_panel_coordinates(0, 1));
+        fprintf(gnuplotPipe, "%lf %lf\n", body.wake_panel_coordinates(1, 0), body.wake_panel_coordinates(1, 1));
+        for (size_t k = 0; k < body.gamma_wake_x_location.size(); k++)
+        {
+            fprintf(gnuplotPipe, "%lf %lf\n", body.gamma_wake_x_location[k], body.gamma_wake_y_location[k]);
+        }
     }
     fprintf(gnuplotPipe, "e\n"); // End of first dataset (wake vortices)
 
-    // Plot airfoil (Blue line)
-    for (int i = 0; i < x_pp.size(); i++)
+    // Plot airfoils (Blue lines, a blank line separates the bodies)
+    for (size_t b = 0; b < bodies.size(); b++)
     {
-        fprintf(gnuplotPipe, "%lf %lf\n", x_pp(i), y_pp(i));
+        if (b > 0)
+        {
+            fprintf(gnuplotPipe, "\n");
+        }
+        for (int i = 0; i < bodies[b].panels.x_pp.size(); i++)
+        {
+            fprintf(gnuplotPipe, "%lf %lf\n", bodies[b].panels.x_pp(i), bodies[b].panels.y_pp(i));
+        }
     }
     fprintf(gnuplotPipe, "e\n"); // End of second dataset (airfoil)
     fflush(gnuplotPipe);         // Update plot immediately
 }
 
-void plot_ClvsTime(FILE *gnuplotPipe1, const vector<double> &xdata, const vector<double> &ydata, int ncycles,const string &terminal_type)
+void plot_ClvsTime(FILE *gnuplotPipe1, const vector<double> &xdata, const vector<vector<double>> &ydata, double xmax,const string &terminal_type)
 {
+    static const char *colors[] = {"green", "blue", "red", "orange", "purple", "brown"};
+
     fprintf(gnuplotPipe1, "set terminal %s\n", terminal_type.c_str());
     fprintf(gnuplotPipe1, "set grid\n");
     fprintf(gnuplotPipe1, "set title 'Evolution of lift coefficient with time'\n");
     fprintf(gnuplotPipe1, "set xlabel 't/T'\n");
     fprintf(gnuplotPipe1, "set ylabel 'Cl(t)'\n");
 
-    fprintf(gnuplotPipe1, "set xrange [0:%d]\n",ncycles);
+    fprintf(gnuplotPipe1, "set xrange [0:%g]\n",xmax);
 
     fprintf(gnuplotPipe1, "set terminal %s\n", terminal_type.c_str());
-    fprintf(gnuplotPipe1, "plot '-' with lines lw 3 lc rgb 'green'\n");
+    if (ydata.size() == 1)
+    {
+        fprintf(gnuplotPipe1, "plot '-' with lines lw 3 lc rgb 'green'\n");
+    }
+    else
+    {
+        fprintf(gnuplotPipe1, "plot ");
+        for (size_t b = 0; b < ydata.size(); b++)
+        {
+            fprintf(gnuplotPipe1, "%s'-' title 'body %zu' with lines lw 3 lc rgb '%s'", (b > 0) ? ", " : "", b, colors[b % 6]);
+        }
+        fprintf(gnuplotPipe1, "\n");
+    }
 
-    for (size_t i = 0; i < xdata.size(); i++)
+    for (size_t b = 0; b < ydata.size(); b++)
     {
-        fprintf(gnuplotPipe1, "%lf %lf\n", xdata[i], ydata[i]);
+        for (size_t i = 0; i < xdata.size(); i++)
+        {
+            fprintf(gnuplotPipe1, "%lf %lf\n", xdata[i], ydata[b][i]);
+        }
+        fprintf(gnuplotPipe1, "e\n"); // End of dataset
     }
-    fprintf(gnuplotPipe1, "e\n"); // End of dataset
     fflush(gnuplotPipe1);         // Update plot immediately
 }
@@ -3,8 +3,12 @@
 #include <Eigen/Dense>
 #include <fstream>
 #include <chrono>
+#include <cmath>
 #include <string>
+#include <cstdlib>
+#include <algorithm>
 #include "json.hpp"
+#include "Input.h"
 #include "VectorOperations.h"
 #include "geometry.h"
 #include "MotionParameters.h"
@@ -12,6 +16,23 @@
 #include "InfluenceMatrix.h"
 #include "Amatrix.h"
 #include "NewtonRaphsonNonLinear.h"
+#include "Body.h"
+#include "CoupledSystem.h"
+#include "Loads.h"
+#include "Polar.h"
+#include "Convergence.h"
+#include "HarmonicBalance.h"
+#include "Ensemble.h"
+#include "Sensitivity.h"
+#include "Optimizer.h"
+#include "Sweep.h"
+#include "ImpulseLoads.h"
+#include "Performance.h"
+#include "FlowField.h"
+#include "OutputControl.h"
+#include "VtkOutput.h"
+#include "TimeStep.h"
+#include "Cache.h"
 #include "velocity.h"
 #include "gnuplot.h"
 #include "constants.h"
@@ -20,25 +41,50 @@ using namespace std;
 using namespace Eigen;
 using json = nlohmann::json;
 
-// Helper function to convert double to string without trailing zeros
-string double_to_string(double val, int precision = 3) {
-    ostringstream out;
-    out << fixed << setprecision(precision) << val;
-    string s = out.str();
-    s.erase(s.find_last_not_of('0') + 1, string::npos); 
-    if (s.back() == '.') s.pop_back();
-    return s;
+/* reads the trigger of one per-step output from the "output" block: every step unless a stride or phase step is given */
+OutputTrigger parse_output_trigger(json block, double k)
+{
+    OutputTrigger trigger;
+    trigger.phase_step = optional_setting(block, "phase_step", 0.0);
+    trigger.stride = optional_setting(block, "stride", trigger.phase_step > 0.0 ? 0 : 1);
+    if (trigger.stride < 0 || trigger.phase_step < 0.0)
+    {
+        throw invalid_argument("output strides and phase steps must not be negative");
+    }
+    if (trigger.phase_step > 0.0 && !(k > 0.0))
+    {
+        throw invalid_argument("output phase steps need a periodic motion (k > 0)");
+    }
+    return trigger;
 }
+
 int main(int argc, char *argv[])
 {
    
     if (argc < 2)
     {
-        cerr << "Usage:" << argv[0] << " <input_file.json>" << endl;
+        cerr << "Usage:" << argv[0] << " [polar|converge|harmonic|ensemble|sweep|sensitivity|optimize] <input_file.json>" << endl;
+        cerr << "       " << argv[0] << " unpack <wake_stream.bin>" << endl;
         return 1;
     }
 
-    string filename = argv[1];
+    // Optional mode before the input file: "polar" solves steady polars, "converge" runs a refinement study,
+    // "harmonic" solves for the periodic state of the prescribed wake, "ensemble" marches a sweep of motions
+    // over one factorisation, "sweep" runs a list of cases as separate processes (a local pool or MPI ranks),
+    // "sensitivity" differentiates the cycle means with respect to the kinematic parameters, "optimize" searches
+    // the kinematics of the best efficiency or thrust, default is the unsteady simulation;
+    // "unpack" rebuilds the wake and motion files from an incremental wake stream
+    string mode = (argc >= 3) ? argv[1] : "unsteady";
+    if (mode != "unsteady" && mode != "polar" && mode != "converge" && mode != "harmonic" && mode != "ensemble" && mode != "sweep" && mode != "sensitivity" && mode != "optimize" && mode != "unpack")
+    {
+        cerr << "Error: unknown mode '" << mode << "' (use polar, converge, harmonic, ensemble, sweep, sensitivity, optimize, unpack, or no mode for the unsteady simulation)" << endl;
+        return 1;
+    }
+    string filename = argv[argc - 1];
+    if (mode == "unpack")
+    {
+        return run_unpack(filename);
+    }
     ifstream inputFile(filename);
     if (!inputFile.is_open())
     {
@@ -48,127 +94,577 @@ int main(int argc, char *argv[])
 
     json input;
     inputFile >> input;
+    if (mode == "polar")
+    {
+        return run_polar(input);
+    }
+    if (mode == "converge")
+    {
+        return run_converge(input, argv[0]);
+    }
+    if (mode == "sweep")
+    {
+        return run_sweep(input, argv[0]);
+    }
+    auto wall_start = chrono::high_resolution_clock::now();
 
-    // Extract geometry
+    // Reference geometry and motion: the top-level blocks set the chord and reduced frequency of the time step
     int n = input["geometry"]["n"];
     double c = input["geometry"]["c"];
-    double ymc = input["geometry"]["ymc"];
-    double xmc = input["geometry"]["xmc"];
-    double tmax = input["geometry"]["tmax"];
-    int trailing_edge_type = input["geometry"]["trailing_edge_type"];
-
-    // Derived parameters
-    double p = ymc / 100.0;
-    double q = xmc / 10.0;
-    double t_m = tmax / 100.0;
+    double k = input["motion"]["k"];
 
     // Extract flow
-    double rho = input["flow"]["rho"];
-    double mu = input["flow"]["mu"];
-    double Re = input["flow"]["Re"];
-    double Qinf = input["flow"]["Qinf"].is_null() ? (Re * mu / (rho * c)) : input["flow"]["Qinf"].get<double>();
+    double Qinf = freestream_speed(input["flow"], c);
     double Vinf = input["flow"]["Vinf"];
     VectorXd freestream(2); // size must be specified
     freestream(0) = Qinf;
     freestream(1) = Vinf;
-
-    // Extract motion
-    double k = input["motion"]["k"];
-    double h1 = input["motion"]["h1"].is_null() ? 0.25 * c : input["motion"]["h1"].get<double>();
-    double h0 = input["motion"]["h0"];
-    double alpha0 = input["motion"]["alpha0"].get<double>() * DEG2RAD;
-    double phi_h = input["motion"]["phi_h"].get<double>() * DEG2RAD;
-
-    // alpha1: either use JSON input (if provided) or derive it
-    double alpha1 = input["motion"]["alpha1"].is_null()
-                        ? (15.0 * DEG2RAD - atan2(2.0 * k * h1, c)) // derived
-                        : input["motion"]["alpha1"].get<double>() * DEG2RAD;      // provided
-
-    // Pitch axis: default to mid-chord if not specified
-    double x_pitch = input["motion"]["x_pitch"].is_null() ? c / 3.0 : input["motion"]["x_pitch"].get<double>();
-    double y_pitch = input["motion"]["y_pitch"].is_null() ? 0.0 : input["motion"]["y_pitch"].get<double>();
-
+    // Optional: "start" of the freestream, "impulsive" (default) or a smooth "ramp" from rest over duration seconds
+    MotionChannel inflow = ramp_channel(0.0, 1.0, 0.0, 0.0);
+    string start_type = input["flow"]["start"].is_null() ? "impulsive" : input["flow"]["start"]["type"].get<string>();
+    if (start_type != "impulsive" && start_type != "ramp")
+    {
+        cerr << "Error: unknown flow.start.type '" << start_type << "' (use impulsive or ramp)" << endl;
+        return 1;
+    }
+    if (start_type == "ramp")
+    {
+        inflow = ramp_channel(0.0, 1.0, 0.0, input["flow"]["start"]["duration"].get<double>());
+    }
+    double Qinf_t = Qinf;
 
     // Extract simulation
     int wake = input["simulation"]["wake"];
     double tolerance = input["simulation"]["tolerance"];
     double epsilon = input["simulation"]["epsilon"];
+    // Optional: Newton iterations of the wake panel after which a time step fails (a limit cycle never converges)
+    int max_newton_iterations = optional_setting(input["simulation"], "max_newton_iterations", 100);
+    if (max_newton_iterations < 1)
+    {
+        cerr << "Error: simulation.max_newton_iterations must be at least 1" << endl;
+        return 1;
+    }
     int ncycles = input["simulation"]["ncycles"];
     int nsteps = input["simulation"]["nsteps"];
     int z = input["simulation"]["z"];
     string gnuplot_terminal = input["simulation"]["gnuplot_terminal"].get<std::string>();
+    // Optional: leading-edge potential in "closed_form" (default) or by the stagnation streamline "quadrature" (validation)
+    string phi_le_method = optional_setting<string>(input["simulation"], "phi_le", "closed_form");
+    if (phi_le_method != "closed_form" && phi_le_method != "quadrature")
+    {
+        cerr << "Error: unknown simulation.phi_le '" << phi_le_method << "' (use closed_form or quadrature)" << endl;
+        return 1;
+    }
+    bool phi_le_quadrature = (phi_le_method == "quadrature");
+    // Optional: wake panel of the prescribed wake, iterated by "newton" (default, as the free wake) or "prescribed"
+    // from the trailing-edge trajectory (one linear solve per step, the time-marched limit of the harmonic mode)
+    string wake_panel_method = optional_setting<string>(input["simulation"], "wake_panel", "newton");
+    if (wake_panel_method != "newton" && wake_panel_method != "prescribed")
+    {
+        cerr << "Error: unknown simulation.wake_panel '" << wake_panel_method << "' (use newton or prescribed)" << endl;
+        return 1;
+    }
+    if (wake_panel_method == "prescribed" && wake != 1)
+    {
+        cerr << "Error: simulation.wake_panel = prescribed needs the prescribed wake (simulation.wake = 1)" << endl;
+        return 1;
+    }
+    bool prescribed_wake_panel = (wake_panel_method == "prescribed");
+    // Optional: "solver" block, "direct" (default, dense factorisation), or GMRES for large n with treecode ("gmres")
+    // or H-matrix ("hmatrix") products
+    json solver = input["simulation"]["solver"];
+    string solver_type = solver.is_null() ? "direct" : solver["type"].get<string>();
+    if (solver_type != "direct" && solver_type != "gmres" && solver_type != "hmatrix")
+    {
+        cerr << "Error: unknown simulation.solver.type '" << solver_type << "' (use direct, gmres or hmatrix)" << endl;
+        return 1;
+    }
+    KrylovSettings krylov;
+    krylov.enabled = (solver_type != "direct");
+    krylov.hmatrix = (solver_type == "hmatrix");
+    krylov.eta = optional_setting(solver, "eta", 1.5);
+    krylov.aca_tolerance = optional_setting(solver, "aca_tolerance", 1e-10);
+    krylov.tolerance = optional_setting(solver, "tolerance", 1e-10);
+    krylov.restart = optional_setting(solver, "restart", 50);
+    krylov.max_iterations = optional_setting(solver, "max_iterations", 500);
+    krylov.theta = optional_setting(solver, "theta", 0.5);
+    krylov.order = optional_setting(solver, "order", 16);
+    krylov.leaf_size = optional_setting(solver, "leaf_size", 16);
+    krylov.block_size = optional_setting(solver, "block_size", 128);
     
-    double phi_alpha=(90.0+phi_h)*DEG2RAD;
     double omega =(2.0*k*Qinf)/c;
     double T = 2.0*pi/omega;
-    double dt = T / nsteps;    // time increment
-    double time_max = ncycles * T; // maximum time
-    double t;
-    double alpha_ins;
-
-    // cout << freestream << endl;
-
-    VectorXd x0(n), y0(n), x_pp(n), y_pp(n), x_cp(n - 1), y_cp(n - 1);
-    VectorXd l(n - 1), l_x(n - 1), l_y(n - 1), normal_vector_panel_cp(2);
-    MatrixXd unit_normal(n - 1, 2), unit_tangent(n - 1, 2);
-    MatrixXd A(n, n);
-
-    MatrixXd A_unsteady(n + 1, n + 1);
-    VectorXd B_unsteady(n + 1);
-    VectorXd gamma_unsteady(n + 1);
-    VectorXd gamma_bound(n);
-
-    MatrixXd wake_panel_coordinates(2, 2), panel_coeff_matrix_wake(2, 2);
-    VectorXd wake_panel_cp(2), wake_panel_normal(2);
-    VectorXd wake_influence(n - 1);
-    Vector2d unit_gamma_wake(1, 1);
-    vector<double> gamma_wake_strength;   // create a vector which will store the strengths of the shed vortices
-    vector<double> gamma_wake_x_location; // create vectors which will store the x and y coordinates of the shed vortices[remember that these vectors needs to be updated at the end of each time step]
-    vector<double> gamma_wake_y_location;
-    VectorXd phi_old(n - 1), phi_new(n - 1), cp(n - 1); //[phi old and phi new required for dphi/dt and cp vector stores pressure coefficient at all the control points.]
-
-    VectorXd shed_vel(2), flow_vel(2);
-    double lwp, theta_wp;
-    double lwp_new, theta_wp_new;
-    double gamma_wp = 0.0;
+    // Optional: explicit time step and duration (required for non-periodic motions, k = 0), default nsteps per cycle for ncycles
+    double dt = optional_setting(input["simulation"], "dt", T / nsteps);    // time increment
+    double time_max = optional_setting(input["simulation"], "t_max", ncycles * T); // maximum time
+    if (!(dt > 0.0) || !isfinite(dt) || !isfinite(time_max))
+    {
+        cerr << "Error: a non-periodic motion (k = 0) needs simulation.dt and simulation.t_max" << endl;
+        return 1;
+    }
+    // time axis of the load files: t/T for periodic motions, convective time 2 Qinf t / c otherwise
+    double time_scale = (k > 0.0) ? 1.0 / T : 2.0 * Qinf / c;
+    double t = 0.0;
+    // Optional: "time_step" block, fixed dt (default) or adaptive from the wake spacing, Newton iterations and Cl error
+    json time_step = input["simulation"]["time_step"];
+    TimeStepController controller;
+    controller.adaptive = !time_step.is_null() && time_step["type"].get<string>() == "adaptive";
+    if (!time_step.is_null() && time_step["type"].get<string>() != "adaptive" && time_step["type"].get<string>() != "fixed")
+    {
+        cerr << "Error: unknown simulation.time_step.type '" << time_step["type"].get<string>() << "' (use fixed or adaptive)" << endl;
+        return 1;
+    }
+    controller.cfl = optional_setting(time_step, "cfl", 0.25);
+    controller.dt_min = optional_setting(time_step, "dt_min", 0.1 * dt);
+    controller.dt_max = optional_setting(time_step, "dt_max", 4.0 * dt);
+    controller.newton_iterations = optional_setting(time_step, "newton_iterations", 6);
+    controller.cl_tolerance = optional_setting(time_step, "cl_tolerance", 0.05);
+    controller.growth = optional_setting(time_step, "growth", 1.1);
+    controller.steps = 0;
+    if (controller.adaptive && !(controller.cfl > 0.0 && controller.dt_min > 0.0 && controller.dt_min <= controller.dt_max && controller.cl_tolerance > 0.0 && controller.growth > 1.0))
+    {
+        cerr << "Error: simulation.time_step needs cfl > 0, 0 < dt_min <= dt_max, cl_tolerance > 0 and growth > 1" << endl;
+        return 1;
+    }
     double offset = 1.e-4;
 
-    nodal_coordinates_initial(n, c, q, p, trailing_edge_type, t_m, x0, y0);
+    /* Optional: several bodies (tandem, biplane, flap), each overriding entries of the top-level geometry and motion */
+    vector<Body> bodies;
+    try
+    {
+        if (input["bodies"].is_null())
+        {
+            bodies.push_back(make_body(input["geometry"], input["motion"], json(), Qinf));
+        }
+        else
+        {
+            for (const json &entry : input["bodies"])
+            {
+                json geometry = input["geometry"];
+                json motion = input["motion"];
+                if (entry.contains("geometry"))
+                {
+                    geometry.update(entry["geometry"]);
+                }
+                if (entry.contains("motion"))
+                {
+                    motion.update(entry["motion"]);
+                }
+                bodies.push_back(make_body(geometry, motion, entry.contains("position") ? entry["position"] : json(), Qinf));
+            }
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    if (bodies.empty())
+    {
+        cerr << "Error: \"bodies\" must contain at least one body" << endl;
+        return 1;
+    }
+    int nbodies = bodies.size();
+    for (int b = 0; b < nbodies; b++)
+    {
+        initialize_body(bodies[b], Qinf, dt, !krylov.enabled);
+    }
+    CoupledSystem system;
+    initialize_coupled_system(bodies, system, krylov);
 
-    Vector2d rhs_vector, length_and_angle;
-    Matrix2d jacobian;
-    double delta_lwp, delta_theta_wp;
+    /* Optional: ground plane, free surface or channel walls modelled by images (default unbounded flow) */
+    try
+    {
+        json walls = input["images"];
+        string image_type = optional_setting<string>(walls, "type", "none");
+        double y_lower = optional_setting(walls, "y_lower", 0.0);
+        double y_upper = optional_setting(walls, "y_upper", 0.0);
+        int reflections = optional_setting(walls, "reflections", 5);
+        system.images = make_image_system(image_type, y_lower, y_upper, reflections);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
 
-    double cl = 0.0;
-    double cn_tilda, ca_tilda;
-    double Ct = 0.0;
+    // Optional: "loads" block, "pressure" (default) integrates the unsteady Bernoulli pressure, "impulse" differentiates
+    // the vortex impulse in O(n + N_w) per step, "both" writes the impulse loads next to the pressure loads as a cross-check
+    json loads = input["simulation"]["loads"];
+    string load_method = optional_setting<string>(loads, "method", "pressure");
+    if (load_method != "pressure" && load_method != "impulse" && load_method != "both")
+    {
+        cerr << "Error: unknown simulation.loads.method '" << load_method << "' (use pressure, impulse or both)" << endl;
+        return 1;
+    }
+    if (load_method != "pressure" && (nbodies > 1 || !system.images.transforms.empty()))
+    {
+        cerr << "Error: impulse loads need a single body in an unbounded flow (no bodies list, images type none)" << endl;
+        return 1;
+    }
+    if (load_method != "pressure" && wake == 1)
+    {
+        cerr << "Error: impulse loads need the free wake (simulation.wake = 0): the impulse of a prescribed wake is not force-free" << endl;
+        return 1;
+    }
+    // Optional: online pitching moment, input power and cycle-averaged Ct, Cpower and efficiency from the pressure
+    // loads (default on unless impulse only), and the per-step pressure and potential files (default on)
+    bool performance = optional_setting(loads, "performance", load_method != "impulse");
+    bool pressure_files = optional_setting(loads, "pressure_files", true);
+    if (performance && load_method == "impulse")
+    {
+        cerr << "Error: simulation.loads.performance needs the pressure loads (method pressure or both)" << endl;
+        return 1;
+    }
+    // Optional: "field" block, velocity, pressure and smoothed vorticity on a Cartesian grid at chosen time steps,
+    // written as binary grids to output_files/field/ (default disabled)
+    json field = input["field"];
+    bool field_enabled = optional_setting(field, "enabled", false);
+    FieldSettings field_settings;
+    vector<int> field_steps;
+    int field_every = 0;
+    if (field_enabled)
+    {
+        vector<double> x_range = field["x"].get<vector<double>>(), y_range = field["y"].get<vector<double>>();
+        if (x_range.size() != 3 || y_range.size() != 3)
+        {
+            cerr << "Error: field.x and field.y must be [min, max, number of points]" << endl;
+            return 1;
+        }
+        field_settings.grid.x_min = x_range[0];
+        field_settings.grid.x_max = x_range[1];
+        field_settings.grid.nx = (int)x_range[2];
+        field_settings.grid.y_min = y_range[0];
+        field_settings.grid.y_max = y_range[1];
+        field_settings.grid.ny = (int)y_range[2];
+        field_settings.core_radius = optional_setting(field, "core_radius", 0.02 * c);
+        field_settings.theta = optional_setting(field, "theta", 0.5);
+        field_settings.order = optional_setting(field, "order", 12);
+        field_settings.tile = optional_setting(field, "tile", 16);
+        field_steps = optional_setting(field, "steps", vector<int>());
+        field_every = optional_setting(field, "every", 0);
+        if (::system("mkdir -p output_files/field") != 0)
+        {
+            cerr << "Error: cannot create output_files/field" << endl;
+            return 1;
+        }
+    }
+    // Optional: "probes" block, velocity and pressure at fixed points of the inertial frame every time step,
+    // one row per step in output_files/probes.dat (default none)
+    json probes = input["probes"];
+    vector<double> probe_x, probe_y;
+    FieldSettings probe_settings;
+    if (!probes.is_null() && !probes["points"].is_null())
+    {
+        for (const json &point : probes["points"])
+        {
+            if (point.size() != 2)
+            {
+                cerr << "Error: probes.points must be a list of [x, y] pairs" << endl;
+                return 1;
+            }
+            probe_x.push_back(point[0].get<double>());
+            probe_y.push_back(point[1].get<double>());
+        }
+        probe_settings.core_radius = optional_setting(probes, "core_radius", 0.02 * c);
+        probe_settings.theta = optional_setting(probes, "theta", 0.5);
+        probe_settings.order = optional_setting(probes, "order", 12);
+    }
+    bool probes_enabled = !probe_x.empty();
+    // Optional: "output" block, per-step file triggers (a stride in time steps and/or a phase step in degrees, default
+    // every step), and the "incremental" wake mode: one binary stream of the newly shed vortices and the quantised
+    // motion of the older ones instead of a text file of the whole wake per step (rebuilt by the unpack mode)
+    json output = input["output"];
+    OutputTrigger wake_trigger, motion_trigger, pressure_trigger, potential_trigger, gamma_trigger, a_matrix_trigger, b_vector_trigger, normal_trigger;
+    OutputTrigger vtk_trigger = {0, 0.0};
+    string wake_output = "full";
+    double wake_quantum = 1e-6 * c;
+    try
+    {
+        json wake_block = optional_setting(output, "wake", json());
+        wake_trigger = parse_output_trigger(wake_block, k);
+        motion_trigger = parse_output_trigger(optional_setting(output, "motion", json()), k);
+        pressure_trigger = parse_output_trigger(optional_setting(output, "pressure", json()), k);
+        potential_trigger = parse_output_trigger(optional_setting(output, "potential", json()), k);
+        gamma_trigger = parse_output_trigger(optional_setting(output, "gamma", json()), k);
+        a_matrix_trigger = parse_output_trigger(optional_setting(output, "a_matrix", json()), k);
+        b_vector_trigger = parse_output_trigger(optional_setting(output, "b_vector", json()), k);
+        normal_trigger = parse_output_trigger(optional_setting(output, "airfoil_normal", json()), k);
+        if (!output.is_null() && !output["vtk"].is_null())
+        {
+            vtk_trigger = parse_output_trigger(output["vtk"], k); // VTK files only when requested
+        }
+        wake_output = optional_setting<string>(wake_block, "mode", "full");
+        wake_quantum = optional_setting(wake_block, "quantum", wake_quantum);
+        if (wake_output == "incremental" && (output.is_null() || output["motion"].is_null()))
+        {
+            motion_trigger = wake_trigger; // the stream carries the motion files, at the steps of its records
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    if (wake_output != "full" && wake_output != "incremental")
+    {
+        cerr << "Error: unknown output.wake.mode '" << wake_output << "' (use full or incremental)" << endl;
+        return 1;
+    }
+    bool vtk_enabled = vtk_trigger.stride > 0 || vtk_trigger.phase_step > 0.0;
+    if (vtk_enabled && ::system("mkdir -p output_files/vtk") != 0)
+    {
+        cerr << "Error: cannot create output_files/vtk" << endl;
+        return 1;
+    }
+    if (!pressure_files)
+    {
+        pressure_trigger.stride = 0;
+        pressure_trigger.phase_step = 0.0;
+        potential_trigger = pressure_trigger;
+    }
+    FieldHistory field_history; // previous step for dphi/dt of the field snapshots and the probes
+    field_history.valid = false;
 
-    VectorXd n_capi(2);
-    VectorXd i_cap(2);
-    VectorXd j_cap(2);
+    vector<ImpulseHistory> impulse(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        initialize_impulse_history(bodies[b], impulse[b]);
+    }
 
-    i_cap(0) = 1.0;
-    i_cap(1) = 0.0;
+    if (mode == "harmonic")
+    {
+        if (wake != 1 || !(k > 0.0))
+        {
+            cerr << "Error: harmonic mode needs the prescribed wake (simulation.wake = 1) and a periodic motion (k > 0)" << endl;
+            return 1;
+        }
+        HarmonicBalanceSettings settings;
+        json harmonic = input["harmonic"];
+        settings.harmonics = optional_setting(harmonic, "harmonics", 4);
+        settings.wake_cycles = optional_setting(harmonic, "wake_cycles", 16.0);
+        settings.wake_steps = nsteps;
+        settings.z = z;
+        settings.offset = offset;
+        settings.phi_le_quadrature = phi_le_quadrature;
+        return run_harmonic(bodies, system, freestream, omega, settings, k, n, wall_start);
+    }
 
-    j_cap(0) = 0.0;
-    j_cap(1) = 1.0;
+    if (mode == "ensemble")
+    {
+        if (!input["bodies"].is_null() || !system.images.transforms.empty() || krylov.enabled || controller.adaptive || load_method != "pressure")
+        {
+            cerr << "Error: ensemble mode needs a single body in an unbounded flow, the direct solver, a fixed time step and the pressure loads" << endl;
+            return 1;
+        }
+        EnsembleSettings settings;
+        settings.wake = wake;
+        settings.prescribed_wake_panel = prescribed_wake_panel;
+        settings.epsilon = epsilon;
+        settings.tolerance = tolerance;
+        settings.max_newton_iterations = max_newton_iterations;
+        settings.Qinf = Qinf;
+        settings.Vinf = Vinf;
+        settings.inflow = inflow;
+        settings.z = z;
+        settings.offset = offset;
+        settings.phi_le_quadrature = phi_le_quadrature;
+        return run_ensemble(input, settings, wall_start);
+    }
+    if (mode == "sensitivity" || mode == "optimize")
+    {
+        json motion = input["motion"];
+        if (!input["bodies"].is_null() || !system.images.transforms.empty() || krylov.enabled || controller.adaptive || load_method != "pressure" || !input["simulation"]["dt"].is_null() || !(k > 0.0))
+        {
+            cerr << "Error: " << mode << " mode needs a single body in an unbounded flow, the direct solver, the periodic fixed time step (k > 0) and the pressure loads" << endl;
+            return 1;
+        }
+        if (!motion["plunge"].is_null() || !motion["pitch"].is_null() || !motion["surge"].is_null())
+        {
+            cerr << "Error: " << mode << " mode varies the sinusoidal motion of k, h1, alpha1 and phi_h (no plunge, pitch or surge channels)" << endl;
+            return 1;
+        }
+        PitchPlungeSettings settings;
+        settings.c = c;
+        settings.Qinf = Qinf;
+        settings.Vinf = Vinf;
+        settings.inflow_duration = inflow.duration;
+        settings.nsteps = nsteps;
+        settings.ncycles = ncycles;
+        settings.wake = wake;
+        settings.prescribed_wake_panel = prescribed_wake_panel;
+        settings.epsilon = epsilon;
+        settings.tolerance = tolerance;
+        settings.max_newton_iterations = max_newton_iterations;
+        settings.z = z;
+        settings.offset = offset;
+        settings.phi_le_quadrature = phi_le_quadrature;
+        if (mode == "optimize")
+        {
+            return run_optimize(input, bodies[0], settings, k, wall_start);
+        }
+        return run_sensitivity(bodies[0], settings, k, input["sensitivity"], wall_start);
+    }
 
     ofstream wake_last_time_step, wake_panel, wakefile, motionfile, pressurefile, gammafile, potentialfile, amatrixfile, bvectorfile, airfoilnormalfile;
     
     string motion_type = "pitch_plunge"; //subjected to change manually
-    string myfile_load_cal = "output_files/cl_cd_" + motion_type + "_k=" + double_to_string(k, 3)+ "_n=" + to_string(n)+ ".dat";
-    ofstream file(myfile_load_cal);
+    vector<string> load_files(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        string myfile_load_cal = "cl_cd_" + motion_type + "_k=" + double_to_string(k, 3) + "_n=" + to_string(n);
+        if (nbodies > 1)
+        {
+            myfile_load_cal += "_body" + to_string(b);
+        }
+        load_files[b] = myfile_load_cal + ".dat";
+    }
+    // files of the last time step kept in the cache next to the loads
+    vector<string> result_files = load_files;
+    if (performance)
+    {
+        for (int b = 0; b < nbodies; b++)
+        {
+            result_files.push_back("power_" + load_files[b]);
+            result_files.push_back("performance_" + load_files[b]);
+        }
+    }
+    result_files.push_back("wake at last time step.dat");
+    result_files.push_back("panel_points_instantaneous.dat");
+    result_files.push_back("control_points_instantaneous.dat");
+
+    double iterMax = floor(time_max / dt + 0.5);
+
+    // per window (one period, or the whole run for non-periodic motions) the means of Ct and Cpower; part of the
+    // cached state, so that a resumed run continues its current window bit for bit
+    vector<PerformanceAccumulator> accumulator(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        initialize_performance_accumulator(accumulator[b], (k > 0.0) ? T : time_max);
+    }
+
+    // Optional: "cache" block, content-addressed store of results (default disabled). A repeated input copies the
+    // stored results; a longer run of the same trajectory (fixed time step) resumes from the state of a shorter one
+    json cache = input["cache"];
+    bool cache_enabled = optional_setting(cache, "enabled", false);
+    if (cache_enabled && (field_enabled || probes_enabled || vtk_enabled || wake_output == "incremental"))
+    {
+        cout << "cache: disabled, field snapshots, probe histories, VTK files and the incremental wake stream are not stored in the cache" << endl;
+        cache_enabled = false;
+    }
+    string cache_root = optional_setting<string>(cache, "directory", "pankh_cache");
+    CacheKeys keys;
+    string cached_directory;
+    int first_iter = 0;
+    if (cache_enabled)
+    {
+        keys = cache_keys(input);
+        string directory = cache_entry_directory(cache_root, keys);
+        if (ifstream(directory + "/entry.json").is_open())
+        {
+            for (const string &result : result_files)
+            {
+                if (!copy_file(directory + "/" + result, "output_files/" + result))
+                {
+                    cerr << "Error: cannot copy " << result << " from the cache entry " << directory << endl;
+                    return 1;
+                }
+            }
+            auto wall_stop = chrono::high_resolution_clock::now();
+            cout << "cache: results of " << keys.full << " copied from " << directory << endl;
+            cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
+            return 0;
+        }
+        // the impulse of the previous step is not part of the stored state, so impulse runs start from the beginning
+        if (!controller.adaptive && load_method == "pressure" && find_cache_entry(cache_root, keys, (int)iterMax + 1, cached_directory, first_iter))
+        {
+            try
+            {
+                load_simulation_state(cached_directory + "/state.json", bodies, system, accumulator);
+                for (int b = 0; b < nbodies; b++)
+                {
+                    update_body_geometry(bodies[b], (first_iter - 1) * dt); // geometry of the last cached step
+                }
+            }
+            catch (const exception &e)
+            {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
+            cout << "cache: resuming after " << first_iter << " time steps from " << cached_directory << endl;
+        }
+    }
+
+    vector<ofstream> file(nbodies);
+    for (int b = 0; b < nbodies; b++)
+    {
+        file[b].open("output_files/" + load_files[b]);
+    }
 
     wake_last_time_step.open("output_files/wake at last time step.dat");
     wake_panel.open("output_files/wake panel at last time step.dat");
-
-    /*initial guesses for lwp and theta_wp*/
-    lwp = Qinf * dt;
-    theta_wp = 0.0;
-    double gamma_t_minus_dt;
-    double gamma_old = 0.0;
-    VectorXd vtotal_wp_cp(2);
-    double iterMax = nsteps * ncycles;
+    ofstream impulse_file;
+    if (load_method == "both")
+    {
+        impulse_file.open("output_files/impulse_" + load_files[0]);
+    }
+    double check_cl = 0.0, check_cd = 0.0; // largest differences of the two load paths
+    ofstream probe_file;
+    if (probes_enabled)
+    {
+        probe_file.open("output_files/probes.dat");
+        probe_file << "# probes at";
+        for (size_t p = 0; p < probe_x.size(); p++)
+        {
+            probe_file << " (" << probe_x[p] << ", " << probe_y[p] << ")";
+        }
+        probe_file << endl << "# t/T";
+        for (size_t p = 0; p < probe_x.size(); p++)
+        {
+            probe_file << "\tu_" << p << "\tv_" << p << "\tcp_" << p;
+        }
+        probe_file << endl;
+    }
+    WakeStreamWriter wake_stream;
+    if (wake_output == "incremental")
+    {
+        try
+        {
+            open_wake_stream("output_files/vortex_shedding/wake_stream.bin", bodies, wake_quantum, wake_stream);
+        }
+        catch (const exception &e)
+        {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
+    // airfoil and wake PolyData files written in the background; the ages of the wake vortices count from their shedding
+    AsyncWriter vtk_writer;
+    VtkSeries vtk_airfoil, vtk_wake;
+    vector<vector<double>> wake_birth(nbodies);
+    if (vtk_enabled)
+    {
+        start_async_writer(vtk_writer, (size_t)256 << 20);
+        for (int b = 0; b < nbodies; b++)
+        {
+            for (size_t j = 0; j < bodies[b].gamma_wake_strength.size(); j++)
+            {
+                wake_birth[b].push_back(j * dt); // vortices restored from the cache, one per fixed time step
+            }
+        }
+    }
+    // per step t, Ct, Cm and Cpower; per window the means
+    vector<ofstream> power_file(nbodies), performance_file(nbodies);
+    vector<CyclePerformance> completed;
+    if (performance)
+    {
+        for (int b = 0; b < nbodies; b++)
+        {
+            power_file[b].open("output_files/power_" + load_files[b]);
+            performance_file[b].open("output_files/performance_" + load_files[b]);
+            performance_file[b] << "# cycle\tCt mean\tCt rms\tCpower mean\tCpower rms\tefficiency" << endl;
+        }
+    }
 
     FILE *gnuplotPipe = popen("gnuplot -persist", "w");
     if (!gnuplotPipe)
@@ -186,426 +682,341 @@ int main(int argc, char *argv[])
         return 1;
     }
     vector<double> xdata; // required for real time plotting cl vs t/T
-    vector<double> ydata;
+    vector<vector<double>> ydata(nbodies);
+    if (first_iter > 0)
+    {
+        /* the loads of the cached steps are copied, the per-step files are not regenerated */
+        for (int b = 0; b < nbodies; b++)
+        {
+            ifstream cached_loads(cached_directory + "/" + load_files[b]);
+            string line;
+            for (int i = 0; i < first_iter && getline(cached_loads, line); i++)
+            {
+                file[b] << line << endl;
+                double time_value, cl_value;
+                istringstream row(line);
+                row >> time_value >> cl_value;
+                if (b == 0)
+                {
+                    xdata.push_back(time_value);
+                }
+                ydata[b].push_back(cl_value);
+            }
+            if (performance)
+            {
+                /* the accumulator was restored with the state: the cached windows are copied, not recomputed from the
+                   rounded samples */
+                ifstream cached_power(cached_directory + "/power_" + load_files[b]);
+                for (int i = 0; i < first_iter && getline(cached_power, line); i++)
+                {
+                    power_file[b] << line << endl;
+                }
+                ifstream cached_performance(cached_directory + "/performance_" + load_files[b]);
+                while (getline(cached_performance, line))
+                {
+                    if (!line.empty() && line[0] != '#')
+                    {
+                        performance_file[b] << line << endl;
+                    }
+                }
+            }
+        }
+    }
 
     double prcntgtme;
+    double dt_previous = dt; // the step that led to the current time: the wake panel length and dphi/dt in Bernoulli's equation
+    int newton_iterations;
 
-    for (int iter = 0; iter <= iterMax; iter++)
+    for (int iter = first_iter; controller.adaptive ? t <= time_max * (1.0 + 1e-12) : iter <= iterMax; iter++)
     {
-        prcntgtme = iter / (double)(iterMax) * 100.0;
+        if (!controller.adaptive)
+        {
+            t = iter * dt;
+        }
+        prcntgtme = controller.adaptive ? t / time_max * 100.0 : iter / (double)(iterMax) * 100.0;
         cout << "percentage time completed =" << "\t" << prcntgtme << endl;
-        t = iter * dt;
-        alpha_ins = alpha_instantaneous(alpha0, alpha1, phi_alpha, t, omega);
-        nodal_coordinates_instantaneous(n,h0,h1,phi_h,x_pitch,y_pitch,alpha_ins,t,omega,x0,y0,x_pp,y_pp);
-        controlpoints(n, x_pp, y_pp, x_cp, y_cp);
-        Amatrix(n, A, x_cp, y_cp, x_pp, y_pp);
-        panel(n, l_x, l_y, l, x_pp, y_pp);
-        normal_function_for_panels(n, unit_normal, l_x, l_y);
-        tangent_function_for_panels(n, unit_tangent, l_x, l_y);
-
-        string name = "output_files/vortex_shedding/wake_";
-        name += to_string(iter);
-        name += ".dat";
-        wakefile.open(name.c_str());
-
-        string name1 = "output_files/vortex_shedding/motion_";
-        name1 += to_string(iter);
-        name1 += ".dat";
-        motionfile.open(name1.c_str());
-        for (int i = 0; i < n; i++)
-        {
-            motionfile << x_pp(i) << "\t" << y_pp(i) << endl;
-        }
-        string name2 = "output_files/pressure_file/t_";
-        name2 += to_string(iter);
-        name2 += ".dat";
-        pressurefile.open(name2.c_str());
-
-        string name3 = "output_files/gamma_vector_file/t_";
-        name3 += to_string(iter);
-        name3 += ".dat";
-        gammafile.open(name3.c_str());
-
-        string name4 = "output_files/potential_file/t_";
-        name4 += to_string(iter);
-        name4 += ".dat";
-        potentialfile.open(name4.c_str());
-
-        string name5 = "output_files/a_matrix_file/t_";
-        name5 += to_string(iter);
-        name5 += ".dat";
-        amatrixfile.open(name5.c_str());
-
-        string name6 = "output_files/b_vector_file/t_";
-        name6 += to_string(iter);
-        name6 += ".dat";
-        bvectorfile.open(name6.c_str());
-
-        string name7 = "output_files/airfoil_normal_file/t_";
-        name7 += to_string(iter);
-        name7 += ".dat";
-        airfoilnormalfile.open(name7.c_str());
-
-        for (int i = 0; i < n - 1; i++)
-        {
-            airfoilnormalfile << unit_normal(i, 0) << "\t" << unit_normal(i, 1) << endl;
-        }
-
-        /*self induced portion and kutta conditon...*/
-        for (int i = 0; i < n; i++)
-        {
-            for (int j = 0; j < n; j++)
-            {
-                A_unsteady(i, j) = A(i, j);
-            }
+        // the freestream reached at the end of the step, so that a ramp from rest has already some inflow in the first step
+        double inflow_fraction, inflow_rate;
+        evaluate_channel(inflow, t + dt, inflow_fraction, inflow_rate);
+        Qinf_t = Qinf * inflow_fraction;
+        freestream(0) = Qinf_t;
+        freestream(1) = Vinf * inflow_fraction;
+        for (int b = 0; b < nbodies; b++)
+        {
+            update_body_geometry(bodies[b], t);
         }
-        A_unsteady(n - 1, n) = 1.0; // kutta condition
-        /* Kelvins Circulation [DGAMMA/DT=0.0] */
-        A_unsteady(n, 0) = l(0) * 0.5;
-        for (int i = 1; i < n - 1; i++)
+        /* self-influence blocks are cached, only the inter-body blocks change with the motion */
+        assemble_bound_system(bodies, system);
+
+        /* the per-step files due at this step; the cycles count from the start of the motion */
+        double cycles = (k > 0.0) ? t / T : 0.0;
+        double cycles_previous = (k > 0.0 && iter > 0) ? (t - dt_previous) / T : cycles;
+        bool wake_due = output_due(wake_trigger, iter, cycles, cycles_previous);
+        bool pressure_due = output_due(pressure_trigger, iter, cycles, cycles_previous);
+        bool potential_due = output_due(potential_trigger, iter, cycles, cycles_previous);
+        bool a_matrix_due = output_due(a_matrix_trigger, iter, cycles, cycles_previous);
+        if (wake_due && wake_output == "full")
         {
-            A_unsteady(n, i) = (l(i - 1) + l(i - 1 + 1)) * 0.5;
+            wakefile.open("output_files/vortex_shedding/wake_" + to_string(iter) + ".dat");
+        }
+        if (output_due(motion_trigger, iter, cycles, cycles_previous))
+        {
+            motionfile.open("output_files/vortex_shedding/motion_" + to_string(iter) + ".dat");
+        }
+        if (pressure_due)
+        {
+            pressurefile.open("output_files/pressure_file/t_" + to_string(iter) + ".dat");
+        }
+        if (output_due(gamma_trigger, iter, cycles, cycles_previous))
+        {
+            gammafile.open("output_files/gamma_vector_file/t_" + to_string(iter) + ".dat");
+        }
+        if (potential_due)
+        {
+            potentialfile.open("output_files/potential_file/t_" + to_string(iter) + ".dat");
+        }
+        if (a_matrix_due)
+        {
+            amatrixfile.open("output_files/a_matrix_file/t_" + to_string(iter) + ".dat");
+        }
+        if (output_due(b_vector_trigger, iter, cycles, cycles_previous))
+        {
+            bvectorfile.open("output_files/b_vector_file/t_" + to_string(iter) + ".dat");
+        }
+        if (output_due(normal_trigger, iter, cycles, cycles_previous))
+        {
+            airfoilnormalfile.open("output_files/airfoil_normal_file/t_" + to_string(iter) + ".dat");
         }
-        A_unsteady(n, n - 1) = l(n - 2) * 0.5;
-
-        /* the last column of the A_unsteady matrix will be filled inside the newtonraphson function after calculating the influence of the wake control point..*/
 
-        /*construct the rhs or the B vector */
-        // cout << "flowvelocity " << endl;
-        for (int i = 0; i < n - 1; i++)
+        /* per-body blocks of the step files are separated by a blank line */
+        for (int b = 0; b < nbodies && (motionfile.is_open() || airfoilnormalfile.is_open()); b++)
         {
-            normal_vector_panel_cp(0) = unit_normal(i, 0);
-            normal_vector_panel_cp(1) = unit_normal(i, 1);
-            if (t == 0)
+            if (b > 0)
             {
-                shed_vel(0) = 0.0;
-                shed_vel(1) = 0.0;
+                motionfile << endl;
+                airfoilnormalfile << endl;
             }
-            else
+            for (int i = 0; i < bodies[b].n; i++)
             {
-                shed_vel(0) = 0.0;
-                shed_vel(1) = 0.0;
-                for (size_t j = 0; j < gamma_wake_strength.size(); j++) /* due to the previously shed vortices */
-                {
-                    shed_vel = shed_vel + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[j], gamma_wake_x_location[j], gamma_wake_y_location[j], x_cp(i), y_cp(i));
-                }
+                motionfile << bodies[b].panels.x_pp(i) << "\t" << bodies[b].panels.y_pp(i) << endl;
             }
-            flow_vel = velocity_at_surface_of_the_body_inertial_frame(Qinf, x_pitch, y_pitch, h0, h1, phi_h, alpha0, alpha1, phi_alpha, t, omega, x_cp(i), y_cp(i));
-            // cout << magnitude(flow_vel) << endl;
-
-            B_unsteady(i) = -dot(shed_vel + flow_vel, normal_vector_panel_cp);
-        }
-        B_unsteady(n - 1) = 0.0; /* [kutta condition] */
-
-        VectorXd residuals(2);
-        VectorXd residuals_plus(2);
-        int conv_iter = 0;
-        double convergence;
-
-        cout << "initial guess for the present time step = " << "length = " << lwp << "\t" << "angle = " << theta_wp << endl;
-
-        do
-        {
-            cout << "convergence iteration= " << conv_iter << endl;
-            /*first step is to fill the first column of the Jacobian matrix...*/
-            residuals = newton_raphson(n,dt, t, lwp, theta_wp, freestream, vtotal_wp_cp, x_pp, y_pp, x_cp, y_cp, l, B_unsteady, gamma_unsteady, gamma_old, gamma_bound, gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, wake_panel_cp, wake_panel_normal, A_unsteady, unit_normal, wake_panel_coordinates);
-            jacobian(0, 0) = 0.0;
-            jacobian(0, 1) = 0.0;
-            jacobian(1, 0) = 0.0;
-            jacobian(1, 1) = 0.0;
-            residuals_plus = newton_raphson(n,dt, t, lwp + epsilon, theta_wp, freestream, vtotal_wp_cp, x_pp, y_pp, x_cp, y_cp, l, B_unsteady, gamma_unsteady, gamma_old, gamma_bound, gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, wake_panel_cp, wake_panel_normal, A_unsteady, unit_normal, wake_panel_coordinates);
-
-            jacobian(0, 0) = (residuals_plus(0) - residuals(0)) / epsilon;
-            jacobian(1, 0) = (residuals_plus(1) - residuals(1)) / epsilon;
-
-            residuals_plus = newton_raphson(n,dt, t, lwp, theta_wp + epsilon, freestream, vtotal_wp_cp, x_pp, y_pp, x_cp, y_cp, l, B_unsteady, gamma_unsteady, gamma_old, gamma_bound, gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, wake_panel_cp, wake_panel_normal, A_unsteady, unit_normal, wake_panel_coordinates);
-
-            jacobian(0, 1) = (residuals_plus(0) - residuals(0)) / epsilon;
-            jacobian(1, 1) = (residuals_plus(1) - residuals(1)) / epsilon;
-            cout << "JACOBIAN" << "\t" << endl
-                 << jacobian << endl;
-            /* fill the coefficient matrix or the jacobian matrix */
-            rhs_vector(0) = -residuals(0);
-            rhs_vector(1) = -residuals(1);
-            // length_and_angle = jacobian.colPivHouseholderQr().solve(rhs_vector);
-            length_and_angle = jacobian.partialPivLu().solve(rhs_vector);
-            delta_lwp = length_and_angle(0);
-            delta_theta_wp = length_and_angle(1);
-            convergence = magnitude(length_and_angle);
-            cout << "convergence=" << convergence << endl;
-
-            lwp_new = lwp + delta_lwp;
-            theta_wp_new = theta_wp + delta_theta_wp;
-
-            lwp = lwp_new;
-            theta_wp = theta_wp_new;
-
-            conv_iter++;
-        } while ((convergence) > tolerance);
-        residuals = newton_raphson(n,dt, t, lwp, theta_wp, freestream, vtotal_wp_cp, x_pp, y_pp, x_cp, y_cp, l, B_unsteady, gamma_unsteady, gamma_old, gamma_bound, gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, wake_panel_cp, wake_panel_normal, A_unsteady, unit_normal, wake_panel_coordinates);
-        gamma_wp = gamma_unsteady(n);
-        cout << "CONVERGED VALUES =" << "\t" << "uwp= " << vtotal_wp_cp(0) << "\t" << "vwp=" << vtotal_wp_cp(1) << "\t" << "gamma_wp=" << gamma_wp << "\t" << "lwp=" << lwp << "\t" << "theta_wp=" << theta_wp << endl;
-        cout << "--------------------------------------------------------------------------------------------------------------------- " << endl;
-        gammafile << gamma_unsteady << endl;
-        amatrixfile << A_unsteady << endl;
-        bvectorfile << B_unsteady << endl;
+            for (int i = 0; i < bodies[b].n - 1; i++)
+            {
+                airfoilnormalfile << bodies[b].panels.unit_normal(i, 0) << "\t" << bodies[b].panels.unit_normal(i, 1) << endl;
+            }
+        }
 
-        double gamma_t_minus_dt = 0.0;
-        for (int i = 0; i < n - 1; i++)
+        for (int b = 0; b < nbodies; b++)
         {
-            gamma_t_minus_dt += (gamma_bound(i) + gamma_bound(i + 1)) * l(i) * 0.5;
+            cout << "initial guess for the present time step = " << "length = " << bodies[b].lwp << "\t" << "angle = " << bodies[b].theta_wp << endl;
         }
-        gamma_old = gamma_t_minus_dt;
-
-        /* Once the Iterative Procedure to calculate the length and orientation of the wake panel has converged,we can now calculate the aerodynamic loads ......*/
-
-        /* For that first compute the pressure distribution on the surface of the airfoil and then integrate that pressure to obtain the lift and drag forces ...*/
-        // int z = 200;                               // number of panels..
-        VectorXd x_forward_stag_streamline(z + 1); // z+1 is the number of nodes in forward stagnation streamline.
-        VectorXd y_forward_stag_streamline(z + 1);
-        VectorXd xcp_forward_stag_streamline(z);
-        VectorXd ycp_forward_stag_streamline(z);
-
-        /* now divide this stagnation line into z number of points by sine clustering such that clustering is towards the leading edge */
-        double lz = (10.0 * c);
-
-        for (int i = 0; i < z + 1; i++)
+        try
         {
-            x_forward_stag_streamline(i) = (1.0 - sin(i * 0.5 * pi / z)) * (-lz) + x_pp(n / 2 - 1);
+            /*construct the rhs or the B vector; the wake panel columns are filled inside the newtonraphson function */
+            assemble_right_hand_side(bodies, system, Qinf_t);
+            /* both wake panel models span the step that just ended, over which Kelvin's condition closes */
+            if (prescribed_wake_panel)
+            {
+                /* prescribed wake panel: it follows from the kinematics, one linear solve per time step */
+                for (int b = 0; b < nbodies; b++)
+                {
+                    prescribe_wake_panel(bodies[b], freestream, t, dt_previous, 0.0);
+                }
+                solve_coupled_system(bodies, system);
+                newton_iterations = 0;
+            }
+            else
+            {
+                newton_iterations = converge_wake_panels(bodies, system, dt_previous, freestream, epsilon, tolerance, max_newton_iterations);
+            }
         }
-        // cout << x_pp << endl;
-        //   cout <<x_forward_stag_streamline << endl;
-
-        for (int i = 0; i < z + 1; i++)
+        catch (const exception &e)
         {
-            y_forward_stag_streamline(i) = (1.0 - sin(i * 0.5 * pi / z)) * (0) + y_pp(n / 2 - 1);
+            cerr << "Error: " << e.what() << " at time step " << iter << endl;
+            return 1;
         }
-        /*cal. the control points */
-
-        /*cal. phi_le _at the current time step..*/
-        ofstream fsl;
-        fsl.open("output_files/check_streamline_usptream.dat");
-        for (int i = 0; i < z; i++)
+        for (int b = 0; b < nbodies; b++)
         {
-            xcp_forward_stag_streamline(i) = (x_forward_stag_streamline(i) + x_forward_stag_streamline(i + 1)) / 2.0;
-            ycp_forward_stag_streamline(i) = (y_forward_stag_streamline(i) + y_forward_stag_streamline(i + 1)) / 2.0;
+            const Body &body = bodies[b];
+            cout << "CONVERGED VALUES =" << "\t" << "uwp= " << body.vtotal_wp_cp(0) << "\t" << "vwp=" << body.vtotal_wp_cp(1) << "\t" << "gamma_wp=" << body.gamma_wp << "\t" << "lwp=" << body.lwp << "\t" << "theta_wp=" << body.theta_wp << endl;
         }
-
-        for (int i = 0; i < z + 1; i++)
+        cout << "--------------------------------------------------------------------------------------------------------------------- " << endl;
+        if (gammafile.is_open())
         {
-            fsl << x_forward_stag_streamline(i) << "\t" << y_forward_stag_streamline(i) << endl;
+            gammafile << system.gamma_unsteady << endl;
         }
-
-        /* calculate phi at LE [phi_le(t_k)]*/
-
-        VectorXd wake_panel_strength(2);
-        wake_panel_strength(0) = gamma_wp;
-        wake_panel_strength(1) = gamma_wp;
-
-        VectorXd vifsl_rw(2); // vifsl_rw stands for velocity induced at forward stagnation streamline due to recently shed wake panel
-        VectorXd vifsl_b(2);  // vifsl_b  stands for velocity induced at forward stagnation streamline due to bound vortices
-        VectorXd vifsl_pw(2); // vifsl_pw stands for velocity induced at forward stagnation streamline due to prev. shed wake vortices
-
-        double tang_vel;
-        double phi_le;
-
-        phi_le = 0.0;
-        VectorXd unit_tangent_vector(2);
-
-        for (int i = 0; i < z; i++) // accessing all the control points of the forward stagnation streamline[APPROXIMATED]
+        if (krylov.enabled)
         {
-            panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), xcp_forward_stag_streamline(i), ycp_forward_stag_streamline(i));
-            vifsl_rw = panel_coeff_matrix_wake * wake_panel_strength;
-            vifsl_b = velocity_bound_vortices(n, x_pp, y_pp, xcp_forward_stag_streamline(i), ycp_forward_stag_streamline(i), gamma_bound);
-            if (t == 0)
+            cout << "GMRES: " << system.krylov_iterations << " products, largest relative residual = " << system.krylov_residual;
+            if (krylov.hmatrix)
             {
-                vifsl_pw(0) = 0.0;
-                vifsl_pw(1) = 0.0;
+                cout << ", H-matrix storage = " << 100.0 * hmatrix_storage(system.H) / ((double)system.H.rows * system.H.columns) << " % of dense";
             }
-            else
+            cout << endl;
+        }
+        else if (a_matrix_due)
+        {
+            amatrixfile << coupled_matrix(bodies, system) << endl; // K is not formed on the matrix-free path
+        }
+        if (bvectorfile.is_open())
+        {
+            bvectorfile << coupled_right_hand_side(bodies, system) << endl;
+        }
+
+        for (int b = 0; b < nbodies; b++)
+        {
+            Body &body = bodies[b];
+            double gamma_t_minus_dt = 0.0;
+            for (int i = 0; i < body.n - 1; i++)
             {
-                vifsl_pw(0) = 0.0;
-                vifsl_pw(1) = 0.0;
-                for (size_t j = 0; j < gamma_wake_strength.size(); j++) /* due to the previously shed vortices */
-                {
-                    vifsl_pw = vifsl_pw + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[j], gamma_wake_x_location[j], gamma_wake_y_location[j], xcp_forward_stag_streamline(i), ycp_forward_stag_streamline(i));
-                }
+                gamma_t_minus_dt += (body.gamma_bound(i) + body.gamma_bound(i + 1)) * body.panels.l(i) * 0.5;
             }
-
-            tang_vel = vifsl_rw(0) + vifsl_b(0) + vifsl_pw(0);
-            // cout <<"tangential velcoity"<< endl;
-            // cout << fabs(x_forward_stag_streamline((i + 1)) - x_forward_stag_streamline((i))) << endl;
-            phi_le = phi_le + tang_vel * fabs(x_forward_stag_streamline((i + 1)) - x_forward_stag_streamline((i)));
-            // phi_le =0.0;
+            body.gamma_old = gamma_t_minus_dt;
         }
-        VectorXd phi_airfoil_nodes(n);
-        VectorXd viacp_rw(2); // viacp stands for velocity induced at airfoil control point.
-        VectorXd viacp_b(2);
-        VectorXd viacp_pw(2);
-        // cout << endl <<  A_unsteady << endl;
-
-        /*** now calculate the values of phi for the current time step at all the control points on the AIRFOIL surface ***/
 
-        for (int j = 0; j < n; j++) // scanning all the nodes.
+        /* Once the Iterative Procedure to calculate the length and orientation of the wake panels has converged,we can now calculate the aerodynamic loads ......*/
+        xdata.push_back(t * time_scale);
+        for (int b = 0; b < nbodies; b++)
         {
-            if (j >= 0 && j < (n + 1) / 2 - 1) // lower surface
+            Body &body = bodies[b];
+            if (load_method == "impulse")
             {
-                double addition = 0.0;
-                for (int i = j; i < (n + 1) / 2 - 1; i++) // scanning the control points..
+                compute_impulse_loads(body, impulse[b], dt_previous, Qinf);
+            }
+            else
+            {
+                compute_surface_loads(bodies, system.images, b, iter, dt_previous, Qinf_t, Qinf, z, offset, phi_le_quadrature);
+                if (pressure_due || potential_due)
                 {
-                    panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
-                    viacp_rw = panel_coeff_matrix_wake * wake_panel_strength;
-                    viacp_b = velocity_bound_vortices(n,x_pp, y_pp, x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset, gamma_bound);
-                    if (t == 0)
+                    if (b > 0)
                     {
-                        viacp_pw(0) = 0.0;
-                        viacp_pw(1) = 0.0;
+                        potentialfile << endl;
+                        pressurefile << endl;
                     }
-                    else
+                    for (int i = 0; i < body.n - 1; i++)
                     {
-                        viacp_pw(0) = 0.0;
-                        viacp_pw(1) = 0.0;
-                        for (size_t k = 0; k < gamma_wake_strength.size(); k++) /* due to the previously shed vortices */
-                        {
-                            viacp_pw = viacp_pw + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[k], gamma_wake_x_location[k], gamma_wake_y_location[k], x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
-                        }
+                        potentialfile << body.panels.x_cp(i) << "\t" << body.phi_airfoil_cps(i) << endl;
+                        pressurefile << body.panels.x_cp(i) << "\t" << body.cp(i) << endl;
                     }
-                    unit_tangent_vector(0) = unit_tangent(i, 0); // tangent vector at ith control point
-                    unit_tangent_vector(1) = unit_tangent(i, 1);
-                    tang_vel = dot(unit_tangent_vector, (viacp_rw + viacp_b + viacp_pw));
-
-                    // tang_vel = magnitude(viacp_rw + viacp_b + viacp_pw);
-                    addition = addition + (tang_vel * l(i));
                 }
-                phi_airfoil_nodes(j) = phi_le - addition;
             }
-
-            if ((j > (n + 1) / 2 - 1) && j < (n)) // upper panels
+            if (performance)
             {
-                double addition = 0.0;
-                for (int i = (n + 1) / 2 - 1; i <= j - 1; i++) // scanning the control points
+                double cm, cpower;
+                compute_moment_and_power(body, Qinf, cm, cpower);
+                power_file[b] << t * time_scale << "\t" << -body.ca_tilda << "\t" << cm << "\t" << cpower << endl;
+                add_performance_sample(accumulator[b], t, -body.ca_tilda, cpower, completed);
+                for (const CyclePerformance &cycle : completed)
                 {
-                    panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
-                    viacp_rw = panel_coeff_matrix_wake * wake_panel_strength;
-                    viacp_b = velocity_bound_vortices(n,x_pp, y_pp, x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset, gamma_bound);
-                    if (t == 0)
-                    {
-                        viacp_pw(0) = 0.0;
-                        viacp_pw(1) = 0.0;
-                    }
-                    else
-                    {
-                        viacp_pw(0) = 0.0;
-                        viacp_pw(1) = 0.0;
-                        for (size_t k = 0; k < gamma_wake_strength.size(); k++) /* due to the previously shed vortices */
-                        {
-                            viacp_pw = viacp_pw + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[k], gamma_wake_x_location[k], gamma_wake_y_location[k], x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
-                        }
-                    }
-                    unit_tangent_vector(0) = unit_tangent(i, 0); // tangent vector at ith control point
-                    unit_tangent_vector(1) = unit_tangent(i, 1);
-                    tang_vel = dot(unit_tangent_vector, (viacp_rw + viacp_b + viacp_pw));
-                    addition = addition + (tang_vel * l(i));
+                    performance_file[b] << cycle.cycle << "\t" << cycle.ct_mean << "\t" << cycle.ct_rms << "\t" << cycle.cpower_mean << "\t" << cycle.cpower_rms << "\t" << cycle.efficiency << endl;
+                    cout << "cycle " << cycle.cycle << ((nbodies > 1) ? " body " + to_string(b) : "") << ": Ct mean = " << cycle.ct_mean << ", rms = " << cycle.ct_rms << ", Cpower mean = " << cycle.cpower_mean << ", rms = " << cycle.cpower_rms << ", efficiency = " << cycle.efficiency << endl;
                 }
-                phi_airfoil_nodes(j) = phi_le + addition;
             }
-            if (j == (n + 1) / 2 - 1)
+            if (load_method == "both")
             {
-                phi_airfoil_nodes(j) = phi_le;
+                /* cross-check: the impulse loads go to their own file, the load file keeps the pressure loads */
+                double cn_pressure = body.cn_tilda, ca_pressure = body.ca_tilda;
+                compute_impulse_loads(body, impulse[b], dt_previous, Qinf);
+                impulse_file << t * time_scale << "\t" << body.cn_tilda << "\t" << body.ca_tilda << endl;
+                if (iter > 0)
+                {
+                    check_cl = max(check_cl, fabs(body.cn_tilda - cn_pressure));
+                    check_cd = max(check_cd, fabs(body.ca_tilda - ca_pressure));
+                }
+                body.cn_tilda = cn_pressure;
+                body.ca_tilda = ca_pressure;
             }
-        }
 
-        VectorXd phi_airfoil_cps(n - 1);
-        VectorXd dphi_dt(n - 1);
-        for (int i = 0; i < n - 1; i++) // accessing the control points.
-        {
-            phi_airfoil_cps(i) = (phi_airfoil_nodes(i + 1) + phi_airfoil_nodes(i)) / 2.0;
-        }
-        if (iter == 0)
-        {
-            phi_old = phi_airfoil_cps;
-        }
-        else
-        {
-            phi_new = phi_airfoil_cps;
+            file[b] << t * time_scale << "\t" << body.cn_tilda << "\t" << body.ca_tilda << endl;
+            ydata[b].push_back(body.cn_tilda);
         }
-        for (int i = 0; i < n - 1; i++)
-        {
-            potentialfile << x_cp(i) << "\t" << phi_airfoil_cps(i) << endl;
-        }
-
-        /* calculation of the pressure coefficients at all the control points.. */
-        VectorXd vi(2);
 
-        double V;
-        for (int i = 0; i < n - 1; i++)
+        if (field_enabled)
         {
-            panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
-            viacp_rw = panel_coeff_matrix_wake * wake_panel_strength;
-            viacp_b = velocity_bound_vortices(n,x_pp, y_pp, x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset, gamma_bound);
-            if (iter == 0)
+            /* the listed steps, every field_every steps, or else the last time step only */
+            bool last = controller.adaptive ? t >= time_max * (1.0 - 1e-12) : iter == iterMax;
+            bool snapshot_step = (find(field_steps.begin(), field_steps.end(), iter) != field_steps.end()) || (field_every > 0 && iter % field_every == 0) || (field_steps.empty() && field_every <= 0 && last);
+            if (snapshot_step)
             {
-                viacp_pw(0) = 0.0;
-                viacp_pw(1) = 0.0;
-                dphi_dt(i) = 0.0;
-            }
-            else
-            {
-                viacp_pw(0) = 0.0;
-                viacp_pw(1) = 0.0;
-                for (size_t k = 0; k < gamma_wake_strength.size(); k++) /*........... due to the previously shed vortices.......*/
+                auto field_start = chrono::high_resolution_clock::now();
+                FlowFieldSnapshot snapshot;
+                string field_name = "output_files/field/field_" + to_string(iter) + ".bin";
+                try
+                {
+                    evaluate_flow_field(bodies, system.images, freestream, Qinf, field_history, dt_previous, t, field_settings, snapshot);
+                    write_field_grid(field_name, snapshot);
+                }
+                catch (const exception &e)
                 {
-                    viacp_pw = viacp_pw + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[k], gamma_wake_x_location[k], gamma_wake_y_location[k], x_cp(i) + unit_normal(i, 0) * offset, y_cp(i) + unit_normal(i, 1) * offset);
+                    cerr << "Error: " << e.what() << endl;
+                    return 1;
                 }
-                dphi_dt(i) = ((phi_new(i) - phi_old(i))) / dt;
+                auto field_stop = chrono::high_resolution_clock::now();
+                cout << "field: " << snapshot.u.size() << " points in " << chrono::duration<double>(field_stop - field_start).count() << " s, written to " << field_name << endl;
             }
-
-            flow_vel = velocity_at_surface_of_the_body_inertial_frame(Qinf, x_pitch, y_pitch, h0, h1, phi_h, alpha0, alpha1, phi_alpha, t, omega, x_cp(i), y_cp(i));
-            vi = viacp_rw + viacp_b + viacp_pw + flow_vel;
-            V = magnitude(vi);
-            cp(i) = 1.0 - (V * V) / (Qinf * Qinf) - (2.0 / (Qinf * Qinf)) * (dphi_dt(i));
         }
-        for (int i = 0; i < n - 1; i++)
+        if (probes_enabled)
         {
-            pressurefile << x_cp(i) << "\t" << cp(i) << endl;
+            vector<double> probe_u, probe_v, probe_cp;
+            try
+            {
+                evaluate_flow_points(bodies, system.images, freestream, Qinf, field_history, dt_previous, probe_x, probe_y, probe_settings, probe_u, probe_v, probe_cp);
+            }
+            catch (const exception &e)
+            {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
+            probe_file << t * time_scale;
+            for (size_t p = 0; p < probe_x.size(); p++)
+            {
+                probe_file << "\t" << probe_u[p] << "\t" << probe_v[p] << "\t" << probe_cp[p];
+            }
+            probe_file << endl;
         }
-
-        if (iter > 0)
+        if (field_enabled || probes_enabled)
         {
-            phi_old = phi_new;
+            record_field_history(bodies, field_history);
         }
-        /* calculation of lift and drag */
 
-        cn_tilda = 0.0;
-        ca_tilda = 0.0;
-
-        for (int i = 0; i < n - 1; i++) // scanning the control points...........
+        if (vtk_enabled && output_due(vtk_trigger, iter, cycles, cycles_previous))
         {
-            n_capi(0) = unit_normal(i, 0);
-            n_capi(1) = unit_normal(i, 1);
-            cn_tilda = cn_tilda - (1.0 / c) * cp(i) * l(i) * dot(n_capi, j_cap);
-            ca_tilda = ca_tilda - (1.0 / c) * cp(i) * l(i) * dot(n_capi, i_cap);
+            try
+            {
+                write_vtk_step(vtk_writer, "output_files/vtk", bodies, wake_birth, iter, t, load_method != "impulse", vtk_airfoil, vtk_wake);
+            }
+            catch (const exception &e)
+            {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
         }
-
-        // myfile_load_cal << 2.0*t*Qinf/c  << "\t" << cn_tilda / cl_tilda_steady << "\t" << ca_tilda << endl; //uncomment this for sudden acceleration case.
-        file << t / T << "\t" << cn_tilda << "\t" << ca_tilda << endl;
-
-        xdata.push_back(t / T);
-        ydata.push_back(cn_tilda);
-
-        /*now we need to convect the panel as a discrete vortex for the next time step*/
-        /* so we need to find the local flow velocity or the velocity induced at the control point of the panels.....*/
-
-        for (int i = 0; i < 2; i++)
+        if (wake_due && wake_output == "incremental")
         {
-            wakefile << wake_panel_coordinates(i, 0) << "\t" << wake_panel_coordinates(i, 1) << endl;
+            try
+            {
+                append_wake_stream(wake_stream, bodies, iter, t);
+            }
+            catch (const exception &e)
+            {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
         }
-        for (size_t k = 0; k < gamma_wake_strength.size(); k++) /* due to the previously shed vortices */
+        for (int b = 0; b < nbodies && wakefile.is_open(); b++)
         {
-            wakefile << gamma_wake_x_location[k] << "\t" << gamma_wake_y_location[k] << endl;
+            const Body &body = bodies[b];
+            for (int i = 0; i < 2; i++)
+            {
+                wakefile << body.wake_panel_coordinates(i, 0) << "\t" << body.wake_panel_coordinates(i, 1) << endl;
+            }
+            for (size_t k = 0; k < body.gamma_wake_strength.size(); k++) /* due to the previously shed vortices */
+            {
+                wakefile << body.gamma_wake_x_location[k] << "\t" << body.gamma_wake_y_location[k] << endl;
+            }
         }
-        plot_wake(gnuplotPipe, gamma_wake_x_location, gamma_wake_y_location, wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), x_pp, y_pp,gnuplot_terminal);
-        plot_ClvsTime(gnuplotPipe1, xdata, ydata, ncycles,gnuplot_terminal);
+        plot_wake(gnuplotPipe, bodies, gnuplot_terminal);
+        plot_ClvsTime(gnuplotPipe1, xdata, ydata, time_max * time_scale, gnuplot_terminal);
 
         /***  next task is to propagate the wake point vortices ***/
         /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -615,57 +1026,19 @@ int main(int argc, char *argv[])
         //  IN THIS PROBLEM WE ASSUMED THE CASE OF FREE WAKE MODELLING[where the wake vortices move with the local flow velocity(vel. induced at a  wake point due to other shed vortices,bound vortices and freestream.)] //
         //                                                                                                                                                                                                                 //
         /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-        int size = gamma_wake_x_location.size();
-        VectorXd gamma_wake_x_new_location(size);
-        VectorXd gamma_wake_y_new_location(size);
-        Vector2d velocity;
-        Vector2d vel_wake_point;
-
-        if (iter > 0)
+        convect_wakes(bodies, system.images, freestream, dt, wake);
+        for (int b = 0; b < nbodies && vtk_enabled; b++)
         {
-            for (int j = 0; j < size; j++)
-            {
-                shed_vel(0) = 0.0;
-                shed_vel(1) = 0.0;
-                for (int i = 0; i < size; i++) /* effect of other wake vortices on jth wake point... */
-                {
-                    if (i != j)
-                    {
-                        shed_vel = shed_vel + velocity_induced_due_to_discrete_vortex(gamma_wake_strength[i], gamma_wake_x_location[i], gamma_wake_y_location[i], gamma_wake_x_location[j], gamma_wake_y_location[j]);
-                    }
-                }
-                // cout << shed_vel << endl;
-                /*velocity induced at jth wake point due to bound vortices*/
-                velocity = velocity_bound_vortices(n,x_pp, y_pp, gamma_wake_x_location[j], gamma_wake_y_location[j], gamma_bound);
-                /*********** velocity induced at jth wake point due to wake panel ********/
-                panel_coeff_matrix_wake = influence_matrix(wake_panel_coordinates(0, 0), wake_panel_coordinates(0, 1), wake_panel_coordinates(1, 0), wake_panel_coordinates(1, 1), gamma_wake_x_location[j], gamma_wake_y_location[j]);
-                vel_wake_point = panel_coeff_matrix_wake * wake_panel_strength;
-                /******** free wake ********/
-                if (wake == 0)
-                {
-                    gamma_wake_x_new_location[j] = gamma_wake_x_location[j] + (freestream(0) + shed_vel(0) + velocity(0) + vel_wake_point(0)) * dt;
-                    gamma_wake_y_new_location[j] = gamma_wake_y_location[j] + (freestream(1) + shed_vel(1) + velocity(1) + vel_wake_point(1)) * dt;
-                }
-                else if (wake == 1)
-                {
-                    /******** prescribed wake ********/
-                    gamma_wake_x_new_location[j] = gamma_wake_x_location[j] + (freestream(0)) * dt;
-                    gamma_wake_y_new_location[j] = gamma_wake_y_location[j] + (freestream(1)) * dt;
-                }
-            }
-            for (int j = 0; j < size; j++)
-            {
-                //  cout << setw(10) << fixed << setprecision(5) << j << setw(10) << fixed << setprecision(5) << gamma_wake_x_location[j] << setw(10) << fixed << setprecision(5) << gamma_wake_y_location[j] << setw(10) << fixed << setprecision(5) << gamma_wake_x_new_location[j] << setw(10) << fixed << setprecision(5) << gamma_wake_y_new_location[j] << endl;
-                gamma_wake_x_location[j] = gamma_wake_x_new_location[j];
-                gamma_wake_y_location[j] = gamma_wake_y_new_location[j];
-                // cout << gamma_wake_x_location[j] << "\t" << gamma_wake_y_location[j] << endl;
-            }
+            wake_birth[b].resize(bodies[b].gamma_wake_strength.size(), t); // the panel of this step became a vortex
+        }
+        if (controller.adaptive)
+        {
+            double dt_next = next_time_step(controller, bodies, t, dt, time_max, newton_iterations);
+            cout << "time step = " << dt << ", next = " << dt_next << " (Newton iterations " << newton_iterations << ")" << endl;
+            t += dt;
+            dt_previous = dt;
+            dt = dt_next;
         }
-        gamma_wake_strength.push_back(gamma_wp * lwp);
-        gamma_wake_x_location.push_back(wake_panel_cp(0) + vtotal_wp_cp(0) * dt); /* basically in gamma_wake_x_location and gamma_wake_y_location, we have updated that where the panel shed in the current time step will lie[as a discrete vortex] in the next time step */
-        gamma_wake_y_location.push_back(wake_panel_cp(1) + vtotal_wp_cp(1) * dt);
-        size = gamma_wake_x_new_location.size();
 
         wakefile.close();
         motionfile.close();
@@ -678,16 +1051,78 @@ int main(int argc, char *argv[])
     }
     pclose(gnuplotPipe);
     pclose(gnuplotPipe1);
-    file.close();
+    for (int b = 0; b < nbodies; b++)
+    {
+        file[b].close();
+        power_file[b].close();
+        performance_file[b].close();
+    }
+    probe_file.close();
+    wake_stream.file.close();
+    if (vtk_enabled)
+    {
+        try
+        {
+            write_vtk_series(vtk_writer, "output_files/vtk/airfoil.pvd", vtk_airfoil);
+            write_vtk_series(vtk_writer, "output_files/vtk/wake.pvd", vtk_wake);
+            finish_async_writer(vtk_writer);
+        }
+        catch (const exception &e)
+        {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
     
     /*plotting the flowfield at the last time step.*/
-    for (size_t j = 0; j < gamma_wake_strength.size(); j++)
+    for (int b = 0; b < nbodies; b++)
+    {
+        for (size_t j = 0; j < bodies[b].gamma_wake_strength.size(); j++)
+        {
+            wake_last_time_step << bodies[b].gamma_wake_x_location[j] << "\t" << bodies[b].gamma_wake_y_location[j] << endl;
+        }
+    }
+    ofstream panel_points("output_files/panel_points_instantaneous.dat");
+    ofstream control_points("output_files/control_points_instantaneous.dat");
+    for (int b = 0; b < nbodies; b++)
     {
-        wake_last_time_step << gamma_wake_x_location[j] << "\t" << gamma_wake_y_location[j] << endl;
+        if (b > 0)
+        {
+            panel_points << endl;
+            control_points << endl;
+        }
+        write_panel_geometry(bodies[b].panels, panel_points, control_points);
+    }
+    wake_last_time_step.close();
+    panel_points.close();
+    control_points.close();
+
+    if (cache_enabled)
+    {
+        string directory = cache_entry_directory(cache_root, keys);
+        if (::system(("mkdir -p '" + directory + "'").c_str()) != 0) // system is the coupled system here
+        {
+            cerr << "Error: cannot create the cache entry " << directory << endl;
+            return 1;
+        }
+        for (const string &result : result_files)
+        {
+            copy_file("output_files/" + result, directory + "/" + result);
+        }
+        save_simulation_state(directory + "/state.json", bodies, system, accumulator);
+        int steps = controller.adaptive ? controller.steps : (int)iterMax + 1;
+        complete_cache_entry(directory, keys, steps);
+        cout << "cache: results stored in " << directory << endl;
     }
     // End timer
+    auto wall_stop = chrono::high_resolution_clock::now();
 
-    cout << "The code was run for" << "\t" << ncycles << "cycles" << endl;
+    if (load_method == "both")
+    {
+        cout << "impulse cross-check: largest difference to the pressure loads |dCl| = " << check_cl << ", |dCd| = " << check_cd << " (impulse loads in output_files/impulse_" << load_files[0] << ")" << endl;
+    }
+    cout << "The code was run for" << "\t" << time_max * time_scale << ((k > 0.0) ? "cycles" : " convective times") << endl;
+    cout << "Wall time = " << chrono::duration<double>(wall_stop - wall_start).count() << " s" << endl;
     
 
     return 0;
@@ -2,22 +2,9 @@
 
 
 // THIS FUNCTION CALCULATES THE VELOCITY INDUCED BY THE BOUND VORTICES(AIRFOIL VORTEX PANELS AT ANY RANDOM POINT IN THE FLOWFIELD)
-VectorXd velocity_bound_vortices(int n,VectorXd &x_pp, VectorXd &y_pp, double x, double y, VectorXd G_bound)
+VectorXd velocity_bound_vortices(int n, const VectorXd &x_pp, const VectorXd &y_pp, double x, double y, const VectorXd &G_bound, const ImageSystem &images)
 {
-    VectorXd VEL(2);
-    VEL.setZero();
-
-    MatrixXd P(2, 2);
-    VectorXd vortex_strength(2);
-
-    for (int i = 0; i < n - 1; i++)
-    {
-        P = influence_matrix(x_pp(i), y_pp(i), x_pp(i + 1), y_pp(i + 1), x, y);
-        vortex_strength << G_bound(i), G_bound(i + 1);
-        VEL += (P * vortex_strength);
-    }
-
-    return VEL;
+    return bound_vortex_velocity(n, x_pp, y_pp, x, y, G_bound, images);
 }
 // THIS FUNCTION CALCULATES THE VELOCITY INDUCED AT (des_point_x,des_point_y) BY A  POINT VORTEX OF STRENGTH GAMMA LOCATED AT (vor_point_x,vor_point_y)
 VectorXd velocity_induced_due_to_discrete_vortex(double gamma, double vor_point_x, double vor_point_y, double des_point_x, double des_point_y)
@@ -41,3 +28,33 @@ VectorXd velocity_induced_due_to_discrete_vortex(double gamma, double vor_point_
 
     return V;
 }
+
+// THIS FUNCTION CALCULATES THE VELOCITY INDUCED AT (des_point_x,des_point_y) BY ALL THE SHED WAKE VORTICES (blocked compensated sums, pairwise combined)
+VectorXd velocity_wake_vortices(const vector<double> &gamma_wake_strength, const vector<double> &gamma_wake_x_location, const vector<double> &gamma_wake_y_location, double des_point_x, double des_point_y, const ImageSystem &images, int skip)
+{
+    return wake_vortex_velocity(gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, des_point_x, des_point_y, images, skip);
+}
+
+// THIS FUNCTION CALCULATES THE POTENTIAL AT (des_point_x,des_point_y) OF A POINT VORTEX, ZERO FAR UPSTREAM (branch cut running upstream of the point)
+double potential_due_to_discrete_vortex(double gamma, double vor_point_x, double vor_point_y, double des_point_x, double des_point_y)
+{
+    return point_vortex_potential(gamma, vor_point_x, vor_point_y, des_point_x, des_point_y);
+}
+
+// THIS FUNCTION CALCULATES THE POTENTIAL OF A LINEAR-STRENGTH VORTEX PANEL IN CLOSED FORM
+double potential_linear_vortex_panel(double point1_x, double point1_y, double point2_x, double point2_y, double gamma_1, double gamma_2, double des_point_x, double des_point_y)
+{
+    return linear_vortex_panel_potential(point1_x, point1_y, point2_x, point2_y, gamma_1, gamma_2, des_point_x, des_point_y);
+}
+
+// THIS FUNCTION CALCULATES THE POTENTIAL OF THE BOUND VORTICES (AIRFOIL VORTEX PANELS) AT ANY POINT IN THE FLOWFIELD
+double potential_bound_vortices(int n, const VectorXd &x_pp, const VectorXd &y_pp, double x, double y, const VectorXd &G_bound, const ImageSystem &images)
+{
+    return bound_vortex_potential(n, x_pp, y_pp, x, y, G_bound, images);
+}
+
+// THIS FUNCTION CALCULATES THE POTENTIAL AT (des_point_x,des_point_y) OF ALL THE SHED WAKE VORTICES (blocked compensated sums, pairwise combined)
+double potential_wake_vortices(const vector<double> &gamma_wake_strength, const vector<double> &gamma_wake_x_location, const vector<double> &gamma_wake_y_location, double des_point_x, double des_point_y, const ImageSystem &images)
+{
+    return wake_vortex_potential(gamma_wake_strength, gamma_wake_x_location, gamma_wake_y_location, des_point_x, des_point_y, images);
+}
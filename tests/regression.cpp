@@ -0,0 +1,444 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include "json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Every check runs ./PANKH_solver in its own directory under regression_runs/ and compares outputs of two
+// paths that must agree, each against a stated tolerance.
+
+struct LoadHistory {
+    vector<double> t, cl, cd;
+};
+
+// Reads the t, Cl, Cd columns of a load file (comment lines skipped)
+LoadHistory read_loads(const string& filename) {
+    LoadHistory loads;
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error opening file: " << filename << endl;
+        return loads;
+    }
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        double t, cl, cd;
+        if (sscanf(line.c_str(), "%lf %lf %lf", &t, &cl, &cd) == 3) {
+            loads.t.push_back(t);
+            loads.cl.push_back(cl);
+            loads.cd.push_back(cd);
+        }
+    }
+    return loads;
+}
+
+// Small free-wake pitch-plunge case derived from the test input
+json base_input() {
+    json input;
+    ifstream("tests/input.json") >> input;
+    input["geometry"]["n"] = 41;
+    input["simulation"]["nsteps"] = 40;
+    input["simulation"]["ncycles"] = 2;
+    input["simulation"]["gnuplot_terminal"] = "dumb";
+    return input;
+}
+
+// Writes input.json into regression_runs/<name> and runs the solver there; false if it fails
+bool run_solver(const string& name, const json& input, const string& mode = "") {
+    string directory = "regression_runs/" + name;
+    string command = "rm -rf '" + directory + "' && mkdir -p";
+    for (const char* subdirectory : {"a_matrix_file", "airfoil_normal_file", "b_vector_file", "gamma_vector_file", "potential_file", "pressure_file", "vortex_shedding"}) {
+        command += " '" + directory + "/output_files/" + subdirectory + "'";
+    }
+    if (system(command.c_str()) != 0) {
+        cerr << "Cannot create " << directory << endl;
+        return false;
+    }
+    ofstream(directory + "/input.json") << input.dump(2) << endl;
+    int ret = system(("cd '" + directory + "' && ../../PANKH_solver " + mode + (mode.empty() ? "" : " ") + "input.json > log.txt 2>&1").c_str());
+    if (ret != 0) {
+        cerr << "Solver execution failed with code " << ret << " (see " << directory << "/log.txt)" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Largest |a - b| over the samples from first on; infinity when the lengths differ
+double largest_difference(const vector<double>& a, const vector<double>& b, size_t first = 0) {
+    if (a.size() != b.size() || a.size() <= first) {
+        cerr << "Mismatch in number of samples: " << a.size() << " and " << b.size() << endl;
+        return INFINITY;
+    }
+    double diff = 0.0;
+    for (size_t i = first; i < a.size(); ++i) {
+        diff = fmax(diff, fabs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+bool within(const string& what, double diff, double tolerance) {
+    bool pass = diff <= tolerance;
+    cout << "  " << what << ": |diff| = " << diff << " (tolerance " << tolerance << ")" << (pass ? "" : "  FAILED") << endl;
+    return pass;
+}
+
+// Load file of the check run <name> for n nodes at the reduced frequency k (as printed in the file name)
+string load_file(const string& name, int n, const string& k = "1.2") {
+    return "regression_runs/" + name + "/output_files/cl_cd_pitch_plunge_k=" + k + "_n=" + to_string(n) + ".dat";
+}
+
+// An iterative linear solver against the dense LU at n nodes, every step of the free-wake run
+// (the load files carry 6 digits; GMRES at n = 101 and the H-matrix at n = 401, 57 % of the dense storage, agree
+// with it to 2e-7 and to all digits)
+bool check_linear_solver(const string& type, int n, int ncycles) {
+    json input = base_input();
+    input["geometry"]["n"] = n;
+    input["simulation"]["ncycles"] = ncycles;
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    if (!run_solver("direct", input)) {
+        return false;
+    }
+    input["simulation"]["solver"] = {{"type", type}};
+    if (!run_solver(type, input)) {
+        return false;
+    }
+    LoadHistory direct = read_loads(load_file("direct", n));
+    LoadHistory iterative = read_loads(load_file(type, n));
+    bool pass = within("Cl", largest_difference(direct.cl, iterative.cl), 1e-5);
+    pass = within("Cd", largest_difference(direct.cd, iterative.cd), 1e-5) && pass;
+    return pass;
+}
+
+bool check_gmres() {
+    return check_linear_solver("gmres", 101, 2);
+}
+
+bool check_hmatrix() {
+    return check_linear_solver("hmatrix", 401, 1); // compresses only beyond a few hundred nodes
+}
+
+// Whole content of a file
+string read_file(const string& filename) {
+    ifstream file(filename);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+// Two cycles resumed from the cached state of one cycle against an uninterrupted run, bit for bit
+bool check_cache_resume() {
+    json input = base_input();
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    if (!run_solver("uninterrupted", input)) {
+        return false;
+    }
+    if (system("rm -rf regression_runs/cache_store") != 0) {
+        return false;
+    }
+    input["cache"] = {{"enabled", true}, {"directory", "../cache_store"}};
+    input["simulation"]["ncycles"] = 1;
+    if (!run_solver("cached", input)) {
+        return false;
+    }
+    input["simulation"]["ncycles"] = 2;
+    if (!run_solver("resumed", input)) {
+        return false;
+    }
+    bool resumed = read_file("regression_runs/resumed/log.txt").find("cache: resuming after 41 time steps") != string::npos;
+    cout << "  resumed from the cached cycle: " << (resumed ? "yes" : "no  FAILED") << endl;
+    bool identical = true;
+    for (const char* prefix : {"", "power_", "performance_"}) {
+        string file = "/output_files/" + string(prefix) + "cl_cd_pitch_plunge_k=1.2_n=41.dat";
+        string reference = read_file("regression_runs/uninterrupted" + file);
+        bool same = !reference.empty() && reference == read_file("regression_runs/resumed" + file);
+        cout << "  " << prefix << "load file identical: " << (same ? "yes" : "no  FAILED") << endl;
+        identical = identical && same;
+    }
+    return resumed && identical;
+}
+
+// All numbers of a text file, in order
+vector<double> read_numbers(const string& filename) {
+    vector<double> numbers;
+    ifstream file(filename);
+    double value;
+    while (file >> value) {
+        numbers.push_back(value);
+    }
+    return numbers;
+}
+
+// The pitch angle of the airfoil in the motion files against alpha1 sin(omega t + 90 deg + phi_h), every step of a
+// cycle with phi_h = 30 deg (the files carry 6 digits: 8e-7 rad when measured)
+bool check_pitch_phase() {
+    const double pi = acos(-1.0);
+    json input = base_input();
+    input["simulation"]["ncycles"] = 1;
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    input["motion"]["alpha1"] = 10.0;
+    input["motion"]["phi_h"] = 30.0;
+    if (!run_solver("pitch_phase", input)) {
+        return false;
+    }
+    double c = input["geometry"]["c"], k = input["motion"]["k"];
+    double qinf = input["flow"]["Re"].get<double>() * input["flow"]["mu"].get<double>() / (input["flow"]["rho"].get<double>() * c);
+    double omega = 2.0 * k * qinf / c;
+    int nsteps = input["simulation"]["nsteps"];
+    double dt = 2.0 * pi / omega / nsteps;
+    double diff = 0.0;
+    for (int iter = 0; iter <= nsteps; ++iter) {
+        vector<double> xy = read_numbers("regression_runs/pitch_phase/output_files/vortex_shedding/motion_" + to_string(iter) + ".dat");
+        if (xy.size() < 4) {
+            cerr << "No airfoil nodes in the motion file of step " << iter << endl;
+            return false;
+        }
+        // the first node is the trailing edge, the leading edge is the node farthest from it
+        size_t le = 0;
+        for (size_t i = 0; i + 1 < xy.size(); i += 2) {
+            if (hypot(xy[i] - xy[0], xy[i + 1] - xy[1]) > hypot(xy[le] - xy[0], xy[le + 1] - xy[1])) {
+                le = i;
+            }
+        }
+        // a positive pitch turns the chord clockwise
+        double alpha = atan2(xy[le + 1] - xy[1], xy[0] - xy[le]);
+        diff = fmax(diff, fabs(alpha - 10.0 * pi / 180.0 * sin(omega * iter * dt + (90.0 + 30.0) * pi / 180.0)));
+    }
+    return within("pitch angle", diff, 1e-5);
+}
+
+// Every case of an ensemble against a separate run of it, bit for bit
+bool check_ensemble() {
+    const char* frequencies[] = {"0.8", "1.2", "1.6"};
+    json input = base_input();
+    input["simulation"]["ncycles"] = 1;
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    json cases = json::array();
+    for (const char* k : frequencies) {
+        cases.push_back({{"motion", {{"k", stod(k)}}}});
+    }
+    json ensemble = input;
+    ensemble["ensemble"] = {{"cases", cases}};
+    if (!run_solver("ensemble", ensemble, "ensemble")) {
+        return false;
+    }
+    bool pass = true;
+    for (int i = 0; i < 3; ++i) {
+        json single = input;
+        single["motion"]["k"] = stod(frequencies[i]);
+        string name = "single_k=" + string(frequencies[i]);
+        if (!run_solver(name, single)) {
+            return false;
+        }
+        string reference = read_file(load_file(name, 41, frequencies[i]));
+        bool same = !reference.empty() && reference == read_file("regression_runs/ensemble/output_files/ensemble/cl_cd_case" + to_string(i) + ".dat");
+        cout << "  case " << i << " (k = " << frequencies[i] << ") identical to its separate run: " << (same ? "yes" : "no  FAILED") << endl;
+        pass = pass && same;
+    }
+    return pass;
+}
+
+// The five derivatives of the rows of a quantity in a sensitivity log: the forward-mode ones, then the central
+// differences (each row ends with the derivatives with respect to k, h1, alpha1, phi_h and x_pitch)
+vector<vector<double>> sensitivity_rows(const string& log, const string& quantity) {
+    vector<vector<double>> rows;
+    istringstream lines(log);
+    string line;
+    while (getline(lines, line)) {
+        if (line.compare(0, quantity.size() + 1, quantity + "\t") != 0) {
+            continue;
+        }
+        vector<double> fields;
+        istringstream row(line.substr(quantity.size()));
+        double value;
+        while (row >> value) {
+            fields.push_back(value);
+        }
+        if (fields.size() >= 5) {
+            rows.push_back(vector<double>(fields.end() - 5, fields.end()));
+        }
+    }
+    return rows;
+}
+
+// The forward-mode kinematic derivatives of the last cycle against central differences of plain marches,
+// relative to the largest derivative of each quantity (they agree to 5e-7 when measured)
+bool check_sensitivity() {
+    json input = base_input();
+    input["motion"]["alpha1"] = 10.0;
+    input["motion"]["phi_h"] = 30.0;
+    input["sensitivity"] = {{"check_step", 1e-4}};
+    if (!run_solver("sensitivity", input, "sensitivity")) {
+        return false;
+    }
+    string log = read_file("regression_runs/sensitivity/log.txt");
+    bool pass = true;
+    for (const char* quantity : {"Ct mean", "Cpower mean", "efficiency"}) {
+        vector<vector<double>> rows = sensitivity_rows(log, quantity);
+        if (rows.size() != 2) {
+            cerr << "No derivatives and central differences of " << quantity << " in regression_runs/sensitivity/log.txt" << endl;
+            return false;
+        }
+        double scale = 0.0;
+        for (double derivative : rows[0]) {
+            scale = fmax(scale, fabs(derivative));
+        }
+        pass = within(string(quantity) + " derivatives (relative)", largest_difference(rows[0], rows[1]) / scale, 1e-4) && pass;
+    }
+    return pass;
+}
+
+// Numbers of the data rows of a table (comment lines skipped)
+vector<vector<double>> read_rows(const string& filename) {
+    vector<vector<double>> rows;
+    ifstream file(filename);
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        vector<double> row;
+        istringstream fields(line);
+        double value;
+        while (fields >> value) {
+            row.push_back(value);
+        }
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+// The last-cycle mean Ct, mean Cpower and efficiency of the plain march of the sensitivity and optimize modes (the
+// start candidate of a one-generation optimize run) against the performance file of the unsteady solver, with
+// alpha1 = 10 deg and phi_h = 30 deg (both print 6 digits and agree to all of them when measured)
+bool check_march() {
+    json input = base_input();
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    input["motion"]["alpha1"] = 10.0;
+    input["motion"]["phi_h"] = 30.0;
+    if (!run_solver("unsteady", input)) {
+        return false;
+    }
+    input["optimize"] = {{"bounds", {{"k", {1.0, 1.4}}}}, {"generations", 1}, {"population", 2}, {"jobs", 1}};
+    if (!run_solver("march", input, "optimize")) {
+        return false;
+    }
+    vector<vector<double>> cycles = read_rows("regression_runs/unsteady/output_files/performance_cl_cd_pitch_plunge_k=1.2_n=41.dat");
+    vector<vector<double>> candidates = read_rows("regression_runs/march/output_files/optimize.dat");
+    if (cycles.size() != 2 || cycles.back().size() != 6 || candidates.empty() || candidates[0].size() != 9 || candidates[0][0] != 0.0) {
+        cerr << "No last cycle in the performance file or no start candidate in optimize.dat" << endl;
+        return false;
+    }
+    bool pass = true;
+    const char* quantities[] = {"Ct mean", "Cpower mean", "efficiency"};
+    for (int q = 0; q < 3; ++q) {
+        double unsteady = cycles.back()[1 + 2 * q], march = candidates[0][6 + q];
+        pass = within(string(quantities[q]) + " (relative)", fabs(march - unsteady) / fabs(unsteady), 1e-5) && pass;
+    }
+    return pass;
+}
+
+// The wake and motion files rebuilt from the incremental wake stream against those of a full run, every
+// 5 steps (6 printed digits and half a quantum, 1e-7 m)
+bool check_wake_stream() {
+    json input = base_input();
+    input["simulation"]["loads"] = {{"pressure_files", false}};
+    input["output"] = {{"wake", {{"stride", 5}}}};
+    if (!run_solver("wake_full", input)) {
+        return false;
+    }
+    input["output"]["wake"]["mode"] = "incremental";
+    if (!run_solver("wake_stream", input)) {
+        return false;
+    }
+    if (system("cd regression_runs/wake_stream && ../../PANKH_solver unpack output_files/vortex_shedding/wake_stream.bin >> log.txt 2>&1") != 0) {
+        cerr << "Unpack failed (see regression_runs/wake_stream/log.txt)" << endl;
+        return false;
+    }
+    double wake_diff = 0.0, motion_diff = 0.0;
+    for (int iter = 0; iter <= 80; iter += 5) {
+        string wake = "/output_files/vortex_shedding/wake_" + to_string(iter) + ".dat";
+        string motion = "/output_files/vortex_shedding/motion_" + to_string(iter) + ".dat";
+        wake_diff = fmax(wake_diff, largest_difference(read_numbers("regression_runs/wake_full" + wake), read_numbers("regression_runs/wake_stream" + wake)));
+        motion_diff = fmax(motion_diff, largest_difference(read_numbers("regression_runs/wake_full" + motion), read_numbers("regression_runs/wake_stream" + motion)));
+    }
+    bool pass = within("wake positions", wake_diff, 2e-6);
+    pass = within("motion", motion_diff, 2e-6) && pass;
+    return pass;
+}
+
+// Vortex-impulse loads against the pressure loads over the second cycle of a free-wake plunge
+// (n = 101, 80 steps per cycle: 0.017 in Cl, 0.076 in Cd and 0.014 in mean Ct when measured)
+bool check_impulse_loads() {
+    json input = base_input();
+    input["geometry"]["n"] = 101;
+    input["motion"]["alpha1"] = 0.0;
+    input["simulation"]["nsteps"] = 80;
+    input["simulation"]["loads"] = {{"method", "both"}, {"pressure_files", false}};
+    if (!run_solver("impulse", input)) {
+        return false;
+    }
+    LoadHistory pressure = read_loads(load_file("impulse", 101));
+    LoadHistory impulse = read_loads("regression_runs/impulse/output_files/impulse_cl_cd_pitch_plunge_k=1.2_n=101.dat");
+    size_t first = 81; // the second cycle
+    double ct_pressure = 0.0, ct_impulse = 0.0;
+    for (size_t i = first; i < pressure.cd.size() && i < impulse.cd.size(); ++i) {
+        ct_pressure -= pressure.cd[i] / (pressure.cd.size() - first);
+        ct_impulse -= impulse.cd[i] / (impulse.cd.size() - first);
+    }
+    bool pass = within("Cl", largest_difference(pressure.cl, impulse.cl, first), 0.025);
+    pass = within("Cd", largest_difference(pressure.cd, impulse.cd, first), 0.1) && pass;
+    pass = within("mean Ct", fabs(ct_pressure - ct_impulse), 0.025) && pass;
+    return pass;
+}
+
+int main(int argc, char* argv[]) {
+    // checks by name; all of them without arguments
+    vector<pair<string, bool (*)()>> checks = {
+        {"gmres", check_gmres},
+        {"hmatrix", check_hmatrix},
+        {"cache", check_cache_resume},
+        {"pitch_phase", check_pitch_phase},
+        {"ensemble", check_ensemble},
+        {"sensitivity", check_sensitivity},
+        {"march", check_march},
+        {"wake_stream", check_wake_stream},
+        {"impulse", check_impulse_loads},
+    };
+
+    bool pass = true;
+    int run = 0;
+    for (const auto& check : checks) {
+        bool selected = (argc < 2);
+        for (int a = 1; a < argc; ++a) {
+            selected = selected || (check.first == argv[a]);
+        }
+        if (!selected) {
+            continue;
+        }
+        cout << "Check " << check.first << endl;
+        bool passed = check.second();
+        cout << "  " << (passed ? "passed" : "FAILED") << endl;
+        pass = pass && passed;
+        ++run;
+    }
+
+    if (run == 0) {
+        cerr << "Usage: " << argv[0] << " [check ...]" << endl;
+        return 1;
+    }
+    if (pass) {
+        cout << "Regression Passed: " << run << " checks within their tolerances" << endl;
+        return 0;
+    } else {
+        cerr << "Regression Failed: some checks exceeded their tolerances." << endl;
+        return 1;
+    }
+}